@@ -36,9 +36,15 @@ typedef enum { X_CORD, Y_CORD, Z_CORD } TYPE_OF_CORD;
 #define AX_DIMEN 3         ///< Axises dimensional for X Y Z
 #define BUFFER_SIZE 65536  ///< Size of buffer to reading file into RAM
 #define MAX_POWER 20       ///< Max power for float parsing
+#define MAX_THREADS 64     ///< Upper limit of worker threads in backend
 
 typedef unsigned int u_int;  ///< alias of type unsigned int
 
+/**
+ * @brief  Collection of weightings for smooth vertex normals
+ */
+typedef enum { NORMALS_AREA_WEIGHTED, NORMALS_ANGLE_WEIGHTED } NORMALS_WEIGHTING;
+
 /**
  * @brief Data about indexes for polygons
  *
@@ -71,6 +77,9 @@ typedef struct {
   u_int faces_count;     ///< count of faces
   u_int total_indexes;   ///< total count of indices
   float* vertexes;       ///< 1-dimensional array of vertexes
+  float* normals;  ///< per-vertex unit normals, 3 floats per vertex in the
+                   ///< same order as vertexes, NULL until computed
+  u_int normals_count;   ///< count of vertexes covered by normals
   polygon_t polygons;    //< obj of polygons_t, contains array of vertex indices
                          // and indices counts
   axises bounds;  //< obj of axises, contains bounds for axises X Y Z to make it
@@ -84,12 +93,79 @@ typedef struct {
  * @return[out] obj3d*
  */
 obj3d* parse_obj_file(const char* path);
+/**
+ * @brief progress of reading, called after every BUFFER_SIZE window
+ *
+ * @param[in] user user data of the caller
+ * @param[in] bytes_read bytes of the file consumed so far
+ * @param[in] bytes_total size of the file, 0 if unknown
+ * @return[out] TRUE to continue, FALSE to cancel loading
+ */
+typedef int (*load_progress_t)(void* user, unsigned long long bytes_read,
+                               unsigned long long bytes_total);
+/**
+ * @brief parse .obj file reporting progress, see parse_obj_file
+ *
+ * @param[in] path a path to the .obj file
+ * @param[in] progress callback or NULL
+ * @param[in] user user data passed to progress
+ * @return[out] obj3d* or NULL on error or cancellation
+ */
+obj3d* parse_obj_file_progress(const char* path, load_progress_t progress,
+                               void* user);
+/**
+ * @brief whether the last .obj parse on the calling thread met a face with a
+ * missing vertex, the flag is cleared
+ *
+ * @details get_count_edges also clears it and returns 0 then
+ * @return[out] TRUE if the file was incorrect
+ */
+int obj_take_incorrect_file(void);
+/**
+ * @brief parse the file from offset to its end and append data to obj
+ *
+ * @details bounds are updated, negative indices of the new faces are counted
+ * from the vertexes already in obj
+ * @param[in,out] obj the 3D object to append to
+ * @param[in] path a path to the .obj file
+ * @param[in] offset first byte to parse, should be the start of a line
+ * @param[out] end_offset offset after the last parsed byte, may be NULL
+ * @param[out] is_complete FALSE if the file ends inside a line, may be NULL
+ * @return[out] TRUE on success, FALSE if the file can't be read or a face
+ * refers to a missing vertex, obj is unchanged then
+ */
+int parse_obj_file_tail(obj3d* obj, const char* path,
+                        unsigned long long offset,
+                        unsigned long long* end_offset, int* is_complete);
+/**
+ * @brief create an empty 3D object, for example for parse_obj_file_tail
+ *
+ * @return[out] obj3d* or NULL
+ */
+obj3d* obj_create(void);
+/**
+ * @brief replace data of the object with arrays of exact sizes to be filled
+ * by the caller, bounds are zeroed
+ *
+ * @param[in,out] obj the 3D object
+ * @param[in] vertexes, faces, indexes sizes of the new arrays
+ * @return[out] TRUE on success, the object is unchanged otherwise
+ */
+int obj_reserve(obj3d* obj, u_int vertexes, u_int faces, u_int indexes);
 /**
  * @brief free memory from the 3D object
  *
  * @param[in] obj a pointer to the 3D object
  */
 void obj_destroy(obj3d* obj);
+/**
+ * @brief resize obj->normals to hold normals of the given count of vertexes
+ *
+ * @param[in,out] obj the 3D object
+ * @param[in] vertexes count of vertexes, 0 frees the normals
+ * @return[out] obj->normals, NULL on failure with the old normals kept
+ */
+float* obj_normals_resize(obj3d* obj, u_int vertexes);
 
 /**
  * @brief count obj3d edges and return it
@@ -99,6 +175,16 @@ void obj_destroy(obj3d* obj);
  */
 u_int get_count_edges(obj3d* obj);
 
+/**
+ * @brief collect unique edges of the 3D object
+ *
+ * @param[in] obj the 3D object
+ * @param[out] edges allocated array of pairs of vertex indexes (1-based,
+ * lesser first), sorted, should be freed by free()
+ * @return[out] u_int count of edges
+ */
+u_int collect_unique_edges(const obj3d* obj, u_int** edges);
+
 /*---------------------------affine transformations-----------------*/
 /**
  * @brief functions for affine transformations
@@ -111,6 +197,601 @@ void matrix_vector_multiply(float matrix_transform[3][3], float* x, float* y,
                             float* z);
 void rotate_object(float angle, obj3d* obj, int type_of_coordinate);
 void moveToCenter(obj3d* obj);
+void matrix4_identity(float m[4][4]);
+void matrix4_multiply(float a[4][4], float b[4][4],
+                      float result[4][4]);
+void matrix4_translation(float x, float y, float z, float m[4][4]);
+void matrix4_rotation(float angle, int type_of_coordinate, float m[4][4]);
+void matrix4_perspective(float fov_y, float aspect, float z_near, float z_far,
+                         float m[4][4]);
+
+/*---------------------------parallel helpers-----------------------*/
+/**
+ * @brief body of a parallel loop, processes indices [begin, end)
+ */
+typedef void (*range_func_t)(void* ctx, u_int begin, u_int end,
+                             u_int thread_index);
+
+/**
+ * @brief resolve count of worker threads
+ *
+ * @param[in] requested wanted count of threads, 0 means all online cores
+ * @return[out] u_int
+ */
+u_int get_threads_count(u_int requested);
+/**
+ * @brief split [0, count) into contiguous chunks and run them on threads
+ *
+ * @param[in] count size of the index range
+ * @param[in] threads count of threads, 0 means all online cores
+ * @param[in] func body of the loop
+ * @param[in] ctx user data passed to func
+ * @return[out] u_int count of chunks which were used
+ */
+u_int parallel_for(u_int count, u_int threads, range_func_t func, void* ctx);
+/**
+ * @brief run func for every index of [0, count) with work stealing
+ *
+ * @details func is called with ranges of one index, so tasks of very
+ * different cost (files, meshes) are balanced between threads
+ * @param[in] count size of the index range
+ * @param[in] threads count of threads, 0 means all online cores
+ * @param[in] func body of the loop
+ * @param[in] ctx user data passed to func
+ * @return[out] u_int count of workers which were used
+ */
+u_int parallel_for_stealing(u_int count, u_int threads, range_func_t func,
+                            void* ctx);
+
+/*---------------------------load statistics------------------------*/
+/**
+ * @brief per-phase timing and memory of loading, filled only when attached
+ */
+typedef struct {
+  double read_ms;     ///< reading the file into the buffer
+  double parse_ms;    ///< tokenizing, without time of reallocations
+  double realloc_ms;  ///< growth of the vertex and index arrays
+  double edges_ms;    ///< get_count_edges and collect_unique_edges
+  double total_ms;    ///< the whole parse_obj_file
+  unsigned long long bytes_read;
+  u_int realloc_count;
+  long long heap_bytes;          ///< backend heap in use right now
+  long long peak_heap_bytes;     ///< max of heap_bytes
+  unsigned long long obj_bytes;  ///< footprint of the loaded obj3d
+} load_stats_t;
+
+/**
+ * @brief collect load statistics of the calling thread into stats
+ *
+ * @param[in] stats zeroed and filled by the next calls, NULL to stop
+ */
+void load_stats_attach(load_stats_t* stats);
+/**
+ * @brief bytes of heap owned by the 3D object, including spare capacity
+ */
+size_t obj_footprint(const obj3d* obj);
+
+/*---------------------------async loading--------------------------*/
+/**
+ * @brief  Collection of states of the async loader
+ */
+typedef enum {
+  LOAD_RUNNING,
+  LOAD_DONE,
+  LOAD_FAILED,
+  LOAD_CANCELLED
+} LOAD_STATE;
+
+/**
+ * @brief model loading on a worker thread, see obj_loader_start
+ */
+typedef struct obj_loader obj_loader_t;
+
+/**
+ * @brief start parsing the file and counting edges on a worker thread
+ *
+ * @param[in] path a path to the .obj file
+ * @return[out] obj_loader_t* or NULL if the thread can't be started
+ */
+obj_loader_t* obj_loader_start(const char* path);
+/**
+ * @brief current state and progress, never blocks, safe for any thread
+ *
+ * @param[out] bytes_read, bytes_total progress of reading, may be NULL
+ * @return[out] one of LOAD_STATE
+ */
+int obj_loader_poll(obj_loader_t* loader, unsigned long long* bytes_read,
+                    unsigned long long* bytes_total);
+/**
+ * @brief ask the worker to stop after the current BUFFER_SIZE window
+ */
+void obj_loader_cancel(obj_loader_t* loader);
+/**
+ * @brief take the loaded object, only the first call after LOAD_DONE gets it
+ *
+ * @param[out] edges_count count of edges of the object, may be NULL
+ * @return[out] obj3d* owned by the caller or NULL
+ */
+obj3d* obj_loader_take(obj_loader_t* loader, u_int* edges_count);
+/**
+ * @brief load statistics of the finished loading
+ *
+ * @return[out] TRUE if the worker has finished and stats were copied
+ */
+int obj_loader_stats(obj_loader_t* loader, load_stats_t* stats);
+/**
+ * @brief cancel if running, wait for the worker and free the loader with the
+ * object which was not taken
+ */
+void obj_loader_destroy(obj_loader_t* loader);
+
+/**
+ * @brief called on a worker thread when the file index of the multi loader
+ * has finished, the object is taken by obj_multi_loader_take
+ *
+ * @param[in] state LOAD_DONE, LOAD_FAILED or LOAD_CANCELLED
+ */
+typedef void (*load_done_t)(void* user, u_int index, int state);
+
+/**
+ * @brief loading of many files on a pool of threads, see
+ * obj_multi_loader_start
+ */
+typedef struct obj_multi_loader obj_multi_loader_t;
+
+/**
+ * @brief start loading files on a pool of threads, larger files first
+ *
+ * @details the format of every file is detected like in parse_mesh_file,
+ * the kernel is asked to read ahead the next file in the queue while the
+ * current ones are parsed
+ * @param[in] paths paths to the files, copied
+ * @param[in] count count of files
+ * @param[in] threads count of threads, 0 means all online cores
+ * @param[in] done callback for every file or NULL
+ * @param[in] user user data passed to done
+ * @return[out] obj_multi_loader_t* or NULL if the threads can't be started
+ */
+obj_multi_loader_t* obj_multi_loader_start(const char* const* paths,
+                                           u_int count, u_int threads,
+                                           load_done_t done, void* user);
+/**
+ * @brief count of finished files whose callback has returned, never blocks,
+ * safe for any thread
+ */
+u_int obj_multi_loader_poll(obj_multi_loader_t* loader);
+/**
+ * @brief state of the file index, one of LOAD_STATE
+ */
+int obj_multi_loader_state(obj_multi_loader_t* loader, u_int index);
+/**
+ * @brief take the loaded object of the file index, only the first call after
+ * LOAD_DONE gets it
+ *
+ * @param[out] edges_count count of edges of the object, may be NULL
+ * @return[out] obj3d* owned by the caller or NULL
+ */
+obj3d* obj_multi_loader_take(obj_multi_loader_t* loader, u_int index,
+                             u_int* edges_count);
+/**
+ * @brief stop parsing, files which were not started become LOAD_CANCELLED
+ */
+void obj_multi_loader_cancel(obj_multi_loader_t* loader);
+/**
+ * @brief cancel if running, wait for the workers and free the loader with
+ * the objects which were not taken
+ */
+void obj_multi_loader_destroy(obj_multi_loader_t* loader);
+
+/*---------------------------live reload----------------------------*/
+/**
+ * @brief  Collection of results of checking the watched file
+ */
+typedef enum {
+  WATCH_UNCHANGED,
+  WATCH_APPENDED,
+  WATCH_RELOADED,
+  WATCH_FAILED
+} WATCH_RESULT;
+
+/**
+ * @brief watched .obj file with its parsed object, see obj_watch_open
+ */
+typedef struct obj_watch obj_watch_t;
+
+/**
+ * @brief parse the file and start watching it
+ *
+ * @param[in] path a path to the .obj file
+ * @return[out] obj_watch_t* or NULL on error
+ */
+obj_watch_t* obj_watch_open(const char* path);
+/**
+ * @brief descriptor which becomes readable when the file may have changed
+ *
+ * @return[out] inotify descriptor or -1 if the system has no inotify
+ */
+int obj_watch_fd(const obj_watch_t* watch);
+/**
+ * @brief wait for changes up to timeout_ms and apply them
+ *
+ * @return[out] one of WATCH_RESULT
+ */
+int obj_watch_poll(obj_watch_t* watch, int timeout_ms);
+/**
+ * @brief check the file now: parse only the appended tail if the parsed part
+ * is unchanged, otherwise parse the whole file
+ *
+ * @details the parsed part is compared by at most 8 blocks of BUFFER_SIZE,
+ * the first, the last and a rotating sample of the middle ones
+ *
+ * @return[out] one of WATCH_RESULT, the old object is kept on WATCH_FAILED
+ */
+int obj_watch_refresh(obj_watch_t* watch);
+/**
+ * @brief object in file coordinates, owned by the watcher
+ *
+ * @details the pointer changes after WATCH_RELOADED and the data grows after
+ * WATCH_APPENDED, transformations should be applied to a copy
+ */
+obj3d* obj_watch_object(const obj_watch_t* watch);
+/**
+ * @brief count of unique edges, updated incrementally
+ */
+u_int obj_watch_edges(const obj_watch_t* watch);
+void obj_watch_close(obj_watch_t* watch);
+
+/*---------------------------obj export-----------------------------*/
+/**
+ * @brief write the object into the .obj file, with vn lines and f v//vn
+ * faces if obj->normals is set
+ *
+ * @details every float is written with the shortest of 6..9 significant
+ * digits which reads back to the same value
+ * @param[in] threads count of formatting threads, 0 means all online cores
+ * @return[out] TRUE on success, FALSE otherwise
+ */
+int write_obj_file(const obj3d* obj, const char* path, u_int threads);
+
+/*---------------------------mesh formats---------------------------*/
+/**
+ * @brief  Collection of mesh formats recognised by their first bytes
+ */
+typedef enum {
+  MESH_OBJ,
+  MESH_STL_BINARY,
+  MESH_STL_ASCII,
+  MESH_PLY
+} MESH_FORMAT;
+
+/**
+ * @brief detect the format of the mesh file by its content
+ *
+ * @return[out] MESH_FORMAT or -1 if the file can't be read
+ */
+int detect_mesh_format(const char* path);
+/**
+ * @brief read .obj, binary or ascii .stl or .ply (ascii, binary little or
+ * big endian) into a 3D object, the format is detected by the content
+ *
+ * @details equal STL vertexes are welded into shared indices, degenerate
+ * triangles are dropped, indices out of range in any format are a failure
+ * @return[out] obj3d* or NULL on failure
+ */
+obj3d* parse_mesh_file(const char* path);
+
+/*---------------------------binary cache---------------------------*/
+#define CACHE_QUANT_BITS 16  ///< default precision of compressed vertexes
+#define CACHE_MAX_QUANT_BITS 24
+
+/**
+ * @brief write the object in the native binary layout, atomically replacing
+ * the file
+ *
+ * @return[out] TRUE on success, FALSE otherwise
+ */
+int obj_save_binary(const obj3d* obj, const char* path);
+/**
+ * @brief write the object with delta and varint coded arrays, atomically
+ * replacing the file
+ *
+ * @param[in] quant_bits bits per coordinate inside the bounds of the model,
+ * error is at most half of a step; 0 keeps floats exactly
+ * @return[out] TRUE on success, FALSE otherwise
+ */
+int obj_save_compressed(const obj3d* obj, const char* path, u_int quant_bits);
+/**
+ * @brief read the object written by obj_save_binary or obj_save_compressed
+ *
+ * @return[out] obj3d* or NULL if the file is missing, foreign or truncated
+ */
+obj3d* obj_load_binary(const char* path);
+
+/*---------------------------scene of models------------------------*/
+#define SCENE_PREFETCH_RADIUS 2  ///< neighbours loaded around the viewed one
+
+/**
+ * @brief  Collection of what happens with the evicted model
+ */
+typedef enum { SCENE_EVICT_TO_CACHE, SCENE_EVICT_TO_LOD } SCENE_EVICT_POLICY;
+
+/**
+ * @brief  Collection of states of the model in the scene
+ */
+typedef enum {
+  MODEL_UNLOADED,
+  MODEL_LOADING,
+  MODEL_LOADED,
+  MODEL_LOD,     ///< only the low LOD is in memory
+  MODEL_CACHED,  ///< not in memory, the binary cache is fresh
+  MODEL_FAILED
+} MODEL_STATE;
+
+/**
+ * @brief browse list of models under a memory budget, see scene_create
+ */
+typedef struct scene scene_t;
+
+/**
+ * @brief create the scene
+ *
+ * @param[in] budget_bytes limit of obj_footprint of all models in memory, the
+ * viewed model is kept even if it alone is bigger
+ * @param[in] cache_dir directory of binary caches, created if missing, NULL
+ * to evict without caching
+ * @param[in] policy one of SCENE_EVICT_POLICY
+ * @param[in] prefetch_threads background loaders, 0 disables prefetching
+ * @return[out] scene_t* or NULL on error
+ */
+scene_t* scene_create(size_t budget_bytes, const char* cache_dir, int policy,
+                      u_int prefetch_threads);
+/**
+ * @brief append the file to the browse list without loading it
+ *
+ * @return[out] id of the model or -1 on error
+ */
+int scene_add(scene_t* scene, const char* path);
+/**
+ * @brief load the model if needed, pin it and prefetch its neighbours
+ *
+ * @details must be called from one thread, the object is owned by the scene
+ * and stays valid until the next scene_view or scene_destroy
+ * @return[out] obj3d* or NULL if the file can't be loaded
+ */
+obj3d* scene_view(scene_t* scene, u_int id);
+/**
+ * @brief copy of the low LOD of the model for thumbnails
+ *
+ * @return[out] obj3d* owned by the caller or NULL if the state is not
+ * MODEL_LOD
+ */
+obj3d* scene_preview(scene_t* scene, u_int id);
+/**
+ * @return[out] one of MODEL_STATE
+ */
+int scene_state(scene_t* scene, u_int id);
+/**
+ * @brief bytes of models in memory
+ */
+size_t scene_memory(scene_t* scene);
+void scene_destroy(scene_t* scene);
+
+/*---------------------------vertex normals-------------------------*/
+/**
+ * @brief compute smooth per-vertex normals into obj->normals
+ *
+ * @param[in] obj the 3D object
+ * @param[in] weighting one of NORMALS_WEIGHTING
+ * @param[in] threads count of threads, 0 means all online cores
+ * @return[out] TRUE on success, FALSE otherwise
+ */
+int compute_vertex_normals(obj3d* obj, int weighting, u_int threads);
+
+/*---------------------------meshlets-------------------------------*/
+#define MESHLET_MAX_VERTEXES 64    ///< Max vertexes of one meshlet
+#define MESHLET_MAX_TRIANGLES 124  ///< Max triangles of one meshlet
+
+/**
+ * @brief cluster of neighbouring triangles with its bounds
+ *
+ */
+typedef struct {
+  u_int vertex_offset;    ///< first item of meshlets_t.vertexes
+  u_int triangle_offset;  ///< first triangle in meshlets_t.triangles
+  u_int vertex_count;
+  u_int triangle_count;
+  float aabb_min[AX_DIMEN];
+  float aabb_max[AX_DIMEN];
+  float center[AX_DIMEN];  ///< bounding sphere
+  float radius;
+  float cone_apex[AX_DIMEN];  ///< behind the planes of all triangles
+  float cone_axis[AX_DIMEN];  ///< mean unit normal of triangles
+  float cone_cutoff;  ///< sine of the cone half-angle, 1 if never back-facing
+} meshlet_t;
+
+/**
+ * @brief triangles of the 3D object split into meshlets
+ *
+ */
+typedef struct {
+  meshlet_t* items;
+  u_int count;
+  u_int* vertexes;  ///< 0-based vertexes of the object used by meshlets
+  u_int vertexes_count;
+  unsigned char* triangles;  ///< 3 indices into the meshlet vertexes each
+  u_int triangles_count;
+} meshlets_t;
+
+/**
+ * @brief split fan-triangulated polygons into meshlets of at most
+ * MESHLET_MAX_VERTEXES vertexes and MESHLET_MAX_TRIANGLES triangles
+ *
+ * @param[in] obj the 3D object
+ * @param[in] threads count of threads for bounds, 0 means all online cores
+ * @return[out] meshlets_t* or NULL on error
+ */
+meshlets_t* build_meshlets(const obj3d* obj, u_int threads);
+/**
+ * @brief recompute bounds and cones after vertexes of the object changed
+ *
+ * @return[out] TRUE on success, FALSE if the meshlets don't fit the object
+ */
+int meshlets_update_bounds(meshlets_t* meshlets, const obj3d* obj,
+                           u_int threads);
+/**
+ * @brief reject meshlets outside the view frustum or facing away from the
+ * camera, triangles are front-facing when counter-clockwise
+ *
+ * @param[in] model, view, projection matrices 4x4 as in render_obj
+ * @param[out] visible indices of visible meshlets, meshlets->count items
+ * @return[out] u_int count of visible meshlets
+ */
+u_int cull_meshlets(const meshlets_t* meshlets, float model[4][4],
+                    float view[4][4], float projection[4][4], u_int* visible);
+void meshlets_destroy(meshlets_t* meshlets);
+
+/*---------------------------face culling---------------------------*/
+/**
+ * @brief  Collection of face culling flags, can be combined
+ */
+typedef enum { CULL_BACK_FACES = 1, CULL_FRUSTUM = 2 } CULL_MODE;
+
+/**
+ * @brief visible faces of the last frame and buffers reused between frames
+ *
+ */
+typedef struct {
+  polygon_t polygons;  ///< visible faces in the order of the object, 1-based
+                       ///< vertexes as in obj3d.polygons
+  u_int* faces;        ///< ids of visible faces
+  u_int faces_count;
+  u_int total_indexes;
+  const obj3d* obj;       ///< object of planes
+  u_int planes_faces;     ///< faces_count of obj when planes were computed
+  float* planes;          ///< blocks of 4 faces: nx[4], ny[4], nz[4], d[4]
+  u_int* face_start;      ///< first index of every face
+  unsigned char* outcodes;  ///< frustum planes outside of every vertex
+  u_int outcodes_capacity;
+  u_int* scratch;  ///< visible faces of every chunk, at the chunk start
+} face_cull_t;
+
+face_cull_t* face_cull_create(void);
+/**
+ * @brief recompute planes of faces after vertexes of the object changed
+ *
+ * @details planes are computed automatically for a new object or a new count
+ * of faces, degenerate faces and faces with broken indices are back-facing
+ * @param[in] threads count of threads, 0 means all online cores
+ * @return[out] TRUE on success, FALSE otherwise
+ */
+int face_cull_update(face_cull_t* cull, const obj3d* obj, u_int threads);
+/**
+ * @brief collect faces facing the camera and not outside the view frustum
+ *
+ * @details faces are front-facing when counter-clockwise, a face is outside
+ * when all its vertexes are outside one plane of the frustum
+ * @param[in] model, view, projection matrices 4x4 as in render_obj
+ * @param[in] mode CULL_MODE flags
+ * @param[in] threads count of threads, 0 means all online cores
+ * @return[out] TRUE on success, results are in cull->polygons and cull->faces
+ */
+int cull_faces(face_cull_t* cull, const obj3d* obj, float model[4][4],
+               float view[4][4], float projection[4][4], int mode,
+               u_int threads);
+void face_cull_destroy(face_cull_t* cull);
+
+/*---------------------------software rasterizer--------------------*/
+#define TILE_SIZE 64  ///< Side of a screen tile in pixels
+
+/**
+ * @brief  Collection of render mode flags, can be combined
+ */
+typedef enum { RENDER_WIREFRAME = 1, RENDER_FLAT = 2 } RENDER_MODE;
+
+/**
+ * @brief offscreen RGBA image with depth buffer
+ *
+ */
+typedef struct {
+  u_int width;
+  u_int height;
+  unsigned char* pixels;  ///< RGBA bytes, 4 * width * height, rows top-down
+  float* depth;           ///< depth of every pixel
+} framebuffer_t;
+
+/**
+ * @brief options of render_obj
+ *
+ */
+typedef struct {
+  int mode;                      ///< RENDER_MODE flags
+  unsigned char background[4];   ///< RGBA of clear color
+  unsigned char face_color[4];   ///< RGBA of lit faces
+  unsigned char edge_color[4];   ///< RGBA of edges
+  u_int threads;                 ///< count of threads, 0 means all cores
+  const u_int* edges;  ///< optional unique edges from collect_unique_edges
+  u_int edges_count;   ///< count of pairs in edges
+  const meshlets_t* meshlets;  ///< optional clusters from build_meshlets,
+                               ///< culled ones are not filled
+  face_cull_t* face_cull;  ///< optional, only faces left by cull_faces with
+                           ///< cull_mode are filled, ignored with meshlets
+  int cull_mode;           ///< CULL_MODE flags for face_cull
+} render_options_t;
+
+framebuffer_t* framebuffer_create(u_int width, u_int height);
+void framebuffer_destroy(framebuffer_t* fb);
+/**
+ * @brief write framebuffer as RGBA PNG (uncompressed deflate)
+ *
+ * @return[out] TRUE on success, FALSE otherwise
+ */
+int framebuffer_save_png(const framebuffer_t* fb, const char* path);
+void render_options_default(render_options_t* options);
+/**
+ * @brief render the 3D object into framebuffer by tiles on all cores
+ *
+ * @param[in] obj the 3D object
+ * @param[in] model, view, projection matrices 4x4 (row-major, column vectors)
+ * @param[in] options mode, colors and threads
+ * @param[out] fb framebuffer, fully overwritten
+ * @return[out] TRUE on success, FALSE otherwise
+ */
+int render_obj(const obj3d* obj, float model[4][4],
+               float view[4][4], float projection[4][4],
+               const render_options_t* options, framebuffer_t* fb);
+
+/*---------------------------GIF recording--------------------------*/
+/**
+ * @brief background GIF recorder, see gif_recorder_start
+ */
+typedef struct gif_recorder gif_recorder_t;
+
+/**
+ * @brief open GIF file and start quantization workers and encoder thread
+ *
+ * @param[in] path a path to the .gif file
+ * @param[in] width, height size of every frame
+ * @param[in] delay_cs delay between frames in 1/100 of second
+ * @param[in] queue_frames count of frames in flight, rounded up to power of 2
+ * @param[in] workers count of quantization threads, 0 means all cores
+ * @return[out] gif_recorder_t* or NULL on error
+ */
+gif_recorder_t* gif_recorder_start(const char* path, u_int width, u_int height,
+                                   u_int delay_cs, u_int queue_frames,
+                                   u_int workers);
+/**
+ * @brief copy RGBA frame into the queue, never blocks
+ *
+ * @return[out] TRUE if queued, FALSE if the frame was dropped
+ */
+int gif_recorder_push(gif_recorder_t* rec, const unsigned char* rgba);
+void gif_recorder_stats(gif_recorder_t* rec, u_int* encoded, u_int* dropped);
+/**
+ * @brief encode all queued frames, close the file and free the recorder
+ *
+ * @return[out] TRUE if the file was fully written
+ */
+int gif_recorder_finish(gif_recorder_t* rec);
 
 #ifdef __cplusplus
 }
@@ -185,4 +185,89 @@ void rotate_object(float angle, obj3d* obj, int type_of_coordinate) {
     matrix_vector_multiply(matrixOfLinearOperator, &(obj->vertexes[i]),
                            &(obj->vertexes[i + 1]), &(obj->vertexes[i + 2]));
   }
+  // нормали при вращении поворачиваются тем же оператором
+  if (obj->normals) {
+    for (unsigned int i = 0; i < obj->normals_count * 3; i += 3) {
+      matrix_vector_multiply(matrixOfLinearOperator, &(obj->normals[i]),
+                             &(obj->normals[i + 1]), &(obj->normals[i + 2]));
+    }
+  }
+}
+
+// МАТРИЦЫ 4 НА 4 ДЛЯ КАМЕРЫ
+// матрицы хранятся по строкам m[строка][столбец] и умножаются на вектор-столбец
+/**
+ * @brief set identity matrix
+ * @param[out] m - matrix 4x4
+ */
+void matrix4_identity(float m[4][4]) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) m[i][j] = (i == j) ? 1.0f : 0.0f;
+  }
+}
+
+/**
+ * @brief multiply matrices, result = a * b
+ * @param[in] a, b - matrices 4x4
+ * @param[out] result - matrix 4x4, can't be the same as a or b
+ */
+void matrix4_multiply(float a[4][4], float b[4][4],
+                      float result[4][4]) {
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      result[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] +
+                     a[i][2] * b[2][j] + a[i][3] * b[3][j];
+    }
+  }
+}
+
+/**
+ * @brief set translation matrix
+ * @param[in] x, y, z - offsets along axises
+ * @param[out] m - matrix 4x4
+ */
+void matrix4_translation(float x, float y, float z, float m[4][4]) {
+  matrix4_identity(m);
+  m[0][3] = x;
+  m[1][3] = y;
+  m[2][3] = z;
+}
+
+/**
+ * @brief set rotation matrix, the same operator as in rotate_object
+ * @param[in] angle - angle for rotation
+ * @param[in] type_of_coordinate - X, Y, Z
+ * @param[out] m - matrix 4x4
+ */
+void matrix4_rotation(float angle, int type_of_coordinate, float m[4][4]) {
+  float sin_angle = sin(angle);
+  float cos_angle = cos(angle);
+  int a = (type_of_coordinate + 1) % 3, b = (type_of_coordinate + 2) % 3;
+
+  matrix4_identity(m);
+  m[a][a] = cos_angle;
+  m[a][b] = -sin_angle;
+  m[b][a] = sin_angle;
+  m[b][b] = cos_angle;
+}
+
+/**
+ * @brief set perspective projection matrix (as gluPerspective)
+ * @param[in] fov_y - vertical field of view in radians
+ * @param[in] aspect - width / height
+ * @param[in] z_near, z_far - distances to clipping planes
+ * @param[out] m - matrix 4x4
+ */
+void matrix4_perspective(float fov_y, float aspect, float z_near, float z_far,
+                         float m[4][4]) {
+  float f = 1.0f / tanf(fov_y / 2.0f);
+
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) m[i][j] = 0.0f;
+  }
+  m[0][0] = f / aspect;
+  m[1][1] = f;
+  m[2][2] = (z_far + z_near) / (z_near - z_far);
+  m[2][3] = 2.0f * z_far * z_near / (z_near - z_far);
+  m[3][2] = -1.0f;
 }
@@ -0,0 +1,507 @@
+/**
+ * @file s21_cache.c
+ * @brief Binary cache of the parsed 3D object, raw or compressed
+ * @details
+ * Файл кэша - это заголовок cache_header_t и три массива объекта подряд:
+ * вершины, количества индексов граней и индексы. Порядок байт и размеры
+ * типов - как у текущей машины, кэш не предназначен для переноса между
+ * компьютерами, поэтому заголовок хранит проверочные поля и чужой или
+ * поврежденный файл просто не читается.
+ * Запись идет во временный файл и переименовывается, чтобы читатель никогда
+ * не увидел наполовину записанный кэш.
+ *
+ * В сжатом виде (obj_save_compressed) каждый массив - это поток целых:
+ * - индексы - разность с предыдущим индексом в порядке граней;
+ * - вершины - координаты, квантованные в quant_bits бит по габаритам, или
+ *   биты float при quant_bits = 0, и разность с той же координатой
+ *   предыдущей вершины;
+ * - размеры граней не хранятся, если все грани одного размера.
+ * Разности переводятся в zigzag и пишутся как varint в раскладке stream
+ * vbyte: сначала байты управления (по 2 бита длины на число), потом байты
+ * чисел. Такой varint распаковывается без ветвлений, а на x86 с SSSE3 -
+ * одной перестановкой pshufb на четыре числа.
+ */
+
+#define _GNU_SOURCE
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "s21_3d_viewer.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define HAS_SSSE3_PATH 1
+#else
+#define HAS_SSSE3_PATH 0
+#endif
+
+#define CACHE_MAGIC 0x42313253u  ///< "S21B" in little endian
+#define CACHE_VERSION 2u
+#define CACHE_SLACK 16   ///< readable bytes after a stream for wide loads
+#define CODEC_CHUNK 768  ///< values decoded per step, multiple of 3 and 4
+
+/**
+ * @brief  Collection of layouts of the arrays in the cache file
+ */
+typedef enum { CACHE_RAW, CACHE_PACKED } CACHE_ENCODING;
+
+/**
+ * @brief header of the cache file, followed by the arrays of the object
+ */
+typedef struct {
+  u_int magic;
+  u_int version;
+  u_int sizeof_header;  ///< guards against other layouts of the struct
+  u_int vertexes_count;
+  u_int faces_count;
+  u_int total_indexes;
+  axises bounds;
+  u_int encoding;    ///< one of CACHE_ENCODING
+  u_int quant_bits;  ///< 0 keeps bits of floats
+  u_int face_size;   ///< size of every face, 0 if sizes differ
+  u_int reserved;
+  float quant_min[AX_DIMEN];
+  float quant_step[AX_DIMEN];
+  unsigned long long vertexes_bytes;  ///< sizes of packed streams
+  unsigned long long counts_bytes;
+  unsigned long long indexes_bytes;
+} cache_header_t;
+
+/**
+ * @brief lengths and pshufb masks of the 256 control bytes of stream vbyte
+ */
+typedef struct {
+  unsigned char length[256];
+  unsigned char shuffle[256][16];
+} vbyte_tables_t;
+
+static vbyte_tables_t vbyte_tables;
+static pthread_once_t vbyte_once = PTHREAD_ONCE_INIT;
+static int has_ssse3 = FALSE;
+
+static void init_vbyte_tables(void) {
+  for (u_int control = 0; control < 256; control++) {
+    u_int offset = 0;
+    for (u_int k = 0; k < 4; k++) {
+      u_int size = ((control >> (2 * k)) & 3) + 1;
+      for (u_int byte = 0; byte < 4; byte++) {
+        // 0x80 в маске pshufb обнуляет байт
+        vbyte_tables.shuffle[control][4 * k + byte] =
+            byte < size ? (unsigned char)(offset + byte) : 0x80;
+      }
+      offset += size;
+    }
+    vbyte_tables.length[control] = (unsigned char)offset;
+  }
+#if HAS_SSSE3_PATH
+  __builtin_cpu_init();
+  has_ssse3 = __builtin_cpu_supports("ssse3");
+#endif
+}
+
+/*-------------------------------encoding-----------------------------*/
+
+static u_int zigzag(u_int delta) {
+  return (delta << 1) ^ (u_int)-(int)(delta >> 31);
+}
+
+static u_int unzigzag(u_int value) { return (value >> 1) ^ -(value & 1); }
+
+/**
+ * @brief largest size of count values packed by vbyte_encode
+ */
+static size_t vbyte_bound(size_t count) { return (count + 3) / 4 + count * 4; }
+
+/**
+ * @brief control bytes, then little endian bytes of values
+ */
+static size_t vbyte_encode(const u_int *values, size_t count,
+                           unsigned char *out) {
+  unsigned char *control = out, *data = out + (count + 3) / 4;
+
+  memset(control, 0, (count + 3) / 4);
+  for (size_t i = 0; i < count; i++) {
+    u_int v = values[i];
+    u_int size = 1 + (v > 0xFFu) + (v > 0xFFFFu) + (v > 0xFFFFFFu);
+    control[i / 4] |= (unsigned char)((size - 1) << (2 * (i % 4)));
+    for (u_int byte = 0; byte < size; byte++) {
+      *data++ = (unsigned char)(v >> (8 * byte));
+    }
+  }
+
+  return (size_t)(data - out);
+}
+
+static int is_uniform_faces(const obj3d *obj) {
+  int is_uniform = obj->faces_count > 0;
+  const u_int *counts = obj->polygons.indeces_count;
+
+  for (u_int f = 1; is_uniform && f < obj->faces_count; f++) {
+    is_uniform = counts[f] == counts[0];
+  }
+
+  return is_uniform;
+}
+
+static void quantize_setup(const obj3d *obj, u_int bits,
+                           cache_header_t *header) {
+  float min[AX_DIMEN], max[AX_DIMEN];
+
+  for (u_int i = 0; i < AX_DIMEN; i++) {
+    min[i] = obj->vertexes_count ? obj->vertexes[i] : 0.0f;
+    max[i] = min[i];
+  }
+  for (size_t v = 0; v < (size_t)obj->vertexes_count * AX_DIMEN; v++) {
+    float x = obj->vertexes[v];
+    if (x < min[v % AX_DIMEN]) min[v % AX_DIMEN] = x;
+    if (x > max[v % AX_DIMEN]) max[v % AX_DIMEN] = x;
+  }
+  for (u_int i = 0; i < AX_DIMEN; i++) {
+    header->quant_min[i] = min[i];
+    header->quant_step[i] =
+        bits ? (max[i] - min[i]) / (float)((1u << bits) - 1) : 0.0f;
+  }
+}
+
+/**
+ * @brief deltas of quantized coordinates or of float bits, zigzag coded
+ */
+static u_int *vertex_deltas(const obj3d *obj, const cache_header_t *header) {
+  size_t count = (size_t)obj->vertexes_count * AX_DIMEN;
+  u_int *deltas = (u_int *)malloc((count + 1) * sizeof(u_int));
+  u_int max_q = header->quant_bits ? (1u << header->quant_bits) - 1 : 0;
+  u_int prev[AX_DIMEN] = {0};
+
+  for (size_t i = 0; deltas && i < count; i++) {
+    u_int axis = (u_int)(i % AX_DIMEN), q = 0;
+    if (header->quant_bits == 0) {
+      memcpy(&q, obj->vertexes + i, sizeof(q));
+    } else if (header->quant_step[axis] > 0.0f) {
+      float scaled = (obj->vertexes[i] - header->quant_min[axis]) /
+                     header->quant_step[axis];
+      q = scaled <= 0.0f ? 0 : (u_int)lrintf(scaled);
+      if (q > max_q) q = max_q;
+    }
+    deltas[i] = zigzag(q - prev[axis]);
+    prev[axis] = q;
+  }
+
+  return deltas;
+}
+
+static u_int *index_deltas(const obj3d *obj) {
+  u_int *deltas =
+      (u_int *)malloc(((size_t)obj->total_indexes + 1) * sizeof(u_int));
+  u_int prev = 0;
+
+  for (u_int i = 0; deltas && i < obj->total_indexes; i++) {
+    deltas[i] = zigzag(obj->polygons.vertexes_ind[i] - prev);
+    prev = obj->polygons.vertexes_ind[i];
+  }
+
+  return deltas;
+}
+
+/*-------------------------------decoding-----------------------------*/
+
+/**
+ * @brief position in a packed stream, data is followed by CACHE_SLACK bytes
+ */
+typedef struct {
+  const unsigned char *control;
+  const unsigned char *data;
+} vbyte_reader_t;
+
+/**
+ * @brief check that control bytes describe exactly the stored data
+ */
+static int vbyte_open(vbyte_reader_t *reader, const unsigned char *stream,
+                      size_t bytes, size_t count) {
+  size_t controls = (count + 3) / 4, expected = controls;
+
+  if (bytes < controls) return FALSE;
+  for (size_t i = 0; i < controls; i++) {
+    expected += vbyte_tables.length[stream[i]];
+  }
+  // неполная последняя группа кодируется нулевыми битами длины
+  expected -= (controls * 4 - count);
+  reader->control = stream;
+  reader->data = stream + controls;
+
+  return expected == bytes;
+}
+
+static void vbyte_decode_scalar(vbyte_reader_t *reader, u_int *out,
+                                u_int count) {
+  static const u_int MASKS[4] = {0xFFu, 0xFFFFu, 0xFFFFFFu, 0xFFFFFFFFu};
+
+  for (u_int i = 0; i < count; i++) {
+    u_int size = (reader->control[i / 4] >> (2 * (i % 4))) & 3;
+    u_int v = 0;
+    memcpy(&v, reader->data, sizeof(v));
+    out[i] = v & MASKS[size];
+    reader->data += size + 1;
+  }
+  reader->control += (count + 3) / 4;
+}
+
+#if HAS_SSSE3_PATH
+__attribute__((target("ssse3"))) static void vbyte_decode_ssse3(
+    vbyte_reader_t *reader, u_int *out, u_int count) {
+  u_int groups = count / 4;
+
+  for (u_int g = 0; g < groups; g++) {
+    unsigned char control = reader->control[g];
+    __m128i bytes = _mm_loadu_si128((const __m128i *)reader->data);
+    __m128i mask =
+        _mm_loadu_si128((const __m128i *)vbyte_tables.shuffle[control]);
+    _mm_storeu_si128((__m128i *)(out + 4 * g), _mm_shuffle_epi8(bytes, mask));
+    reader->data += vbyte_tables.length[control];
+  }
+  reader->control += groups;
+  if (count % 4) vbyte_decode_scalar(reader, out + 4 * groups, count % 4);
+}
+#endif
+
+/**
+ * @brief unpack count values, count is a multiple of 4 except the last call
+ */
+static void vbyte_decode(vbyte_reader_t *reader, u_int *out, u_int count) {
+#if HAS_SSSE3_PATH
+  if (has_ssse3) {
+    vbyte_decode_ssse3(reader, out, count);
+    return;
+  }
+#endif
+  vbyte_decode_scalar(reader, out, count);
+}
+
+static void decode_vertexes(vbyte_reader_t *reader,
+                            const cache_header_t *header, float *out) {
+  size_t count = (size_t)header->vertexes_count * AX_DIMEN;
+  u_int chunk[CODEC_CHUNK], prev[AX_DIMEN] = {0};
+
+  for (size_t begin = 0; begin < count; begin += CODEC_CHUNK) {
+    u_int n = count - begin < CODEC_CHUNK ? (u_int)(count - begin)
+                                          : CODEC_CHUNK;
+    vbyte_decode(reader, chunk, n);
+    // CODEC_CHUNK кратен 3, поэтому ось - это номер внутри тройки
+    for (u_int i = 0; i + AX_DIMEN <= n; i += AX_DIMEN) {
+      for (u_int a = 0; a < AX_DIMEN; a++) {
+        prev[a] += unzigzag(chunk[i + a]);
+        chunk[i + a] = prev[a];
+      }
+    }
+    if (header->quant_bits == 0) {
+      memcpy(out + begin, chunk, n * sizeof(float));
+      continue;
+    }
+    for (u_int i = 0; i < n; i += AX_DIMEN) {
+      for (u_int a = 0; a < AX_DIMEN; a++) {
+        out[begin + i + a] =
+            header->quant_min[a] + (float)chunk[i + a] * header->quant_step[a];
+      }
+    }
+  }
+}
+
+static void decode_indexes(vbyte_reader_t *reader, u_int count, u_int *out) {
+  u_int prev = 0;
+
+  for (u_int begin = 0; begin < count; begin += CODEC_CHUNK) {
+    u_int n = count - begin < CODEC_CHUNK ? count - begin : CODEC_CHUNK;
+    u_int *dst = out + begin;
+    vbyte_decode(reader, dst, n);
+    for (u_int i = 0; i < n; i++) {
+      prev += unzigzag(dst[i]);
+      dst[i] = prev;
+    }
+  }
+}
+
+/*--------------------------------files-------------------------------*/
+
+static int write_block(FILE *file, const void *data, size_t bytes) {
+  return bytes == 0 || fwrite(data, 1, bytes, file) == bytes;
+}
+
+static int read_block(FILE *file, void *data, size_t bytes) {
+  return bytes == 0 || fread(data, 1, bytes, file) == bytes;
+}
+
+static void fill_header(const obj3d *obj, cache_header_t *header) {
+  memset(header, 0, sizeof(*header));
+  header->magic = CACHE_MAGIC;
+  header->version = CACHE_VERSION;
+  header->sizeof_header = sizeof(cache_header_t);
+  header->vertexes_count = obj->vertexes_count;
+  header->faces_count = obj->faces_count;
+  header->total_indexes = obj->total_indexes;
+  header->bounds = obj->bounds;
+}
+
+/**
+ * @brief write header and blocks into a temp file and rename it to path
+ */
+static int write_cache(const char *path, const cache_header_t *header,
+                       const void *const *blocks, const size_t *sizes) {
+  char *tmp_path = (char *)malloc(strlen(path) + 5);
+  FILE *file = NULL;
+  int is_written = FALSE;
+
+  if (!tmp_path) return FALSE;
+  sprintf(tmp_path, "%s.tmp", path);
+  file = fopen(tmp_path, "wb");
+  if (file) {
+    is_written = write_block(file, header, sizeof(*header));
+    for (int i = 0; is_written && i < 3; i++) {
+      is_written = write_block(file, blocks[i], sizes[i]);
+    }
+    if (fclose(file) != 0) is_written = FALSE;
+    if (is_written) is_written = rename(tmp_path, path) == 0;
+    if (!is_written) unlink(tmp_path);
+  }
+  free(tmp_path);
+
+  return is_written;
+}
+
+int obj_save_binary(const obj3d *obj, const char *path) {
+  cache_header_t header;
+
+  if (!obj || !path) return FALSE;
+  fill_header(obj, &header);
+  const void *blocks[3] = {obj->vertexes, obj->polygons.indeces_count,
+                           obj->polygons.vertexes_ind};
+  size_t sizes[3] = {(size_t)obj->vertexes_count * AX_DIMEN * sizeof(float),
+                     (size_t)obj->faces_count * sizeof(u_int),
+                     (size_t)obj->total_indexes * sizeof(u_int)};
+
+  return write_cache(path, &header, blocks, sizes);
+}
+
+int obj_save_compressed(const obj3d *obj, const char *path,
+                        u_int quant_bits) {
+  cache_header_t header;
+  u_int *vertexes = NULL, *indexes = NULL;
+  unsigned char *packed = NULL;
+  int is_written = FALSE;
+
+  if (!obj || !path || quant_bits > CACHE_MAX_QUANT_BITS) return FALSE;
+  fill_header(obj, &header);
+  header.encoding = CACHE_PACKED;
+  header.quant_bits = quant_bits;
+  header.face_size = is_uniform_faces(obj) ? obj->polygons.indeces_count[0] : 0;
+  quantize_setup(obj, quant_bits, &header);
+  size_t vertex_values = (size_t)obj->vertexes_count * AX_DIMEN;
+  size_t count_values = header.face_size ? 0 : obj->faces_count;
+  vertexes = vertex_deltas(obj, &header);
+  indexes = index_deltas(obj);
+  packed = (unsigned char *)malloc(vbyte_bound(vertex_values) +
+                                   vbyte_bound(count_values) +
+                                   vbyte_bound(obj->total_indexes) + 1);
+  if (vertexes && indexes && packed) {
+    unsigned char *counts = NULL, *index_stream = NULL;
+    header.vertexes_bytes = vbyte_encode(vertexes, vertex_values, packed);
+    counts = packed + header.vertexes_bytes;
+    header.counts_bytes =
+        vbyte_encode(obj->polygons.indeces_count, count_values, counts);
+    index_stream = counts + header.counts_bytes;
+    header.indexes_bytes =
+        vbyte_encode(indexes, obj->total_indexes, index_stream);
+    const void *blocks[3] = {packed, counts, index_stream};
+    size_t sizes[3] = {header.vertexes_bytes, header.counts_bytes,
+                       header.indexes_bytes};
+    is_written = write_cache(path, &header, blocks, sizes);
+  }
+  free(vertexes);
+  free(indexes);
+  free(packed);
+
+  return is_written;
+}
+
+static int read_raw(FILE *file, const cache_header_t *header, obj3d *obj) {
+  return read_block(file, obj->vertexes,
+                    (size_t)header->vertexes_count * AX_DIMEN *
+                        sizeof(float)) &&
+         read_block(file, obj->polygons.indeces_count,
+                    (size_t)header->faces_count * sizeof(u_int)) &&
+         read_block(file, obj->polygons.vertexes_ind,
+                    (size_t)header->total_indexes * sizeof(u_int));
+}
+
+static int read_packed(FILE *file, const cache_header_t *header, obj3d *obj) {
+  unsigned long long total =
+      header->vertexes_bytes + header->counts_bytes + header->indexes_bytes;
+  vbyte_reader_t vertexes, counts, indexes;
+  unsigned char *packed = NULL;
+  int is_read = FALSE;
+
+  if (header->quant_bits > CACHE_MAX_QUANT_BITS ||
+      total > (unsigned long long)SIZE_MAX - CACHE_SLACK ||
+      (header->face_size && header->counts_bytes)) {
+    return FALSE;
+  }
+  // запас после потоков позволяет читать по 4 и 16 байт без проверок
+  packed = (unsigned char *)calloc((size_t)total + CACHE_SLACK, 1);
+  pthread_once(&vbyte_once, init_vbyte_tables);
+  if (packed && read_block(file, packed, (size_t)total) &&
+      vbyte_open(&vertexes, packed, header->vertexes_bytes,
+                 (size_t)header->vertexes_count * AX_DIMEN) &&
+      vbyte_open(&counts, packed + header->vertexes_bytes,
+                 header->counts_bytes,
+                 header->face_size ? 0 : header->faces_count) &&
+      vbyte_open(&indexes,
+                 packed + header->vertexes_bytes + header->counts_bytes,
+                 header->indexes_bytes, header->total_indexes)) {
+    decode_vertexes(&vertexes, header, obj->vertexes);
+    if (header->face_size) {
+      for (u_int f = 0; f < header->faces_count; f++) {
+        obj->polygons.indeces_count[f] = header->face_size;
+      }
+    } else {
+      vbyte_decode(&counts, obj->polygons.indeces_count, header->faces_count);
+    }
+    decode_indexes(&indexes, header->total_indexes, obj->polygons.vertexes_ind);
+    is_read = TRUE;
+  }
+  free(packed);
+
+  return is_read;
+}
+
+obj3d *obj_load_binary(const char *path) {
+  cache_header_t header;
+  obj3d *obj = NULL;
+  FILE *file = NULL;
+  int is_read = FALSE;
+
+  if (!path) return NULL;
+  file = fopen(path, "rb");
+  if (!file) return NULL;
+  memset(&header, 0, sizeof(header));
+  if (read_block(file, &header, sizeof(header)) &&
+      header.magic == CACHE_MAGIC && header.version == CACHE_VERSION &&
+      header.sizeof_header == sizeof(cache_header_t) &&
+      header.vertexes_count <= UINT_MAX / AX_DIMEN) {
+    obj = obj_create();
+  }
+  if (obj && obj_reserve(obj, header.vertexes_count, header.faces_count,
+                         header.total_indexes)) {
+    if (header.encoding == CACHE_RAW) is_read = read_raw(file, &header, obj);
+    if (header.encoding == CACHE_PACKED) {
+      is_read = read_packed(file, &header, obj);
+    }
+    obj->bounds = header.bounds;
+  }
+  fclose(file);
+  if (!is_read && obj) {
+    obj_destroy(obj);
+    obj = NULL;
+  }
+
+  return obj;
+}
@@ -0,0 +1,371 @@
+/**
+ * @file s21_face_cull.c
+ * @brief CPU culling of separate faces before drawing
+ * @details
+ * Плоскость каждой грани (нормаль по методу Ньюэлла и смещение по центру)
+ * считается один раз и хранится блоками по 4 грани: nx[4], ny[4], nz[4],
+ * d[4]. На кадр нужны только:
+ * 1) камера в пространстве модели - однородная точка, которую матрица
+ *    model-view-projection переводит в x = y = w = 0, при ортогональной
+ *    проекции это бесконечно удаленная точка (w = 0);
+ * 2) коды выхода за плоскости пирамиды видимости для всех вершин.
+ * Грань смотрит на камеру, если dot(n, camera) - d * camera.w > 0, и это
+ * проверяется сразу для 4 граней одной SSE инструкцией сравнения. Грань вне
+ * пирамиды, если все ее вершины снаружи одной и той же плоскости.
+ * Грани делятся на куски по потокам, каждый кусок пишет видимые грани в
+ * начало своего диапазона, потом куски сдвигаются в общий плотный список
+ * в исходном порядке. Буферы живут между кадрами и пересоздаются только для
+ * другого объекта.
+ */
+
+#include "s21_3d_viewer.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define PLANE_BLOCK 16  ///< floats of one block of 4 faces
+
+/**
+ * @brief shared data of one cull_faces call
+ */
+typedef struct {
+  face_cull_t *cull;
+  const obj3d *obj;
+  float mvp[4][4];
+  float camera[4];  ///< homogeneous camera position in the model space
+  int mode;
+  u_int chunk_begin[MAX_THREADS];    ///< first face of every chunk
+  u_int chunk_faces[MAX_THREADS];    ///< visible faces of every chunk
+  u_int chunk_indexes[MAX_THREADS];  ///< their indexes
+  u_int face_offset[MAX_THREADS];    ///< chunk position in the output
+  u_int index_offset[MAX_THREADS];
+} cull_job_t;
+
+face_cull_t *face_cull_create(void) {
+  return (face_cull_t *)calloc(1, sizeof(face_cull_t));
+}
+
+void face_cull_destroy(face_cull_t *cull) {
+  if (!cull) return;
+  free(cull->polygons.indeces_count);
+  free(cull->polygons.vertexes_ind);
+  free(cull->faces);
+  free(cull->planes);
+  free(cull->face_start);
+  free(cull->outcodes);
+  free(cull->scratch);
+  free(cull);
+}
+
+/*-------------------------------planes-------------------------------*/
+
+/**
+ * @brief Newell normal and offset of faces [begin, end)
+ */
+static void planes_range(void *ctx, u_int begin, u_int end,
+                         u_int thread_index) {
+  cull_job_t *job = (cull_job_t *)ctx;
+  const obj3d *obj = job->obj;
+  const u_int *start = job->cull->face_start;
+  (void)thread_index;
+
+  for (u_int f = begin; f < end; f++) {
+    const u_int *ind = obj->polygons.vertexes_ind + start[f];
+    u_int n = start[f + 1] - start[f];
+    float normal[3] = {0.0f, 0.0f, 0.0f}, center[3] = {0.0f, 0.0f, 0.0f};
+    float *block = job->cull->planes + (size_t)(f / 4) * PLANE_BLOCK;
+    int is_valid = n >= 3;
+
+    for (u_int k = 0; is_valid && k < n; k++) {
+      u_int a = ind[k], b = ind[(k + 1) % n];
+      if (a == 0 || b == 0 || a > obj->vertexes_count ||
+          b > obj->vertexes_count) {
+        is_valid = FALSE;
+        continue;
+      }
+      const float *p = obj->vertexes + (size_t)(a - 1) * AX_DIMEN;
+      const float *q = obj->vertexes + (size_t)(b - 1) * AX_DIMEN;
+      normal[0] += (p[1] - q[1]) * (p[2] + q[2]);
+      normal[1] += (p[2] - q[2]) * (p[0] + q[0]);
+      normal[2] += (p[0] - q[0]) * (p[1] + q[1]);
+      for (int i = 0; i < AX_DIMEN; i++) center[i] += p[i];
+    }
+    // нулевая нормаль дает 0 > 0, то есть грань всегда отсекается
+    if (!is_valid) memset(normal, 0, sizeof(normal));
+    for (int i = 0; i < AX_DIMEN; i++) block[4 * i + f % 4] = normal[i];
+    block[12 + f % 4] = is_valid ? (normal[0] * center[0] +
+                                    normal[1] * center[1] +
+                                    normal[2] * center[2]) /
+                                       (float)n
+                                 : 0.0f;
+  }
+}
+
+static void release_face_buffers(face_cull_t *cull) {
+  free(cull->planes);
+  free(cull->face_start);
+  free(cull->scratch);
+  free(cull->faces);
+  free(cull->polygons.indeces_count);
+  free(cull->polygons.vertexes_ind);
+  memset(&cull->polygons, 0, sizeof(cull->polygons));
+  cull->planes = NULL;
+  cull->face_start = NULL;
+  cull->scratch = NULL;
+  cull->faces = NULL;
+  cull->faces_count = 0;
+  cull->total_indexes = 0;
+  cull->obj = NULL;
+}
+
+/**
+ * @brief buffers of faces have exact sizes of the object
+ */
+static int alloc_face_buffers(face_cull_t *cull, const obj3d *obj) {
+  size_t faces = (size_t)obj->faces_count + 4;
+
+  cull->planes = (float *)calloc(faces / 4 * PLANE_BLOCK, sizeof(float));
+  cull->face_start = (u_int *)malloc(faces * sizeof(u_int));
+  cull->scratch = (u_int *)malloc(faces * sizeof(u_int));
+  cull->faces = (u_int *)malloc(faces * sizeof(u_int));
+  cull->polygons.indeces_count = (u_int *)malloc(faces * sizeof(u_int));
+  if (!cull->planes || !cull->face_start || !cull->scratch || !cull->faces ||
+      !cull->polygons.indeces_count) {
+    return FALSE;
+  }
+  cull->face_start[0] = 0;
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    unsigned long long next = (unsigned long long)cull->face_start[f] +
+                              obj->polygons.indeces_count[f];
+    if (next > obj->total_indexes) return FALSE;
+    cull->face_start[f + 1] = (u_int)next;
+  }
+  cull->polygons.vertexes_ind = (u_int *)malloc(
+      ((size_t)cull->face_start[obj->faces_count] + 1) * sizeof(u_int));
+
+  return cull->polygons.vertexes_ind != NULL;
+}
+
+int face_cull_update(face_cull_t *cull, const obj3d *obj, u_int threads) {
+  cull_job_t job;
+
+  if (!cull || !obj) return FALSE;
+  if (cull->obj != obj || cull->planes_faces != obj->faces_count) {
+    release_face_buffers(cull);
+    if (!alloc_face_buffers(cull, obj)) {
+      release_face_buffers(cull);
+      return FALSE;
+    }
+  }
+  memset(&job, 0, sizeof(job));
+  job.cull = cull;
+  job.obj = obj;
+  parallel_for(obj->faces_count, threads, planes_range, &job);
+  cull->obj = obj;
+  cull->planes_faces = obj->faces_count;
+
+  return TRUE;
+}
+
+/*-------------------------------frame--------------------------------*/
+
+static double det3(double a[3][3]) {
+  return a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+         a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+         a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+}
+
+/**
+ * @brief null vector of rows x, y and w of mvp, oriented towards the viewer
+ */
+static void frame_camera(cull_job_t *job) {
+  const float *rows[3] = {job->mvp[0], job->mvp[1], job->mvp[3]};
+  double camera[4], length = 0.0;
+
+  // i-я координата - минор без i-го столбца со знаком (-1)^i
+  for (int i = 0; i < 4; i++) {
+    double minor[3][3];
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0, k = 0; c < 4; c++) {
+        if (c != i) minor[r][k++] = rows[r][c];
+      }
+    }
+    camera[i] = (i % 2 ? -1.0 : 1.0) * det3(minor);
+    length += camera[i] * camera[i];
+  }
+  length = sqrt(length);
+  if (fabs(camera[3]) > length * 1e-7) {
+    for (int i = 0; i < 4; i++) camera[i] /= camera[3];
+  } else {
+    // бесконечная камера лежит против направления роста глубины
+    double depth = camera[0] * job->mvp[2][0] + camera[1] * job->mvp[2][1] +
+                   camera[2] * job->mvp[2][2];
+    camera[3] = 0.0;
+    for (int i = 0; i < 3; i++) camera[i] *= depth > 0.0 ? -1.0 : 1.0;
+  }
+  for (int i = 0; i < 4; i++) job->camera[i] = (float)camera[i];
+}
+
+/**
+ * @brief bits of clip planes -x, +x, -y, +y, -z, +z which the vertex is behind
+ */
+static void outcodes_range(void *ctx, u_int begin, u_int end,
+                           u_int thread_index) {
+  cull_job_t *job = (cull_job_t *)ctx;
+  float(*m)[4] = job->mvp;
+  (void)thread_index;
+
+  for (u_int v = begin; v < end; v++) {
+    const float *p = job->obj->vertexes + (size_t)v * AX_DIMEN;
+    float clip[4];
+    for (int i = 0; i < 4; i++) {
+      clip[i] = m[i][0] * p[0] + m[i][1] * p[1] + m[i][2] * p[2] + m[i][3];
+    }
+    job->cull->outcodes[v] = (unsigned char)(
+        (clip[0] < -clip[3]) | (clip[0] > clip[3]) << 1 |
+        (clip[1] < -clip[3]) << 2 | (clip[1] > clip[3]) << 3 |
+        (clip[2] < -clip[3]) << 4 | (clip[2] > clip[3]) << 5);
+  }
+}
+
+/*-------------------------------faces--------------------------------*/
+
+/**
+ * @brief bit k is set if face k of the block faces the camera
+ */
+static int facing_mask(const float *block, const float *camera) {
+#if defined(__SSE2__)
+  __m128 s = _mm_mul_ps(_mm_loadu_ps(block), _mm_set1_ps(camera[0]));
+  s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(block + 4),
+                               _mm_set1_ps(camera[1])));
+  s = _mm_add_ps(s, _mm_mul_ps(_mm_loadu_ps(block + 8),
+                               _mm_set1_ps(camera[2])));
+  s = _mm_sub_ps(s, _mm_mul_ps(_mm_loadu_ps(block + 12),
+                               _mm_set1_ps(camera[3])));
+
+  return _mm_movemask_ps(_mm_cmpgt_ps(s, _mm_setzero_ps()));
+#else
+  int mask = 0;
+
+  for (int k = 0; k < 4; k++) {
+    float s = block[k] * camera[0] + block[4 + k] * camera[1] +
+              block[8 + k] * camera[2] - block[12 + k] * camera[3];
+    mask |= (s > 0.0f) << k;
+  }
+
+  return mask;
+#endif
+}
+
+static int is_outside(const cull_job_t *job, u_int face) {
+  const u_int *start = job->cull->face_start;
+  const u_int *ind = job->obj->polygons.vertexes_ind;
+  unsigned char common = 0x3F;
+
+  for (u_int k = start[face]; common && k < start[face + 1]; k++) {
+    // битая вершина не отсекает грань, ее отбросит рисование
+    if (ind[k] == 0 || ind[k] > job->obj->vertexes_count) return FALSE;
+    common &= job->cull->outcodes[ind[k] - 1];
+  }
+
+  return common != 0;
+}
+
+/**
+ * @brief visible faces of the chunk of blocks [begin, end)
+ */
+static void select_range(void *ctx, u_int begin, u_int end,
+                         u_int thread_index) {
+  cull_job_t *job = (cull_job_t *)ctx;
+  const face_cull_t *cull = job->cull;
+  u_int faces_count = job->obj->faces_count;
+  u_int *out = cull->scratch + (size_t)begin * 4;
+  u_int visible = 0, indexes = 0;
+
+  for (u_int b = begin; b < end; b++) {
+    int mask = job->mode & CULL_BACK_FACES
+                   ? facing_mask(cull->planes + (size_t)b * PLANE_BLOCK,
+                                 job->camera)
+                   : 0xF;
+    for (u_int k = 0; mask && k < 4; k++, mask >>= 1) {
+      u_int face = b * 4 + k;
+      if (!(mask & 1) || face >= faces_count) continue;
+      if ((job->mode & CULL_FRUSTUM) && is_outside(job, face)) continue;
+      out[visible++] = face;
+      indexes += cull->face_start[face + 1] - cull->face_start[face];
+    }
+  }
+  job->chunk_begin[thread_index] = begin * 4;
+  job->chunk_faces[thread_index] = visible;
+  job->chunk_indexes[thread_index] = indexes;
+}
+
+/**
+ * @brief copy visible faces of the chunk to their place in the output
+ */
+static void compact_range(void *ctx, u_int begin, u_int end,
+                          u_int thread_index) {
+  cull_job_t *job = (cull_job_t *)ctx;
+  face_cull_t *cull = job->cull;
+  u_int face_offset = job->face_offset[thread_index];
+  const u_int *in = cull->scratch + job->chunk_begin[thread_index];
+  u_int *faces = cull->faces + face_offset;
+  u_int *counts = cull->polygons.indeces_count + face_offset;
+  u_int *indexes = cull->polygons.vertexes_ind + job->index_offset[thread_index];
+  (void)begin;
+  (void)end;
+
+  for (u_int i = 0; i < job->chunk_faces[thread_index]; i++) {
+    u_int face = in[i], first = cull->face_start[face];
+    u_int n = cull->face_start[face + 1] - first;
+    faces[i] = face;
+    counts[i] = n;
+    memcpy(indexes, job->obj->polygons.vertexes_ind + first,
+           n * sizeof(u_int));
+    indexes += n;
+  }
+}
+
+int cull_faces(face_cull_t *cull, const obj3d *obj, float model[4][4],
+               float view[4][4], float projection[4][4], int mode,
+               u_int threads) {
+  float mv[4][4];
+  cull_job_t job;
+  u_int chunks = 0;
+
+  if (!cull || !obj) return FALSE;
+  if (cull->obj != obj || cull->planes_faces != obj->faces_count) {
+    if (!face_cull_update(cull, obj, threads)) return FALSE;
+  }
+  if (cull->outcodes_capacity < obj->vertexes_count + 1) {
+    free(cull->outcodes);
+    cull->outcodes = (unsigned char *)malloc(obj->vertexes_count + 1);
+    cull->outcodes_capacity = cull->outcodes ? obj->vertexes_count + 1 : 0;
+    if (!cull->outcodes) return FALSE;
+  }
+  memset(&job, 0, sizeof(job));
+  job.cull = cull;
+  job.obj = obj;
+  job.mode = mode;
+  matrix4_multiply(view, model, mv);
+  matrix4_multiply(projection, mv, job.mvp);
+  frame_camera(&job);
+  if (mode & CULL_FRUSTUM) {
+    parallel_for(obj->vertexes_count, threads, outcodes_range, &job);
+  }
+  chunks =
+      parallel_for((obj->faces_count + 3) / 4, threads, select_range, &job);
+  cull->faces_count = 0;
+  cull->total_indexes = 0;
+  for (u_int t = 0; t < chunks; t++) {
+    job.face_offset[t] = cull->faces_count;
+    job.index_offset[t] = cull->total_indexes;
+    cull->faces_count += job.chunk_faces[t];
+    cull->total_indexes += job.chunk_indexes[t];
+  }
+  // кусок t второго прохода переносит результат куска t первого
+  parallel_for(chunks, chunks, compact_range, &job);
+
+  return TRUE;
+}
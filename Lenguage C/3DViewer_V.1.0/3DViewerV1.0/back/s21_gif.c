@@ -0,0 +1,619 @@
+/**
+ * @file s21_gif.c
+ * @brief Background GIF recorder: lock-free frame queue, parallel color
+ * quantization and LZW encoding on a dedicated thread
+ * @details
+ * Путь кадра:
+ * 1) поток интерфейса вызывает gif_recorder_push: берет свободный слот из
+ *    очереди свободных слотов, копирует кадр и кладет слот в очередь работы.
+ *    Обе очереди кольцевые и без блокировок (алгоритм Вьюкова), поэтому
+ *    интерфейс никогда не ждет: если слотов нет, кадр отбрасывается;
+ * 2) пул потоков квантования забирает кадры из очереди работы, строит для
+ *    каждого кадра свою палитру из 256 цветов методом медианного сечения и
+ *    переводит кадр в индексы палитры;
+ * 3) отдельный поток кодирования записывает кадры строго по порядку номеров
+ *    (LZW, GIF89a) и возвращает слоты в очередь свободных.
+ * Спящие потоки будятся условной переменной без захвата мьютекса со стороны
+ * интерфейса, потерянное пробуждение стоит не больше GIF_POLL_MS.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include "s21_3d_viewer.h"
+
+#define GIF_POLL_MS 2        ///< Max sleep of an idle worker
+#define GIF_COLORS 256       ///< Palette size of every frame
+#define GIF_HIST_BITS 5      ///< Bits per channel in the color histogram
+#define GIF_HIST_SIZE (1 << (3 * GIF_HIST_BITS))
+#define LZW_MAX_CODE 4095    ///< Max code of 12-bit LZW
+#define LZW_HASH_BITS 13     ///< Hash table of LZW strings, twice the codes
+#define LZW_HASH_SIZE (1 << LZW_HASH_BITS)
+
+/**
+ * @brief bounded lock-free MPMC ring of slot indexes
+ */
+typedef struct {
+  atomic_uint sequence;
+  u_int value;
+} ring_cell_t;
+
+typedef struct {
+  ring_cell_t *cells;
+  u_int mask;
+  atomic_uint head;
+  atomic_uint tail;
+} frame_ring_t;
+
+/**
+ * @brief one frame in flight
+ */
+typedef struct {
+  unsigned char *rgba;     ///< captured frame
+  unsigned char *indexed;  ///< palette indexes of pixels
+  unsigned char palette[GIF_COLORS * 3];
+  u_int number;            ///< sequence number of the frame
+} frame_slot_t;
+
+/**
+ * @brief sleeping place of idle threads
+ */
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} doorbell_t;
+
+struct gif_recorder {
+  FILE *file;
+  u_int width;
+  u_int height;
+  u_int delay_cs;
+  u_int capacity;
+  frame_slot_t *slots;
+  frame_ring_t free_slots;
+  frame_ring_t work;
+  atomic_uint *done;  ///< [number % capacity] = slot + 1 of quantized frame
+  u_int next_number;  ///< touched only by the pushing thread
+  atomic_uint pushed;
+  atomic_uint encoded;
+  atomic_uint dropped;
+  atomic_int stop;
+  atomic_int failed;
+  doorbell_t work_bell;
+  doorbell_t done_bell;
+  pthread_t workers[MAX_THREADS];
+  u_int workers_count;
+  pthread_t encoder;
+  int is_encoder_started;
+};
+
+/*----------------------------lock-free ring--------------------------*/
+
+static int ring_init(frame_ring_t *ring, u_int capacity) {
+  ring->cells = (ring_cell_t *)malloc(capacity * sizeof(ring_cell_t));
+  if (!ring->cells) return FALSE;
+  for (u_int i = 0; i < capacity; i++) atomic_init(&ring->cells[i].sequence, i);
+  ring->mask = capacity - 1;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+
+  return TRUE;
+}
+
+static int ring_push(frame_ring_t *ring, u_int value) {
+  u_int pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+  while (1) {
+    ring_cell_t *cell = &ring->cells[pos & ring->mask];
+    u_int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    int diff = (int)(seq - pos);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        cell->value = value;
+        atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+        return TRUE;
+      }
+    } else if (diff < 0) {
+      return FALSE;
+    } else {
+      pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    }
+  }
+}
+
+static int ring_pop(frame_ring_t *ring, u_int *value) {
+  u_int pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+  while (1) {
+    ring_cell_t *cell = &ring->cells[pos & ring->mask];
+    u_int seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    int diff = (int)(seq - (pos + 1));
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        *value = cell->value;
+        atomic_store_explicit(&cell->sequence, pos + ring->mask + 1,
+                              memory_order_release);
+        return TRUE;
+      }
+    } else if (diff < 0) {
+      return FALSE;
+    } else {
+      pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    }
+  }
+}
+
+static void doorbell_wait(doorbell_t *bell) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += GIF_POLL_MS * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  pthread_mutex_lock(&bell->mutex);
+  pthread_cond_timedwait(&bell->cond, &bell->mutex, &ts);
+  pthread_mutex_unlock(&bell->mutex);
+}
+
+/*------------------------median cut quantization---------------------*/
+
+/**
+ * @brief box of the color histogram, bounds are inclusive
+ */
+typedef struct {
+  u_int lo[3];
+  u_int hi[3];
+  unsigned long long pixels;
+} color_box_t;
+
+static u_int hist_index(u_int r, u_int g, u_int b) {
+  return (r << (2 * GIF_HIST_BITS)) | (g << GIF_HIST_BITS) | b;
+}
+
+static void box_shrink(color_box_t *box, const u_int *hist) {
+  u_int lo[3] = {31, 31, 31}, hi[3] = {0, 0, 0};
+
+  box->pixels = 0;
+  for (u_int r = box->lo[0]; r <= box->hi[0]; r++) {
+    for (u_int g = box->lo[1]; g <= box->hi[1]; g++) {
+      for (u_int b = box->lo[2]; b <= box->hi[2]; b++) {
+        u_int count = hist[hist_index(r, g, b)];
+        if (!count) continue;
+        u_int c[3] = {r, g, b};
+        for (int i = 0; i < 3; i++) {
+          if (c[i] < lo[i]) lo[i] = c[i];
+          if (c[i] > hi[i]) hi[i] = c[i];
+        }
+        box->pixels += count;
+      }
+    }
+  }
+  if (box->pixels) {
+    memcpy(box->lo, lo, sizeof(lo));
+    memcpy(box->hi, hi, sizeof(hi));
+  }
+}
+
+/**
+ * @brief split the box by the median of its longest axis
+ */
+static int box_split(color_box_t *box, color_box_t *other, const u_int *hist) {
+  int axis = 0;
+  unsigned long long half = box->pixels / 2, sum = 0;
+  u_int cut = 0;
+
+  for (int i = 1; i < 3; i++) {
+    if (box->hi[i] - box->lo[i] > box->hi[axis] - box->lo[axis]) axis = i;
+  }
+  if (box->hi[axis] == box->lo[axis]) return FALSE;
+  for (cut = box->lo[axis]; cut < box->hi[axis]; cut++) {
+    color_box_t slice = *box;
+    slice.lo[axis] = slice.hi[axis] = cut;
+    box_shrink(&slice, hist);
+    sum += slice.pixels;
+    if (sum >= half) break;
+  }
+  if (cut == box->hi[axis]) cut--;
+  *other = *box;
+  box->hi[axis] = cut;
+  other->lo[axis] = cut + 1;
+  box_shrink(box, hist);
+  box_shrink(other, hist);
+
+  return TRUE;
+}
+
+static u_int build_palette(const u_int *hist, unsigned char *palette) {
+  color_box_t boxes[GIF_COLORS];
+  u_int count = 1;
+
+  boxes[0].lo[0] = boxes[0].lo[1] = boxes[0].lo[2] = 0;
+  boxes[0].hi[0] = boxes[0].hi[1] = boxes[0].hi[2] = 31;
+  box_shrink(&boxes[0], hist);
+  while (count < GIF_COLORS) {
+    int best = -1;
+    for (u_int i = 0; i < count; i++) {
+      int is_splittable = boxes[i].hi[0] > boxes[i].lo[0] ||
+                          boxes[i].hi[1] > boxes[i].lo[1] ||
+                          boxes[i].hi[2] > boxes[i].lo[2];
+      if (is_splittable &&
+          (best < 0 || boxes[i].pixels > boxes[best].pixels)) {
+        best = (int)i;
+      }
+    }
+    if (best < 0 || !box_split(&boxes[best], &boxes[count], hist)) break;
+    count++;
+  }
+  // цвет палитры - средний цвет ячеек гистограммы внутри коробки
+  for (u_int i = 0; i < count; i++) {
+    unsigned long long sum[3] = {0}, total = 0;
+    for (u_int r = boxes[i].lo[0]; r <= boxes[i].hi[0]; r++) {
+      for (u_int g = boxes[i].lo[1]; g <= boxes[i].hi[1]; g++) {
+        for (u_int b = boxes[i].lo[2]; b <= boxes[i].hi[2]; b++) {
+          u_int n = hist[hist_index(r, g, b)];
+          sum[0] += (unsigned long long)n * r;
+          sum[1] += (unsigned long long)n * g;
+          sum[2] += (unsigned long long)n * b;
+          total += n;
+        }
+      }
+    }
+    for (int c = 0; c < 3; c++) {
+      u_int mean = total ? (u_int)((sum[c] * 8 + total * 4) / total) : 0;
+      palette[3 * i + c] = (unsigned char)(mean > 255 ? 255 : mean);
+    }
+  }
+  for (u_int i = count; i < GIF_COLORS; i++) {
+    memset(palette + 3 * i, 0, 3);
+  }
+
+  return count;
+}
+
+static void quantize_frame(frame_slot_t *slot, u_int pixels, u_int *hist,
+                           unsigned char *lut) {
+  const unsigned char *rgba = slot->rgba;
+  u_int colors = 0;
+
+  memset(hist, 0, GIF_HIST_SIZE * sizeof(u_int));
+  for (u_int p = 0; p < pixels; p++, rgba += 4) {
+    hist[hist_index(rgba[0] >> 3, rgba[1] >> 3, rgba[2] >> 3)]++;
+  }
+  colors = build_palette(hist, slot->palette);
+  // ближайший цвет палитры только для встретившихся ячеек гистограммы
+  for (u_int h = 0; h < GIF_HIST_SIZE; h++) {
+    if (!hist[h]) continue;
+    int r = (int)((h >> (2 * GIF_HIST_BITS)) << 3) + 4;
+    int g = (int)(((h >> GIF_HIST_BITS) & 31) << 3) + 4;
+    int b = (int)((h & 31) << 3) + 4;
+    int best = 0, best_dist = 1 << 30;
+    for (u_int i = 0; i < colors && best_dist; i++) {
+      int dr = r - slot->palette[3 * i], dg = g - slot->palette[3 * i + 1];
+      int db = b - slot->palette[3 * i + 2];
+      int dist = dr * dr + dg * dg + db * db;
+      if (dist < best_dist) {
+        best_dist = dist;
+        best = (int)i;
+      }
+    }
+    lut[h] = (unsigned char)best;
+  }
+  rgba = slot->rgba;
+  for (u_int p = 0; p < pixels; p++, rgba += 4) {
+    slot->indexed[p] =
+        lut[hist_index(rgba[0] >> 3, rgba[1] >> 3, rgba[2] >> 3)];
+  }
+}
+
+static void *quantize_worker(void *arg) {
+  gif_recorder_t *rec = (gif_recorder_t *)arg;
+  u_int pixels = rec->width * rec->height;
+  u_int *hist = (u_int *)malloc(GIF_HIST_SIZE * sizeof(u_int));
+  unsigned char *lut = (unsigned char *)malloc(GIF_HIST_SIZE);
+  u_int slot = 0;
+
+  if (!hist || !lut) atomic_store(&rec->failed, TRUE);
+  while (hist && lut) {
+    if (ring_pop(&rec->work, &slot)) {
+      frame_slot_t *frame = &rec->slots[slot];
+      quantize_frame(frame, pixels, hist, lut);
+      atomic_store_explicit(&rec->done[frame->number % rec->capacity],
+                            slot + 1, memory_order_release);
+      pthread_cond_signal(&rec->done_bell.cond);
+    } else if (atomic_load(&rec->stop)) {
+      break;
+    } else {
+      doorbell_wait(&rec->work_bell);
+    }
+  }
+  free(hist);
+  free(lut);
+
+  return NULL;
+}
+
+/*------------------------------LZW encoder---------------------------*/
+
+/**
+ * @brief state of the variable-length code writer with 255-byte sub-blocks
+ */
+typedef struct {
+  FILE *file;
+  unsigned char block[256];
+  u_int block_size;
+  unsigned long bits;
+  u_int bits_count;
+} lzw_writer_t;
+
+static void lzw_flush_block(lzw_writer_t *w) {
+  if (w->block_size) {
+    fputc((int)w->block_size, w->file);
+    fwrite(w->block, 1, w->block_size, w->file);
+    w->block_size = 0;
+  }
+}
+
+static void lzw_put_code(lzw_writer_t *w, u_int code, u_int code_size) {
+  w->bits |= (unsigned long)code << w->bits_count;
+  w->bits_count += code_size;
+  while (w->bits_count >= 8) {
+    w->block[w->block_size++] = (unsigned char)(w->bits & 0xFF);
+    w->bits >>= 8;
+    w->bits_count -= 8;
+    if (w->block_size == 255) lzw_flush_block(w);
+  }
+}
+
+static void lzw_encode(FILE *file, const unsigned char *data, u_int length) {
+  static const u_int min_code_size = 8;
+  const u_int clear = 1U << min_code_size, eoi = clear + 1;
+  long keys[LZW_HASH_SIZE];
+  unsigned short codes[LZW_HASH_SIZE];
+  lzw_writer_t w = {file, {0}, 0, 0, 0};
+  u_int code_size = min_code_size + 1, next_code = eoi + 1;
+  u_int prefix = 0;
+
+  fputc((int)min_code_size, file);
+  for (u_int i = 0; i < LZW_HASH_SIZE; i++) keys[i] = -1;
+  lzw_put_code(&w, clear, code_size);
+  if (length) prefix = data[0];
+  for (u_int i = 1; i < length; i++) {
+    u_int c = data[i];
+    long key = ((long)c << 12) | prefix;
+    // мультипликативный хеш: у кадра с одним фоном ключи почти одинаковы
+    u_int h = ((u_int)key * 2654435761U) >> (32 - LZW_HASH_BITS);
+    int is_found = FALSE;
+
+    while (keys[h] >= 0) {
+      if (keys[h] == key) {
+        prefix = codes[h];
+        is_found = TRUE;
+        break;
+      }
+      h = (h + 1) & (LZW_HASH_SIZE - 1);
+    }
+    if (is_found) continue;
+    lzw_put_code(&w, prefix, code_size);
+    if (next_code <= LZW_MAX_CODE) {
+      // ширина кода растет, когда в словарь добавляется код 2^code_size
+      if (next_code == (1U << code_size) && code_size < 12) code_size++;
+      keys[h] = key;
+      codes[h] = (unsigned short)next_code++;
+    } else {
+      lzw_put_code(&w, clear, code_size);
+      for (u_int k = 0; k < LZW_HASH_SIZE; k++) keys[k] = -1;
+      code_size = min_code_size + 1;
+      next_code = eoi + 1;
+    }
+    prefix = c;
+  }
+  if (length) lzw_put_code(&w, prefix, code_size);
+  // декодер на последнем коде добавит в словарь еще одну строку
+  if (length && next_code == (1U << code_size) && code_size < 12) code_size++;
+  lzw_put_code(&w, eoi, code_size);
+  if (w.bits_count) lzw_put_code(&w, 0, 8 - w.bits_count);
+  lzw_flush_block(&w);
+  fputc(0, file);
+}
+
+static void put_le16(FILE *file, u_int value) {
+  fputc((int)(value & 0xFF), file);
+  fputc((int)((value >> 8) & 0xFF), file);
+}
+
+static void gif_write_header(gif_recorder_t *rec) {
+  static const unsigned char loop[19] = {
+      0x21, 0xFF, 0x0B, 'N', 'E', 'T', 'S', 'C', 'A', 'P',
+      'E',  '2',  '.',  '0', 0x03, 0x01, 0x00, 0x00, 0x00};
+
+  fwrite("GIF89a", 1, 6, rec->file);
+  put_le16(rec->file, rec->width);
+  put_le16(rec->file, rec->height);
+  fputc(0x00, rec->file);  // без глобальной палитры
+  fputc(0x00, rec->file);
+  fputc(0x00, rec->file);
+  fwrite(loop, 1, sizeof(loop), rec->file);
+}
+
+static void gif_write_frame(gif_recorder_t *rec, const frame_slot_t *frame) {
+  const unsigned char control[4] = {0x21, 0xF9, 0x04, 0x00};
+
+  fwrite(control, 1, sizeof(control), rec->file);
+  put_le16(rec->file, rec->delay_cs);
+  fputc(0x00, rec->file);
+  fputc(0x00, rec->file);
+  fputc(0x2C, rec->file);
+  put_le16(rec->file, 0);
+  put_le16(rec->file, 0);
+  put_le16(rec->file, rec->width);
+  put_le16(rec->file, rec->height);
+  fputc(0x87, rec->file);  // локальная палитра из 256 цветов
+  fwrite(frame->palette, 1, sizeof(frame->palette), rec->file);
+  lzw_encode(rec->file, frame->indexed, rec->width * rec->height);
+}
+
+static void *encode_worker(void *arg) {
+  gif_recorder_t *rec = (gif_recorder_t *)arg;
+  u_int number = 0;
+
+  while (1) {
+    atomic_uint *done = &rec->done[number % rec->capacity];
+    u_int slot = atomic_load_explicit(done, memory_order_acquire);
+    if (slot) {
+      atomic_store(done, 0);
+      gif_write_frame(rec, &rec->slots[slot - 1]);
+      number++;
+      atomic_store(&rec->encoded, number);
+      ring_push(&rec->free_slots, slot - 1);
+    } else if (atomic_load(&rec->stop) &&
+               (number == atomic_load(&rec->pushed) ||
+                atomic_load(&rec->failed))) {
+      break;
+    } else {
+      doorbell_wait(&rec->done_bell);
+    }
+  }
+
+  return NULL;
+}
+
+/*------------------------------public API----------------------------*/
+
+static void gif_recorder_free(gif_recorder_t *rec) {
+  for (u_int i = 0; rec->slots && i < rec->capacity; i++) {
+    free(rec->slots[i].rgba);
+    free(rec->slots[i].indexed);
+  }
+  free(rec->slots);
+  free(rec->free_slots.cells);
+  free(rec->work.cells);
+  free(rec->done);
+  pthread_mutex_destroy(&rec->work_bell.mutex);
+  pthread_cond_destroy(&rec->work_bell.cond);
+  pthread_mutex_destroy(&rec->done_bell.mutex);
+  pthread_cond_destroy(&rec->done_bell.cond);
+  if (rec->file) fclose(rec->file);
+  free(rec);
+}
+
+static int gif_recorder_alloc(gif_recorder_t *rec) {
+  int function_result = ring_init(&rec->free_slots, rec->capacity) &&
+                        ring_init(&rec->work, rec->capacity);
+
+  rec->slots = (frame_slot_t *)calloc(rec->capacity, sizeof(frame_slot_t));
+  rec->done = (atomic_uint *)malloc(rec->capacity * sizeof(atomic_uint));
+  function_result = function_result && rec->slots && rec->done;
+  for (u_int i = 0; function_result && i < rec->capacity; i++) {
+    size_t pixels = (size_t)rec->width * rec->height;
+    atomic_init(&rec->done[i], 0);
+    rec->slots[i].rgba = (unsigned char *)malloc(pixels * 4);
+    rec->slots[i].indexed = (unsigned char *)malloc(pixels);
+    function_result = rec->slots[i].rgba && rec->slots[i].indexed &&
+                      ring_push(&rec->free_slots, i);
+  }
+
+  return function_result;
+}
+
+gif_recorder_t *gif_recorder_start(const char *path, u_int width, u_int height,
+                                   u_int delay_cs, u_int queue_frames,
+                                   u_int workers) {
+  gif_recorder_t *rec = NULL;
+  u_int capacity = 2;
+
+  if (!path || width == 0 || height == 0 || width > 65535 || height > 65535) {
+    return NULL;
+  }
+  rec = (gif_recorder_t *)calloc(1, sizeof(gif_recorder_t));
+  if (!rec) return NULL;
+  // емкость очереди - степень двойки
+  while (capacity < queue_frames) capacity <<= 1;
+  rec->width = width;
+  rec->height = height;
+  rec->delay_cs = delay_cs;
+  rec->capacity = capacity;
+  atomic_init(&rec->pushed, 0);
+  atomic_init(&rec->encoded, 0);
+  atomic_init(&rec->dropped, 0);
+  atomic_init(&rec->stop, FALSE);
+  atomic_init(&rec->failed, FALSE);
+  pthread_mutex_init(&rec->work_bell.mutex, NULL);
+  pthread_cond_init(&rec->work_bell.cond, NULL);
+  pthread_mutex_init(&rec->done_bell.mutex, NULL);
+  pthread_cond_init(&rec->done_bell.cond, NULL);
+  rec->file = fopen(path, "wb");
+  if (!rec->file || !gif_recorder_alloc(rec)) {
+    gif_recorder_free(rec);
+    return NULL;
+  }
+  gif_write_header(rec);
+
+  workers = get_threads_count(workers);
+  if (workers > MAX_THREADS) workers = MAX_THREADS;
+  for (u_int i = 0; i < workers; i++) {
+    if (pthread_create(&rec->workers[i], NULL, quantize_worker, rec)) break;
+    rec->workers_count++;
+  }
+  rec->is_encoder_started =
+      pthread_create(&rec->encoder, NULL, encode_worker, rec) == 0;
+  if (!rec->workers_count || !rec->is_encoder_started) {
+    gif_recorder_finish(rec);
+    rec = NULL;
+  }
+
+  return rec;
+}
+
+int gif_recorder_push(gif_recorder_t *rec, const unsigned char *rgba) {
+  u_int slot = 0;
+
+  if (!rec || !rgba) return FALSE;
+  if (!ring_pop(&rec->free_slots, &slot)) {
+    atomic_fetch_add(&rec->dropped, 1);
+    return FALSE;
+  }
+  memcpy(rec->slots[slot].rgba, rgba, (size_t)rec->width * rec->height * 4);
+  rec->slots[slot].number = rec->next_number++;
+  // свободных слотов не больше емкости, поэтому место в очереди работы есть
+  ring_push(&rec->work, slot);
+  atomic_fetch_add(&rec->pushed, 1);
+  pthread_cond_signal(&rec->work_bell.cond);
+
+  return TRUE;
+}
+
+void gif_recorder_stats(gif_recorder_t *rec, u_int *encoded, u_int *dropped) {
+  if (encoded) *encoded = atomic_load(&rec->encoded);
+  if (dropped) *dropped = atomic_load(&rec->dropped);
+}
+
+int gif_recorder_finish(gif_recorder_t *rec) {
+  int function_result = FALSE;
+
+  if (!rec) return function_result;
+  atomic_store(&rec->stop, TRUE);
+  pthread_cond_broadcast(&rec->work_bell.cond);
+  for (u_int i = 0; i < rec->workers_count; i++) {
+    pthread_join(rec->workers[i], NULL);
+  }
+  if (rec->is_encoder_started) {
+    pthread_cond_broadcast(&rec->done_bell.cond);
+    pthread_join(rec->encoder, NULL);
+  }
+  fputc(0x3B, rec->file);
+  function_result = rec->workers_count && rec->is_encoder_started &&
+                    !atomic_load(&rec->failed) && !ferror(rec->file);
+  function_result = fclose(rec->file) == 0 && function_result;
+  rec->file = NULL;
+  gif_recorder_free(rec);
+
+  return function_result;
+}
@@ -0,0 +1,361 @@
+/**
+ * @file s21_loader.c
+ * @brief Asynchronous cancellable loading of .obj files
+ * @details
+ * Файл разбирается и ребра считаются в отдельном потоке, интерфейс только
+ * опрашивает состояние (например, таймером раз в кадр) и поэтому не
+ * блокируется. Прогресс обновляется после каждого окна BUFFER_SIZE, там же
+ * проверяется запрос отмены. Готовый объект публикуется одним атомарным
+ * указателем и забирается атомарным обменом, поэтому получить его может
+ * только один вызов obj_loader_take.
+ *
+ * Много файлов (obj_multi_loader_start) загружаются пулом потоков из
+ * parallel_for: каждый поток берет следующий файл из общей очереди,
+ * отсортированной по убыванию размера, поэтому самые долгие файлы
+ * начинаются первыми и не остаются на конец. Взяв файл, поток просит ядро
+ * заранее прочитать следующий файл очереди, и его чтение с диска идет
+ * одновременно с разбором текущих.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "s21_3d_viewer.h"
+
+struct obj_loader {
+  char *path;
+  pthread_t thread;
+  atomic_int state;
+  atomic_int is_cancel_requested;
+  atomic_ullong bytes_read;
+  atomic_ullong bytes_total;
+  _Atomic(obj3d *) result;
+  u_int edges_count;   ///< written before result is published
+  load_stats_t stats;  ///< written before state is published
+};
+
+static int loader_progress(void *user, unsigned long long bytes_read,
+                           unsigned long long bytes_total) {
+  obj_loader_t *loader = (obj_loader_t *)user;
+
+  atomic_store_explicit(&loader->bytes_total, bytes_total,
+                        memory_order_relaxed);
+  atomic_store_explicit(&loader->bytes_read, bytes_read, memory_order_relaxed);
+
+  return !atomic_load_explicit(&loader->is_cancel_requested,
+                               memory_order_relaxed);
+}
+
+static void *loader_run(void *arg) {
+  obj_loader_t *loader = (obj_loader_t *)arg;
+  obj3d *obj = NULL;
+  int state = LOAD_FAILED;
+
+  load_stats_attach(&loader->stats);
+  obj = parse_obj_file_progress(loader->path, loader_progress, loader);
+  if (obj) {
+    loader->edges_count = get_count_edges(obj);
+    atomic_store_explicit(&loader->result, obj, memory_order_release);
+    state = LOAD_DONE;
+  } else if (atomic_load(&loader->is_cancel_requested)) {
+    state = LOAD_CANCELLED;
+  }
+  load_stats_attach(NULL);
+  atomic_store_explicit(&loader->state, state, memory_order_release);
+
+  return NULL;
+}
+
+obj_loader_t *obj_loader_start(const char *path) {
+  obj_loader_t *loader = NULL;
+
+  if (!path) return NULL;
+  loader = (obj_loader_t *)calloc(1, sizeof(obj_loader_t));
+  if (!loader) return NULL;
+  loader->path = strdup(path);
+  atomic_init(&loader->state, LOAD_RUNNING);
+  atomic_init(&loader->is_cancel_requested, FALSE);
+  atomic_init(&loader->bytes_read, 0);
+  atomic_init(&loader->bytes_total, 0);
+  atomic_init(&loader->result, NULL);
+  if (!loader->path ||
+      pthread_create(&loader->thread, NULL, loader_run, loader)) {
+    free(loader->path);
+    free(loader);
+    loader = NULL;
+  }
+
+  return loader;
+}
+
+int obj_loader_poll(obj_loader_t *loader, unsigned long long *bytes_read,
+                    unsigned long long *bytes_total) {
+  if (!loader) return LOAD_FAILED;
+  if (bytes_read) *bytes_read = atomic_load(&loader->bytes_read);
+  if (bytes_total) *bytes_total = atomic_load(&loader->bytes_total);
+
+  return atomic_load_explicit(&loader->state, memory_order_acquire);
+}
+
+void obj_loader_cancel(obj_loader_t *loader) {
+  if (loader) atomic_store(&loader->is_cancel_requested, TRUE);
+}
+
+obj3d *obj_loader_take(obj_loader_t *loader, u_int *edges_count) {
+  obj3d *obj = NULL;
+
+  if (!loader) return NULL;
+  obj = atomic_exchange_explicit(&loader->result, NULL, memory_order_acquire);
+  if (obj && edges_count) *edges_count = loader->edges_count;
+
+  return obj;
+}
+
+int obj_loader_stats(obj_loader_t *loader, load_stats_t *stats) {
+  if (!loader || !stats) return FALSE;
+  if (obj_loader_poll(loader, NULL, NULL) == LOAD_RUNNING) return FALSE;
+  *stats = loader->stats;
+
+  return TRUE;
+}
+
+void obj_loader_destroy(obj_loader_t *loader) {
+  obj3d *obj = NULL;
+
+  if (!loader) return;
+  obj_loader_cancel(loader);
+  pthread_join(loader->thread, NULL);
+  obj = atomic_exchange(&loader->result, NULL);
+  if (obj) obj_destroy(obj);
+  free(loader->path);
+  free(loader);
+}
+
+/*-----------------------------many files-----------------------------*/
+
+/**
+ * @brief one file of the multi loader
+ */
+typedef struct {
+  char *path;
+  long long size;  ///< -1 if the file can't be accessed
+  atomic_int state;
+  _Atomic(obj3d *) result;
+  u_int edges_count;  ///< written before state is published
+} multi_file_t;
+
+struct obj_multi_loader {
+  multi_file_t *files;
+  u_int *order;  ///< indices of files, larger first
+  u_int count;
+  u_int threads;
+  load_done_t done;
+  void *user;
+  pthread_t thread;
+  atomic_uint next;      ///< position of the next file in order
+  atomic_uint finished;  ///< count of files with the final state
+  atomic_int is_cancel_requested;
+};
+
+static int multi_progress(void *user, unsigned long long bytes_read,
+                          unsigned long long bytes_total) {
+  (void)bytes_read;
+  (void)bytes_total;
+
+  return !atomic_load_explicit((atomic_int *)user, memory_order_relaxed);
+}
+
+static void read_ahead(const char *path) {
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0) return;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  close(fd);
+}
+
+static void multi_finish(obj_multi_loader_t *loader, u_int index, int state) {
+  atomic_store_explicit(&loader->files[index].state, state,
+                        memory_order_release);
+  // счетчик растет после обратного вызова, чтобы poll не обгонял его
+  if (loader->done) loader->done(loader->user, index, state);
+  atomic_fetch_add_explicit(&loader->finished, 1, memory_order_release);
+}
+
+static void multi_load(obj_multi_loader_t *loader, u_int index) {
+  multi_file_t *file = &loader->files[index];
+  obj3d *obj = NULL;
+  int state = LOAD_FAILED;
+
+  if (atomic_load(&loader->is_cancel_requested)) {
+    state = LOAD_CANCELLED;
+  } else if (file->size >= 0) {
+    // отменить можно только разбор .obj, остальные форматы читаются целиком
+    if (detect_mesh_format(file->path) == MESH_OBJ) {
+      obj = parse_obj_file_progress(file->path, multi_progress,
+                                    &loader->is_cancel_requested);
+    } else {
+      obj = parse_mesh_file(file->path);
+    }
+    if (obj) {
+      file->edges_count = get_count_edges(obj);
+      atomic_store_explicit(&file->result, obj, memory_order_release);
+      state = LOAD_DONE;
+    } else if (atomic_load(&loader->is_cancel_requested)) {
+      state = LOAD_CANCELLED;
+    }
+  }
+  multi_finish(loader, index, state);
+}
+
+static void multi_worker(void *ctx, u_int begin, u_int end,
+                         u_int thread_index) {
+  obj_multi_loader_t *loader = (obj_multi_loader_t *)ctx;
+  u_int position = 0;
+  (void)begin;
+  (void)end;
+  (void)thread_index;
+
+  while ((position = atomic_fetch_add(&loader->next, 1)) < loader->count) {
+    if (position + 1 < loader->count) {
+      read_ahead(loader->files[loader->order[position + 1]].path);
+    }
+    multi_load(loader, loader->order[position]);
+  }
+}
+
+static void *multi_run(void *arg) {
+  obj_multi_loader_t *loader = (obj_multi_loader_t *)arg;
+
+  // каждый кусок parallel_for - это один поток, разбирающий файлы из очереди
+  parallel_for(loader->threads, loader->threads, multi_worker, loader);
+
+  return NULL;
+}
+
+/**
+ * @brief key of sorting files by size
+ */
+typedef struct {
+  long long size;
+  u_int index;
+} multi_order_t;
+
+static int compare_sizes(const void *a, const void *b) {
+  const multi_order_t *x = (const multi_order_t *)a;
+  const multi_order_t *y = (const multi_order_t *)b;
+
+  if (x->size != y->size) return x->size < y->size ? 1 : -1;
+
+  return x->index < y->index ? -1 : 1;
+}
+
+/**
+ * @brief fill loader->order, larger files first, inaccessible ones last
+ */
+static int sort_files(obj_multi_loader_t *loader) {
+  multi_order_t *keys =
+      (multi_order_t *)malloc((loader->count + 1) * sizeof(multi_order_t));
+
+  if (!keys) return FALSE;
+  for (u_int i = 0; i < loader->count; i++) {
+    keys[i].size = loader->files[i].size;
+    keys[i].index = i;
+  }
+  qsort(keys, loader->count, sizeof(multi_order_t), compare_sizes);
+  for (u_int i = 0; i < loader->count; i++) loader->order[i] = keys[i].index;
+  free(keys);
+
+  return TRUE;
+}
+
+static void multi_free(obj_multi_loader_t *loader) {
+  for (u_int i = 0; loader->files && i < loader->count; i++) {
+    obj3d *obj = atomic_exchange(&loader->files[i].result, NULL);
+    if (obj) obj_destroy(obj);
+    free(loader->files[i].path);
+  }
+  free(loader->files);
+  free(loader->order);
+  free(loader);
+}
+
+obj_multi_loader_t *obj_multi_loader_start(const char *const *paths,
+                                           u_int count, u_int threads,
+                                           load_done_t done, void *user) {
+  obj_multi_loader_t *loader = NULL;
+  int is_ready = TRUE;
+  struct stat st;
+
+  if (!paths && count) return NULL;
+  loader = (obj_multi_loader_t *)calloc(1, sizeof(obj_multi_loader_t));
+  if (!loader) return NULL;
+  loader->files = (multi_file_t *)calloc(count + 1, sizeof(multi_file_t));
+  loader->order = (u_int *)calloc(count + 1, sizeof(u_int));
+  loader->count = count;
+  threads = get_threads_count(threads);
+  loader->threads = threads < count ? threads : count;
+  loader->done = done;
+  loader->user = user;
+  atomic_init(&loader->next, 0);
+  atomic_init(&loader->finished, 0);
+  atomic_init(&loader->is_cancel_requested, FALSE);
+  is_ready = loader->files && loader->order;
+  for (u_int i = 0; is_ready && i < count; i++) {
+    multi_file_t *file = &loader->files[i];
+    atomic_init(&file->state, LOAD_RUNNING);
+    atomic_init(&file->result, NULL);
+    file->path = paths[i] ? strdup(paths[i]) : NULL;
+    file->size = file->path && stat(file->path, &st) == 0 ? st.st_size : -1;
+    is_ready = file->path != NULL;
+  }
+  if (is_ready && sort_files(loader)) {
+    is_ready = !pthread_create(&loader->thread, NULL, multi_run, loader);
+  } else {
+    is_ready = FALSE;
+  }
+  if (!is_ready) {
+    multi_free(loader);
+    loader = NULL;
+  }
+
+  return loader;
+}
+
+u_int obj_multi_loader_poll(obj_multi_loader_t *loader) {
+  return loader ? atomic_load_explicit(&loader->finished, memory_order_acquire)
+                : 0;
+}
+
+int obj_multi_loader_state(obj_multi_loader_t *loader, u_int index) {
+  if (!loader || index >= loader->count) return LOAD_FAILED;
+
+  return atomic_load_explicit(&loader->files[index].state,
+                              memory_order_acquire);
+}
+
+obj3d *obj_multi_loader_take(obj_multi_loader_t *loader, u_int index,
+                             u_int *edges_count) {
+  obj3d *obj = NULL;
+
+  if (!loader || index >= loader->count) return NULL;
+  obj = atomic_exchange_explicit(&loader->files[index].result, NULL,
+                                 memory_order_acquire);
+  if (obj && edges_count) *edges_count = loader->files[index].edges_count;
+
+  return obj;
+}
+
+void obj_multi_loader_cancel(obj_multi_loader_t *loader) {
+  if (loader) atomic_store(&loader->is_cancel_requested, TRUE);
+}
+
+void obj_multi_loader_destroy(obj_multi_loader_t *loader) {
+  if (!loader) return;
+  obj_multi_loader_cancel(loader);
+  pthread_join(loader->thread, NULL);
+  multi_free(loader);
+}
@@ -0,0 +1,744 @@
+/**
+ * @file s21_mesh_formats.c
+ * @brief STL and PLY readers into obj3d with detection by magic bytes
+ * @details
+ * Файл отображается в память через mmap и читается прямо из отображения,
+ * без промежуточного буфера. Формат определяется по содержимому:
+ * 1) 84 + 50 * N байт, где N записано по смещению 80, - бинарный STL, даже
+ *    если заголовок начинается с "solid", как пишут некоторые экспортеры;
+ * 2) "solid" и "facet" в начале файла - текстовый STL;
+ * 3) "ply" в первой строке - PLY (ascii, binary_little_endian и
+ *    binary_big_endian);
+ * 4) все остальное разбирается как .obj.
+ * В STL у каждого треугольника свои копии вершин, поэтому одинаковые по
+ * битам вершины сливаются через хеш-таблицу, а выродившиеся треугольники
+ * отбрасываются. Индексы в obj3d, как и в .obj, начинаются с 1.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "s21_3d_viewer.h"
+
+#define STL_HEADER_SIZE 80
+#define STL_TRIANGLE_SIZE 50
+#define PLY_MAX_ELEMENTS 16
+#define PLY_MAX_PROPERTIES 32
+#define PLY_NAME_SIZE 32
+#define NUMBER_SIZE 64  ///< longest number token of text formats
+
+typedef struct {
+  const char *data;
+  size_t size;
+} mapped_file_t;
+
+/**
+ * @brief growing arrays of the object being read
+ */
+typedef struct {
+  float *vertexes;
+  u_int vertexes_count;
+  u_int vertexes_cap;
+  u_int *counts;
+  u_int faces_count;
+  u_int faces_cap;
+  u_int *indexes;
+  u_int indexes_count;
+  u_int indexes_cap;
+} mesh_builder_t;
+
+/*-------------------------------mapping------------------------------*/
+
+static int map_file(const char *path, mapped_file_t *file) {
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  void *data = MAP_FAILED;
+
+  if (fd < 0) return FALSE;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (data == MAP_FAILED) return FALSE;
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+  file->data = (const char *)data;
+  file->size = (size_t)st.st_size;
+
+  return TRUE;
+}
+
+static void unmap_file(mapped_file_t *file) {
+  munmap((void *)file->data, file->size);
+}
+
+/*-------------------------------builder------------------------------*/
+
+static int grow(void **array, u_int *cap, u_int need, size_t item) {
+  u_int new_cap = *cap ? *cap : 1024;
+  void *bigger = NULL;
+
+  if (need <= *cap) return TRUE;
+  while (new_cap < need) {
+    if (new_cap > UINT_MAX / 2) return FALSE;
+    new_cap *= 2;
+  }
+  bigger = realloc(*array, (size_t)new_cap * item);
+  if (!bigger) return FALSE;
+  *array = bigger;
+  *cap = new_cap;
+
+  return TRUE;
+}
+
+static int builder_add_vertex(mesh_builder_t *b, const float *v) {
+  if (b->vertexes_count >= UINT_MAX / AX_DIMEN ||
+      !grow((void **)&b->vertexes, &b->vertexes_cap,
+            (b->vertexes_count + 1) * AX_DIMEN, sizeof(float))) {
+    return FALSE;
+  }
+  memcpy(b->vertexes + (size_t)b->vertexes_count * AX_DIMEN, v,
+         AX_DIMEN * sizeof(float));
+  b->vertexes_count++;
+
+  return TRUE;
+}
+
+static int builder_add_face(mesh_builder_t *b, const u_int *ind, u_int n) {
+  if (b->indexes_count > UINT_MAX - n ||
+      !grow((void **)&b->counts, &b->faces_cap, b->faces_count + 1,
+            sizeof(u_int)) ||
+      !grow((void **)&b->indexes, &b->indexes_cap, b->indexes_count + n,
+            sizeof(u_int))) {
+    return FALSE;
+  }
+  b->counts[b->faces_count++] = n;
+  memcpy(b->indexes + b->indexes_count, ind, n * sizeof(u_int));
+  b->indexes_count += n;
+
+  return TRUE;
+}
+
+static void builder_free(mesh_builder_t *b) {
+  free(b->vertexes);
+  free(b->counts);
+  free(b->indexes);
+}
+
+static void compute_bounds(obj3d *obj) {
+  float *min = &obj->bounds.x_min;
+
+  // в axises минимумы и максимумы чередуются: x_min, x_max, y_min, ...
+  for (u_int v = 0; v < obj->vertexes_count; v++) {
+    const float *p = obj->vertexes + (size_t)v * AX_DIMEN;
+    for (u_int i = 0; i < AX_DIMEN; i++) {
+      if (v == 0 || p[i] < min[2 * i]) min[2 * i] = p[i];
+      if (v == 0 || p[i] > min[2 * i + 1]) min[2 * i + 1] = p[i];
+    }
+  }
+}
+
+/**
+ * @brief move the builder into a new obj3d, the builder is freed
+ */
+static obj3d *builder_finish(mesh_builder_t *b) {
+  obj3d *obj = obj_create();
+
+  if (obj && obj_reserve(obj, b->vertexes_count, b->faces_count,
+                         b->indexes_count)) {
+    if (b->vertexes_count) {
+      memcpy(obj->vertexes, b->vertexes,
+             (size_t)b->vertexes_count * AX_DIMEN * sizeof(float));
+    }
+    if (b->faces_count) {
+      memcpy(obj->polygons.indeces_count, b->counts,
+             b->faces_count * sizeof(u_int));
+      memcpy(obj->polygons.vertexes_ind, b->indexes,
+             b->indexes_count * sizeof(u_int));
+    }
+    compute_bounds(obj);
+  } else if (obj) {
+    obj_destroy(obj);
+    obj = NULL;
+  }
+  builder_free(b);
+
+  return obj;
+}
+
+/*---------------------------------bytes------------------------------*/
+
+static u_int read_u32_le(const char *p) {
+  const unsigned char *u = (const unsigned char *)p;
+
+  return (u_int)u[0] | (u_int)u[1] << 8 | (u_int)u[2] << 16 |
+         (u_int)u[3] << 24;
+}
+
+static float read_f32_le(const char *p) {
+  u_int bits = read_u32_le(p);
+  float value = 0.0f;
+
+  memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+static int starts_with(const char *p, const char *end, const char *word) {
+  size_t len = strlen(word);
+
+  return (size_t)(end - p) >= len && memcmp(p, word, len) == 0;
+}
+
+static int is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static const char *skip_spaces(const char *p, const char *end) {
+  while (p < end && is_space(*p)) p++;
+
+  return p;
+}
+
+static const char *next_line(const char *p, const char *end) {
+  const char *eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+
+  return eol ? eol + 1 : end;
+}
+
+/**
+ * @brief read a number token of a text format, the mapping has no NUL
+ */
+static int parse_number(const char **ptr, const char *end, double *value) {
+  char token[NUMBER_SIZE];
+  const char *p = skip_spaces(*ptr, end);
+  size_t len = 0;
+  char *stop = NULL;
+
+  while (p + len < end && len < NUMBER_SIZE - 1 && !is_space(p[len])) len++;
+  if (len == 0) return FALSE;
+  memcpy(token, p, len);
+  token[len] = 0;
+  *value = strtod(token, &stop);
+  *ptr = p + len;
+
+  return stop == token + len;
+}
+
+/*-------------------------------welding------------------------------*/
+
+/**
+ * @brief open addressing set of vertexes, a slot holds index + 1
+ */
+typedef struct {
+  u_int *slots;
+  u_int mask;
+} weld_map_t;
+
+static u_int weld_hash(const float *v) {
+  u_int bits[AX_DIMEN];
+  u_int hash = 2166136261U;
+
+  memcpy(bits, v, sizeof(bits));
+  for (u_int i = 0; i < AX_DIMEN; i++) hash = (hash ^ bits[i]) * 16777619U;
+
+  return hash ^ (hash >> 15);
+}
+
+static int weld_grow(weld_map_t *map, const mesh_builder_t *b) {
+  u_int size = map->slots ? (map->mask + 1) * 2 : 1024;
+  u_int *slots = (u_int *)calloc(size, sizeof(u_int));
+
+  if (!slots || size == 0) {
+    free(slots);
+    return FALSE;
+  }
+  for (u_int v = 0; v < b->vertexes_count; v++) {
+    u_int i = weld_hash(b->vertexes + (size_t)v * AX_DIMEN) & (size - 1);
+    while (slots[i]) i = (i + 1) & (size - 1);
+    slots[i] = v + 1;
+  }
+  free(map->slots);
+  map->slots = slots;
+  map->mask = size - 1;
+
+  return TRUE;
+}
+
+/**
+ * @brief index (from 1) of the vertex equal by bits, added if it is new
+ */
+static u_int weld_vertex(weld_map_t *map, mesh_builder_t *b, const float *p) {
+  float v[AX_DIMEN];
+  u_int i = 0;
+
+  // -0.0 и 0.0 - одна и та же точка
+  for (u_int k = 0; k < AX_DIMEN; k++) v[k] = p[k] + 0.0f;
+  if ((b->vertexes_count + 1) * 2 > map->mask + 1 && !weld_grow(map, b)) {
+    return 0;
+  }
+  for (i = weld_hash(v) & map->mask; map->slots[i]; i = (i + 1) & map->mask) {
+    const float *old = b->vertexes + (size_t)(map->slots[i] - 1) * AX_DIMEN;
+    if (memcmp(old, v, sizeof(v)) == 0) return map->slots[i];
+  }
+  if (!builder_add_vertex(b, v)) return 0;
+  map->slots[i] = b->vertexes_count;
+
+  return b->vertexes_count;
+}
+
+static int add_stl_triangle(weld_map_t *map, mesh_builder_t *b,
+                            const float *corners) {
+  u_int ind[3];
+
+  for (u_int k = 0; k < 3; k++) {
+    ind[k] = weld_vertex(map, b, corners + k * AX_DIMEN);
+    if (!ind[k]) return FALSE;
+  }
+  // после слияния у треугольника могли совпасть вершины
+  if (ind[0] == ind[1] || ind[1] == ind[2] || ind[0] == ind[2]) return TRUE;
+
+  return builder_add_face(b, ind, 3);
+}
+
+/*----------------------------------STL-------------------------------*/
+
+static int is_binary_stl(const mapped_file_t *file) {
+  return file->size >= STL_HEADER_SIZE + 4 &&
+         (file->size - STL_HEADER_SIZE - 4) / STL_TRIANGLE_SIZE ==
+             read_u32_le(file->data + STL_HEADER_SIZE) &&
+         (file->size - STL_HEADER_SIZE - 4) % STL_TRIANGLE_SIZE == 0;
+}
+
+static int is_ascii_stl(const mapped_file_t *file) {
+  const char *end = file->data + file->size;
+  const char *p = skip_spaces(file->data, end);
+  size_t window = file->size < 1024 ? file->size : 1024;
+
+  return starts_with(p, end, "solid") &&
+         memmem(file->data, window, "facet", 5) != NULL;
+}
+
+static obj3d *read_binary_stl(const mapped_file_t *file) {
+  mesh_builder_t b = {0};
+  weld_map_t map = {NULL, 0};
+  u_int triangles = read_u32_le(file->data + STL_HEADER_SIZE);
+  const char *p = file->data + STL_HEADER_SIZE + 4;
+  int is_ok = weld_grow(&map, &b);
+
+  for (u_int t = 0; is_ok && t < triangles; t++, p += STL_TRIANGLE_SIZE) {
+    float corners[3 * AX_DIMEN];
+    // первые 12 байт - нормаль грани, она не нужна
+    for (u_int k = 0; k < 3 * AX_DIMEN; k++) {
+      corners[k] = read_f32_le(p + 12 + 4 * k);
+    }
+    is_ok = add_stl_triangle(&map, &b, corners);
+  }
+  free(map.slots);
+  if (!is_ok) {
+    builder_free(&b);
+    return NULL;
+  }
+
+  return builder_finish(&b);
+}
+
+static obj3d *read_ascii_stl(const mapped_file_t *file) {
+  mesh_builder_t b = {0};
+  weld_map_t map = {NULL, 0};
+  const char *p = file->data, *end = file->data + file->size;
+  float corners[3 * AX_DIMEN];
+  u_int corner = 0;
+  int is_ok = weld_grow(&map, &b);
+
+  while (is_ok && p < end) {
+    p = skip_spaces(p, end);
+    if (starts_with(p, end, "vertex")) {
+      p += 6;
+      for (u_int k = 0; is_ok && k < AX_DIMEN; k++) {
+        double value = 0.0;
+        is_ok = parse_number(&p, end, &value);
+        corners[corner * AX_DIMEN + k] = (float)value;
+      }
+      if (is_ok && ++corner == 3) {
+        is_ok = add_stl_triangle(&map, &b, corners);
+        corner = 0;
+      }
+    }
+    p = next_line(p, end);
+  }
+  free(map.slots);
+  if (!is_ok || corner != 0) {
+    builder_free(&b);
+    return NULL;
+  }
+
+  return builder_finish(&b);
+}
+
+/*----------------------------------PLY-------------------------------*/
+
+/**
+ * @brief  Collection of scalar types of PLY properties
+ */
+typedef enum {
+  PLY_INT8,
+  PLY_UINT8,
+  PLY_INT16,
+  PLY_UINT16,
+  PLY_INT32,
+  PLY_UINT32,
+  PLY_FLOAT32,
+  PLY_FLOAT64,
+  PLY_TYPES
+} PLY_TYPE;
+
+/**
+ * @brief  Collection of PLY encodings
+ */
+typedef enum { PLY_ASCII, PLY_BINARY_LE, PLY_BINARY_BE } PLY_FORMAT;
+
+typedef struct {
+  char name[PLY_NAME_SIZE];
+  int type;
+  int count_type;  ///< type of the list length, -1 for scalars
+} ply_property_t;
+
+typedef struct {
+  char name[PLY_NAME_SIZE];
+  unsigned long long count;
+  ply_property_t properties[PLY_MAX_PROPERTIES];
+  u_int properties_count;
+} ply_element_t;
+
+typedef struct {
+  int format;
+  ply_element_t elements[PLY_MAX_ELEMENTS];
+  u_int elements_count;
+  const char *ptr;  ///< body, then the read position
+  const char *end;
+  int is_broken;
+} ply_reader_t;
+
+static const char *PLY_TYPE_NAMES[PLY_TYPES][2] = {
+    {"char", "int8"},   {"uchar", "uint8"},   {"short", "int16"},
+    {"ushort", "uint16"}, {"int", "int32"},   {"uint", "uint32"},
+    {"float", "float32"}, {"double", "float64"}};
+
+static const u_int PLY_TYPE_SIZES[PLY_TYPES] = {1, 1, 2, 2, 4, 4, 4, 8};
+
+static int ply_type_of(const char *name) {
+  int type = -1;
+
+  for (int t = 0; type < 0 && t < PLY_TYPES; t++) {
+    if (strcmp(name, PLY_TYPE_NAMES[t][0]) == 0 ||
+        strcmp(name, PLY_TYPE_NAMES[t][1]) == 0) {
+      type = t;
+    }
+  }
+
+  return type;
+}
+
+/**
+ * @brief copy a whitespace separated word of the header line
+ */
+static const char *header_word(const char *p, const char *eol, char *word) {
+  size_t len = 0;
+
+  while (p < eol && (*p == ' ' || *p == '\t')) p++;
+  while (p + len < eol && !is_space(p[len]) && len < PLY_NAME_SIZE - 1) len++;
+  memcpy(word, p, len);
+  word[len] = 0;
+
+  return p + len;
+}
+
+static int ply_header_line(ply_reader_t *ply, const char *p, const char *eol) {
+  char word[PLY_NAME_SIZE], a[PLY_NAME_SIZE], b[PLY_NAME_SIZE];
+  char c[PLY_NAME_SIZE];
+  ply_element_t *element =
+      ply->elements_count ? ply->elements + ply->elements_count - 1 : NULL;
+  int is_ok = TRUE;
+
+  p = header_word(p, eol, word);
+  if (strcmp(word, "format") == 0) {
+    header_word(p, eol, a);
+    ply->format = strcmp(a, "ascii") == 0                  ? PLY_ASCII
+                  : strcmp(a, "binary_little_endian") == 0 ? PLY_BINARY_LE
+                  : strcmp(a, "binary_big_endian") == 0    ? PLY_BINARY_BE
+                                                           : -1;
+    is_ok = ply->format >= 0;
+  } else if (strcmp(word, "element") == 0) {
+    is_ok = ply->elements_count < PLY_MAX_ELEMENTS;
+    if (is_ok) {
+      element = ply->elements + ply->elements_count++;
+      p = header_word(p, eol, element->name);
+      header_word(p, eol, a);
+      element->count = strtoull(a, NULL, 10);
+    }
+  } else if (strcmp(word, "property") == 0) {
+    is_ok = element && element->properties_count < PLY_MAX_PROPERTIES;
+    if (is_ok) {
+      ply_property_t *property =
+          element->properties + element->properties_count++;
+      p = header_word(p, eol, a);
+      p = header_word(p, eol, b);
+      if (strcmp(a, "list") == 0) {
+        // property list <тип длины> <тип индекса> <имя>
+        p = header_word(p, eol, c);
+        header_word(p, eol, property->name);
+        property->count_type = ply_type_of(b);
+        property->type = ply_type_of(c);
+        is_ok = property->count_type >= 0 && property->type >= 0;
+      } else {
+        property->count_type = -1;
+        property->type = ply_type_of(a);
+        memcpy(property->name, b, PLY_NAME_SIZE);
+        is_ok = property->type >= 0;
+      }
+    }
+  }
+
+  return is_ok;
+}
+
+static int ply_read_header(ply_reader_t *ply, const mapped_file_t *file) {
+  const char *p = file->data, *end = file->data + file->size;
+  int is_ok = TRUE, is_done = FALSE;
+
+  ply->format = -1;
+  p = next_line(p, end);  // "ply"
+  while (is_ok && !is_done && p < end) {
+    const char *eol = next_line(p, end);
+    if (starts_with(p, end, "end_header")) {
+      is_done = TRUE;
+    } else {
+      is_ok = ply_header_line(ply, p, eol);
+    }
+    p = eol;
+  }
+  ply->ptr = p;
+  ply->end = end;
+
+  return is_ok && is_done && ply->format >= 0;
+}
+
+static double ply_read(ply_reader_t *ply, int type) {
+  const unsigned char *p = (const unsigned char *)ply->ptr;
+  u_int size = PLY_TYPE_SIZES[type];
+  unsigned long long bits = 0;
+  double value = 0.0;
+
+  if (ply->format == PLY_ASCII) {
+    if (!parse_number(&ply->ptr, ply->end, &value)) ply->is_broken = TRUE;
+    return value;
+  }
+  if ((size_t)(ply->end - ply->ptr) < size) {
+    ply->is_broken = TRUE;
+    return value;
+  }
+  for (u_int i = 0; i < size; i++) {
+    u_int shift = ply->format == PLY_BINARY_LE ? i : size - 1 - i;
+    bits |= (unsigned long long)p[i] << (8 * shift);
+  }
+  ply->ptr += size;
+  if (type == PLY_INT8) value = (signed char)bits;
+  if (type == PLY_INT16) value = (short)bits;
+  if (type == PLY_INT32) value = (int)bits;
+  if (type == PLY_UINT8 || type == PLY_UINT16 || type == PLY_UINT32) {
+    value = (double)bits;
+  }
+  if (type == PLY_FLOAT32) {
+    u_int bits32 = (u_int)bits;
+    float f = 0.0f;
+    memcpy(&f, &bits32, sizeof(f));
+    value = f;
+  }
+  if (type == PLY_FLOAT64) memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+/**
+ * @brief read the length of the list property, -1 if it is broken
+ */
+static double ply_read_count(ply_reader_t *ply,
+                             const ply_property_t *property) {
+  double n = ply_read(ply, property->count_type);
+
+  return n >= 0 && n <= UINT_MAX / 2 && !ply->is_broken ? n : -1;
+}
+
+static void ply_skip_property(ply_reader_t *ply,
+                              const ply_property_t *property) {
+  if (property->count_type < 0) {
+    ply_read(ply, property->type);
+    return;
+  }
+  double n = ply_read_count(ply, property);
+  if (n < 0) {
+    ply->is_broken = TRUE;
+  } else if (ply->format != PLY_ASCII) {
+    // в бинарном файле список пропускается без разбора элементов
+    size_t size = (size_t)n * PLY_TYPE_SIZES[property->type];
+    if ((size_t)(ply->end - ply->ptr) < size) ply->is_broken = TRUE;
+    if (!ply->is_broken) ply->ptr += size;
+  } else {
+    for (u_int k = 0; !ply->is_broken && k < (u_int)n; k++) {
+      ply_read(ply, property->type);
+    }
+  }
+}
+
+static int is_vertex_list(const ply_property_t *property) {
+  return property->count_type >= 0 &&
+         (strcmp(property->name, "vertex_indices") == 0 ||
+          strcmp(property->name, "vertex_index") == 0);
+}
+
+static int ply_read_face(ply_reader_t *ply, const ply_element_t *element,
+                         mesh_builder_t *b, u_int **scratch, u_int *cap) {
+  int is_ok = TRUE;
+
+  for (u_int i = 0; is_ok && i < element->properties_count; i++) {
+    const ply_property_t *property = element->properties + i;
+    if (!is_vertex_list(property)) {
+      ply_skip_property(ply, property);
+      continue;
+    }
+    double n = ply_read_count(ply, property);
+    is_ok = n >= 0 && grow((void **)scratch, cap, (u_int)n, sizeof(u_int));
+    for (u_int k = 0; is_ok && k < (u_int)n; k++) {
+      double index = ply_read(ply, property->type);
+      // в PLY индексы с 0, в obj3d с 1
+      is_ok = index >= 0 && index < b->vertexes_count;
+      (*scratch)[k] = (u_int)index + 1;
+    }
+    if (is_ok && n >= 1) is_ok = builder_add_face(b, *scratch, (u_int)n);
+  }
+
+  return is_ok && !ply->is_broken;
+}
+
+static int ply_read_vertex(ply_reader_t *ply, const ply_element_t *element,
+                           mesh_builder_t *b) {
+  static const char *AXES[AX_DIMEN] = {"x", "y", "z"};
+  float v[AX_DIMEN] = {0};
+
+  for (u_int i = 0; i < element->properties_count; i++) {
+    const ply_property_t *property = element->properties + i;
+    int axis = -1;
+    for (int a = 0; property->count_type < 0 && a < AX_DIMEN; a++) {
+      if (strcmp(property->name, AXES[a]) == 0) axis = a;
+    }
+    if (axis >= 0) {
+      v[axis] = (float)ply_read(ply, property->type);
+    } else {
+      ply_skip_property(ply, property);
+    }
+  }
+
+  return !ply->is_broken && builder_add_vertex(b, v);
+}
+
+static int ply_skip_item(ply_reader_t *ply, const ply_element_t *element) {
+  for (u_int i = 0; i < element->properties_count; i++) {
+    ply_skip_property(ply, element->properties + i);
+  }
+
+  return !ply->is_broken;
+}
+
+static obj3d *read_ply(const mapped_file_t *file) {
+  ply_reader_t *ply = (ply_reader_t *)calloc(1, sizeof(ply_reader_t));
+  mesh_builder_t b = {0};
+  u_int *scratch = NULL, cap = 0;
+  int is_ok = ply && ply_read_header(ply, file);
+
+  for (u_int e = 0; is_ok && e < ply->elements_count; e++) {
+    const ply_element_t *element = ply->elements + e;
+    int is_vertex = strcmp(element->name, "vertex") == 0;
+    int is_face = strcmp(element->name, "face") == 0;
+    for (unsigned long long i = 0; is_ok && i < element->count; i++) {
+      if (is_vertex) {
+        is_ok = ply_read_vertex(ply, element, &b);
+      } else if (is_face) {
+        is_ok = ply_read_face(ply, element, &b, &scratch, &cap);
+      } else {
+        is_ok = ply_skip_item(ply, element);
+      }
+    }
+  }
+  free(scratch);
+  free(ply);
+  if (!is_ok) {
+    builder_free(&b);
+    return NULL;
+  }
+
+  return builder_finish(&b);
+}
+
+static int is_ply(const mapped_file_t *file) {
+  const char *end = file->data + file->size;
+
+  return starts_with(file->data, end, "ply\n") ||
+         starts_with(file->data, end, "ply\r\n");
+}
+
+/*-------------------------------public API---------------------------*/
+
+static int detect_mapped(const mapped_file_t *file) {
+  int format = MESH_OBJ;
+
+  if (is_binary_stl(file)) {
+    format = MESH_STL_BINARY;
+  } else if (is_ascii_stl(file)) {
+    format = MESH_STL_ASCII;
+  } else if (is_ply(file)) {
+    format = MESH_PLY;
+  }
+
+  return format;
+}
+
+int detect_mesh_format(const char *path) {
+  mapped_file_t file;
+  int format = -1;
+
+  if (path && map_file(path, &file)) {
+    format = detect_mapped(&file);
+    unmap_file(&file);
+  }
+
+  return format;
+}
+
+obj3d *parse_mesh_file(const char *path) {
+  mapped_file_t file;
+  obj3d *obj = NULL;
+  int format = MESH_OBJ;
+
+  if (!path) return NULL;
+  if (map_file(path, &file)) {
+    format = detect_mapped(&file);
+    if (format == MESH_STL_BINARY) obj = read_binary_stl(&file);
+    if (format == MESH_STL_ASCII) obj = read_ascii_stl(&file);
+    if (format == MESH_PLY) obj = read_ply(&file);
+    unmap_file(&file);
+  }
+  if (format == MESH_OBJ) {
+    obj = parse_obj_file(path);
+    // как и в STL и PLY, грань с несуществующей вершиной - ошибка
+    if (obj_take_incorrect_file() && obj) {
+      obj_destroy(obj);
+      obj = NULL;
+    }
+  }
+
+  return obj;
+}
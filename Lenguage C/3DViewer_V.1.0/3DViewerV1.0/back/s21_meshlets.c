@@ -0,0 +1,538 @@
+/**
+ * @file s21_meshlets.c
+ * @brief Meshlets of the 3D object and CPU culling of whole clusters
+ * @details
+ * Многоугольники режутся веером на треугольники, которые собираются в
+ * кластеры до MESHLET_MAX_VERTEXES вершин и MESHLET_MAX_TRIANGLES
+ * треугольников:
+ * 1) строится список смежности вершина -> треугольники (формат CSR);
+ * 2) кластер начинается с первого еще не взятого треугольника и растет
+ *    жадно: из соседей его вершин берется треугольник, добавляющий меньше
+ *    всего новых вершин, поэтому кластеры получаются связными и компактными;
+ * 3) параллельно по кластерам считаются AABB, описанная сфера и конус
+ *    нормалей с вершиной (apex), за которой лежат плоскости всех
+ *    треугольников кластера.
+ * При отсечении плоскости пирамиды видимости и позиция камеры переводятся
+ * в пространство модели один раз на кадр, после чего кластер проверяется
+ * парой скалярных произведений без обхода его треугольников.
+ */
+
+#include <float.h>
+#include <limits.h>
+
+#include "s21_3d_viewer.h"
+
+#define CONE_MIN_DOT 0.1f  ///< wider cones can't cull anything useful
+
+/**
+ * @brief state of the greedy clustering
+ */
+typedef struct {
+  const obj3d *obj;
+  u_int *triangles;  ///< 0-based vertexes of all triangles
+  u_int triangles_count;
+  u_int *vertex_start;  ///< first adjacent triangle of every vertex
+  u_int *vertex_triangles;
+  unsigned char *is_taken;
+  u_int *queued;  ///< meshlet + 1 whose candidates hold the triangle
+  u_int *live;    ///< not taken triangles of every vertex
+  u_int *owner;  ///< meshlet + 1 which holds the vertex now
+  unsigned char *local;
+  u_int *candidates;
+  u_int candidates_count;
+  u_int candidates_cap;
+} cluster_job_t;
+
+static void cross(const float *a, const float *b, float *result) {
+  result[0] = a[1] * b[2] - a[2] * b[1];
+  result[1] = a[2] * b[0] - a[0] * b[2];
+  result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float dot(const float *a, const float *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static int normalize(float *v) {
+  float length = sqrtf(dot(v, v));
+
+  if (length <= 0.0f || !isfinite(length)) return FALSE;
+  for (int i = 0; i < AX_DIMEN; i++) v[i] /= length;
+
+  return TRUE;
+}
+
+/*------------------------------clustering----------------------------*/
+
+/**
+ * @brief fan triangulation, triangles with invalid indices are skipped
+ */
+static int triangulate(cluster_job_t *job) {
+  const obj3d *obj = job->obj;
+  size_t total = 0;
+  u_int first = 0;
+
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    u_int n = obj->polygons.indeces_count[f];
+    total += n >= 3 ? n - 2 : 0;
+  }
+  if (total > UINT_MAX / 3) return FALSE;
+  job->triangles = (u_int *)malloc((total * 3 + 1) * sizeof(u_int));
+  if (!job->triangles) return FALSE;
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    u_int n = obj->polygons.indeces_count[f];
+    const u_int *ind = obj->polygons.vertexes_ind + first;
+    if (first + n > obj->total_indexes) break;
+    for (u_int k = 1; k + 1 < n; k++) {
+      u_int *tri = job->triangles + (size_t)job->triangles_count * 3;
+      tri[0] = ind[0] - 1;
+      tri[1] = ind[k] - 1;
+      tri[2] = ind[k + 1] - 1;
+      if (tri[0] < obj->vertexes_count && tri[1] < obj->vertexes_count &&
+          tri[2] < obj->vertexes_count) {
+        job->triangles_count++;
+      }
+    }
+    first += n;
+  }
+
+  return TRUE;
+}
+
+static int build_adjacency(cluster_job_t *job) {
+  u_int vertexes = job->obj->vertexes_count;
+  size_t corners = (size_t)job->triangles_count * 3;
+
+  job->vertex_start = (u_int *)calloc((size_t)vertexes + 1, sizeof(u_int));
+  job->vertex_triangles = (u_int *)malloc((corners + 1) * sizeof(u_int));
+  job->live = (u_int *)malloc(((size_t)vertexes + 1) * sizeof(u_int));
+  if (!job->vertex_start || !job->vertex_triangles || !job->live) {
+    return FALSE;
+  }
+  for (size_t c = 0; c < corners; c++) job->vertex_start[job->triangles[c]]++;
+  memcpy(job->live, job->vertex_start, (size_t)vertexes * sizeof(u_int));
+  for (u_int v = 0, sum = 0; v <= vertexes; v++) {
+    u_int count = v < vertexes ? job->vertex_start[v] : 0;
+    job->vertex_start[v] = sum;
+    sum += count;
+  }
+  // заполнение сдвигает начала, поэтому после него они восстанавливаются
+  for (size_t c = 0; c < corners; c++) {
+    job->vertex_triangles[job->vertex_start[job->triangles[c]]++] =
+        (u_int)(c / 3);
+  }
+  for (u_int v = vertexes; v > 0; v--) {
+    job->vertex_start[v] = job->vertex_start[v - 1];
+  }
+  job->vertex_start[0] = 0;
+
+  return TRUE;
+}
+
+static int push_candidate(cluster_job_t *job, u_int triangle) {
+  if (job->candidates_count == job->candidates_cap) {
+    u_int cap = job->candidates_cap ? job->candidates_cap * 2 : 1024;
+    u_int *bigger =
+        (u_int *)realloc(job->candidates, (size_t)cap * sizeof(u_int));
+    if (!bigger) return FALSE;
+    job->candidates = bigger;
+    job->candidates_cap = cap;
+  }
+  job->candidates[job->candidates_count++] = triangle;
+
+  return TRUE;
+}
+
+static u_int new_vertexes_of(const cluster_job_t *job, u_int triangle,
+                             u_int stamp) {
+  const u_int *tri = job->triangles + (size_t)triangle * 3;
+
+  return (job->owner[tri[0]] != stamp) + (job->owner[tri[1]] != stamp) +
+         (job->owner[tri[2]] != stamp);
+}
+
+static int take_triangle(cluster_job_t *job, meshlets_t *out, meshlet_t *m,
+                         u_int triangle, u_int stamp) {
+  const u_int *tri = job->triangles + (size_t)triangle * 3;
+  unsigned char *local = out->triangles + (size_t)out->triangles_count * 3;
+  int is_ok = TRUE;
+
+  for (int i = 0; i < 3; i++) {
+    u_int v = tri[i];
+    if (job->owner[v] != stamp) {
+      job->owner[v] = stamp;
+      job->local[v] = (unsigned char)m->vertex_count++;
+      out->vertexes[out->vertexes_count++] = v;
+      const u_int *adjacent = job->vertex_triangles + job->vertex_start[v];
+      u_int adjacent_count = job->vertex_start[v + 1] - job->vertex_start[v];
+      for (u_int a = 0; is_ok && a < adjacent_count; a++) {
+        u_int next = adjacent[a];
+        if (!job->is_taken[next] && job->queued[next] != stamp) {
+          job->queued[next] = stamp;
+          is_ok = push_candidate(job, next);
+        }
+      }
+    }
+    local[i] = job->local[v];
+  }
+  job->is_taken[triangle] = TRUE;
+  for (int i = 0; i < 3; i++) job->live[tri[i]]--;
+  m->triangle_count++;
+  out->triangles_count++;
+
+  return is_ok;
+}
+
+/**
+ * @brief best candidate triangle for the meshlet, UINT_MAX if none fits
+ * @details меньше новых вершин, а при равенстве - вершины с меньшим числом
+ * оставшихся треугольников, чтобы кластер закрывал свою границу и рос пятном
+ */
+static u_int pick_candidate(cluster_job_t *job, const meshlet_t *m,
+                            u_int stamp) {
+  u_int best = UINT_MAX, best_new = 4, best_live = UINT_MAX;
+
+  for (u_int i = 0; i < job->candidates_count;) {
+    u_int t = job->candidates[i];
+    if (job->is_taken[t]) {
+      job->candidates[i] = job->candidates[--job->candidates_count];
+      continue;
+    }
+    const u_int *tri = job->triangles + (size_t)t * 3;
+    u_int added = new_vertexes_of(job, t, stamp);
+    u_int live = job->live[tri[0]] + job->live[tri[1]] + job->live[tri[2]];
+    if (m->vertex_count + added <= MESHLET_MAX_VERTEXES &&
+        (added < best_new || (added == best_new && live < best_live))) {
+      best = t;
+      best_new = added;
+      best_live = live;
+    }
+    i++;
+  }
+
+  return best;
+}
+
+static int cluster_triangles(cluster_job_t *job, meshlets_t *out) {
+  u_int seed = 0;
+  int is_ok = TRUE;
+
+  while (is_ok && out->triangles_count < job->triangles_count) {
+    meshlet_t *m = out->items + out->count++;
+    u_int stamp = out->count, next = 0;
+    while (job->is_taken[seed]) seed++;
+    memset(m, 0, sizeof(*m));
+    m->vertex_offset = out->vertexes_count;
+    m->triangle_offset = out->triangles_count;
+    job->candidates_count = 0;
+    is_ok = take_triangle(job, out, m, seed, stamp);
+    while (is_ok && m->triangle_count < MESHLET_MAX_TRIANGLES &&
+           (next = pick_candidate(job, m, stamp)) != UINT_MAX) {
+      is_ok = take_triangle(job, out, m, next, stamp);
+    }
+  }
+
+  return is_ok;
+}
+
+static void cluster_job_free(cluster_job_t *job) {
+  free(job->triangles);
+  free(job->vertex_start);
+  free(job->vertex_triangles);
+  free(job->is_taken);
+  free(job->queued);
+  free(job->live);
+  free(job->owner);
+  free(job->local);
+  free(job->candidates);
+}
+
+/*--------------------------------bounds------------------------------*/
+
+typedef struct {
+  meshlets_t *meshlets;
+  const obj3d *obj;
+} bounds_job_t;
+
+static void sphere_and_box(const meshlets_t *out, meshlet_t *m,
+                           const float *vertexes) {
+  float radius2 = 0.0f;
+
+  for (int i = 0; i < AX_DIMEN; i++) {
+    m->aabb_min[i] = FLT_MAX;
+    m->aabb_max[i] = -FLT_MAX;
+  }
+  for (u_int k = 0; k < m->vertex_count; k++) {
+    const float *p =
+        vertexes + (size_t)out->vertexes[m->vertex_offset + k] * AX_DIMEN;
+    for (int i = 0; i < AX_DIMEN; i++) {
+      if (p[i] < m->aabb_min[i]) m->aabb_min[i] = p[i];
+      if (p[i] > m->aabb_max[i]) m->aabb_max[i] = p[i];
+    }
+  }
+  for (int i = 0; i < AX_DIMEN; i++) {
+    m->center[i] = (m->aabb_min[i] + m->aabb_max[i]) * 0.5f;
+  }
+  for (u_int k = 0; k < m->vertex_count; k++) {
+    const float *p =
+        vertexes + (size_t)out->vertexes[m->vertex_offset + k] * AX_DIMEN;
+    float d[AX_DIMEN] = {p[0] - m->center[0], p[1] - m->center[1],
+                         p[2] - m->center[2]};
+    if (dot(d, d) > radius2) radius2 = dot(d, d);
+  }
+  // запас на округление, чтобы сфера точно содержала вершины
+  m->radius = sqrtf(radius2) * (1.0f + 1e-6f) + FLT_MIN;
+}
+
+static void triangle_of(const meshlets_t *out, const meshlet_t *m, u_int t,
+                        const float *vertexes, const float **p) {
+  const unsigned char *local =
+      out->triangles + ((size_t)m->triangle_offset + t) * 3;
+
+  for (int i = 0; i < 3; i++) {
+    p[i] = vertexes +
+           (size_t)out->vertexes[m->vertex_offset + local[i]] * AX_DIMEN;
+  }
+}
+
+static int triangle_normal(const float *const *p, float *normal) {
+  float u[AX_DIMEN], v[AX_DIMEN];
+
+  for (int i = 0; i < AX_DIMEN; i++) {
+    u[i] = p[1][i] - p[0][i];
+    v[i] = p[2][i] - p[0][i];
+  }
+  cross(u, v, normal);
+
+  return normalize(normal);
+}
+
+/**
+ * @brief normal cone, cone_cutoff is 1 if the cluster can't be back-facing
+ */
+static void normal_cone(const meshlets_t *out, meshlet_t *m,
+                        const float *vertexes) {
+  float normals[MESHLET_MAX_TRIANGLES][AX_DIMEN];
+  const float *origins[MESHLET_MAX_TRIANGLES];
+  float axis[AX_DIMEN] = {0}, min_dot = 1.0f, max_t = 0.0f;
+  u_int count = 0;
+
+  for (u_int t = 0; t < m->triangle_count; t++) {
+    const float *p[3];
+    triangle_of(out, m, t, vertexes, p);
+    if (triangle_normal(p, normals[count])) {
+      for (int i = 0; i < AX_DIMEN; i++) axis[i] += normals[count][i];
+      origins[count++] = p[0];
+    }
+  }
+  m->cone_cutoff = 1.0f;
+  memcpy(m->cone_apex, m->center, sizeof(m->center));
+  normalize(axis);
+  memcpy(m->cone_axis, axis, sizeof(axis));
+  // вершина конуса сдвигается назад по оси, пока не окажется за плоскостями
+  // всех треугольников кластера
+  for (u_int t = 0; t < count && min_dot >= CONE_MIN_DOT; t++) {
+    float d[AX_DIMEN], along = dot(normals[t], axis);
+    for (int i = 0; i < AX_DIMEN; i++) d[i] = m->center[i] - origins[t][i];
+    if (along < min_dot) min_dot = along;
+    if (along >= CONE_MIN_DOT && dot(normals[t], d) / along > max_t) {
+      max_t = dot(normals[t], d) / along;
+    }
+  }
+  if (count == 0 || min_dot < CONE_MIN_DOT) return;
+  for (int i = 0; i < AX_DIMEN; i++) {
+    m->cone_apex[i] = m->center[i] - axis[i] * max_t;
+  }
+  m->cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+}
+
+static void bounds_range(void *ctx, u_int begin, u_int end,
+                         u_int thread_index) {
+  bounds_job_t *job = (bounds_job_t *)ctx;
+  (void)thread_index;
+
+  for (u_int i = begin; i < end; i++) {
+    meshlet_t *m = job->meshlets->items + i;
+    sphere_and_box(job->meshlets, m, job->obj->vertexes);
+    normal_cone(job->meshlets, m, job->obj->vertexes);
+  }
+}
+
+/*------------------------------public API----------------------------*/
+
+void meshlets_destroy(meshlets_t *meshlets) {
+  if (meshlets) {
+    free(meshlets->items);
+    free(meshlets->vertexes);
+    free(meshlets->triangles);
+    free(meshlets);
+  }
+}
+
+int meshlets_update_bounds(meshlets_t *meshlets, const obj3d *obj,
+                           u_int threads) {
+  bounds_job_t job = {meshlets, obj};
+
+  if (!meshlets || !obj) return FALSE;
+  for (u_int i = 0; i < meshlets->vertexes_count; i++) {
+    if (meshlets->vertexes[i] >= obj->vertexes_count) return FALSE;
+  }
+  parallel_for(meshlets->count, threads, bounds_range, &job);
+
+  return TRUE;
+}
+
+meshlets_t *build_meshlets(const obj3d *obj, u_int threads) {
+  cluster_job_t job;
+  meshlets_t *out = NULL;
+  size_t triangles = 0;
+  int is_ok = FALSE;
+
+  if (!obj) return NULL;
+  memset(&job, 0, sizeof(job));
+  job.obj = obj;
+  out = (meshlets_t *)calloc(1, sizeof(meshlets_t));
+  if (out && triangulate(&job) && build_adjacency(&job)) {
+    triangles = job.triangles_count;
+    job.is_taken = (unsigned char *)calloc(triangles + 1, 1);
+    job.queued = (u_int *)calloc(triangles + 1, sizeof(u_int));
+    job.owner = (u_int *)calloc((size_t)obj->vertexes_count + 1, sizeof(u_int));
+    job.local = (unsigned char *)malloc((size_t)obj->vertexes_count + 1);
+    out->items = (meshlet_t *)malloc((triangles + 1) * sizeof(meshlet_t));
+    out->vertexes = (u_int *)malloc((triangles * 3 + 1) * sizeof(u_int));
+    out->triangles = (unsigned char *)malloc(triangles * 3 + 1);
+    is_ok = job.is_taken && job.queued && job.owner && job.local &&
+            out->items && out->vertexes && out->triangles &&
+            cluster_triangles(&job, out);
+  }
+  cluster_job_free(&job);
+  if (is_ok) {
+    // массивы были выделены с запасом на худший случай
+    meshlet_t *items = (meshlet_t *)realloc(
+        out->items, ((size_t)out->count + 1) * sizeof(meshlet_t));
+    u_int *vertexes = (u_int *)realloc(
+        out->vertexes, ((size_t)out->vertexes_count + 1) * sizeof(u_int));
+    if (items) out->items = items;
+    if (vertexes) out->vertexes = vertexes;
+    is_ok = meshlets_update_bounds(out, obj, threads);
+  }
+  if (!is_ok) {
+    meshlets_destroy(out);
+    out = NULL;
+  }
+
+  return out;
+}
+
+/*-------------------------------culling------------------------------*/
+
+/**
+ * @brief frustum and viewer of one frame in the model space
+ */
+typedef struct {
+  float planes[6][4];  ///< inside if dot(plane, (p, 1)) >= 0, unit normals
+  float camera[AX_DIMEN];
+  float direction[AX_DIMEN];  ///< view direction if the camera is infinite
+  int is_infinite;            ///< orthographic projection
+} cull_frame_t;
+
+/**
+ * @brief camera is the point which the matrix maps to clip x = y = w = 0
+ */
+static void frame_camera(float mvp[4][4], cull_frame_t *frame) {
+  const float *r0 = mvp[0], *r1 = mvp[1], *r2 = mvp[2], *r3 = mvp[3];
+  double a[3][3], b[3], det = 0.0;
+  const float *rows[3] = {r0, r1, r3};
+
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) a[i][j] = rows[i][j];
+    b[i] = -rows[i][3];
+  }
+  det = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+        a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+        a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+  frame->is_infinite = fabs(det) < 1e-12;
+  if (!frame->is_infinite) {
+    // правило Крамера
+    for (int k = 0; k < 3; k++) {
+      double m[3][3];
+      memcpy(m, a, sizeof(m));
+      for (int i = 0; i < 3; i++) m[i][k] = b[i];
+      frame->camera[k] =
+          (float)((m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                   m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                   m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) /
+                  det);
+    }
+  } else {
+    // в ортогональной проекции взгляд идет туда, где растет глубина
+    cross(r0, r1, frame->direction);
+    if (dot(frame->direction, r2) < 0.0f) {
+      for (int i = 0; i < AX_DIMEN; i++) frame->direction[i] *= -1.0f;
+    }
+    normalize(frame->direction);
+  }
+}
+
+static void frame_planes(float mvp[4][4], cull_frame_t *frame) {
+  for (int p = 0; p < 6; p++) {
+    const float *row = mvp[p / 2];
+    float sign = p % 2 ? -1.0f : 1.0f;
+    float *plane = frame->planes[p];
+    for (int i = 0; i < 4; i++) plane[i] = mvp[3][i] + sign * row[i];
+    float length = sqrtf(dot(plane, plane));
+    if (length > 0.0f) {
+      for (int i = 0; i < 4; i++) plane[i] /= length;
+    }
+  }
+}
+
+static int is_outside(const cull_frame_t *frame, const meshlet_t *m) {
+  int is_out = FALSE;
+
+  for (int p = 0; !is_out && p < 6; p++) {
+    const float *plane = frame->planes[p];
+    is_out = dot(plane, m->center) + plane[3] < -m->radius;
+  }
+
+  return is_out;
+}
+
+static int is_back_facing(const cull_frame_t *frame, const meshlet_t *m) {
+  float view[AX_DIMEN];
+
+  if (m->cone_cutoff >= 1.0f) return FALSE;
+  if (frame->is_infinite) {
+    memcpy(view, frame->direction, sizeof(view));
+  } else {
+    for (int i = 0; i < AX_DIMEN; i++) {
+      view[i] = m->cone_apex[i] - frame->camera[i];
+    }
+    if (!normalize(view)) return FALSE;
+  }
+
+  return dot(view, m->cone_axis) > m->cone_cutoff;
+}
+
+u_int cull_meshlets(const meshlets_t *meshlets, float model[4][4],
+                    float view[4][4], float projection[4][4],
+                    u_int *visible) {
+  float mv[4][4], mvp[4][4];
+  cull_frame_t frame;
+  u_int count = 0;
+
+  if (!meshlets || !visible) return 0;
+  memset(&frame, 0, sizeof(frame));
+  matrix4_multiply(view, model, mv);
+  matrix4_multiply(projection, mv, mvp);
+  frame_camera(mvp, &frame);
+  frame_planes(mvp, &frame);
+  for (u_int i = 0; i < meshlets->count; i++) {
+    const meshlet_t *m = meshlets->items + i;
+    if (!is_outside(&frame, m) && !is_back_facing(&frame, m)) {
+      visible[count++] = i;
+    }
+  }
+
+  return count;
+}
@@ -0,0 +1,223 @@
+/**
+ * @file s21_normals.c
+ * @brief Smooth per-vertex normals of the 3D object
+ * @details
+ * Нормали считаются без атомарных операций и без записи в общие ячейки:
+ * 1) параллельно по граням считается ненормированная нормаль грани методом
+ *    Ньюэлла (ее длина равна площади грани);
+ * 2) строится список смежности вершина -> углы граней (формат CSR);
+ * 3) параллельно по вершинам каждая вершина сама собирает (gather) нормали
+ *    своих граней с весом площади или угла при вершине.
+ * Каждый поток пишет только в свои ячейки, поэтому результат не зависит от
+ * количества потоков.
+ */
+
+#include "s21_3d_viewer.h"
+
+/**
+ * @brief shared data of all stages of the normals computation
+ */
+typedef struct {
+  const obj3d *obj;
+  const u_int *face_start;      ///< first corner of every face, faces + 1
+  u_int *corner_face;           ///< face of every corner
+  const u_int *vertex_start;    ///< first adjacent corner of every vertex
+  const u_int *vertex_corners;  ///< adjacent corners grouped by vertex
+  float *face_normals;          ///< area-scaled normals of faces
+  int weighting;
+} normals_job_t;
+
+static int is_valid_index(const obj3d *obj, u_int index) {
+  return index > 0 && index <= obj->vertexes_count;
+}
+
+static const float *vertex_at(const obj3d *obj, u_int index) {
+  return obj->vertexes + (size_t)(index - 1) * AX_DIMEN;
+}
+
+static float vector_length(const float *v) {
+  return sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+/**
+ * @brief stage 1: area-scaled normal of every face by Newell's method
+ */
+static void face_normals_range(void *ctx, u_int begin, u_int end,
+                               u_int thread_index) {
+  normals_job_t *job = (normals_job_t *)ctx;
+  const obj3d *obj = job->obj;
+  (void)thread_index;
+
+  for (u_int f = begin; f < end; f++) {
+    u_int first = job->face_start[f];
+    u_int n = job->face_start[f + 1] - first;
+    const u_int *ind = obj->polygons.vertexes_ind + first;
+    float normal[AX_DIMEN] = {0};
+    int is_valid = n >= 3;
+
+    for (u_int k = 0; k < n; k++) {
+      job->corner_face[first + k] = f;
+      if (!is_valid_index(obj, ind[k])) is_valid = FALSE;
+    }
+    for (u_int k = 0; is_valid && k < n; k++) {
+      const float *a = vertex_at(obj, ind[k]);
+      const float *b = vertex_at(obj, ind[(k + 1) % n]);
+      normal[X_CORD] += (a[Y_CORD] - b[Y_CORD]) * (a[Z_CORD] + b[Z_CORD]);
+      normal[Y_CORD] += (a[Z_CORD] - b[Z_CORD]) * (a[X_CORD] + b[X_CORD]);
+      normal[Z_CORD] += (a[X_CORD] - b[X_CORD]) * (a[Y_CORD] + b[Y_CORD]);
+    }
+    for (u_int i = 0; i < AX_DIMEN; i++) {
+      job->face_normals[(size_t)f * AX_DIMEN + i] = 0.5f * normal[i];
+    }
+  }
+}
+
+/**
+ * @brief angle of the face corner between its two neighbour vertexes
+ */
+static float corner_angle(const normals_job_t *job, u_int corner, u_int face) {
+  const obj3d *obj = job->obj;
+  u_int first = job->face_start[face];
+  u_int n = job->face_start[face + 1] - first;
+  u_int k = corner - first;
+  const u_int *ind = obj->polygons.vertexes_ind + first;
+  const float *v = vertex_at(obj, ind[k]);
+  const float *prev = vertex_at(obj, ind[(k + n - 1) % n]);
+  const float *next = vertex_at(obj, ind[(k + 1) % n]);
+  float e1[AX_DIMEN], e2[AX_DIMEN];
+  float len = 0.0f, cos_angle = 0.0f;
+
+  for (u_int i = 0; i < AX_DIMEN; i++) {
+    e1[i] = prev[i] - v[i];
+    e2[i] = next[i] - v[i];
+  }
+  len = vector_length(e1) * vector_length(e2);
+  if (len <= 0.0f) return 0.0f;
+  cos_angle = (e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2]) / len;
+  if (cos_angle > 1.0f) cos_angle = 1.0f;
+  if (cos_angle < -1.0f) cos_angle = -1.0f;
+
+  return acosf(cos_angle);
+}
+
+/**
+ * @brief stage 3: every vertex gathers normals of its adjacent faces
+ */
+static void vertex_normals_range(void *ctx, u_int begin, u_int end,
+                                 u_int thread_index) {
+  normals_job_t *job = (normals_job_t *)ctx;
+  float *normals = job->obj->normals;
+  (void)thread_index;
+
+  for (u_int v = begin; v < end; v++) {
+    float sum[AX_DIMEN] = {0};
+    float len = 0.0f;
+
+    for (u_int c = job->vertex_start[v]; c < job->vertex_start[v + 1]; c++) {
+      u_int corner = job->vertex_corners[c];
+      u_int face = job->corner_face[corner];
+      const float *fn = job->face_normals + (size_t)face * AX_DIMEN;
+      float weight = 1.0f;
+
+      if (job->weighting == NORMALS_ANGLE_WEIGHTED) {
+        float face_len = vector_length(fn);
+        weight = face_len > 0.0f ? corner_angle(job, corner, face) / face_len
+                                 : 0.0f;
+      }
+      for (u_int i = 0; i < AX_DIMEN; i++) sum[i] += weight * fn[i];
+    }
+    len = vector_length(sum);
+    for (u_int i = 0; i < AX_DIMEN; i++) {
+      normals[(size_t)v * AX_DIMEN + i] = len > 0.0f ? sum[i] / len : 0.0f;
+    }
+  }
+}
+
+/**
+ * @brief stage 2: adjacency vertex -> corners in CSR layout
+ */
+static int build_vertex_corners(const obj3d *obj, u_int *vertex_start,
+                                u_int *vertex_corners, u_int corners) {
+  const u_int *ind = obj->polygons.vertexes_ind;
+  u_int *cursor = (u_int *)malloc((obj->vertexes_count + 1) * sizeof(u_int));
+  if (!cursor) return FALSE;
+
+  // считаем количество углов у каждой вершины, индексы в файле начинаются с 1
+  for (u_int c = 0; c < corners; c++) {
+    if (is_valid_index(obj, ind[c])) vertex_start[ind[c]]++;
+  }
+  for (u_int v = 0; v < obj->vertexes_count; v++) {
+    vertex_start[v + 1] += vertex_start[v];
+    cursor[v] = vertex_start[v];
+  }
+  for (u_int c = 0; c < corners; c++) {
+    if (is_valid_index(obj, ind[c])) vertex_corners[cursor[ind[c] - 1]++] = c;
+  }
+  free(cursor);
+
+  return TRUE;
+}
+
+static u_int *build_face_start(const obj3d *obj) {
+  u_int *face_start = (u_int *)malloc((obj->faces_count + 1) * sizeof(u_int));
+  if (!face_start) return NULL;
+
+  face_start[0] = 0;
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    face_start[f + 1] = face_start[f] + obj->polygons.indeces_count[f];
+  }
+  if (face_start[obj->faces_count] > obj->total_indexes) {
+    free(face_start);
+    face_start = NULL;
+  }
+
+  return face_start;
+}
+
+int compute_vertex_normals(obj3d *obj, int weighting, u_int threads) {
+  int function_result = FALSE;
+  normals_job_t job = {0};
+  u_int *face_start = NULL, *corner_face = NULL;
+  u_int *vertex_start = NULL, *vertex_corners = NULL;
+  float *face_normals = NULL, *normals = NULL;
+  u_int corners = 0;
+
+  if (!obj || obj->vertexes_count == 0) return function_result;
+
+  face_start = build_face_start(obj);
+  if (face_start) {
+    corners = face_start[obj->faces_count];
+    corner_face = (u_int *)malloc((corners + 1) * sizeof(u_int));
+    vertex_start = (u_int *)calloc(obj->vertexes_count + 1, sizeof(u_int));
+    vertex_corners = (u_int *)malloc((corners + 1) * sizeof(u_int));
+    face_normals =
+        (float *)malloc(((size_t)obj->faces_count + 1) * AX_DIMEN * sizeof(float));
+    normals = obj_normals_resize(obj, obj->vertexes_count);
+  }
+
+  if (corner_face && vertex_start && vertex_corners && face_normals &&
+      normals &&
+      build_vertex_corners(obj, vertex_start, vertex_corners, corners)) {
+    job.obj = obj;
+    job.face_start = face_start;
+    job.corner_face = corner_face;
+    job.vertex_start = vertex_start;
+    job.vertex_corners = vertex_corners;
+    job.face_normals = face_normals;
+    job.weighting = weighting;
+
+    parallel_for(obj->faces_count, threads, face_normals_range, &job);
+    parallel_for(obj->vertexes_count, threads, vertex_normals_range, &job);
+    function_result = TRUE;
+  } else if (normals) {
+    obj_normals_resize(obj, 0);
+  }
+
+  free(face_start);
+  free(corner_face);
+  free(vertex_start);
+  free(vertex_corners);
+  free(face_normals);
+
+  return function_result;
+}
@@ -72,6 +72,10 @@
 * ======================================================
  */
 
+#define _GNU_SOURCE
+#include <limits.h>
+#include <time.h>
+
 #include "s21_3d_viewer.h"
 
 #define _array_header(_arr) \
@@ -115,7 +119,7 @@
 // если возможно увеличить или вместимость превосходит возможный размер, то 1,
 // иначе, если увеличить нельзя, то 0
 #define array_clean(_arr) \
-  ((_arr) ? mem_dealloc(_array_header(_arr)), 0 : 0)  ///<
+  ((_arr) ? array_release(_arr, sizeof(*(_arr))), 0 : 0)  ///<
 // чистим массив начиная с загловка массива - первого адреса на ячейку памяти с
 // индексом 0 в случае наличия не пустого указателя вызывается функция очистки
 // памяти и возвращается результат 0, благодаря прописанию дополнительного
@@ -144,7 +148,32 @@ static const double POWER_10_NEG[MAX_POWER] = {
     1.0e-14, 1.0e-15, 1.0e-16, 1.0e-17, 1.0e-18, 1.0e-19,
 };
 
-static int incorrect_file = 0;
+// у каждого потока свой флаг, чтобы файлы можно было читать параллельно
+static _Thread_local int incorrect_file = 0;
+
+// статистика загрузки включается для потока через load_stats_attach
+static _Thread_local load_stats_t *active_stats = NULL;
+
+static double stats_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void stats_heap_add(long long bytes) {
+  if (!active_stats) return;
+  active_stats->heap_bytes += bytes;
+  if (active_stats->heap_bytes > active_stats->peak_heap_bytes) {
+    active_stats->peak_heap_bytes = active_stats->heap_bytes;
+  }
+}
+
+void load_stats_attach(load_stats_t *stats) {
+  if (stats) memset(stats, 0, sizeof(*stats));
+  active_stats = stats;
+}
 
 static void *mem_realloc(void *ptr, size_t bytes) {
   return realloc(ptr, bytes);
@@ -152,6 +181,15 @@ static void *mem_realloc(void *ptr, size_t bytes) {
 
 static void mem_dealloc(void *ptr) { free(ptr); }
 
+static size_t array_bytes(u_int cap, size_t b) {
+  return b * cap + 2 * sizeof(u_int);
+}
+
+static void array_release(void *ptr, size_t b) {
+  stats_heap_add(-(long long)array_bytes(array_cap(ptr), b));
+  mem_dealloc(_array_header(ptr));
+}
+
 static void *array_realloc(void *ptr, u_int n, u_int b) {
   // берем размер массива
   // считаем его новый размер
@@ -162,6 +200,7 @@ static void *array_realloc(void *ptr, u_int n, u_int b) {
   u_int cap = array_cap(ptr);
   u_int ncap = cap + cap / 2;
   u_int *res = NULL;
+  double start = active_stats ? stats_now_ms() : 0.0;
 
   // удостоверимся, что новой емкости для последующих расчетов хватит
   // {случаи использования, когда вместимости хватает мы не рассматриваем, так
@@ -182,6 +221,12 @@ static void *array_realloc(void *ptr, u_int n, u_int b) {
   res = (u_int *)(mem_realloc(ptr ? _array_header(ptr) : 0,
                               (size_t)b * ncap + 2 * sizeof(u_int)));
   if (!res) return 0;
+  if (active_stats) {
+    active_stats->realloc_count++;
+    active_stats->realloc_ms += stats_now_ms() - start;
+    stats_heap_add((long long)array_bytes(ncap, b) -
+                   (long long)(cap ? array_bytes(cap, b) : 0));
+  }
 
   // заполняем заголовок массива текущий размер и вместимость
   // после возвращаем указатель на адрес 2 ячейки
@@ -215,6 +260,8 @@ static void init_obj3d(obj3d *obj) {
   obj->faces_count = 0;
   obj->total_indexes = 0;
   obj->vertexes = 0;
+  obj->normals = 0;
+  obj->normals_count = 0;
   init_bounds_obj3d(obj);
   obj->polygons.indeces_count = 0;
   obj->polygons.vertexes_ind = 0;
@@ -248,10 +295,17 @@ static void close_obj_file(FILE *file) {
 
 static size_t read_obj_file(void *file, void *dst, size_t bytes) {
   FILE *f = NULL;
+  double start = active_stats ? stats_now_ms() : 0.0;
+  size_t read = 0;
 
   f = (FILE *)(file);
+  read = fread(dst, 1, bytes, f);
+  if (active_stats) {
+    active_stats->read_ms += stats_now_ms() - start;
+    active_stats->bytes_read += read;
+  }
 
-  return fread(dst, 1, bytes, f);
+  return read;
 }
 
 static int is_whitespace(char c) {
@@ -439,9 +493,9 @@ static const char *parse_float(const char *ptr, float *val) {
 
   if (is_exponent(*ptr)) {
     if (is_neg_e_skip_neg_sign_fl(&ptr)) {
-      powers = POWER_10_POS;
-    } else {
       powers = POWER_10_NEG;
+    } else {
+      powers = POWER_10_POS;
     }
 
     while (is_digit(*ptr)) eval = 10 * eval + (*ptr++ - '0');
@@ -486,9 +540,11 @@ static const char *parse_face(obj3d *data, const char *ptr) {
     }
 
     // add vertexe index to array of indeces
-    if (v < 0) {
-      v_index = (array_size(data->vertexes) / 3) - (u_int)(-v);
-    } else if (v == 0) {
+    // отрицательный индекс отсчитывается от последней прочитанной вершины:
+    // -1 это последняя вершина
+    if (v < 0 && (u_int)(-v) <= array_size(data->vertexes) / 3) {
+      v_index = (array_size(data->vertexes) / 3) + 1 - (u_int)(-v);
+    } else if (v <= 0) {
       incorrect_file = 1;
       break;
     } else {
@@ -580,31 +636,89 @@ static void copy_overflow_to_next_buffer(char **buffer, char **last,
   *start = *buffer + *bytes;
 }
 
+static unsigned long long get_obj_file_size(FILE *file) {
+  long size = 0;
+
+  if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+  rewind(file);
+
+  return size > 0 ? (unsigned long long)size : 0ULL;
+}
+
+obj3d *obj_create(void) {
+  obj3d *obj = (obj3d *)(mem_realloc(0, sizeof(obj3d)));
+
+  if (obj) {
+    init_obj3d(obj);
+    stats_heap_add(sizeof(obj3d));
+  }
+
+  return obj;
+}
+
+int obj_reserve(obj3d *obj, u_int vertexes, u_int faces, u_int indexes) {
+  float *v = NULL;
+  u_int *counts = NULL, *ind = NULL;
+
+  if (!obj || vertexes > UINT_MAX / AX_DIMEN) return FALSE;
+  v = (float *)array_realloc(NULL, vertexes * AX_DIMEN, sizeof(float));
+  counts = (u_int *)array_realloc(NULL, faces, sizeof(u_int));
+  ind = (u_int *)array_realloc(NULL, indexes, sizeof(u_int));
+  if (!v || !counts || !ind) {
+    array_clean(v);
+    array_clean(counts);
+    array_clean(ind);
+    return FALSE;
+  }
+  array_clean(obj->vertexes);
+  array_clean(obj->polygons.indeces_count);
+  array_clean(obj->polygons.vertexes_ind);
+  obj_normals_resize(obj, 0);
+  init_obj3d(obj);
+  _array_size(v) = vertexes * AX_DIMEN;
+  _array_size(counts) = faces;
+  _array_size(ind) = indexes;
+  obj->vertexes = v;
+  obj->polygons.indeces_count = counts;
+  obj->polygons.vertexes_ind = ind;
+  set_main_data_obj3d(obj);
+
+  return TRUE;
+}
+
 obj3d *parse_obj_file(const char *path) {
-  obj3d *obj = NULL;
-  void *file = NULL;
-  char *buffer = NULL;  // буфер
-  char *start = NULL;   // начало буфера
-  char *end = NULL;     // конец буфера
+  return parse_obj_file_progress(path, NULL, NULL);
+}
+
+/**
+ * @brief read the file window by window and append its data to the object
+ *
+ * @param obj the 3D object to append to
+ * @param file opened file
+ * @param buffer buffer of 2 * BUFFER_SIZE bytes
+ * @param progress callback or NULL
+ * @param user user data passed to progress
+ * @param total size of the file for progress
+ * @param consumed bytes read from the file
+ * @param last_char last byte read from the file, 0 if nothing was read
+ * @return TRUE if cancelled by progress
+ */
+static int parse_obj_stream(obj3d *obj, FILE *file, char *buffer,
+                            load_progress_t progress, void *user,
+                            unsigned long long total,
+                            unsigned long long *consumed, char *last_char) {
+  char *start = buffer;  // начало буфера
+  char *end = NULL;      // конец буфера
   char *last = NULL;
   u_int read = 0;
   u_int bytes = 0;
+  int is_cancelled = FALSE;
 
-  // Открытие файла
-  file = open_obj_file(path);
-  if (!file) return 0;
-  // Создание пустого 3d объекта
-  obj = (obj3d *)(mem_realloc(0, sizeof(obj3d)));
-  if (!obj) return 0;
-  // Зануление данных
-  init_obj3d(obj);
-  // Создание буфера для чтения данных
-  buffer = (char *)(mem_realloc(NULL, 2 * BUFFER_SIZE * sizeof(char)));
-  if (!buffer) return 0;
-  start = buffer;
   while (1) {
     // Считываем количество байт из файла (медленно обращаемся к диску)
     read = (u_int)(read_obj_file(file, start, BUFFER_SIZE));
+    *consumed += read;
+    if (read) *last_char = start[read - 1];
     // проверка на пустоту
     if (read == 0 && start == buffer) break;
     // Обеспечиваем окончание буфера на символ новой строки '\n'
@@ -624,20 +738,130 @@ obj3d *parse_obj_file(const char *path) {
     if (*last != '\n') break;
     last++;
     // Использование буфера для парсинга
+    double parse_start = active_stats ? stats_now_ms() : 0.0;
     parse_buffer(obj, buffer, last);
+    if (active_stats) active_stats->parse_ms += stats_now_ms() - parse_start;
     // Копируем переполненные ячейки для следующего буфера
     copy_overflow_to_next_buffer(&buffer, &last, &bytes, &start, &end);
+    // Сообщаем о прогрессе после каждого окна BUFFER_SIZE
+    if (progress && !progress(user, *consumed, total)) {
+      is_cancelled = TRUE;
+      break;
+    }
   }
   // Вычисляем основные данные о количестве вершин/фейсов/всех индексов
   set_main_data_obj3d(obj);
+
+  return is_cancelled;
+}
+
+obj3d *parse_obj_file_progress(const char *path, load_progress_t progress,
+                               void *user) {
+  obj3d *obj = NULL;
+  void *file = NULL;
+  char *buffer = NULL;  // буфер
+  unsigned long long consumed = 0, total = 0;
+  char last_char = 0;
+  int is_cancelled = FALSE;
+  double start_ms = active_stats ? stats_now_ms() : 0.0;
+  double realloc_ms = active_stats ? active_stats->realloc_ms : 0.0;
+
+  // Открытие файла
+  file = open_obj_file(path);
+  if (!file) return 0;
+  if (progress) total = get_obj_file_size(file);
+  // Создание пустого 3d объекта
+  obj = (obj3d *)(mem_realloc(0, sizeof(obj3d)));
+  // Создание буфера для чтения данных
+  buffer = (char *)(mem_realloc(NULL, 2 * BUFFER_SIZE * sizeof(char)));
+  if (!obj || !buffer) {
+    mem_dealloc(obj);
+    mem_dealloc(buffer);
+    close_obj_file(file);
+    return 0;
+  }
+  // Зануление данных
+  init_obj3d(obj);
+  stats_heap_add(sizeof(obj3d) + 2 * BUFFER_SIZE);
+  is_cancelled = parse_obj_stream(obj, file, buffer, progress, user, total,
+                                  &consumed, &last_char);
   // Удаляем буфер из RAM
   mem_dealloc(buffer);
+  stats_heap_add(-2 * BUFFER_SIZE);
   // Закрываем файл
   close_obj_file(file);
+  if (active_stats) {
+    // время перевыделений внутри разбора считается отдельно
+    active_stats->parse_ms -= active_stats->realloc_ms - realloc_ms;
+    active_stats->total_ms += stats_now_ms() - start_ms;
+    active_stats->obj_bytes = obj_footprint(obj);
+  }
+  if (is_cancelled) {
+    obj_destroy(obj);
+    obj = NULL;
+    incorrect_file = 0;
+  }
 
   return obj;
 }
 
+int obj_take_incorrect_file(void) {
+  int is_incorrect = incorrect_file;
+
+  incorrect_file = 0;
+
+  return is_incorrect;
+}
+
+int parse_obj_file_tail(obj3d *obj, const char *path,
+                        unsigned long long offset,
+                        unsigned long long *end_offset, int *is_complete) {
+  FILE *file = NULL;
+  char *buffer = NULL;
+  unsigned long long consumed = 0;
+  char last_char = '\n';
+  u_int vertexes = 0, faces = 0, indexes = 0;
+  axises bounds;
+
+  if (!obj) return FALSE;
+  vertexes = array_size(obj->vertexes);
+  faces = array_size(obj->polygons.indeces_count);
+  indexes = array_size(obj->polygons.vertexes_ind);
+  bounds = obj->bounds;
+  incorrect_file = 0;
+  file = (FILE *)open_obj_file(path);
+  if (!file) return FALSE;
+  buffer = (char *)(mem_realloc(NULL, 2 * BUFFER_SIZE * sizeof(char)));
+  if (!buffer || fseek(file, (long)offset, SEEK_SET) != 0) {
+    mem_dealloc(buffer);
+    close_obj_file(file);
+    return FALSE;
+  }
+  stats_heap_add(2 * BUFFER_SIZE);
+  parse_obj_stream(obj, file, buffer, NULL, NULL, 0, &consumed, &last_char);
+  mem_dealloc(buffer);
+  stats_heap_add(-2 * BUFFER_SIZE);
+  close_obj_file(file);
+  if (incorrect_file) {
+    // грань с несуществующей вершиной: дописанное убирается
+    incorrect_file = 0;
+    if (obj->vertexes) _array_size(obj->vertexes) = vertexes;
+    if (obj->polygons.indeces_count) {
+      _array_size(obj->polygons.indeces_count) = faces;
+    }
+    if (obj->polygons.vertexes_ind) {
+      _array_size(obj->polygons.vertexes_ind) = indexes;
+    }
+    obj->bounds = bounds;
+    set_main_data_obj3d(obj);
+    return FALSE;
+  }
+  if (end_offset) *end_offset = offset + consumed;
+  if (is_complete) *is_complete = last_char == '\n';
+
+  return TRUE;
+}
+
 static void set_first_lesser_and_second_greater(u_int *first, u_int *second) {
   if (*first > *second) {
     u_int temp = *first;
@@ -666,7 +890,7 @@ static u_int get_one_if_new_edge(u_int index1, u_int index2,
   return !is_have_in_set ? 1 : 0;
 }
 
-u_int get_count_edges(obj3d *obj) {
+static u_int count_edges_by_sets(obj3d *obj) {
   u_int edges_count = 0;
   if (!obj || incorrect_file) {
     incorrect_file = 0;
@@ -681,6 +905,7 @@ u_int get_count_edges(obj3d *obj) {
   // matrix (not smart 2 dimensional array of smart arrays)
   u_int **unique_edges = (u_int **)malloc(vertexes_count * sizeof(u_int *));
   if (!unique_edges) return edges_count;
+  stats_heap_add((long long)vertexes_count * sizeof(u_int *));
 
   for (u_int i = 0; i < vertexes_count; i++) unique_edges[i] = 0;
   // main range
@@ -705,14 +930,144 @@ u_int get_count_edges(obj3d *obj) {
   }
   for (u_int i = 0; i < vertexes_count; i++) array_clean(unique_edges[i]);
   free(unique_edges);
+  stats_heap_add(-(long long)vertexes_count * sizeof(u_int *));
+
+  return edges_count;
+}
+
+u_int get_count_edges(obj3d *obj) {
+  double start = active_stats ? stats_now_ms() : 0.0;
+  u_int edges_count = count_edges_by_sets(obj);
+
+  if (active_stats) active_stats->edges_ms += stats_now_ms() - start;
 
   return edges_count;
 }
 
+/**
+ * @brief LSD radix sort of 64-bit keys by bytes, skips bytes equal in all keys
+ *
+ * @param keys array to sort
+ * @param tmp scratch array of the same size
+ * @param n count of keys
+ * @return pointer to the sorted array, keys or tmp
+ */
+static unsigned long long *radix_sort_keys(unsigned long long *keys,
+                                           unsigned long long *tmp, u_int n) {
+  for (u_int shift = 0; shift < 64; shift += 8) {
+    u_int hist[256] = {0};
+    u_int sum = 0;
+
+    for (u_int i = 0; i < n; i++) hist[(keys[i] >> shift) & 0xFF]++;
+    if (hist[(keys[0] >> shift) & 0xFF] == n) continue;
+    for (u_int b = 0; b < 256; b++) {
+      u_int count = hist[b];
+      hist[b] = sum;
+      sum += count;
+    }
+    for (u_int i = 0; i < n; i++) tmp[hist[(keys[i] >> shift) & 0xFF]++] = keys[i];
+    unsigned long long *swap = keys;
+    keys = tmp;
+    tmp = swap;
+  }
+
+  return keys;
+}
+
+u_int collect_unique_edges(const obj3d *obj, u_int **edges) {
+  u_int count = 0, sides = 0;
+  unsigned long long *keys = NULL, *tmp = NULL, *sorted = NULL;
+  const u_int *ind = NULL;
+  double start = active_stats ? stats_now_ms() : 0.0;
+
+  if (edges) *edges = NULL;
+  if (!obj || !edges || obj->total_indexes == 0) return count;
+
+  keys = (unsigned long long *)malloc(obj->total_indexes * sizeof(*keys));
+  tmp = (unsigned long long *)malloc(obj->total_indexes * sizeof(*tmp));
+  if (keys && tmp) {
+    stats_heap_add(2LL * obj->total_indexes * sizeof(*keys));
+    // каждая сторона многоугольника кодируется ключом (меньший << 32 | больший)
+    ind = obj->polygons.vertexes_ind;
+    for (u_int f = 0; f < obj->faces_count; f++) {
+      u_int n = obj->polygons.indeces_count[f];
+      for (u_int k = 0; k < n && sides < obj->total_indexes; k++) {
+        u_int a = ind[k], b = ind[(k + 1) % n];
+        set_first_lesser_and_second_greater(&a, &b);
+        keys[sides++] = ((unsigned long long)a << 32) | b;
+      }
+      ind += n;
+    }
+    sorted = sides ? radix_sort_keys(keys, tmp, sides) : keys;
+    for (u_int i = 0; i < sides; i++) {
+      if (i == 0 || sorted[i] != sorted[i - 1]) sorted[count++] = sorted[i];
+    }
+    *edges = (u_int *)malloc((2 * (size_t)count + 1) * sizeof(u_int));
+    for (u_int i = 0; *edges && i < count; i++) {
+      (*edges)[2 * i] = (u_int)(sorted[i] >> 32);
+      (*edges)[2 * i + 1] = (u_int)(sorted[i] & 0xFFFFFFFFu);
+    }
+    if (!*edges) count = 0;
+  }
+  free(keys);
+  free(tmp);
+  if (active_stats) {
+    if (keys && tmp) stats_heap_add(-2LL * obj->total_indexes * sizeof(*keys));
+    active_stats->edges_ms += stats_now_ms() - start;
+  }
+
+  return count;
+}
+
+size_t obj_footprint(const obj3d *obj) {
+  size_t bytes = 0;
+
+  if (!obj) return bytes;
+  bytes = sizeof(obj3d);
+  if (obj->vertexes) {
+    bytes += array_bytes(array_cap(obj->vertexes), sizeof(float));
+  }
+  if (obj->polygons.vertexes_ind) {
+    bytes += array_bytes(array_cap(obj->polygons.vertexes_ind), sizeof(u_int));
+  }
+  if (obj->polygons.indeces_count) {
+    bytes += array_bytes(array_cap(obj->polygons.indeces_count), sizeof(u_int));
+  }
+  if (obj->normals) {
+    bytes += (size_t)obj->normals_count * AX_DIMEN * sizeof(float);
+  }
+
+  return bytes;
+}
+
+float *obj_normals_resize(obj3d *obj, u_int vertexes) {
+  const size_t b = AX_DIMEN * sizeof(float);
+  float *normals = NULL;
+
+  if (vertexes == 0) {
+    if (obj->normals) stats_heap_add(-(long long)(obj->normals_count * b));
+    mem_dealloc(obj->normals);
+    obj->normals = NULL;
+    obj->normals_count = 0;
+  } else {
+    normals = (float *)mem_realloc(obj->normals, vertexes * b);
+    if (normals) {
+      stats_heap_add((long long)(vertexes * b) -
+                     (long long)(obj->normals ? obj->normals_count * b : 0));
+      obj->normals = normals;
+      obj->normals_count = vertexes;
+    }
+  }
+
+  return normals;
+}
+
 void obj_destroy(obj3d *obj) {
   array_clean(obj->vertexes);
   array_clean(obj->polygons.vertexes_ind);
   array_clean(obj->polygons.indeces_count);
+  obj_normals_resize(obj, 0);
 
   mem_dealloc(obj);
+  stats_heap_add(-(long long)sizeof(obj3d));
 }
@@ -0,0 +1,486 @@
+/**
+ * @file s21_obj_writer.c
+ * @brief Fast export of the 3D object into a .obj file
+ * @details
+ * Файл пишется раундами без printf:
+ * 1) вершины, нормали и грани режутся на куски примерно по
+ *    WRITER_CHUNK_BYTES, в раунде до двух кусков на поток;
+ * 2) куски раунда форматируются параллельно, каждый поток пишет только в
+ *    буфер своего куска, буферы переиспользуются между раундами;
+ * 3) готовые буферы раунда уходят в файл одним writev по порядку.
+ * Число записывается самым коротким из 6..9 значащих знаков, которое
+ * переводится обратно в тот же float, 9 знаков всегда достаточно. Короткий
+ * кандидат проверяется попаданием в интервал чисел, округляемых к этому
+ * float, без обратного разбора. Степени десяти берутся из таблицы
+ * литералов, поэтому компилятор округлил их точно.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "s21_3d_viewer.h"
+
+#define WRITER_CHUNK_BYTES (1U << 20)  ///< target size of a formatted chunk
+#define WRITER_FLOAT_BYTES 16          ///< "-1.23456789e-38"
+#define WRITER_LINE_BYTES (3 + AX_DIMEN * (WRITER_FLOAT_BYTES + 1) + 1)
+#define WRITER_INDEX_BYTES (2 * 11 + 2)  ///< " 4294967295//4294967295"
+#define WRITER_MAX_CHUNKS (2 * MAX_THREADS)
+#define WRITER_SLACK 16  ///< fixed-size copies may write past the end
+#define WRITER_POW10_MIN (-45)
+
+/**
+ * @brief  Collection of sections of the written file
+ */
+typedef enum { SECTION_VERTEXES, SECTION_NORMALS, SECTION_FACES } SECTION;
+
+static const double POW10[] = {
+    1e-45, 1e-44, 1e-43, 1e-42, 1e-41, 1e-40, 1e-39, 1e-38, 1e-37, 1e-36,
+    1e-35, 1e-34, 1e-33, 1e-32, 1e-31, 1e-30, 1e-29, 1e-28, 1e-27, 1e-26,
+    1e-25, 1e-24, 1e-23, 1e-22, 1e-21, 1e-20, 1e-19, 1e-18, 1e-17, 1e-16,
+    1e-15, 1e-14, 1e-13, 1e-12, 1e-11, 1e-10, 1e-9,  1e-8,  1e-7,  1e-6,
+    1e-5,  1e-4,  1e-3,  1e-2,  1e-1,  1e0,   1e1,   1e2,   1e3,   1e4,
+    1e5,   1e6,   1e7,   1e8,   1e9,   1e10,  1e11,  1e12,  1e13,  1e14,
+    1e15,  1e16,  1e17,  1e18,  1e19,  1e20,  1e21,  1e22,  1e23,  1e24,
+    1e25,  1e26,  1e27,  1e28,  1e29,  1e30,  1e31,  1e32,  1e33,  1e34,
+    1e35,  1e36,  1e37,  1e38,  1e39,  1e40,  1e41,  1e42,  1e43,  1e44,
+    1e45,  1e46,  1e47,  1e48,  1e49,  1e50,  1e51,  1e52,  1e53,
+};
+
+static const u_int POW10_U[] = {1,         10,        100,      1000,
+                                10000,     100000,    1000000,  10000000,
+                                100000000, 1000000000};
+
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324"
+    "25262728293031323334353637383940414243444546474849"
+    "50515253545556575859606162636465666768697071727374"
+    "75767778798081828384858687888990919293949596979899";
+
+/**
+ * @brief formatted part of the file
+ */
+typedef struct {
+  int section;
+  u_int begin;        ///< first vertex or face
+  u_int end;          ///< past the last vertex or face
+  size_t first_index;  ///< offset of the face begin in vertexes_ind
+  size_t bound;       ///< upper bound of the formatted length
+  char *data;
+  size_t capacity;
+  size_t length;
+} write_chunk_t;
+
+typedef struct {
+  const obj3d *obj;
+  write_chunk_t chunks[WRITER_MAX_CHUNKS];
+  u_int count;
+} write_job_t;
+
+/**
+ * @brief where the next round starts
+ */
+typedef struct {
+  int section;
+  u_int item;
+  size_t index;
+} write_cursor_t;
+
+/*------------------------------formatting----------------------------*/
+
+static double pow10_of(int n) { return POW10[n - WRITER_POW10_MIN]; }
+
+/**
+ * @brief exactly k digits of m, m has no leading zeros
+ */
+static void format_digits(char *digits, u_int m, int k) {
+  char *p = digits + k;
+
+  while (m >= 100) {
+    u_int pair = (m % 100) * 2;
+    m /= 100;
+    *--p = DIGIT_PAIRS[pair + 1];
+    *--p = DIGIT_PAIRS[pair];
+  }
+  if (m >= 10) {
+    *--p = DIGIT_PAIRS[m * 2 + 1];
+    *--p = DIGIT_PAIRS[m * 2];
+  } else {
+    *--p = (char)('0' + m);
+  }
+}
+
+static int count_digits(u_int value) {
+  int count = 1;
+
+  // сумма сравнений вместо цикла с непредсказуемым числом итераций
+  for (int i = 1; i < 10; i++) count += value >= POW10_U[i];
+
+  return count;
+}
+
+static char *format_uint(char *out, u_int value) {
+  int count = count_digits(value);
+
+  format_digits(out, value, count);
+
+  return out + count;
+}
+
+// x * 10^shift: для |shift| до 22 множитель точный
+static double shift_decimal(double x, int shift) {
+  return shift >= 0 ? x * pow10_of(shift) : x / pow10_of(-shift);
+}
+
+static u_int round_decimal(double x, int shift) {
+  return (u_int)(shift_decimal(x, shift) + 0.5);
+}
+
+static double float_of_bits(u_int bits) {
+  float value = 0.0f;
+
+  memcpy(&value, &bits, sizeof(value));
+
+  return (double)value;
+}
+
+/**
+ * @brief e of 10^e <= x < 10^(e + 1), bits are bits of positive float x
+ */
+static int decimal_exponent(u_int bits, double x) {
+  int binary = (int)(bits >> 23) - 127;
+  // 1233 / 4096 ~ log10(2), сдвиг на 200 делает деление целым и неотрицательным
+  int e = (((binary + 200) * 1233) >> 12) - 61;
+
+  if (e < WRITER_POW10_MIN) e = WRITER_POW10_MIN;
+  while (e < 38 && x >= pow10_of(e + 1)) e++;
+  // у денормализованных чисел двоичная степень меньше -127
+  while (e > WRITER_POW10_MIN && x < pow10_of(e)) e--;
+
+  return e;
+}
+
+static inline u_int round_to(u_int m, u_int step) {
+  return (m + step / 2) / step * step;
+}
+
+// & вместо &&: лишнее сравнение дешевле неверно предсказанного перехода
+static inline int is_inside(u_int m, double lo, double hi) {
+  return ((double)m > lo) & ((double)m < hi);
+}
+
+/**
+ * @brief shortest of 6..9 significant digits which reads back to the float
+ *
+ * @details x is rounded to 9 digits once, a shorter rounding is taken if it
+ * lies strictly inside the interval of reals which round to this float, the
+ * bounds are halfway to the neighbour floats and are exact in double
+ */
+static int shortest_digits(u_int bits, double x, int *e, u_int *mantissa) {
+  double lo = (float_of_bits(bits - 1) + x) * 0.5;
+  double hi = (float_of_bits(bits + 1) + x) * 0.5;
+  u_int m = round_decimal(x, 8 - *e);
+  int k = 9;
+
+  // округление перешло в следующую декаду: 9.999999995 -> 10.0000000
+  if (m >= 1000000000U) m = round_decimal(x, 8 - ++(*e));
+  lo = shift_decimal(lo, 8 - *e);
+  hi = shift_decimal(hi, 8 - *e);
+  // запас на ошибку умножения на степень десяти
+  lo += hi * 0x1p-50;
+  hi -= hi * 0x1p-50;
+  // какой кандидат подойдет, не предсказать, поэтому выбор по маскам без
+  // ветвлений, а округления делятся на константы
+  u_int c8 = round_to(m, 10), c7 = round_to(m, 100), c6 = round_to(m, 1000);
+  u_int mask8 = -(u_int)is_inside(c8, lo, hi);
+  u_int mask7 = -(u_int)is_inside(c7, lo, hi);
+  u_int mask6 = -(u_int)is_inside(c6, lo, hi);
+  k -= (int)(1 & mask8);
+  k -= (int)((u_int)(k - 7) & mask7);
+  k -= (int)((u_int)(k - 6) & mask6);
+  m += (c8 - m) & mask8;
+  m += (c7 - m) & mask7;
+  m += (c6 - m) & mask6;
+  m /= POW10_U[9 - k];
+  // 9.9999996 -> 10.00000: знаков стало на один больше
+  if (m >= POW10_U[k]) {
+    m /= 10;
+    (*e)++;
+  }
+  while (k > 1 && m % 10 == 0) {
+    m /= 10;
+    k--;
+  }
+  *mantissa = m;
+
+  return k;
+}
+
+static char *format_float(char *out, float value) {
+  char digits[24] = "000000000000000000000000";
+  u_int m = 0;
+  u_int bits = 0;
+  double x = 0.0;
+  int e = 0, k = 0;
+
+  memcpy(&bits, &value, sizeof(bits));
+  if ((bits & 0x7FFFFFFFU) > 0x7F800000U) {
+    memcpy(out, "nan", 3);
+    return out + 3;
+  }
+  if ((bits >> 31) && (bits & 0x7FFFFFFFU)) *out++ = '-';
+  bits &= 0x7FFFFFFFU;
+  if (bits == 0x7F800000U) {
+    memcpy(out, "inf", 3);
+    return out + 3;
+  }
+  if (bits == 0) {
+    *out++ = '0';
+    return out;
+  }
+  x = float_of_bits(bits);
+  e = decimal_exponent(bits, x);
+  k = shortest_digits(bits, x, &e, &m);
+  format_digits(digits, m, k);
+
+  // копии фиксированной длины вместо побайтовых циклов, лишние байты
+  // затрет следующая запись, место под них есть в WRITER_SLACK
+  if (e >= 0 && e <= 8) {
+    // 123.45, цифры после k уже нули и дополняют целую часть
+    memcpy(out, digits, 16);
+    if (k > e + 1) {
+      out[e + 1] = '.';
+      memcpy(out + e + 2, digits + e + 1, 8);
+      out++;
+    }
+    out += k > e + 1 ? k : e + 1;
+  } else if (e < 0 && e >= -5) {
+    // 0.00012345
+    memcpy(out, "0.00000", 8);
+    out += 1 - e;
+    memcpy(out, digits, 16);
+    out += k;
+  } else {
+    // 1.2345e-20
+    *out++ = digits[0];
+    if (k > 1) {
+      *out = '.';
+      memcpy(out + 1, digits + 1, 8);
+      out += k;
+    }
+    *out++ = 'e';
+    if (e < 0) *out++ = '-';
+    out = format_uint(out, (u_int)(e < 0 ? -e : e));
+  }
+
+  return out;
+}
+
+static char *format_vector(char *out, const char *prefix, size_t prefix_len,
+                           const float *v) {
+  memcpy(out, prefix, prefix_len);
+  out += prefix_len;
+  for (u_int i = 0; i < AX_DIMEN; i++) {
+    *out++ = ' ';
+    out = format_float(out, v[i]);
+  }
+  *out++ = '\n';
+
+  return out;
+}
+
+static char *format_faces(char *out, const obj3d *obj, u_int begin, u_int end,
+                          size_t index) {
+  const u_int *ind = obj->polygons.vertexes_ind + index;
+
+  for (u_int f = begin; f < end; f++) {
+    *out++ = 'f';
+    for (u_int k = 0; k < obj->polygons.indeces_count[f]; k++) {
+      *out++ = ' ';
+      out = format_uint(out, *ind);
+      if (obj->normals && *ind >= 1 && *ind <= obj->normals_count) {
+        *out++ = '/';
+        *out++ = '/';
+        out = format_uint(out, *ind);
+      }
+      ind++;
+    }
+    *out++ = '\n';
+  }
+
+  return out;
+}
+
+static void format_range(void *ctx, u_int begin, u_int end,
+                         u_int thread_index) {
+  write_job_t *job = (write_job_t *)ctx;
+  const obj3d *obj = job->obj;
+  (void)thread_index;
+
+  for (u_int c = begin; c < end; c++) {
+    write_chunk_t *chunk = job->chunks + c;
+    char *out = chunk->data;
+
+    if (chunk->section == SECTION_FACES) {
+      out = format_faces(out, obj, chunk->begin, chunk->end,
+                         chunk->first_index);
+    } else {
+      const float *v = chunk->section == SECTION_VERTEXES ? obj->vertexes
+                                                          : obj->normals;
+      const char *prefix = chunk->section == SECTION_VERTEXES ? "v" : "vn";
+      for (u_int i = chunk->begin; i < chunk->end; i++) {
+        out = format_vector(out, prefix, strlen(prefix),
+                            v + (size_t)i * AX_DIMEN);
+      }
+    }
+    chunk->length = (size_t)(out - chunk->data);
+  }
+}
+
+/*-------------------------------planning-----------------------------*/
+
+static u_int section_size(const obj3d *obj, int section) {
+  u_int size = obj->faces_count;
+
+  if (section == SECTION_VERTEXES) size = obj->vertexes_count;
+  if (section == SECTION_NORMALS) size = obj->normals ? obj->normals_count : 0;
+
+  return size;
+}
+
+/**
+ * @brief cut the next piece of the current section into the chunk
+ */
+static void plan_chunk(const obj3d *obj, write_cursor_t *cursor,
+                       write_chunk_t *chunk) {
+  u_int size = section_size(obj, cursor->section);
+
+  chunk->section = cursor->section;
+  chunk->begin = cursor->item;
+  chunk->first_index = cursor->index;
+  chunk->bound = 0;
+  if (cursor->section != SECTION_FACES) {
+    u_int lines = WRITER_CHUNK_BYTES / WRITER_LINE_BYTES;
+    chunk->end = size - cursor->item < lines ? size : cursor->item + lines;
+    chunk->bound = (size_t)(chunk->end - chunk->begin) * WRITER_LINE_BYTES;
+  } else {
+    u_int f = cursor->item;
+    // грань целиком в одном куске, даже если она длиннее WRITER_CHUNK_BYTES
+    while (f < size &&
+           (f == cursor->item || chunk->bound < WRITER_CHUNK_BYTES)) {
+      u_int n = obj->polygons.indeces_count[f++];
+      chunk->bound += 2 + (size_t)n * WRITER_INDEX_BYTES;
+      cursor->index += n;
+    }
+    chunk->end = f;
+  }
+  cursor->item = chunk->end;
+}
+
+static int is_cursor_done(const obj3d *obj, write_cursor_t *cursor) {
+  while (cursor->section <= SECTION_FACES &&
+         cursor->item >= section_size(obj, cursor->section)) {
+    cursor->section++;
+    cursor->item = 0;
+  }
+
+  return cursor->section > SECTION_FACES;
+}
+
+static int plan_round(write_job_t *job, write_cursor_t *cursor,
+                      u_int max_chunks) {
+  job->count = 0;
+  while (job->count < max_chunks && !is_cursor_done(job->obj, cursor)) {
+    write_chunk_t *chunk = job->chunks + job->count;
+    plan_chunk(job->obj, cursor, chunk);
+    if (chunk->bound + WRITER_SLACK > chunk->capacity) {
+      char *data = (char *)realloc(chunk->data, chunk->bound + WRITER_SLACK);
+      if (!data) return FALSE;
+      chunk->data = data;
+      chunk->capacity = chunk->bound + WRITER_SLACK;
+    }
+    job->count++;
+  }
+
+  return TRUE;
+}
+
+/*--------------------------------output------------------------------*/
+
+static int write_all(int fd, struct iovec *iov, u_int count) {
+  u_int first = 0;
+
+  while (first < count) {
+    ssize_t written = writev(fd, iov + first, (int)(count - first));
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return FALSE;
+    }
+    while (first < count && (size_t)written >= iov[first].iov_len) {
+      written -= (ssize_t)iov[first].iov_len;
+      first++;
+    }
+    if (first < count) {
+      iov[first].iov_base = (char *)iov[first].iov_base + written;
+      iov[first].iov_len -= (size_t)written;
+    }
+  }
+
+  return TRUE;
+}
+
+static int write_round(int fd, const write_job_t *job) {
+  struct iovec iov[WRITER_MAX_CHUNKS];
+
+  for (u_int c = 0; c < job->count; c++) {
+    iov[c].iov_base = job->chunks[c].data;
+    iov[c].iov_len = job->chunks[c].length;
+  }
+
+  return write_all(fd, iov, job->count);
+}
+
+static int is_faces_consistent(const obj3d *obj) {
+  size_t total = 0;
+
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    total += obj->polygons.indeces_count[f];
+  }
+
+  return total == obj->total_indexes;
+}
+
+int write_obj_file(const obj3d *obj, const char *path, u_int threads) {
+  static const char header[] = "# exported by 3DViewer\n";
+  write_job_t *job = NULL;
+  write_cursor_t cursor = {SECTION_VERTEXES, 0, 0};
+  struct iovec head = {(void *)header, sizeof(header) - 1};
+  u_int max_chunks = 0;
+  int fd = -1, is_written = FALSE;
+
+  if (!obj || !path || !is_faces_consistent(obj)) return FALSE;
+  job = (write_job_t *)calloc(1, sizeof(write_job_t));
+  if (!job) return FALSE;
+  job->obj = obj;
+  threads = get_threads_count(threads);
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+  max_chunks = 2 * threads;
+
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    is_written = write_all(fd, &head, 1);
+    while (is_written && plan_round(job, &cursor, max_chunks) && job->count) {
+      parallel_for(job->count, threads, format_range, job);
+      is_written = write_round(fd, job);
+    }
+    // раунд прервался из-за нехватки памяти
+    if (!is_cursor_done(obj, &cursor)) is_written = FALSE;
+    if (close(fd) != 0) is_written = FALSE;
+  }
+  for (u_int c = 0; c < WRITER_MAX_CHUNKS; c++) free(job->chunks[c].data);
+  free(job);
+
+  return is_written;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file s21_parallel.c
+ * @brief Minimal fork-join helpers shared by the parallel backend routines
+ * @details
+ * Диапазон [0, count) делится на равные непрерывные куски, каждый кусок
+ * обрабатывается своим потоком. Последний кусок выполняет вызывающий поток,
+ * поэтому при threads == 1 никакие потоки не создаются вовсе.
+ *
+ * Для задач неравной стоимости (например, файлы разного размера) есть
+ * parallel_for_stealing: у каждого потока свой диапазон индексов, упакованный
+ * в одно 64-битное атомарное слово. Владелец забирает индексы с начала,
+ * освободившийся поток крадет половину с конца чужого диапазона.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "s21_3d_viewer.h"
+
+/**
+ * @brief arguments of one worker of parallel_for
+ */
+typedef struct {
+  range_func_t func;
+  void *ctx;
+  u_int begin;
+  u_int end;
+  u_int thread_index;
+} parallel_chunk_t;
+
+static void *parallel_chunk_run(void *arg) {
+  parallel_chunk_t *chunk = (parallel_chunk_t *)arg;
+
+  chunk->func(chunk->ctx, chunk->begin, chunk->end, chunk->thread_index);
+
+  return NULL;
+}
+
+u_int get_threads_count(u_int requested) {
+  long online = 0;
+
+  if (requested > 0) return requested;
+
+  online = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return online > 0 ? (u_int)online : 1U;
+}
+
+u_int parallel_for(u_int count, u_int threads, range_func_t func, void *ctx) {
+  parallel_chunk_t chunks[MAX_THREADS];
+  pthread_t handles[MAX_THREADS];
+  u_int started = 0;
+
+  threads = get_threads_count(threads);
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+  if (threads > count) threads = count;
+  if (threads == 0) return 0;
+
+  for (u_int t = 0; t < threads; t++) {
+    chunks[t].func = func;
+    chunks[t].ctx = ctx;
+    chunks[t].begin = (u_int)((unsigned long long)count * t / threads);
+    chunks[t].end = (u_int)((unsigned long long)count * (t + 1) / threads);
+    chunks[t].thread_index = t;
+  }
+  // создаем потоки для всех кусков кроме последнего, если поток не создался,
+  // то его кусок выполнит вызывающий поток
+  for (u_int t = 0; t + 1 < threads; t++) {
+    if (pthread_create(&handles[t], NULL, parallel_chunk_run, &chunks[t])) {
+      break;
+    }
+    started++;
+  }
+  for (u_int t = started; t < threads; t++) parallel_chunk_run(&chunks[t]);
+  for (u_int t = 0; t < started; t++) pthread_join(handles[t], NULL);
+
+  return threads;
+}
+
+/**
+ * @brief range [begin, end) of one worker of parallel_for_stealing
+ */
+typedef struct {
+  _Alignas(64) atomic_ullong range;  ///< begin in low 32 bits, end in high
+} steal_range_t;
+
+/**
+ * @brief shared data of parallel_for_stealing
+ */
+typedef struct {
+  steal_range_t ranges[MAX_THREADS];
+  u_int threads;
+  range_func_t func;
+  void *ctx;
+} steal_pool_t;
+
+/**
+ * @brief arguments of one worker of parallel_for_stealing
+ */
+typedef struct {
+  steal_pool_t *pool;
+  u_int thread_index;
+} steal_worker_t;
+
+static unsigned long long pack_range(u_int begin, u_int end) {
+  return (unsigned long long)begin | ((unsigned long long)end << 32);
+}
+
+static int take_own_index(steal_range_t *own, u_int *index) {
+  unsigned long long range = atomic_load(&own->range);
+
+  while (1) {
+    u_int begin = (u_int)range, end = (u_int)(range >> 32);
+    if (begin >= end) return FALSE;
+    if (atomic_compare_exchange_weak(&own->range, &range,
+                                     pack_range(begin + 1, end))) {
+      *index = begin;
+      return TRUE;
+    }
+  }
+}
+
+/**
+ * @brief move the back half of some other worker's range into own range
+ */
+static int steal_range(steal_pool_t *pool, u_int thief) {
+  for (u_int k = 1; k < pool->threads; k++) {
+    steal_range_t *victim = &pool->ranges[(thief + k) % pool->threads];
+    unsigned long long range = atomic_load(&victim->range);
+
+    while (1) {
+      u_int begin = (u_int)range, end = (u_int)(range >> 32);
+      u_int middle = begin + (end - begin) / 2;
+      if (begin >= end) break;
+      if (atomic_compare_exchange_weak(&victim->range, &range,
+                                       pack_range(begin, middle))) {
+        // свой диапазон пуст, поэтому его никто не меняет
+        atomic_store(&pool->ranges[thief].range, pack_range(middle, end));
+        return TRUE;
+      }
+    }
+  }
+
+  return FALSE;
+}
+
+static void *steal_worker_run(void *arg) {
+  steal_worker_t *worker = (steal_worker_t *)arg;
+  steal_pool_t *pool = worker->pool;
+  steal_range_t *own = &pool->ranges[worker->thread_index];
+  u_int index = 0;
+
+  do {
+    while (take_own_index(own, &index)) {
+      pool->func(pool->ctx, index, index + 1, worker->thread_index);
+    }
+  } while (steal_range(pool, worker->thread_index));
+
+  return NULL;
+}
+
+u_int parallel_for_stealing(u_int count, u_int threads, range_func_t func,
+                            void *ctx) {
+  steal_pool_t pool;
+  steal_worker_t workers[MAX_THREADS];
+  pthread_t handles[MAX_THREADS];
+  u_int started = 0;
+
+  threads = get_threads_count(threads);
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+  if (threads > count) threads = count;
+  if (threads == 0) return 0;
+
+  pool.threads = threads;
+  pool.func = func;
+  pool.ctx = ctx;
+  for (u_int t = 0; t < threads; t++) {
+    u_int begin = (u_int)((unsigned long long)count * t / threads);
+    u_int end = (u_int)((unsigned long long)count * (t + 1) / threads);
+    atomic_init(&pool.ranges[t].range, pack_range(begin, end));
+    workers[t].pool = &pool;
+    workers[t].thread_index = t;
+  }
+  // если поток не создался, его диапазон украдут остальные
+  for (u_int t = 0; t + 1 < threads; t++) {
+    if (pthread_create(&handles[t], NULL, steal_worker_run, &workers[t])) {
+      break;
+    }
+    started++;
+  }
+  steal_worker_run(&workers[threads - 1]);
+  for (u_int t = 0; t < started; t++) pthread_join(handles[t], NULL);
+
+  return threads;
+}
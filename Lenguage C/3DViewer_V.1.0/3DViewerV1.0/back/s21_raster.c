@@ -0,0 +1,706 @@
+/**
+ * @file s21_raster.c
+ * @brief Headless tile-based software rasterizer of the 3D object
+ * @details
+ * Рендер без Qt и OpenGL проходит в четыре этапа:
+ * 1) параллельно по вершинам: перевод в пространство камеры и на экран;
+ * 2) параллельно по граням: разбиение многоугольников на треугольники веером;
+ * 3) параллельно по примитивам: раскладка (binning) треугольников и ребер по
+ *    экранным плиткам TILE_SIZE x TILE_SIZE, у каждого потока свои корзины;
+ * 4) потоки разбирают плитки через атомарный счетчик и растеризуют их,
+ *    просматривая корзины потоков по порядку, поэтому порядок примитивов
+ *    и итоговое изображение не зависят от количества потоков.
+ * Треугольники, у которых есть вершина за камерой, отбрасываются целиком.
+ * Если переданы meshlets, этап 2 берет треугольники только из кластеров,
+ * прошедших cull_meshlets, и отсеченные кластеры не попадают в раскладку.
+ * Если передан face_cull, этап 2 разбивает только грани, оставленные
+ * cull_faces.
+ */
+
+#include <float.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "s21_3d_viewer.h"
+
+#define NEAR_W 1e-5f      ///< Min clip w of a vertex in front of the camera
+#define EDGE_BIAS 1e-4f   ///< Depth bias of edges drawn over faces
+#define AMBIENT 0.25f     ///< Ambient part of the flat shading
+#define NO_VERTEX 0xFFFFFFFFu
+
+/**
+ * @brief growing list of primitives of one tile filled by one thread
+ */
+typedef struct {
+  u_int *items;
+  u_int count;
+  u_int capacity;
+} tile_bin_t;
+
+/**
+ * @brief shared data of all stages of the render
+ */
+typedef struct {
+  const obj3d *obj;
+  const render_options_t *options;
+  framebuffer_t *fb;
+  float mv[4][4];
+  float projection[4][4];
+  float *screen;  ///< x, y in pixels, z in NDC, clip w
+  float *eye;     ///< position in the camera space
+  const polygon_t *polygons;  ///< faces to triangulate
+  u_int faces_count;
+  const u_int *face_start;
+  const u_int *tri_start;
+  u_int *triangles;  ///< 0-based vertexes of triangles
+  u_int triangles_count;
+  const u_int *edges;  ///< 1-based pairs
+  u_int edges_count;
+  u_int tiles_x;
+  u_int tiles_y;
+  u_int tiles_count;
+  tile_bin_t *tri_bins;   ///< [thread * tiles_count + tile]
+  tile_bin_t *line_bins;  ///< [thread * tiles_count + tile]
+  u_int bins_threads;
+  atomic_uint next_tile;
+  atomic_int failed;
+} raster_ctx_t;
+
+framebuffer_t *framebuffer_create(u_int width, u_int height) {
+  framebuffer_t *fb = NULL;
+
+  if (width == 0 || height == 0) return NULL;
+  fb = (framebuffer_t *)malloc(sizeof(framebuffer_t));
+  if (!fb) return NULL;
+  fb->width = width;
+  fb->height = height;
+  fb->pixels = (unsigned char *)malloc((size_t)width * height * 4);
+  fb->depth = (float *)malloc((size_t)width * height * sizeof(float));
+  if (!fb->pixels || !fb->depth) {
+    framebuffer_destroy(fb);
+    fb = NULL;
+  }
+
+  return fb;
+}
+
+void framebuffer_destroy(framebuffer_t *fb) {
+  if (fb) {
+    free(fb->pixels);
+    free(fb->depth);
+    free(fb);
+  }
+}
+
+void render_options_default(render_options_t *options) {
+  const unsigned char background[4] = {32, 32, 40, 255};
+  const unsigned char face_color[4] = {200, 200, 210, 255};
+  const unsigned char edge_color[4] = {255, 140, 0, 255};
+
+  memcpy(options->background, background, 4);
+  memcpy(options->face_color, face_color, 4);
+  memcpy(options->edge_color, edge_color, 4);
+  options->mode = RENDER_WIREFRAME | RENDER_FLAT;
+  options->threads = 0;
+  options->edges = NULL;
+  options->edges_count = 0;
+  options->meshlets = NULL;
+  options->face_cull = NULL;
+  options->cull_mode = CULL_BACK_FACES | CULL_FRUSTUM;
+}
+
+static int bin_push(tile_bin_t *bin, u_int item) {
+  if (bin->count == bin->capacity) {
+    u_int capacity = bin->capacity ? 2 * bin->capacity : 64;
+    u_int *items = (u_int *)realloc(bin->items, capacity * sizeof(u_int));
+    if (!items) return FALSE;
+    bin->items = items;
+    bin->capacity = capacity;
+  }
+  bin->items[bin->count++] = item;
+
+  return TRUE;
+}
+
+static void bins_destroy(tile_bin_t *bins, u_int count) {
+  for (u_int i = 0; bins && i < count; i++) free(bins[i].items);
+  free(bins);
+}
+
+/**
+ * @brief stage 1: vertexes to camera space and to screen
+ */
+static void transform_range(void *ctx, u_int begin, u_int end,
+                            u_int thread_index) {
+  raster_ctx_t *rc = (raster_ctx_t *)ctx;
+  float(*mv)[4] = rc->mv;
+  float(*p)[4] = rc->projection;
+  float width = (float)rc->fb->width, height = (float)rc->fb->height;
+  (void)thread_index;
+
+  for (u_int v = begin; v < end; v++) {
+    const float *in = rc->obj->vertexes + (size_t)v * AX_DIMEN;
+    float *eye = rc->eye + (size_t)v * AX_DIMEN;
+    float *screen = rc->screen + (size_t)v * 4;
+    float clip[4];
+
+    for (int i = 0; i < 3; i++) {
+      eye[i] = mv[i][0] * in[0] + mv[i][1] * in[1] + mv[i][2] * in[2] + mv[i][3];
+    }
+    for (int i = 0; i < 4; i++) {
+      clip[i] = p[i][0] * eye[0] + p[i][1] * eye[1] + p[i][2] * eye[2] + p[i][3];
+    }
+    screen[3] = clip[3];
+    if (clip[3] > NEAR_W) {
+      screen[0] = (clip[0] / clip[3] * 0.5f + 0.5f) * width;
+      screen[1] = (0.5f - clip[1] / clip[3] * 0.5f) * height;
+      screen[2] = clip[2] / clip[3];
+    }
+  }
+}
+
+/**
+ * @brief stage 2: fan triangulation of polygons
+ */
+static void triangulate_range(void *ctx, u_int begin, u_int end,
+                              u_int thread_index) {
+  raster_ctx_t *rc = (raster_ctx_t *)ctx;
+  const obj3d *obj = rc->obj;
+  (void)thread_index;
+
+  for (u_int f = begin; f < end; f++) {
+    const u_int *ind = rc->polygons->vertexes_ind + rc->face_start[f];
+    u_int n = rc->face_start[f + 1] - rc->face_start[f];
+    u_int *tri = rc->triangles + (size_t)rc->tri_start[f] * 3;
+
+    for (u_int k = 1; k + 1 < n; k++, tri += 3) {
+      tri[0] = ind[0] - 1;
+      tri[1] = ind[k] - 1;
+      tri[2] = ind[k + 1] - 1;
+      for (int i = 0; i < 3; i++) {
+        if (tri[i] >= obj->vertexes_count) tri[0] = NO_VERTEX;
+      }
+    }
+  }
+}
+
+/**
+ * @brief pixel rectangle [x0, x1) x [y0, y1) clamped to framebuffer
+ */
+static int screen_bounds(const raster_ctx_t *rc, const float *const *pts,
+                         int count, int *x0, int *y0, int *x1, int *y1) {
+  float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+
+  for (int i = 0; i < count; i++) {
+    if (pts[i][3] <= NEAR_W) return FALSE;
+    if (pts[i][0] < min_x) min_x = pts[i][0];
+    if (pts[i][0] > max_x) max_x = pts[i][0];
+    if (pts[i][1] < min_y) min_y = pts[i][1];
+    if (pts[i][1] > max_y) max_y = pts[i][1];
+  }
+  if (max_x < 0.0f || max_y < 0.0f || min_x >= (float)rc->fb->width ||
+      min_y >= (float)rc->fb->height) {
+    return FALSE;
+  }
+  *x0 = min_x < 0.0f ? 0 : (int)min_x;
+  *y0 = min_y < 0.0f ? 0 : (int)min_y;
+  *x1 = max_x >= (float)rc->fb->width - 1 ? (int)rc->fb->width : (int)max_x + 2;
+  *y1 = max_y >= (float)rc->fb->height - 1 ? (int)rc->fb->height : (int)max_y + 2;
+
+  return TRUE;
+}
+
+static void bin_primitive(raster_ctx_t *rc, tile_bin_t *bins,
+                          const float *const *pts, int count, u_int id) {
+  int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+  if (!screen_bounds(rc, pts, count, &x0, &y0, &x1, &y1)) return;
+  for (int ty = y0 / TILE_SIZE; ty <= (y1 - 1) / TILE_SIZE; ty++) {
+    for (int tx = x0 / TILE_SIZE; tx <= (x1 - 1) / TILE_SIZE; tx++) {
+      if (!bin_push(&bins[(u_int)ty * rc->tiles_x + (u_int)tx], id)) {
+        atomic_store(&rc->failed, TRUE);
+      }
+    }
+  }
+}
+
+/**
+ * @brief stage 3: per-thread binning of triangles
+ */
+static void bin_triangles_range(void *ctx, u_int begin, u_int end,
+                                u_int thread_index) {
+  raster_ctx_t *rc = (raster_ctx_t *)ctx;
+  tile_bin_t *bins = rc->tri_bins + (size_t)thread_index * rc->tiles_count;
+
+  for (u_int t = begin; t < end; t++) {
+    const u_int *tri = rc->triangles + (size_t)t * 3;
+    if (tri[0] == NO_VERTEX) continue;
+    const float *pts[3] = {rc->screen + (size_t)tri[0] * 4,
+                           rc->screen + (size_t)tri[1] * 4,
+                           rc->screen + (size_t)tri[2] * 4};
+    bin_primitive(rc, bins, pts, 3, t);
+  }
+}
+
+/**
+ * @brief stage 3: per-thread binning of edges
+ */
+static void bin_edges_range(void *ctx, u_int begin, u_int end,
+                            u_int thread_index) {
+  raster_ctx_t *rc = (raster_ctx_t *)ctx;
+  tile_bin_t *bins = rc->line_bins + (size_t)thread_index * rc->tiles_count;
+
+  for (u_int e = begin; e < end; e++) {
+    u_int a = rc->edges[2 * e], b = rc->edges[2 * e + 1];
+    if (a == 0 || b == 0 || a > rc->obj->vertexes_count ||
+        b > rc->obj->vertexes_count) {
+      continue;
+    }
+    const float *pts[2] = {rc->screen + (size_t)(a - 1) * 4,
+                           rc->screen + (size_t)(b - 1) * 4};
+    bin_primitive(rc, bins, pts, 2, e);
+  }
+}
+
+static float orient2d(const float *a, const float *b, float x, float y) {
+  return (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]);
+}
+
+/**
+ * @brief lambert intensity of the triangle lit from the camera, two-sided
+ */
+static float triangle_light(const raster_ctx_t *rc, const u_int *tri) {
+  const float *a = rc->eye + (size_t)tri[0] * AX_DIMEN;
+  const float *b = rc->eye + (size_t)tri[1] * AX_DIMEN;
+  const float *c = rc->eye + (size_t)tri[2] * AX_DIMEN;
+  float u[3], v[3], n[3], center[3];
+  float n_len = 0.0f, c_len = 0.0f, light = 0.0f;
+
+  for (int i = 0; i < 3; i++) {
+    u[i] = b[i] - a[i];
+    v[i] = c[i] - a[i];
+    center[i] = (a[i] + b[i] + c[i]) / 3.0f;
+  }
+  n[0] = u[1] * v[2] - u[2] * v[1];
+  n[1] = u[2] * v[0] - u[0] * v[2];
+  n[2] = u[0] * v[1] - u[1] * v[0];
+  n_len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+  c_len = sqrtf(center[0] * center[0] + center[1] * center[1] +
+                center[2] * center[2]);
+  if (n_len > 0.0f && c_len > 0.0f) {
+    light = fabsf(n[0] * center[0] + n[1] * center[1] + n[2] * center[2]) /
+            (n_len * c_len);
+  }
+
+  return AMBIENT + (1.0f - AMBIENT) * light;
+}
+
+static void raster_triangle(raster_ctx_t *rc, u_int id, int tx0, int ty0,
+                            int tx1, int ty1) {
+  const u_int *tri = rc->triangles + (size_t)id * 3;
+  const float *v0 = rc->screen + (size_t)tri[0] * 4;
+  const float *v1 = rc->screen + (size_t)tri[1] * 4;
+  const float *v2 = rc->screen + (size_t)tri[2] * 4;
+  const float *pts[3] = {v0, v1, v2};
+  int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  float area = orient2d(v0, v1, v2[0], v2[1]);
+  unsigned char color[4];
+  float light = 0.0f;
+
+  if (area == 0.0f) return;
+  // обход против часовой стрелки, грани рисуются с обеих сторон
+  if (area < 0.0f) {
+    const float *swap = v1;
+    v1 = v2;
+    v2 = swap;
+    area = -area;
+  }
+  screen_bounds(rc, pts, 3, &x0, &y0, &x1, &y1);
+  if (x0 < tx0) x0 = tx0;
+  if (y0 < ty0) y0 = ty0;
+  if (x1 > tx1) x1 = tx1;
+  if (y1 > ty1) y1 = ty1;
+
+  light = triangle_light(rc, tri);
+  for (int i = 0; i < 3; i++) {
+    color[i] = (unsigned char)(rc->options->face_color[i] * light);
+  }
+  color[3] = rc->options->face_color[3];
+
+  for (int y = y0; y < y1; y++) {
+    float py = (float)y + 0.5f;
+    for (int x = x0; x < x1; x++) {
+      float px = (float)x + 0.5f;
+      float w0 = orient2d(v1, v2, px, py);
+      float w1 = orient2d(v2, v0, px, py);
+      float w2 = orient2d(v0, v1, px, py);
+      if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+      float z = (w0 * v0[2] + w1 * v1[2] + w2 * v2[2]) / area;
+      size_t pixel = (size_t)y * rc->fb->width + (size_t)x;
+      if (z < -1.0f || z > 1.0f || z >= rc->fb->depth[pixel]) continue;
+      rc->fb->depth[pixel] = z;
+      memcpy(rc->fb->pixels + pixel * 4, color, 4);
+    }
+  }
+}
+
+/**
+ * @brief clip segment to rectangle by Liang-Barsky, t in [t0, t1]
+ */
+static int clip_segment(const float *a, const float *b, float x0, float y0,
+                        float x1, float y1, float *t0, float *t1) {
+  float dx = b[0] - a[0], dy = b[1] - a[1];
+  float p[4] = {-dx, dx, -dy, dy};
+  float q[4] = {a[0] - x0, x1 - a[0], a[1] - y0, y1 - a[1]};
+
+  *t0 = 0.0f;
+  *t1 = 1.0f;
+  for (int i = 0; i < 4; i++) {
+    if (p[i] == 0.0f) {
+      if (q[i] < 0.0f) return FALSE;
+    } else {
+      float r = q[i] / p[i];
+      if (p[i] < 0.0f && r > *t0) *t0 = r;
+      if (p[i] > 0.0f && r < *t1) *t1 = r;
+    }
+  }
+
+  return *t0 <= *t1;
+}
+
+static void raster_edge(raster_ctx_t *rc, u_int id, int tx0, int ty0, int tx1,
+                        int ty1) {
+  const float *a = rc->screen + (size_t)(rc->edges[2 * id] - 1) * 4;
+  const float *b = rc->screen + (size_t)(rc->edges[2 * id + 1] - 1) * 4;
+  int depth_test = rc->options->mode & RENDER_FLAT;
+  float t0 = 0.0f, t1 = 0.0f;
+
+  if (!clip_segment(a, b, (float)tx0, (float)ty0, (float)tx1, (float)ty1, &t0,
+                    &t1)) {
+    return;
+  }
+  float dx = b[0] - a[0], dy = b[1] - a[1];
+  float len = fabsf(dx) > fabsf(dy) ? fabsf(dx) : fabsf(dy);
+  u_int steps = (u_int)(len * (t1 - t0)) + 1;
+  float dt = len > 0.0f ? 1.0f / len : 0.0f;
+
+  for (u_int s = 0; s <= steps; s++) {
+    float t = t0 + (float)s * dt;
+    if (t > t1) t = t1;
+    int x = (int)(a[0] + dx * t), y = (int)(a[1] + dy * t);
+    if (x < tx0 || y < ty0 || x >= tx1 || y >= ty1) continue;
+    size_t pixel = (size_t)y * rc->fb->width + (size_t)x;
+    float z = a[2] + (b[2] - a[2]) * t;
+    if (depth_test && z - EDGE_BIAS > rc->fb->depth[pixel]) continue;
+    memcpy(rc->fb->pixels + pixel * 4, rc->options->edge_color, 4);
+  }
+}
+
+/**
+ * @brief stage 4: workers take tiles dynamically and rasterize them
+ */
+static void raster_tiles_worker(void *ctx, u_int begin, u_int end,
+                                u_int thread_index) {
+  raster_ctx_t *rc = (raster_ctx_t *)ctx;
+  framebuffer_t *fb = rc->fb;
+  u_int tile = 0;
+  (void)begin;
+  (void)end;
+  (void)thread_index;
+
+  while ((tile = atomic_fetch_add(&rc->next_tile, 1)) < rc->tiles_count) {
+    int tx0 = (int)(tile % rc->tiles_x) * TILE_SIZE;
+    int ty0 = (int)(tile / rc->tiles_x) * TILE_SIZE;
+    int tx1 = tx0 + TILE_SIZE > (int)fb->width ? (int)fb->width : tx0 + TILE_SIZE;
+    int ty1 = ty0 + TILE_SIZE > (int)fb->height ? (int)fb->height : ty0 + TILE_SIZE;
+
+    for (int y = ty0; y < ty1; y++) {
+      for (int x = tx0; x < tx1; x++) {
+        size_t pixel = (size_t)y * fb->width + (size_t)x;
+        memcpy(fb->pixels + pixel * 4, rc->options->background, 4);
+        fb->depth[pixel] = FLT_MAX;
+      }
+    }
+    for (u_int t = 0; rc->tri_bins && t < rc->bins_threads; t++) {
+      const tile_bin_t *bin = &rc->tri_bins[(size_t)t * rc->tiles_count + tile];
+      for (u_int i = 0; i < bin->count; i++) {
+        raster_triangle(rc, bin->items[i], tx0, ty0, tx1, ty1);
+      }
+    }
+    for (u_int t = 0; rc->line_bins && t < rc->bins_threads; t++) {
+      const tile_bin_t *bin = &rc->line_bins[(size_t)t * rc->tiles_count + tile];
+      for (u_int i = 0; i < bin->count; i++) {
+        raster_edge(rc, bin->items[i], tx0, ty0, tx1, ty1);
+      }
+    }
+  }
+}
+
+static int prepare_triangles(raster_ctx_t *rc, u_int threads) {
+  u_int faces_count = rc->faces_count, total_indexes = rc->obj->total_indexes;
+  u_int *face_start = (u_int *)malloc((faces_count + 1) * sizeof(u_int));
+  u_int *tri_start = (u_int *)malloc((faces_count + 1) * sizeof(u_int));
+  int function_result = FALSE;
+
+  if (rc->polygons != &rc->obj->polygons) {
+    total_indexes = rc->options->face_cull->total_indexes;
+  }
+  if (face_start && tri_start) {
+    face_start[0] = 0;
+    tri_start[0] = 0;
+    for (u_int f = 0; f < faces_count; f++) {
+      u_int n = rc->polygons->indeces_count[f];
+      face_start[f + 1] = face_start[f] + n;
+      tri_start[f + 1] = tri_start[f] + (n >= 3 ? n - 2 : 0);
+    }
+    if (face_start[faces_count] <= total_indexes) {
+      rc->triangles_count = tri_start[faces_count];
+      rc->triangles = (u_int *)malloc(
+          ((size_t)rc->triangles_count * 3 + 1) * sizeof(u_int));
+    }
+    if (rc->triangles) {
+      rc->face_start = face_start;
+      rc->tri_start = tri_start;
+      parallel_for(faces_count, threads, triangulate_range, rc);
+      function_result = TRUE;
+    }
+  }
+  free(face_start);
+  free(tri_start);
+  rc->face_start = NULL;
+  rc->tri_start = NULL;
+
+  return function_result;
+}
+
+/**
+ * @brief stage 2 for face culling: polygons left by cull_faces
+ */
+static int prepare_culled_triangles(raster_ctx_t *rc, float model[4][4],
+                                    float view[4][4], float projection[4][4],
+                                    u_int threads) {
+  face_cull_t *cull = rc->options->face_cull;
+
+  if (!cull_faces(cull, rc->obj, model, view, projection,
+                  rc->options->cull_mode, threads)) {
+    return FALSE;
+  }
+  rc->polygons = &cull->polygons;
+  rc->faces_count = cull->faces_count;
+
+  return prepare_triangles(rc, threads);
+}
+
+/**
+ * @brief stage 2 for meshlets: triangles of the clusters which passed culling
+ */
+static int prepare_meshlet_triangles(raster_ctx_t *rc, float model[4][4],
+                                     float view[4][4],
+                                     float projection[4][4]) {
+  const meshlets_t *meshlets = rc->options->meshlets;
+  u_int *visible = (u_int *)malloc(((size_t)meshlets->count + 1) *
+                                   sizeof(u_int));
+  u_int count = 0, total = 0;
+
+  if (!visible) return FALSE;
+  count = cull_meshlets(meshlets, model, view, projection, visible);
+  for (u_int i = 0; i < count; i++) {
+    total += meshlets->items[visible[i]].triangle_count;
+  }
+  rc->triangles = (u_int *)malloc(((size_t)total * 3 + 1) * sizeof(u_int));
+  for (u_int i = 0; rc->triangles && i < count; i++) {
+    const meshlet_t *m = meshlets->items + visible[i];
+    const unsigned char *local = meshlets->triangles +
+                                 (size_t)m->triangle_offset * 3;
+    const u_int *vertexes = meshlets->vertexes + m->vertex_offset;
+    u_int *tri = rc->triangles + (size_t)rc->triangles_count * 3;
+    for (u_int k = 0; k < m->triangle_count * 3; k += 3, tri += 3) {
+      for (int j = 0; j < 3; j++) tri[j] = vertexes[local[k + j]];
+      for (int j = 0; j < 3; j++) {
+        if (tri[j] >= rc->obj->vertexes_count) tri[0] = NO_VERTEX;
+      }
+    }
+    rc->triangles_count += m->triangle_count;
+  }
+  free(visible);
+
+  return rc->triangles != NULL;
+}
+
+int render_obj(const obj3d *obj, float model[4][4],
+               float view[4][4], float projection[4][4],
+               const render_options_t *options, framebuffer_t *fb) {
+  raster_ctx_t rc;
+  u_int *own_edges = NULL;
+  u_int threads = 0;
+  int function_result = TRUE;
+
+  if (!obj || !options || !fb) return FALSE;
+  memset(&rc, 0, sizeof(rc));
+  rc.obj = obj;
+  rc.options = options;
+  rc.fb = fb;
+  matrix4_multiply(view, model, rc.mv);
+  memcpy(rc.projection, projection, sizeof(rc.projection));
+  rc.tiles_x = (fb->width + TILE_SIZE - 1) / TILE_SIZE;
+  rc.tiles_y = (fb->height + TILE_SIZE - 1) / TILE_SIZE;
+  rc.tiles_count = rc.tiles_x * rc.tiles_y;
+  atomic_init(&rc.next_tile, 0);
+  atomic_init(&rc.failed, FALSE);
+  threads = get_threads_count(options->threads);
+  if (threads > MAX_THREADS) threads = MAX_THREADS;
+  rc.bins_threads = threads;
+
+  rc.screen = (float *)malloc(((size_t)obj->vertexes_count + 1) * 4 * sizeof(float));
+  rc.eye = (float *)malloc(((size_t)obj->vertexes_count + 1) * AX_DIMEN * sizeof(float));
+  if (!rc.screen || !rc.eye) function_result = FALSE;
+  if (function_result) {
+    parallel_for(obj->vertexes_count, threads, transform_range, &rc);
+  }
+
+  if (function_result && (options->mode & RENDER_FLAT)) {
+    rc.tri_bins = (tile_bin_t *)calloc((size_t)threads * rc.tiles_count,
+                                       sizeof(tile_bin_t));
+    rc.polygons = &obj->polygons;
+    rc.faces_count = obj->faces_count;
+    if (!rc.tri_bins) {
+      function_result = FALSE;
+    } else if (options->meshlets) {
+      function_result = prepare_meshlet_triangles(&rc, model, view, projection);
+    } else if (options->face_cull) {
+      function_result =
+          prepare_culled_triangles(&rc, model, view, projection, threads);
+    } else {
+      function_result = prepare_triangles(&rc, threads);
+    }
+    if (function_result) {
+      parallel_for(rc.triangles_count, threads, bin_triangles_range, &rc);
+    }
+  }
+  if (function_result && (options->mode & RENDER_WIREFRAME)) {
+    rc.edges = options->edges;
+    rc.edges_count = options->edges_count;
+    if (!rc.edges) {
+      rc.edges_count = collect_unique_edges(obj, &own_edges);
+      rc.edges = own_edges;
+    }
+    rc.line_bins = (tile_bin_t *)calloc((size_t)threads * rc.tiles_count,
+                                        sizeof(tile_bin_t));
+    function_result = rc.line_bins != NULL;
+    if (function_result) {
+      parallel_for(rc.edges_count, threads, bin_edges_range, &rc);
+    }
+  }
+  if (function_result && !atomic_load(&rc.failed)) {
+    parallel_for(threads, threads, raster_tiles_worker, &rc);
+  } else {
+    function_result = FALSE;
+  }
+
+  bins_destroy(rc.tri_bins, threads * rc.tiles_count);
+  bins_destroy(rc.line_bins, threads * rc.tiles_count);
+  free(own_edges);
+  free(rc.triangles);
+  free(rc.screen);
+  free(rc.eye);
+
+  return function_result;
+}
+
+/*-----------------------------PNG output-----------------------------*/
+
+static unsigned long crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+// framebuffer_save_png вызывается из нескольких потоков (batch, recorder)
+static void init_crc_table(void) {
+  for (unsigned long n = 0; n < 256; n++) {
+    unsigned long c = n;
+    for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+    crc_table[n] = c;
+  }
+}
+
+static unsigned long png_crc(unsigned long crc, const unsigned char *data,
+                             size_t length) {
+  pthread_once(&crc_once, init_crc_table);
+  crc ^= 0xFFFFFFFFUL;
+  for (size_t i = 0; i < length; i++) {
+    crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+
+  return crc ^ 0xFFFFFFFFUL;
+}
+
+static void put_be32(unsigned char *dst, unsigned long value) {
+  dst[0] = (unsigned char)(value >> 24);
+  dst[1] = (unsigned char)(value >> 16);
+  dst[2] = (unsigned char)(value >> 8);
+  dst[3] = (unsigned char)value;
+}
+
+static int png_write_chunk(FILE *file, const char *type,
+                           const unsigned char *data, size_t length) {
+  unsigned char header[8], footer[4];
+  unsigned long crc = png_crc(0, (const unsigned char *)type, 4);
+
+  crc = png_crc(crc, data, length);
+  put_be32(header, (unsigned long)length);
+  memcpy(header + 4, type, 4);
+  put_be32(footer, crc);
+
+  return fwrite(header, 1, 8, file) == 8 &&
+         (length == 0 || fwrite(data, 1, length, file) == length) &&
+         fwrite(footer, 1, 4, file) == 4;
+}
+
+int framebuffer_save_png(const framebuffer_t *fb, const char *path) {
+  const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  unsigned char ihdr[13] = {0};
+  size_t row = (size_t)fb->width * 4 + 1, raw = row * fb->height;
+  // zlib: заголовок, блоки stored по 65535 байт, adler32
+  size_t blocks = raw / 65535 + 1;
+  size_t length = 2 + raw + 5 * blocks + 4;
+  unsigned char *zdata = (unsigned char *)malloc(length);
+  unsigned long a = 1, b = 0;
+  size_t pos = 0, done = 0;
+  int function_result = FALSE;
+  FILE *file = NULL;
+
+  if (!zdata) return FALSE;
+  zdata[pos++] = 0x78;
+  zdata[pos++] = 0x01;
+  for (size_t block = 0; block < blocks; block++) {
+    size_t size = raw - done < 65535 ? raw - done : 65535;
+    zdata[pos++] = block + 1 == blocks;
+    zdata[pos++] = (unsigned char)size;
+    zdata[pos++] = (unsigned char)(size >> 8);
+    zdata[pos++] = (unsigned char)~size;
+    zdata[pos++] = (unsigned char)(~size >> 8);
+    for (size_t i = 0; i < size; i++, done++) {
+      size_t x = done % row;
+      unsigned char byte =
+          x == 0 ? 0 : fb->pixels[(done / row) * (row - 1) + x - 1];
+      zdata[pos++] = byte;
+      a = (a + byte) % 65521;
+      b = (b + a) % 65521;
+    }
+  }
+  put_be32(zdata + pos, (b << 16) | a);
+
+  put_be32(ihdr, fb->width);
+  put_be32(ihdr + 4, fb->height);
+  ihdr[8] = 8;  // бит на канал
+  ihdr[9] = 6;  // RGBA
+  file = fopen(path, "wb");
+  if (file) {
+    function_result = fwrite(signature, 1, 8, file) == 8 &&
+                      png_write_chunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+                      png_write_chunk(file, "IDAT", zdata, length) &&
+                      png_write_chunk(file, "IEND", NULL, 0);
+    function_result = (fclose(file) == 0) && function_result;
+  }
+  free(zdata);
+
+  return function_result;
+}
@@ -0,0 +1,565 @@
+/**
+ * @file s21_scene.c
+ * @brief Many models of a browse list under a memory budget
+ * @details
+ * Сцена хранит список файлов и загружает модели по требованию:
+ * 1) scene_view загружает модель синхронно (из бинарного кэша, если он свежее
+ *    файла), закрепляет ее и ставит в очередь соседей по списку на
+ *    расстоянии до SCENE_PREFETCH_RADIUS, их загружают фоновые потоки;
+ * 2) после каждой загрузки, пока занятая память больше бюджета, вытесняется
+ *    модель, которую дольше всех не смотрели (LRU по счетчику просмотров);
+ *    закрепленная модель не вытесняется никогда;
+ * 3) вытесненная модель записывается в бинарный кэш, а при политике
+ *    SCENE_EVICT_TO_LOD вместо нее остается грубая копия, построенная
+ *    кластеризацией вершин по сетке, если она влезает в бюджет. Занятых ячеек
+ *    у поверхности примерно grid^2, поэтому сетка выбирается как
+ *    sqrt(vertexes / SCENE_LOD_RATIO).
+ * Состояние защищено одним мьютексом, а разбор файлов, запись кэша и
+ * построение LOD идут без него. Состояние MODEL_LOADING не дает загрузить
+ * одну модель дважды: просмотр ждет фоновую загрузку на условной переменной.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "s21_3d_viewer.h"
+
+#define SCENE_LOD_RATIO 16     ///< about this many vertexes become one
+#define SCENE_LOD_MAX_GRID 1024  ///< grid^3 still fits into u_int
+
+typedef struct {
+  char *path;
+  obj3d *obj;  ///< full model or its LOD, see state
+  size_t bytes;
+  int state;
+  unsigned long long last_view;
+} scene_model_t;
+
+struct scene {
+  pthread_mutex_t mutex;
+  pthread_cond_t loaded;  ///< some model has left MODEL_LOADING
+  pthread_cond_t queued;  ///< prefetch job was queued or scene is stopping
+  scene_model_t *models;
+  u_int count;
+  u_int capacity;
+  size_t budget;
+  size_t used;
+  char *cache_dir;
+  int policy;
+  long long viewed;  ///< pinned model, -1 before the first view
+  unsigned long long tick;
+  u_int queue[2 * SCENE_PREFETCH_RADIUS];
+  u_int queue_len;
+  pthread_t workers[MAX_THREADS];
+  u_int workers_count;
+  int is_stopping;
+};
+
+/*---------------------------------LOD--------------------------------*/
+
+/**
+ * @brief open addressing map cell -> vertex of the LOD
+ */
+typedef struct {
+  u_int *cells;  ///< cell + 1, 0 is an empty slot
+  u_int *vertexes;
+  u_int mask;
+} cell_map_t;
+
+static u_int cell_map_get(cell_map_t *map, u_int cell, u_int *next_vertex) {
+  u_int i = (cell * 2654435761U) & map->mask;
+
+  while (map->cells[i] && map->cells[i] != cell + 1) i = (i + 1) & map->mask;
+  if (!map->cells[i]) {
+    map->cells[i] = cell + 1;
+    map->vertexes[i] = (*next_vertex)++;
+  }
+
+  return map->vertexes[i];
+}
+
+static u_int lod_grid(const obj3d *obj) {
+  u_int grid = (u_int)sqrtf((float)obj->vertexes_count / SCENE_LOD_RATIO);
+
+  if (grid < 2) grid = 2;
+  if (grid > SCENE_LOD_MAX_GRID) grid = SCENE_LOD_MAX_GRID;
+
+  return grid;
+}
+
+static u_int cell_of(const obj3d *obj, const float *v, u_int grid) {
+  const float *min = &obj->bounds.x_min;
+  u_int cell = 0;
+
+  // в axises минимумы и максимумы чередуются: x_min, x_max, y_min, ...
+  for (u_int i = 0; i < AX_DIMEN; i++) {
+    float extent = min[2 * i + 1] - min[2 * i];
+    int c = extent > 0.0f
+                ? (int)((v[i] - min[2 * i]) / extent * (float)grid)
+                : 0;
+    if (c < 0) c = 0;
+    if (c >= (int)grid) c = (int)grid - 1;
+    cell = cell * grid + (u_int)c;
+  }
+
+  return cell;
+}
+
+/**
+ * @brief new vertex of every old one, averages of clustered vertexes in sums
+ */
+static u_int cluster_vertexes(const obj3d *obj, u_int *remap, float *sums) {
+  cell_map_t map = {NULL, NULL, 0};
+  u_int *weights = NULL;
+  u_int size = 16, clusters = 0, grid = lod_grid(obj);
+
+  while (size < 2 * obj->vertexes_count) size *= 2;
+  map.mask = size - 1;
+  map.cells = (u_int *)calloc(size, sizeof(u_int));
+  map.vertexes = (u_int *)malloc(size * sizeof(u_int));
+  weights = (u_int *)calloc(obj->vertexes_count + 1, sizeof(u_int));
+  if (map.cells && map.vertexes && weights) {
+    for (u_int v = 0; v < obj->vertexes_count; v++) {
+      const float *p = obj->vertexes + (size_t)v * AX_DIMEN;
+      u_int c = cell_map_get(&map, cell_of(obj, p, grid), &clusters);
+      remap[v] = c;
+      weights[c]++;
+      for (u_int i = 0; i < AX_DIMEN; i++) {
+        sums[(size_t)c * AX_DIMEN + i] += p[i];
+      }
+    }
+    for (u_int c = 0; c < clusters; c++) {
+      for (u_int i = 0; i < AX_DIMEN; i++) {
+        sums[(size_t)c * AX_DIMEN + i] /= (float)weights[c];
+      }
+    }
+  } else {
+    clusters = UINT_MAX;
+  }
+  free(map.cells);
+  free(map.vertexes);
+  free(weights);
+
+  return clusters;
+}
+
+/**
+ * @brief remapped face without repeated vertexes, 0 if it has degenerated
+ */
+static u_int remap_face(const obj3d *obj, const u_int *ind, u_int n,
+                        const u_int *remap, u_int *out) {
+  u_int kept = 0;
+
+  for (u_int k = 0; k < n; k++) {
+    if (ind[k] == 0 || ind[k] > obj->vertexes_count) return 0;
+    u_int v = remap[ind[k] - 1] + 1;
+    if (kept == 0 || out[kept - 1] != v) out[kept++] = v;
+  }
+  if (kept > 1 && out[kept - 1] == out[0]) kept--;
+
+  return kept >= 3 ? kept : 0;
+}
+
+static obj3d *build_lod(const obj3d *obj) {
+  obj3d *lod = NULL;
+  u_int *remap = (u_int *)malloc((obj->vertexes_count + 1) * sizeof(u_int));
+  float *sums = (float *)calloc((size_t)obj->vertexes_count * AX_DIMEN + 1,
+                                sizeof(float));
+  u_int *counts = (u_int *)malloc((obj->faces_count + 1) * sizeof(u_int));
+  u_int *indexes = (u_int *)malloc((obj->total_indexes + 1) * sizeof(u_int));
+  u_int clusters = UINT_MAX, faces = 0, total = 0;
+
+  if (remap && sums && counts && indexes) {
+    clusters = cluster_vertexes(obj, remap, sums);
+  }
+  if (clusters != UINT_MAX) {
+    const u_int *ind = obj->polygons.vertexes_ind;
+    for (u_int f = 0, used = 0; f < obj->faces_count; f++) {
+      u_int n = obj->polygons.indeces_count[f];
+      if (used + n > obj->total_indexes) break;
+      u_int kept = remap_face(obj, ind + used, n, remap, indexes + total);
+      if (kept) {
+        counts[faces++] = kept;
+        total += kept;
+      }
+      used += n;
+    }
+    lod = obj_create();
+  }
+  if (lod && obj_reserve(lod, clusters, faces, total)) {
+    memcpy(lod->vertexes, sums, (size_t)clusters * AX_DIMEN * sizeof(float));
+    memcpy(lod->polygons.indeces_count, counts, faces * sizeof(u_int));
+    memcpy(lod->polygons.vertexes_ind, indexes, total * sizeof(u_int));
+    lod->bounds = obj->bounds;
+  } else if (lod) {
+    obj_destroy(lod);
+    lod = NULL;
+  }
+  free(remap);
+  free(sums);
+  free(counts);
+  free(indexes);
+
+  return lod;
+}
+
+static obj3d *copy_obj(const obj3d *obj) {
+  obj3d *copy = obj_create();
+
+  if (copy && obj_reserve(copy, obj->vertexes_count, obj->faces_count,
+                          obj->total_indexes)) {
+    memcpy(copy->vertexes, obj->vertexes,
+           (size_t)obj->vertexes_count * AX_DIMEN * sizeof(float));
+    memcpy(copy->polygons.indeces_count, obj->polygons.indeces_count,
+           obj->faces_count * sizeof(u_int));
+    memcpy(copy->polygons.vertexes_ind, obj->polygons.vertexes_ind,
+           obj->total_indexes * sizeof(u_int));
+    copy->bounds = obj->bounds;
+  } else if (copy) {
+    obj_destroy(copy);
+    copy = NULL;
+  }
+
+  return copy;
+}
+
+/*-----------------------------binary cache---------------------------*/
+
+static char *cache_path_of(const scene_t *scene, const char *path) {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  char *cache = NULL;
+
+  if (!scene->cache_dir) return NULL;
+  for (const char *p = path; *p; p++) {
+    hash = (hash ^ (unsigned char)*p) * 0x100000001b3ULL;
+  }
+  cache = (char *)malloc(strlen(scene->cache_dir) + 24);
+  if (cache) sprintf(cache, "%s/%016llx.s21b", scene->cache_dir, hash);
+
+  return cache;
+}
+
+static int is_cache_fresh(const char *cache, const char *path) {
+  struct stat cache_st, path_st;
+
+  return cache && stat(cache, &cache_st) == 0 && stat(path, &path_st) == 0 &&
+         cache_st.st_mtime >= path_st.st_mtime;
+}
+
+static obj3d *load_model(const scene_t *scene, const char *path) {
+  char *cache = cache_path_of(scene, path);
+  obj3d *obj = NULL;
+
+  if (is_cache_fresh(cache, path)) obj = obj_load_binary(cache);
+  if (!obj) obj = parse_mesh_file(path);
+  free(cache);
+
+  return obj;
+}
+
+/*--------------------------state under mutex-------------------------*/
+
+static int is_full(int state) { return state == MODEL_LOADED; }
+
+static int is_loadable(int state) {
+  return state != MODEL_LOADED && state != MODEL_LOADING;
+}
+
+/**
+ * @brief install the loaded object, returns the replaced LOD to destroy
+ */
+static obj3d *finish_load(scene_t *scene, u_int id, obj3d *obj) {
+  scene_model_t *model = scene->models + id;
+  obj3d *old = model->obj;
+
+  scene->used -= model->bytes;
+  model->obj = obj;
+  model->bytes = obj_footprint(obj);
+  model->state = obj ? MODEL_LOADED : MODEL_FAILED;
+  scene->used += model->bytes;
+  pthread_cond_broadcast(&scene->loaded);
+
+  return old;
+}
+
+static void queue_neighbours(scene_t *scene, u_int id) {
+  // старые задания относятся к прошлому просмотру и больше не нужны
+  scene->queue_len = 0;
+  for (u_int d = 1; d <= SCENE_PREFETCH_RADIUS; d++) {
+    if (id + d < scene->count && is_loadable(scene->models[id + d].state) &&
+        scene->models[id + d].state != MODEL_FAILED) {
+      scene->queue[scene->queue_len++] = id + d;
+    }
+    if (id >= d && is_loadable(scene->models[id - d].state) &&
+        scene->models[id - d].state != MODEL_FAILED) {
+      scene->queue[scene->queue_len++] = id - d;
+    }
+  }
+  if (scene->queue_len) pthread_cond_broadcast(&scene->queued);
+}
+
+/**
+ * @brief detach the least recently viewed model while over the budget
+ */
+static int pick_victim(scene_t *scene, u_int *id, obj3d **obj, int *was_full) {
+  scene_model_t *victim = NULL;
+
+  pthread_mutex_lock(&scene->mutex);
+  for (u_int i = 0; scene->used > scene->budget && i < scene->count; i++) {
+    scene_model_t *model = scene->models + i;
+    if ((long long)i != scene->viewed && model->obj &&
+        model->state != MODEL_LOADING &&
+        (!victim || model->last_view < victim->last_view)) {
+      victim = model;
+    }
+  }
+  if (victim) {
+    *id = (u_int)(victim - scene->models);
+    *obj = victim->obj;
+    *was_full = is_full(victim->state);
+    scene->used -= victim->bytes;
+    victim->obj = NULL;
+    victim->bytes = 0;
+    victim->state = MODEL_UNLOADED;
+  }
+  pthread_mutex_unlock(&scene->mutex);
+
+  return victim != NULL;
+}
+
+/*-------------------------------eviction-----------------------------*/
+
+static void retire_victim(scene_t *scene, u_int id, obj3d *obj, int was_full) {
+  obj3d *lod = NULL;
+  int is_cached = FALSE;
+  char *cache = NULL;
+
+  if (was_full) {
+    pthread_mutex_lock(&scene->mutex);
+    cache = cache_path_of(scene, scene->models[id].path);
+    is_cached = is_cache_fresh(cache, scene->models[id].path);
+    pthread_mutex_unlock(&scene->mutex);
+    if (cache && !is_cached) is_cached = obj_save_binary(obj, cache);
+    if (scene->policy == SCENE_EVICT_TO_LOD) lod = build_lod(obj);
+  }
+  obj_destroy(obj);
+
+  pthread_mutex_lock(&scene->mutex);
+  scene_model_t *model = scene->models + id;
+  if (model->state == MODEL_UNLOADED) {
+    size_t bytes = obj_footprint(lod);
+    if (lod && scene->used + bytes <= scene->budget) {
+      model->obj = lod;
+      model->bytes = bytes;
+      model->state = MODEL_LOD;
+      scene->used += bytes;
+      lod = NULL;
+    } else if (is_cached) {
+      model->state = MODEL_CACHED;
+    }
+  }
+  pthread_mutex_unlock(&scene->mutex);
+  if (lod) obj_destroy(lod);
+  free(cache);
+}
+
+static void enforce_budget(scene_t *scene) {
+  obj3d *obj = NULL;
+  u_int id = 0;
+  int was_full = FALSE;
+
+  while (pick_victim(scene, &id, &obj, &was_full)) {
+    retire_victim(scene, id, obj, was_full);
+  }
+}
+
+/*------------------------------prefetching---------------------------*/
+
+static void *prefetch_worker(void *arg) {
+  scene_t *scene = (scene_t *)arg;
+
+  pthread_mutex_lock(&scene->mutex);
+  while (!scene->is_stopping) {
+    if (scene->queue_len == 0) {
+      pthread_cond_wait(&scene->queued, &scene->mutex);
+      continue;
+    }
+    u_int id = scene->queue[0];
+    scene->queue_len--;
+    memmove(scene->queue, scene->queue + 1, scene->queue_len * sizeof(u_int));
+    if (!is_loadable(scene->models[id].state)) continue;
+
+    const char *path = scene->models[id].path;
+    scene->models[id].state = MODEL_LOADING;
+    // соседи моложе всех, кроме текущего просмотра
+    scene->models[id].last_view = scene->tick;
+    pthread_mutex_unlock(&scene->mutex);
+    obj3d *obj = load_model(scene, path);
+    pthread_mutex_lock(&scene->mutex);
+    obj3d *old = finish_load(scene, id, obj);
+    pthread_mutex_unlock(&scene->mutex);
+    if (old) obj_destroy(old);
+    enforce_budget(scene);
+    pthread_mutex_lock(&scene->mutex);
+  }
+  pthread_mutex_unlock(&scene->mutex);
+
+  return NULL;
+}
+
+/*-------------------------------public API---------------------------*/
+
+scene_t *scene_create(size_t budget_bytes, const char *cache_dir, int policy,
+                      u_int prefetch_threads) {
+  scene_t *scene = (scene_t *)calloc(1, sizeof(scene_t));
+
+  if (!scene) return NULL;
+  scene->budget = budget_bytes;
+  scene->policy = policy;
+  scene->viewed = -1;
+  if (cache_dir) {
+    if (mkdir(cache_dir, 0755) != 0 && errno != EEXIST) {
+      free(scene);
+      return NULL;
+    }
+    scene->cache_dir = strdup(cache_dir);
+    if (!scene->cache_dir) {
+      free(scene);
+      return NULL;
+    }
+  }
+  pthread_mutex_init(&scene->mutex, NULL);
+  pthread_cond_init(&scene->loaded, NULL);
+  pthread_cond_init(&scene->queued, NULL);
+  if (prefetch_threads > MAX_THREADS) prefetch_threads = MAX_THREADS;
+  for (u_int i = 0; i < prefetch_threads; i++) {
+    if (pthread_create(scene->workers + scene->workers_count, NULL,
+                       prefetch_worker, scene) == 0) {
+      scene->workers_count++;
+    }
+  }
+
+  return scene;
+}
+
+int scene_add(scene_t *scene, const char *path) {
+  int id = -1;
+
+  if (!scene || !path) return id;
+  pthread_mutex_lock(&scene->mutex);
+  if (scene->count == scene->capacity) {
+    u_int capacity = scene->capacity ? scene->capacity * 2 : 16;
+    scene_model_t *models = (scene_model_t *)realloc(
+        scene->models, capacity * sizeof(scene_model_t));
+    if (models) {
+      scene->models = models;
+      scene->capacity = capacity;
+    }
+  }
+  if (scene->count < scene->capacity) {
+    scene_model_t *model = scene->models + scene->count;
+    memset(model, 0, sizeof(scene_model_t));
+    model->path = strdup(path);
+    if (model->path) {
+      char *cache = cache_path_of(scene, path);
+      model->state =
+          is_cache_fresh(cache, path) ? MODEL_CACHED : MODEL_UNLOADED;
+      free(cache);
+      id = (int)scene->count++;
+    }
+  }
+  pthread_mutex_unlock(&scene->mutex);
+
+  return id;
+}
+
+obj3d *scene_view(scene_t *scene, u_int id) {
+  obj3d *result = NULL, *old = NULL;
+
+  if (!scene) return NULL;
+  pthread_mutex_lock(&scene->mutex);
+  if (id >= scene->count) {
+    pthread_mutex_unlock(&scene->mutex);
+    return NULL;
+  }
+  scene->viewed = id;
+  scene->models[id].last_view = ++scene->tick;
+  while (scene->models[id].state == MODEL_LOADING) {
+    pthread_cond_wait(&scene->loaded, &scene->mutex);
+  }
+  if (is_loadable(scene->models[id].state)) {
+    const char *path = scene->models[id].path;
+    scene->models[id].state = MODEL_LOADING;
+    pthread_mutex_unlock(&scene->mutex);
+    obj3d *obj = load_model(scene, path);
+    pthread_mutex_lock(&scene->mutex);
+    old = finish_load(scene, id, obj);
+  }
+  if (is_full(scene->models[id].state)) result = scene->models[id].obj;
+  queue_neighbours(scene, id);
+  pthread_mutex_unlock(&scene->mutex);
+  if (old) obj_destroy(old);
+  enforce_budget(scene);
+
+  return result;
+}
+
+obj3d *scene_preview(scene_t *scene, u_int id) {
+  obj3d *copy = NULL;
+
+  if (!scene) return NULL;
+  pthread_mutex_lock(&scene->mutex);
+  if (id < scene->count && scene->models[id].state == MODEL_LOD) {
+    copy = copy_obj(scene->models[id].obj);
+  }
+  pthread_mutex_unlock(&scene->mutex);
+
+  return copy;
+}
+
+int scene_state(scene_t *scene, u_int id) {
+  int state = MODEL_FAILED;
+
+  if (!scene) return state;
+  pthread_mutex_lock(&scene->mutex);
+  if (id < scene->count) state = scene->models[id].state;
+  pthread_mutex_unlock(&scene->mutex);
+
+  return state;
+}
+
+size_t scene_memory(scene_t *scene) {
+  size_t used = 0;
+
+  if (!scene) return used;
+  pthread_mutex_lock(&scene->mutex);
+  used = scene->used;
+  pthread_mutex_unlock(&scene->mutex);
+
+  return used;
+}
+
+void scene_destroy(scene_t *scene) {
+  if (!scene) return;
+  pthread_mutex_lock(&scene->mutex);
+  scene->is_stopping = TRUE;
+  pthread_cond_broadcast(&scene->queued);
+  pthread_mutex_unlock(&scene->mutex);
+  for (u_int i = 0; i < scene->workers_count; i++) {
+    pthread_join(scene->workers[i], NULL);
+  }
+  for (u_int i = 0; i < scene->count; i++) {
+    if (scene->models[i].obj) obj_destroy(scene->models[i].obj);
+    free(scene->models[i].path);
+  }
+  pthread_cond_destroy(&scene->queued);
+  pthread_cond_destroy(&scene->loaded);
+  pthread_mutex_destroy(&scene->mutex);
+  free(scene->models);
+  free(scene->cache_dir);
+  free(scene);
+}
@@ -0,0 +1,365 @@
+/**
+ * @file s21_watch.c
+ * @brief Live reload of a .obj file with incremental re-parse of appended data
+ * @details
+ * Наблюдатель держит объект, разобранный до смещения parsed_end, хеши
+ * каждого блока BUFFER_SIZE этой части файла и множество ребер. Хеши
+ * считаются при разборе, после дозаписи заново хешируются только последний
+ * неполный блок и новые.
+ * При изменении файла (размер или mtime с наносекундами) сверяются не больше
+ * WATCH_CHECKED_BLOCKS блоков: первый, последний и равномерно расставленные
+ * между ними со сдвигом при каждой проверке, так что проверка не дороже
+ * чтения 512 КБ при любом размере файла. Файл до 8 блоков сверяется целиком,
+ * в большем правка в середине вместе с дозаписью может быть принята за
+ * дозапись, пока сдвиг не дойдет до измененного блока.
+ * 1) если файл вырос, последний разобранный байт был '\n', а проверенные
+ *    блоки совпали, то дописанный хвост разбирается прямо в тот же объект,
+ *    границы обновляются по новым вершинам, а в множество ребер добавляются
+ *    только ребра новых граней;
+ * 2) иначе, а также если дописать ребра не удалось, файл перечитывается
+ *    целиком, старый объект остается, если новый прочитать не удалось.
+ * В Linux изменения приходят через inotify на каталог файла (редакторы часто
+ * сохраняют через переименование), в остальных системах обновление
+ * проверяется при каждом вызове obj_watch_poll.
+ */
+
+#define _GNU_SOURCE
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "s21_3d_viewer.h"
+
+/**
+ * @brief open addressing set of edge keys (lesser << 32 | greater)
+ */
+typedef struct {
+  unsigned long long *keys;  ///< 0 is an empty cell, indices start from 1
+  u_int bits;
+  size_t count;
+} edge_set_t;
+
+struct obj_watch {
+  char *path;
+  const char *name;  ///< file name inside path
+  obj3d *obj;
+  edge_set_t edges;
+  unsigned long long parsed_end;
+  int is_complete;
+  unsigned long long *block_hashes;  ///< FNV-1a of BUFFER_SIZE blocks of
+                                     ///< [0, parsed_end), the last may be
+                                     ///< shorter
+  size_t block_count;
+  size_t check_round;  ///< shift of the checked middle blocks
+  long long mtime_ns;
+  int fd;
+};
+
+/*------------------------------edge set------------------------------*/
+
+static size_t edge_slot(const edge_set_t *set, unsigned long long key) {
+  return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> (64 - set->bits));
+}
+
+static int edge_set_insert(edge_set_t *set, unsigned long long key);
+
+static int edge_set_grow(edge_set_t *set) {
+  edge_set_t bigger = {NULL, set->bits ? set->bits + 1 : 10, 0};
+
+  bigger.keys = (unsigned long long *)calloc((size_t)1 << bigger.bits,
+                                             sizeof(unsigned long long));
+  if (!bigger.keys) return FALSE;
+  for (size_t i = 0; set->keys && i < ((size_t)1 << set->bits); i++) {
+    if (set->keys[i]) edge_set_insert(&bigger, set->keys[i]);
+  }
+  free(set->keys);
+  *set = bigger;
+
+  return TRUE;
+}
+
+// 1 если ребро новое, 0 если уже было, -1 при ошибке памяти
+static int edge_set_insert(edge_set_t *set, unsigned long long key) {
+  size_t mask = 0, i = 0;
+
+  // заполнение не больше половины, иначе цепочки проб становятся длинными
+  if ((set->count + 1) * 2 > ((size_t)1 << set->bits)) {
+    if (!edge_set_grow(set)) return -1;
+  }
+  mask = ((size_t)1 << set->bits) - 1;
+  for (i = edge_slot(set, key); set->keys[i]; i = (i + 1) & mask) {
+    if (set->keys[i] == key) return 0;
+  }
+  set->keys[i] = key;
+  set->count++;
+
+  return 1;
+}
+
+static int add_face_edges(edge_set_t *set, const obj3d *obj, u_int from_face,
+                          u_int from_index) {
+  const u_int *ind = obj->polygons.vertexes_ind + from_index;
+
+  for (u_int f = from_face; f < obj->faces_count; f++) {
+    u_int n = obj->polygons.indeces_count[f];
+    for (u_int k = 0; k < n; k++) {
+      u_int a = ind[k], b = ind[(k + 1) % n];
+      if (a > b) {
+        u_int swap = a;
+        a = b;
+        b = swap;
+      }
+      if (a && edge_set_insert(set, ((unsigned long long)a << 32) | b) < 0) {
+        return FALSE;
+      }
+    }
+    ind += n;
+  }
+
+  return TRUE;
+}
+
+/*----------------------------file checks-----------------------------*/
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define WATCH_CHECKED_BLOCKS 8  ///< Max blocks compared by one refresh
+
+// FNV-1a окна файла [offset, offset + length)
+static unsigned long long hash_region(FILE *file, unsigned long long offset,
+                                      unsigned long long length) {
+  unsigned long long hash = FNV_OFFSET_BASIS;
+  unsigned char buffer[4096];
+
+  if (fseek(file, (long)offset, SEEK_SET) != 0) return 0;
+  while (length) {
+    size_t chunk = length < sizeof(buffer) ? (size_t)length : sizeof(buffer);
+    size_t read = fread(buffer, 1, chunk, file);
+    for (size_t i = 0; i < read; i++) {
+      hash = (hash ^ buffer[i]) * 0x100000001b3ULL;
+    }
+    if (read < chunk) break;
+    length -= read;
+  }
+
+  return hash;
+}
+
+static unsigned long long hash_block(FILE *file, size_t block,
+                                     unsigned long long parsed_end) {
+  unsigned long long offset = (unsigned long long)block * BUFFER_SIZE;
+  unsigned long long length = parsed_end - offset;
+
+  return hash_region(file, offset, length < BUFFER_SIZE ? length : BUFFER_SIZE);
+}
+
+// секунд мало: две записи за одну секунду с тем же размером не видны
+static long long mtime_ns_of(const struct stat *st) {
+#ifdef __APPLE__
+  return (long long)st->st_mtimespec.tv_sec * 1000000000LL +
+         st->st_mtimespec.tv_nsec;
+#else
+  return (long long)st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+#endif
+}
+
+// блоки до того, в котором лежит from, уже посчитаны
+static void remember_file(obj_watch_t *watch, const struct stat *st,
+                          unsigned long long from) {
+  size_t count = (size_t)((watch->parsed_end + BUFFER_SIZE - 1) / BUFFER_SIZE);
+  size_t first = (size_t)(from / BUFFER_SIZE);
+  unsigned long long *hashes = (unsigned long long *)realloc(
+      watch->block_hashes, (count + 1) * sizeof(unsigned long long));
+  FILE *file = fopen(watch->path, "rb");
+
+  if (first > watch->block_count) first = 0;
+  if (hashes) watch->block_hashes = hashes;
+  // без хешей следующее изменение перечитает файл целиком
+  watch->block_count = 0;
+  if (hashes && file) {
+    for (size_t i = first; i < count; i++) {
+      hashes[i] = hash_block(file, i, watch->parsed_end);
+    }
+    watch->block_count = count;
+  }
+  if (file) fclose(file);
+  watch->mtime_ns = mtime_ns_of(st);
+}
+
+static int is_prefix_same(obj_watch_t *watch) {
+  size_t count = watch->block_count, middle = count > 2 ? count - 2 : 0;
+  size_t checks = count < WATCH_CHECKED_BLOCKS ? count : WATCH_CHECKED_BLOCKS;
+  FILE *file = NULL;
+  int is_same = TRUE;
+
+  if (watch->parsed_end == 0) return TRUE;
+  if (count == 0 || !(file = fopen(watch->path, "rb"))) return FALSE;
+  for (size_t k = 0; is_same && k < checks; k++) {
+    size_t block = k;
+    if (count > WATCH_CHECKED_BLOCKS && k == checks - 1) {
+      block = count - 1;
+    } else if (count > WATCH_CHECKED_BLOCKS && k > 0) {
+      block = 1 + ((k - 1) * middle / (checks - 2) + watch->check_round) %
+                      middle;
+    }
+    is_same = hash_block(file, block, watch->parsed_end) ==
+              watch->block_hashes[block];
+  }
+  fclose(file);
+  watch->check_round++;
+
+  return is_same;
+}
+
+/*-----------------------------reloading------------------------------*/
+
+static int watch_full_parse(obj_watch_t *watch, const struct stat *st) {
+  obj3d *obj = obj_create();
+  edge_set_t edges = {NULL, 0, 0};
+  unsigned long long end = 0;
+  int is_complete = TRUE;
+
+  if (!obj) return FALSE;
+  if (!parse_obj_file_tail(obj, watch->path, 0, &end, &is_complete) ||
+      !add_face_edges(&edges, obj, 0, 0)) {
+    free(edges.keys);
+    obj_destroy(obj);
+    return FALSE;
+  }
+  if (watch->obj) obj_destroy(watch->obj);
+  free(watch->edges.keys);
+  watch->obj = obj;
+  watch->edges = edges;
+  watch->parsed_end = end;
+  watch->is_complete = is_complete;
+  remember_file(watch, st, 0);
+
+  return TRUE;
+}
+
+static int watch_append(obj_watch_t *watch, const struct stat *st) {
+  u_int faces = watch->obj->faces_count;
+  u_int indexes = watch->obj->total_indexes;
+  unsigned long long from = watch->parsed_end, end = watch->parsed_end;
+  int is_complete = TRUE;
+
+  if (!parse_obj_file_tail(watch->obj, watch->path, watch->parsed_end, &end,
+                           &is_complete)) {
+    return FALSE;
+  }
+  if (!add_face_edges(&watch->edges, watch->obj, faces, indexes)) {
+    // хвост уже в объекте, поэтому повторная дозапись его бы удвоила:
+    // до успешного полного чтения дозапись запрещена
+    watch->is_complete = FALSE;
+    return watch_full_parse(watch, st);
+  }
+  watch->parsed_end = end;
+  watch->is_complete = is_complete;
+  remember_file(watch, st, from);
+
+  return TRUE;
+}
+
+int obj_watch_refresh(obj_watch_t *watch) {
+  struct stat st;
+  unsigned long long size = 0;
+
+  if (!watch || stat(watch->path, &st) != 0) return WATCH_FAILED;
+  size = (unsigned long long)st.st_size;
+  if (size == watch->parsed_end && mtime_ns_of(&st) == watch->mtime_ns) {
+    return WATCH_UNCHANGED;
+  }
+  if (watch->is_complete && size > watch->parsed_end &&
+      is_prefix_same(watch)) {
+    return watch_append(watch, &st) ? WATCH_APPENDED : WATCH_FAILED;
+  }
+
+  return watch_full_parse(watch, &st) ? WATCH_RELOADED : WATCH_FAILED;
+}
+
+/*------------------------------public API----------------------------*/
+
+obj_watch_t *obj_watch_open(const char *path) {
+  obj_watch_t *watch = NULL;
+  struct stat st;
+  const char *slash = NULL;
+
+  if (!path || stat(path, &st) != 0) return NULL;
+  watch = (obj_watch_t *)calloc(1, sizeof(obj_watch_t));
+  if (!watch) return NULL;
+  watch->fd = -1;
+  watch->path = strdup(path);
+  if (!watch->path || !watch_full_parse(watch, &st)) {
+    obj_watch_close(watch);
+    return NULL;
+  }
+  slash = strrchr(watch->path, '/');
+  watch->name = slash ? slash + 1 : watch->path;
+#ifdef __linux__
+  watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watch->fd >= 0) {
+    // следим за каталогом, чтобы не потерять файл после переименования
+    char *dir = strdup(slash ? watch->path : ".");
+    if (dir && slash) dir[slash == watch->path ? 1 : slash - watch->path] = 0;
+    if (!dir || inotify_add_watch(watch->fd, dir,
+                                  IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO |
+                                      IN_CREATE) < 0) {
+      close(watch->fd);
+      watch->fd = -1;
+    }
+    free(dir);
+  }
+#endif
+
+  return watch;
+}
+
+int obj_watch_fd(const obj_watch_t *watch) { return watch ? watch->fd : -1; }
+
+int obj_watch_poll(obj_watch_t *watch, int timeout_ms) {
+  if (!watch) return WATCH_FAILED;
+#ifdef __linux__
+  if (watch->fd >= 0) {
+    struct pollfd pfd = {watch->fd, POLLIN, 0};
+    _Alignas(struct inotify_event) char events[4096];
+    int is_touched = FALSE;
+    ssize_t len = 0;
+
+    if (poll(&pfd, 1, timeout_ms) <= 0) return WATCH_UNCHANGED;
+    while ((len = read(watch->fd, events, sizeof(events))) > 0) {
+      for (char *p = events; p < events + len;) {
+        const struct inotify_event *event = (const struct inotify_event *)p;
+        if (event->len && strcmp(event->name, watch->name) == 0) {
+          is_touched = TRUE;
+        }
+        p += sizeof(struct inotify_event) + event->len;
+      }
+    }
+    return is_touched ? obj_watch_refresh(watch) : WATCH_UNCHANGED;
+  }
+#endif
+  if (timeout_ms > 0) usleep((useconds_t)timeout_ms * 1000);
+
+  return obj_watch_refresh(watch);
+}
+
+obj3d *obj_watch_object(const obj_watch_t *watch) {
+  return watch ? watch->obj : NULL;
+}
+
+u_int obj_watch_edges(const obj_watch_t *watch) {
+  return watch ? (u_int)watch->edges.count : 0;
+}
+
+void obj_watch_close(obj_watch_t *watch) {
+  if (!watch) return;
+  if (watch->fd >= 0) close(watch->fd);
+  if (watch->obj) obj_destroy(watch->obj);
+  free(watch->edges.keys);
+  free(watch->block_hashes);
+  free(watch->path);
+  free(watch);
+}
@@ -0,0 +1,509 @@
+/**
+ * @file s21_batch.c
+ * @brief Headless batch processing of mesh assets over the viewer backend
+ * @details
+ * Утилита без Qt: собирает .obj, .stl и .ply файлы из переданных файлов и
+ * каталогов (рекурсивно, каждый каталог один раз, даже через ссылки),
+ * обрабатывает их параллельно на пуле с кражей работы и печатает по одной
+ * JSON строке на файл и итоговую строку summary.
+ *
+ * Для каждого файла: разбор, статистика, количество уникальных ребер,
+ * по запросу нормализация (scaleObjBeforeDraw) и запись в .obj или .off.
+ * В out_dir повторяется структура каталогов относительно переданного пути,
+ * совпавшие имена получают суффикс -2, -3 и т.д.
+ *
+ * Пример:
+ *   3DViewer_batch -j 8 -n 0.5 -o out -f off assets/
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "../back/s21_3d_viewer.h"
+
+#define BATCH_PATH_SIZE 4096
+
+/**
+ * @brief  Collection of output formats of conversion
+ */
+typedef enum { FORMAT_NONE, FORMAT_OBJ, FORMAT_OFF } OUTPUT_FORMAT;
+
+/**
+ * @brief options from the command line
+ */
+typedef struct {
+  u_int threads;
+  float normalize;  ///< scale for scaleObjBeforeDraw, 0 means do not touch
+  int is_edges;
+  int format;
+  const char *out_dir;
+} batch_options_t;
+
+/**
+ * @brief result of one file, filled by a worker thread
+ */
+typedef struct {
+  char *path;
+  size_t name_offset;  ///< start of the path relative to the given argument
+  char *out_path;      ///< converted file, NULL without -o
+  int is_ok;
+  long long bytes;
+  u_int vertexes;
+  u_int faces;
+  u_int indexes;
+  u_int edges;
+  axises bounds;
+  double parse_ms;
+  double total_ms;
+  u_int thread_index;
+} batch_item_t;
+
+/**
+ * @brief directory already walked, symlinks may lead to it again
+ */
+typedef struct {
+  dev_t device;
+  ino_t inode;
+} batch_dir_t;
+
+typedef struct {
+  batch_item_t *items;
+  u_int count;
+  u_int capacity;
+  const batch_options_t *options;
+  batch_dir_t *dirs;
+  u_int dirs_count;
+  u_int dirs_capacity;
+} batch_job_t;
+
+static double now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/*----------------------------collect files---------------------------*/
+
+static int has_mesh_extension(const char *name) {
+  size_t len = strlen(name);
+
+  return len > 4 && (strcmp(name + len - 4, ".obj") == 0 ||
+                     strcmp(name + len - 4, ".stl") == 0 ||
+                     strcmp(name + len - 4, ".ply") == 0);
+}
+
+static int add_item(batch_job_t *job, const char *path, size_t name_offset) {
+  if (job->count == job->capacity) {
+    u_int capacity = job->capacity ? job->capacity * 2 : 64;
+    batch_item_t *items = (batch_item_t *)realloc(
+        job->items, capacity * sizeof(batch_item_t));
+    if (!items) return FALSE;
+    job->items = items;
+    job->capacity = capacity;
+  }
+  memset(&job->items[job->count], 0, sizeof(batch_item_t));
+  job->items[job->count].path = strdup(path);
+  job->items[job->count].name_offset = name_offset;
+  if (!job->items[job->count].path) return FALSE;
+  job->count++;
+
+  return TRUE;
+}
+
+// FALSE если каталог уже обойден, иначе запоминает его
+static int visit_dir(batch_job_t *job, const struct stat *st) {
+  for (u_int i = 0; i < job->dirs_count; i++) {
+    if (job->dirs[i].device == st->st_dev && job->dirs[i].inode == st->st_ino) {
+      return FALSE;
+    }
+  }
+  if (job->dirs_count == job->dirs_capacity) {
+    u_int capacity = job->dirs_capacity ? job->dirs_capacity * 2 : 64;
+    batch_dir_t *dirs =
+        (batch_dir_t *)realloc(job->dirs, capacity * sizeof(batch_dir_t));
+    if (!dirs) return FALSE;
+    job->dirs = dirs;
+    job->dirs_capacity = capacity;
+  }
+  job->dirs[job->dirs_count].device = st->st_dev;
+  job->dirs[job->dirs_count].inode = st->st_ino;
+  job->dirs_count++;
+
+  return TRUE;
+}
+
+static int collect_files(batch_job_t *job, const char *path,
+                         size_t name_offset) {
+  int function_result = TRUE;
+  struct stat st;
+  DIR *dir = NULL;
+  struct dirent *entry = NULL;
+  char child[BATCH_PATH_SIZE];
+
+  if (stat(path, &st) != 0) {
+    fprintf(stderr, "3DViewer_batch: cannot access %s\n", path);
+    return FALSE;
+  }
+  if (!S_ISDIR(st.st_mode)) return add_item(job, path, name_offset);
+  // ссылка на свой же или уже обойденный каталог не обходится второй раз
+  if (!visit_dir(job, &st)) return TRUE;
+
+  dir = opendir(path);
+  if (!dir) return FALSE;
+  while (function_result && (entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') continue;
+    if (snprintf(child, sizeof(child), "%s/%s", path, entry->d_name) >=
+        (int)sizeof(child)) {
+      continue;
+    }
+    if (stat(child, &st) != 0) continue;
+    if (S_ISDIR(st.st_mode)) {
+      function_result = collect_files(job, child, name_offset);
+    } else if (has_mesh_extension(entry->d_name)) {
+      function_result = add_item(job, child, name_offset);
+    }
+  }
+  closedir(dir);
+
+  return function_result;
+}
+
+static int compare_items(const void *a, const void *b) {
+  return strcmp(((const batch_item_t *)a)->path,
+                ((const batch_item_t *)b)->path);
+}
+
+/*------------------------------conversion----------------------------*/
+
+// имя в out_dir начинается с последнего компонента аргумента:
+// assets/ -> assets/sub/a.obj, a/cube.obj -> cube.obj
+static size_t argument_name_offset(const char *path) {
+  size_t len = strlen(path);
+  size_t offset = 0;
+
+  while (len > 1 && path[len - 1] == '/') len--;
+  for (size_t i = 0; i + 1 < len; i++) {
+    if (path[i] == '/') offset = i + 1;
+  }
+
+  return offset;
+}
+
+static int set_out_path(batch_item_t *item, const batch_options_t *options,
+                        u_int copy) {
+  char path[BATCH_PATH_SIZE];
+  const char *name = item->path + item->name_offset;
+  int name_len = (int)strlen(name);
+  const char *ext = options->format == FORMAT_OFF ? "off" : "obj";
+  int len = 0;
+
+  while (name_len > 0 && (*name == '/' || strncmp(name, "../", 3) == 0)) {
+    name += *name == '/' ? 1 : 3;
+    name_len = (int)strlen(name);
+  }
+  if (has_mesh_extension(name)) name_len -= 4;
+  if (copy > 1) {
+    len = snprintf(path, sizeof(path), "%s/%.*s-%u.%s", options->out_dir,
+                   name_len, name, copy, ext);
+  } else {
+    len = snprintf(path, sizeof(path), "%s/%.*s.%s", options->out_dir,
+                   name_len, name, ext);
+  }
+  free(item->out_path);
+  item->out_path = len < (int)sizeof(path) ? strdup(path) : NULL;
+
+  return item->out_path != NULL;
+}
+
+static int compare_out_paths(const void *a, const void *b) {
+  const batch_item_t *x = *(batch_item_t *const *)a;
+  const batch_item_t *y = *(batch_item_t *const *)b;
+  int result = strcmp(x->out_path, y->out_path);
+
+  // при равных именах суффикс получает файл, идущий позже по пути
+  return result ? result : strcmp(x->path, y->path);
+}
+
+/**
+ * @brief give every item a distinct output path, repeated names get -2, -3
+ * until no two items share a file, so parallel workers never write the same
+ * output
+ */
+static int assign_out_paths(batch_job_t *job) {
+  batch_item_t **order = NULL;
+  u_int count = 0;
+  int is_renamed = TRUE;
+
+  for (u_int i = 0; i < job->count; i++) {
+    if (set_out_path(&job->items[i], job->options, 1)) count++;
+  }
+  order = (batch_item_t **)malloc((count + 1) * sizeof(batch_item_t *));
+  if (!order) return FALSE;
+  count = 0;
+  for (u_int i = 0; i < job->count; i++) {
+    if (job->items[i].out_path) order[count++] = &job->items[i];
+  }
+  for (u_int round = 2; is_renamed; round++) {
+    is_renamed = FALSE;
+    if (count) {
+      qsort(order, count, sizeof(batch_item_t *), compare_out_paths);
+    }
+    for (u_int i = 1, copy = 1; i < count; i++) {
+      if (strcmp(order[i - 1]->out_path, order[i]->out_path) == 0) {
+        // у повторов свой номер в каждом раунде, новые имена тоже проверяются
+        copy = copy < round ? round : copy + 1;
+        set_out_path(order[i], job->options, copy);
+        is_renamed = TRUE;
+      } else {
+        copy = 1;
+      }
+    }
+  }
+  free(order);
+
+  return TRUE;
+}
+
+static void make_parent_dirs(const char *path, size_t skip) {
+  char dir[BATCH_PATH_SIZE];
+
+  snprintf(dir, sizeof(dir), "%s", path);
+  for (char *slash = strchr(dir + skip, '/'); slash;
+       slash = strchr(slash + 1, '/')) {
+    *slash = '\0';
+    mkdir(dir, 0755);
+    *slash = '/';
+  }
+}
+
+// в .off индексы вершин начинаются с 0
+static void write_off(FILE *file, const obj3d *obj) {
+  const u_int *ind = obj->polygons.vertexes_ind;
+
+  fprintf(file, "OFF\n%u %u 0\n", obj->vertexes_count, obj->faces_count);
+  for (u_int v = 0; v < obj->vertexes_count; v++) {
+    const float *p = obj->vertexes + (size_t)v * AX_DIMEN;
+    fprintf(file, "%.6f %.6f %.6f\n", p[0], p[1], p[2]);
+  }
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    fprintf(file, "%u", obj->polygons.indeces_count[f]);
+    for (u_int k = 0; k < obj->polygons.indeces_count[f]; k++) {
+      fprintf(file, " %u", *ind++ - 1);
+    }
+    fputc('\n', file);
+  }
+}
+
+static int convert_obj(const obj3d *obj, const char *path,
+                       const batch_options_t *options) {
+  FILE *file = NULL;
+  int function_result = FALSE;
+
+  if (!path) return FALSE;
+  // файлы и так обрабатываются параллельно, поэтому запись в один поток
+  if (options->format != FORMAT_OFF) return write_obj_file(obj, path, 1);
+  file = fopen(path, "w");
+  if (file) {
+    write_off(file, obj);
+    function_result = !ferror(file);
+    function_result = fclose(file) == 0 && function_result;
+  }
+
+  return function_result;
+}
+
+/*-------------------------------workers------------------------------*/
+
+static void process_range(void *ctx, u_int begin, u_int end,
+                          u_int thread_index) {
+  batch_job_t *job = (batch_job_t *)ctx;
+  const batch_options_t *options = job->options;
+
+  for (u_int i = begin; i < end; i++) {
+    batch_item_t *item = &job->items[i];
+    double start = now_ms();
+    struct stat st;
+    obj3d *obj = parse_mesh_file(item->path);
+
+    item->parse_ms = now_ms() - start;
+    item->thread_index = thread_index;
+    if (stat(item->path, &st) == 0) item->bytes = (long long)st.st_size;
+    if (obj) {
+      item->is_ok = TRUE;
+      item->vertexes = obj->vertexes_count;
+      item->faces = obj->faces_count;
+      item->indexes = obj->total_indexes;
+      if (options->is_edges) {
+        u_int *edges = NULL;
+        item->edges = collect_unique_edges(obj, &edges);
+        free(edges);
+      }
+      if (options->normalize > 0.0f && obj->vertexes_count) {
+        scaleObjBeforeDraw(options->normalize, obj);
+      }
+      item->bounds = obj->bounds;
+      if (options->format != FORMAT_NONE) {
+        item->is_ok = convert_obj(obj, item->out_path, options);
+      }
+      obj_destroy(obj);
+    }
+    item->total_ms = now_ms() - start;
+  }
+}
+
+/*--------------------------------output------------------------------*/
+
+static void print_json_string(const char *str) {
+  putchar('"');
+  for (; *str; str++) {
+    unsigned char c = (unsigned char)*str;
+    if (c == '"' || c == '\\') {
+      printf("\\%c", c);
+    } else if (c < 0x20) {
+      printf("\\u%04x", c);
+    } else {
+      putchar(c);
+    }
+  }
+  putchar('"');
+}
+
+static void print_item(const batch_item_t *item,
+                       const batch_options_t *options) {
+  double mb_per_s =
+      item->total_ms > 0.0 ? (double)item->bytes / 1e3 / item->total_ms : 0.0;
+
+  printf("{\"file\":");
+  print_json_string(item->path);
+  printf(",\"status\":\"%s\",\"bytes\":%lld", item->is_ok ? "ok" : "error",
+         item->bytes);
+  if (item->is_ok) {
+    printf(",\"vertexes\":%u,\"faces\":%u,\"indexes\":%u", item->vertexes,
+           item->faces, item->indexes);
+    if (options->is_edges) printf(",\"edges\":%u", item->edges);
+    if (item->out_path) {
+      printf(",\"output\":");
+      print_json_string(item->out_path);
+    }
+    printf(",\"bounds\":[%g,%g,%g,%g,%g,%g]", item->bounds.x_min,
+           item->bounds.x_max, item->bounds.y_min, item->bounds.y_max,
+           item->bounds.z_min, item->bounds.z_max);
+  }
+  printf(",\"parse_ms\":%.3f,\"total_ms\":%.3f,\"mb_per_s\":%.2f",
+         item->parse_ms, item->total_ms, mb_per_s);
+  printf(",\"thread\":%u}\n", item->thread_index);
+}
+
+static void print_summary(const batch_job_t *job, u_int threads,
+                          double wall_ms) {
+  long long bytes = 0;
+  u_int failed = 0;
+  double busy_ms = 0.0;
+
+  for (u_int i = 0; i < job->count; i++) {
+    bytes += job->items[i].bytes;
+    busy_ms += job->items[i].total_ms;
+    if (!job->items[i].is_ok) failed++;
+  }
+  printf("{\"summary\":true,\"files\":%u,\"failed\":%u,\"threads\":%u",
+         job->count, failed, threads);
+  printf(",\"bytes\":%lld,\"wall_ms\":%.3f,\"busy_ms\":%.3f", bytes, wall_ms,
+         busy_ms);
+  printf(",\"files_per_s\":%.2f,\"mb_per_s\":%.2f}\n",
+         wall_ms > 0.0 ? job->count * 1e3 / wall_ms : 0.0,
+         wall_ms > 0.0 ? (double)bytes / 1e3 / wall_ms : 0.0);
+}
+
+/*---------------------------------main-------------------------------*/
+
+static void print_usage(void) {
+  fprintf(stderr,
+          "usage: 3DViewer_batch [-j threads] [-e] [-n scale] "
+          "[-o out_dir [-f obj|off]] path...\n"
+          "  -j  worker threads, 0 means all cores (default)\n"
+          "  -e  count unique edges\n"
+          "  -n  normalize into cube of given scale like the viewer does\n"
+          "  -o  write converted files into out_dir\n"
+          "  -f  output format, obj by default\n");
+}
+
+static int parse_options(int argc, char **argv, batch_options_t *options) {
+  int opt = 0;
+
+  memset(options, 0, sizeof(*options));
+  while ((opt = getopt(argc, argv, "j:en:o:f:h")) != -1) {
+    if (opt == 'j') {
+      options->threads = (u_int)strtoul(optarg, NULL, 10);
+    } else if (opt == 'e') {
+      options->is_edges = TRUE;
+    } else if (opt == 'n') {
+      options->normalize = strtof(optarg, NULL);
+    } else if (opt == 'o') {
+      options->out_dir = optarg;
+    } else if (opt == 'f' && strcmp(optarg, "off") == 0) {
+      options->format = FORMAT_OFF;
+    } else if (opt == 'f' && strcmp(optarg, "obj") == 0) {
+      options->format = FORMAT_OBJ;
+    } else {
+      return FALSE;
+    }
+  }
+  if (options->out_dir && options->format == FORMAT_NONE) {
+    options->format = FORMAT_OBJ;
+  }
+  if (!options->out_dir && options->format != FORMAT_NONE) return FALSE;
+
+  return optind < argc;
+}
+
+int main(int argc, char **argv) {
+  batch_options_t options;
+  batch_job_t job = {NULL, 0, 0, &options, NULL, 0, 0};
+  int is_collected = TRUE;
+  u_int threads = 0;
+  u_int failed = 0;
+  double start = 0.0;
+
+  if (!parse_options(argc, argv, &options)) {
+    print_usage();
+    return 2;
+  }
+  if (options.out_dir) mkdir(options.out_dir, 0755);
+  for (int i = optind; is_collected && i < argc; i++) {
+    is_collected =
+        collect_files(&job, argv[i], argument_name_offset(argv[i]));
+  }
+  free(job.dirs);
+  if (job.count) {
+    qsort(job.items, job.count, sizeof(batch_item_t), compare_items);
+  }
+  if (options.out_dir && is_collected) {
+    is_collected = assign_out_paths(&job);
+    for (u_int i = 0; is_collected && i < job.count; i++) {
+      if (job.items[i].out_path) {
+        make_parent_dirs(job.items[i].out_path, strlen(options.out_dir) + 1);
+      }
+    }
+  }
+
+  start = now_ms();
+  threads = parallel_for_stealing(job.count, options.threads, process_range,
+                                  &job);
+  double wall_ms = now_ms() - start;
+
+  for (u_int i = 0; i < job.count; i++) {
+    print_item(&job.items[i], &options);
+    if (!job.items[i].is_ok) failed++;
+    free(job.items[i].path);
+    free(job.items[i].out_path);
+  }
+  print_summary(&job, threads, wall_ms);
+  free(job.items);
+
+  return is_collected && !failed ? 0 : 1;
+}
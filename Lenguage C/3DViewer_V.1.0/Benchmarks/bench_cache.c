@@ -0,0 +1,60 @@
+#include "bench_common.h"
+
+#define GRID_SIDE 708U  // 2 * 708 * 708 ~ 1M triangles
+#define REPEATS 5
+#define CACHE_PATH "/tmp/s21_bench_cache.s21b"
+
+/**
+ * @brief best time of loading the cache, the file stays in the page cache
+ */
+static double time_load(void) {
+  double best = 0.0;
+
+  for (int i = 0; i < REPEATS; i++) {
+    double start = bench_now_ms();
+    obj3d *obj = obj_load_binary(CACHE_PATH);
+    double elapsed = bench_now_ms() - start;
+    if (obj) obj_destroy(obj);
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  return best;
+}
+
+static void report(const char *name, double raw_mb, int is_saved) {
+  double mb = (double)bench_file_size(CACHE_PATH) / (1024.0 * 1024.0);
+  double ms = is_saved ? time_load() : 0.0;
+
+  if (!is_saved) {
+    printf("%-14s failed to save\n", name);
+    return;
+  }
+  // скорость считается по размеру распакованного объекта
+  printf("%-14s %8.2f MB %5.2fx %9.2f ms %8.1f MB/s\n", name, mb,
+         raw_mb / mb, ms, raw_mb / ms * 1e3);
+}
+
+int main(void) {
+  u_int bits[] = {0, 16, 12};
+
+  if (!bench_write_grid_obj(BENCH_GRID_PATH, GRID_SIDE, GRID_SIDE)) return 1;
+  obj3d *obj = parse_obj_file(BENCH_GRID_PATH);
+  remove(BENCH_GRID_PATH);
+  if (!obj) return 1;
+  rotate_object(0.5f, obj, Y_CORD);
+
+  int is_saved = obj_save_binary(obj, CACHE_PATH);
+  double raw_mb = (double)bench_file_size(CACHE_PATH) / (1024.0 * 1024.0);
+  printf("binary cache: %u vertexes, %u faces, hot page cache, best of %d\n",
+         obj->vertexes_count, obj->faces_count, REPEATS);
+  report("raw", raw_mb, is_saved);
+  for (u_int b = 0; b < sizeof(bits) / sizeof(*bits); b++) {
+    char name[32];
+    snprintf(name, sizeof(name), "packed bits=%u", bits[b]);
+    report(name, raw_mb, obj_save_compressed(obj, CACHE_PATH, bits[b]));
+  }
+  remove(CACHE_PATH);
+  obj_destroy(obj);
+
+  return 0;
+}
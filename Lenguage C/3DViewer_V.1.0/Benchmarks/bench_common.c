@@ -0,0 +1,89 @@
+#define _GNU_SOURCE
+#include "bench_common.h"
+
+#include <sys/stat.h>
+#include <time.h>
+
+double bench_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// wavy height field of (cols + 1) * (rows + 1) vertexes and 2 * cols * rows
+// triangles
+int bench_write_grid_obj(const char *path, u_int cols, u_int rows) {
+  return bench_write_mesh_obj(path, cols, rows, BENCH_OBJ_PLAIN);
+}
+
+static void write_corner(FILE *file, u_int index, u_int vertexes,
+                         int format) {
+  if (format == BENCH_OBJ_NEGATIVE) {
+    // все вершины уже прочитаны, поэтому -1 это последняя
+    fprintf(file, " %d", (int)index - (int)vertexes - 1);
+  } else if (format == BENCH_OBJ_NORMALS) {
+    fprintf(file, " %u//%u", index, index);
+  } else if (format == BENCH_OBJ_FULL) {
+    fprintf(file, " %u/%u/%u", index, index, index);
+  } else {
+    fprintf(file, " %u", index);
+  }
+}
+
+// the same grid in different flavours of the .obj syntax
+int bench_write_mesh_obj(const char *path, u_int cols, u_int rows,
+                         int format) {
+  const char *eol = format == BENCH_OBJ_CRLF ? "\r\n" : "\n";
+  u_int vertexes = (cols + 1) * (rows + 1);
+  FILE *file = fopen(path, "w");
+  if (!file) return FALSE;
+
+  fprintf(file, "# s21 benchmark grid %ux%u%s", cols, rows, eol);
+  for (u_int r = 0; r <= rows; r++) {
+    if (format == BENCH_OBJ_COMMENTS) {
+      fprintf(file, "# row %u of vertexes\no row_%u\ng grid\n", r, r);
+    }
+    for (u_int c = 0; c <= cols; c++) {
+      float x = (float)c / (float)cols, y = (float)r / (float)rows;
+      fprintf(file, "v %f %f %f%s", x, y,
+              0.05f * sinf(20.0f * x) * cosf(20.0f * y), eol);
+      if (format == BENCH_OBJ_FULL) fprintf(file, "vt %f %f\n", x, y);
+      if (format == BENCH_OBJ_NORMALS || format == BENCH_OBJ_FULL) {
+        fprintf(file, "vn 0.000000 0.000000 1.000000\n");
+      }
+    }
+  }
+  for (u_int r = 0; r < rows; r++) {
+    if (format == BENCH_OBJ_COMMENTS) fprintf(file, "# row %u of faces\n", r);
+    for (u_int c = 0; c < cols; c++) {
+      u_int a = r * (cols + 1) + c + 1, b = a + 1;
+      u_int d = a + cols + 1, e = d + 1;
+      u_int corners[6] = {a, b, e, a, e, d};
+      for (u_int t = 0; t < 6; t += 3) {
+        fputc('f', file);
+        for (u_int k = t; k < t + 3; k++) {
+          write_corner(file, corners[k], vertexes, format);
+        }
+        fputs(eol, file);
+      }
+    }
+  }
+  fclose(file);
+
+  return TRUE;
+}
+
+const char *bench_format_name(int format) {
+  static const char *names[BENCH_OBJ_FORMATS] = {
+      "plain", "v//vn", "v/vt/vn", "negative", "comments", "crlf"};
+
+  return format >= 0 && format < BENCH_OBJ_FORMATS ? names[format] : "";
+}
+
+long long bench_file_size(const char *path) {
+  struct stat st;
+
+  return stat(path, &st) == 0 ? (long long)st.st_size : -1;
+}
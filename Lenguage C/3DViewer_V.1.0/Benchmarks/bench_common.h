@@ -0,0 +1,28 @@
+#ifndef SRC_BENCHMARKS_BENCH_COMMON_H_
+#define SRC_BENCHMARKS_BENCH_COMMON_H_
+
+#include "../3DViewerV1.0/back/s21_3d_viewer.h"
+
+#define BENCH_GRID_PATH "/tmp/s21_bench_grid.obj"
+
+/**
+ * @brief  Collection of flavours of synthetic .obj files
+ */
+typedef enum {
+  BENCH_OBJ_PLAIN,     ///< f v
+  BENCH_OBJ_NORMALS,   ///< vn lines and f v//vn
+  BENCH_OBJ_FULL,      ///< vt and vn lines and f v/vt/vn
+  BENCH_OBJ_NEGATIVE,  ///< f with negative (relative) indices
+  BENCH_OBJ_COMMENTS,  ///< comments, groups and objects between lines
+  BENCH_OBJ_CRLF,      ///< windows line endings
+  BENCH_OBJ_FORMATS    ///< count of formats
+} BENCH_OBJ_FORMAT;
+
+double bench_now_ms(void);
+int bench_write_grid_obj(const char *path, u_int cols, u_int rows);
+int bench_write_mesh_obj(const char *path, u_int cols, u_int rows,
+                         int format);
+const char *bench_format_name(int format);
+long long bench_file_size(const char *path);
+
+#endif  // SRC_BENCHMARKS_BENCH_COMMON_H_
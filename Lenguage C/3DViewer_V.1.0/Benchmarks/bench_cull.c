@@ -0,0 +1,125 @@
+#define _GNU_SOURCE
+#include "bench_common.h"
+
+#define RINGS 500U      // 500 * 1000 quads ~ 1M triangles
+#define SEGMENTS 1000U
+#define FB_WIDTH 1280U
+#define FB_HEIGHT 720U
+#define REPEATS 3
+
+/**
+ * @brief closed UV sphere of quads, counter-clockwise from outside
+ */
+static obj3d *make_sphere(void) {
+  obj3d *obj = obj_create();
+  u_int vertexes = (RINGS + 1) * SEGMENTS, faces = RINGS * SEGMENTS;
+
+  if (!obj || !obj_reserve(obj, vertexes, faces, faces * 4)) {
+    obj_destroy(obj);
+    return NULL;
+  }
+  for (u_int i = 0; i <= RINGS; i++) {
+    double theta = M_PI * i / RINGS;
+    for (u_int j = 0; j < SEGMENTS; j++) {
+      double phi = 2.0 * M_PI * j / SEGMENTS;
+      float *p = obj->vertexes + ((size_t)i * SEGMENTS + j) * AX_DIMEN;
+      p[0] = (float)(sin(theta) * cos(phi));
+      p[1] = (float)cos(theta);
+      p[2] = (float)(sin(theta) * sin(phi));
+    }
+  }
+  u_int *ind = obj->polygons.vertexes_ind;
+  for (u_int i = 0; i < RINGS; i++) {
+    for (u_int j = 0; j < SEGMENTS; j++) {
+      u_int a = i * SEGMENTS + j + 1, b = (i + 1) * SEGMENTS + j + 1;
+      u_int d = i * SEGMENTS + (j + 1) % SEGMENTS + 1;
+      u_int c = (i + 1) * SEGMENTS + (j + 1) % SEGMENTS + 1;
+      *ind++ = a;
+      *ind++ = d;
+      *ind++ = c;
+      *ind++ = b;
+      obj->polygons.indeces_count[i * SEGMENTS + j] = 4;
+    }
+  }
+
+  return obj;
+}
+
+static double time_render(obj3d *obj, float distance,
+                          render_options_t *options, framebuffer_t *fb) {
+  float model[4][4], view[4][4], proj[4][4];
+  double best = 0.0;
+
+  matrix4_rotation(0.4f, X_CORD, model);
+  matrix4_translation(0.0f, 0.0f, -distance, view);
+  matrix4_perspective(0.8f, (float)FB_WIDTH / FB_HEIGHT, 0.1f, 100.0f, proj);
+  for (int i = 0; i < REPEATS; i++) {
+    double start = bench_now_ms();
+    render_obj(obj, model, view, proj, options, fb);
+    double elapsed = bench_now_ms() - start;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  return best;
+}
+
+static double time_cull(obj3d *obj, float distance, face_cull_t *cull,
+                        int mode) {
+  float model[4][4], view[4][4], proj[4][4];
+  double best = 0.0;
+
+  matrix4_rotation(0.4f, X_CORD, model);
+  matrix4_translation(0.0f, 0.0f, -distance, view);
+  matrix4_perspective(0.8f, (float)FB_WIDTH / FB_HEIGHT, 0.1f, 100.0f, proj);
+  for (int i = 0; i < REPEATS; i++) {
+    double start = bench_now_ms();
+    cull_faces(cull, obj, model, view, proj, mode, 0);
+    double elapsed = bench_now_ms() - start;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  return best;
+}
+
+int main(void) {
+  const float distances[] = {3.0f, 1.3f};
+  const char *views[] = {"whole sphere", "close-up"};
+  const int modes[] = {CULL_BACK_FACES, CULL_BACK_FACES | CULL_FRUSTUM};
+  const char *names[] = {"back", "back+frustum"};
+  render_options_t options;
+  obj3d *obj = make_sphere();
+  framebuffer_t *fb = framebuffer_create(FB_WIDTH, FB_HEIGHT);
+  face_cull_t *cull = face_cull_create();
+
+  if (!obj || !fb || !cull) return 1;
+  render_options_default(&options);
+  options.mode = RENDER_FLAT;
+  printf("flat render of %u quads, %ux%u, %u threads, best of %d\n",
+         obj->faces_count, FB_WIDTH, FB_HEIGHT, get_threads_count(0),
+         REPEATS);
+  // плоскости граней считаются один раз, как при загрузке модели
+  double planes_start = bench_now_ms();
+  face_cull_update(cull, obj, 0);
+  printf("face planes: %.2f ms once per model\n",
+         bench_now_ms() - planes_start);
+  for (u_int v = 0; v < sizeof(distances) / sizeof(*distances); v++) {
+    options.face_cull = NULL;
+    double base = time_render(obj, distances[v], &options, fb);
+    printf("%-13s no culling   %9.2f ms\n", views[v], base);
+    for (u_int m = 0; m < sizeof(modes) / sizeof(*modes); m++) {
+      options.face_cull = cull;
+      options.cull_mode = modes[m];
+      double ms = time_render(obj, distances[v], &options, fb);
+      double cull_ms = time_cull(obj, distances[v], cull, modes[m]);
+      printf("%-13s %-12s %9.2f ms, cull %6.2f ms, %5.1f%% faces kept, "
+             "saved %7.2f ms per frame\n",
+             views[v], names[m], ms, cull_ms,
+             100.0 * cull->faces_count / obj->faces_count, base - ms);
+    }
+  }
+  face_cull_destroy(cull);
+  framebuffer_destroy(fb);
+  obj_destroy(obj);
+
+  return 0;
+}
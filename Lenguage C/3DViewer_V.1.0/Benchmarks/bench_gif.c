@@ -0,0 +1,59 @@
+#include "bench_common.h"
+
+#define GIF_WIDTH 640U
+#define GIF_HEIGHT 480U
+#define GIF_FRAMES 60U
+#define GIF_PATH "/tmp/s21_bench_record.gif"
+
+static double time_record(framebuffer_t **frames, u_int workers,
+                          u_int *dropped) {
+  double start = bench_now_ms();
+  gif_recorder_t *rec = gif_recorder_start(GIF_PATH, GIF_WIDTH, GIF_HEIGHT, 4,
+                                           GIF_FRAMES, workers);
+  if (!rec) return -1.0;
+  for (u_int i = 0; i < GIF_FRAMES; i++) {
+    gif_recorder_push(rec, frames[i]->pixels);
+  }
+  gif_recorder_stats(rec, NULL, dropped);
+  gif_recorder_finish(rec);
+  remove(GIF_PATH);
+
+  return bench_now_ms() - start;
+}
+
+int main(void) {
+  u_int workers[] = {1, 2, 4, 0};
+  framebuffer_t *frames[GIF_FRAMES] = {NULL};
+  float model[4][4], view[4][4], proj[4][4];
+  render_options_t options;
+
+  if (!bench_write_grid_obj(BENCH_GRID_PATH, 64, 64)) return 1;
+  obj3d *obj = parse_obj_file(BENCH_GRID_PATH);
+  remove(BENCH_GRID_PATH);
+  if (!obj) return 1;
+
+  // кадры рендерятся заранее, чтобы измерять только запись GIF
+  scaleObjBeforeDraw(0.5f, obj);
+  render_options_default(&options);
+  options.mode = RENDER_FLAT;
+  matrix4_translation(0.0f, 0.0f, -1.5f, view);
+  matrix4_perspective(0.8f, (float)GIF_WIDTH / GIF_HEIGHT, 0.1f, 100.0f, proj);
+  for (u_int i = 0; i < GIF_FRAMES; i++) {
+    frames[i] = framebuffer_create(GIF_WIDTH, GIF_HEIGHT);
+    if (!frames[i]) return 1;
+    matrix4_rotation(0.1f * (float)i - 1.0f, X_CORD, model);
+    render_obj(obj, model, view, proj, &options, frames[i]);
+  }
+  printf("gif recorder: %u frames %ux%u\n", GIF_FRAMES, GIF_WIDTH, GIF_HEIGHT);
+  for (u_int w = 0; w < sizeof(workers) / sizeof(*workers); w++) {
+    u_int dropped = 0;
+    double ms = time_record(frames, workers[w], &dropped);
+    printf("workers=%-3u %9.2f ms %8.2f frames/s dropped=%u\n",
+           get_threads_count(workers[w]), ms,
+           1e3 * (GIF_FRAMES - dropped) / ms, dropped);
+  }
+  for (u_int i = 0; i < GIF_FRAMES; i++) framebuffer_destroy(frames[i]);
+  obj_destroy(obj);
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#define _GNU_SOURCE
+#include "bench_common.h"
+
+#include <time.h>
+
+#define GRID_SIDE 1000U   // 1M vertexes, 2M triangles
+#define FRAME_MS 16.667  // poll period of a 60 fps interface
+
+// опрашивает загрузчик раз в кадр, как это делал бы таймер интерфейса
+static int poll_frames(obj_loader_t *loader, double cancel_at_ms,
+                       double *cancel_latency_ms) {
+  struct timespec frame = {0, (long)(FRAME_MS * 1e6)};
+  double start = bench_now_ms(), cancel_time = 0.0;
+  unsigned long long read = 0, total = 0;
+  int state = LOAD_RUNNING, frames = 0;
+
+  while ((state = obj_loader_poll(loader, &read, &total)) == LOAD_RUNNING) {
+    double now = bench_now_ms() - start;
+    if (cancel_at_ms > 0.0 && cancel_time == 0.0 && now >= cancel_at_ms) {
+      obj_loader_cancel(loader);
+      cancel_time = bench_now_ms();
+    }
+    if (frames++ % 30 == 0) {
+      printf("  frame %4d  %7.1f ms  %5.1f%%\n", frames, now,
+             total ? 100.0 * (double)read / (double)total : 0.0);
+    }
+    nanosleep(&frame, NULL);
+  }
+  if (cancel_time > 0.0) *cancel_latency_ms = bench_now_ms() - cancel_time;
+
+  return state;
+}
+
+int main(void) {
+  const char *states[] = {"running", "done", "failed", "cancelled"};
+  double latency = 0.0, start = 0.0;
+  u_int edges = 0;
+  int state = LOAD_RUNNING;
+
+  if (!bench_write_grid_obj(BENCH_GRID_PATH, GRID_SIDE, GRID_SIDE)) return 1;
+
+  printf("async load of %ux%u grid, polled every %.1f ms\n", GRID_SIDE,
+         GRID_SIDE, FRAME_MS);
+  start = bench_now_ms();
+  obj_loader_t *loader = obj_loader_start(BENCH_GRID_PATH);
+  state = poll_frames(loader, 0.0, &latency);
+  obj3d *obj = obj_loader_take(loader, &edges);
+  printf("%s in %.2f ms: %u vertexes, %u faces, %u edges\n", states[state],
+         bench_now_ms() - start, obj ? obj->vertexes_count : 0,
+         obj ? obj->faces_count : 0, edges);
+  if (obj) obj_destroy(obj);
+  obj_loader_destroy(loader);
+
+  loader = obj_loader_start(BENCH_GRID_PATH);
+  state = poll_frames(loader, 50.0, &latency);
+  printf("%s after cancel in %.3f ms\n", states[state], latency);
+  obj_loader_destroy(loader);
+  remove(BENCH_GRID_PATH);
+
+  return 0;
+}
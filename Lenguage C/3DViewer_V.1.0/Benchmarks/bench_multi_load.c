@@ -0,0 +1,87 @@
+#define _GNU_SOURCE
+#include "bench_common.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+#define FILES 12
+#define PATH_SIZE 64
+
+typedef struct {
+  double start;
+  double first_ms;  ///< time until the first model is ready
+  atomic_int is_set;
+} first_ready_t;
+
+static void note_done(void *user, u_int index, int state) {
+  first_ready_t *first = (first_ready_t *)user;
+  int expected = FALSE;
+  (void)index;
+
+  // обратные вызовы идут из разных потоков, время пишет только первый
+  if (state == LOAD_DONE &&
+      atomic_compare_exchange_strong(&first->is_set, &expected, TRUE)) {
+    first->first_ms = bench_now_ms() - first->start;
+  }
+}
+
+static double load_sequential(const char *const *paths) {
+  double start = bench_now_ms();
+
+  for (u_int i = 0; i < FILES; i++) {
+    obj3d *obj = parse_mesh_file(paths[i]);
+    if (obj) {
+      get_count_edges(obj);
+      obj_destroy(obj);
+    }
+  }
+
+  return bench_now_ms() - start;
+}
+
+static double load_pool(const char *const *paths, u_int threads,
+                        double *first_ms) {
+  struct timespec pause = {0, 200000L};
+  first_ready_t first = {bench_now_ms(), 0.0, FALSE};
+  obj_multi_loader_t *loader =
+      obj_multi_loader_start(paths, FILES, threads, note_done, &first);
+
+  if (!loader) return 0.0;
+  while (obj_multi_loader_poll(loader) < FILES) nanosleep(&pause, NULL);
+  double elapsed = bench_now_ms() - first.start;
+  obj_multi_loader_destroy(loader);
+  *first_ms = first.first_ms;
+
+  return elapsed;
+}
+
+int main(void) {
+  char storage[FILES][PATH_SIZE];
+  const char *paths[FILES];
+  u_int threads[] = {1, 2, 4, 0};
+  long long bytes = 0;
+  int is_ready = TRUE;
+
+  // файлы разного размера: от 50x50 до 600x600 вершин
+  for (u_int i = 0; is_ready && i < FILES; i++) {
+    u_int side = 50 + 50 * i;
+    snprintf(storage[i], PATH_SIZE, "/tmp/s21_bench_multi_%u.obj", i);
+    paths[i] = storage[i];
+    is_ready = bench_write_grid_obj(paths[i], side, side);
+    bytes += bench_file_size(paths[i]);
+  }
+  if (is_ready) {
+    printf("%d files, %.1f MB total, hot page cache\n", FILES,
+           (double)bytes / (1024.0 * 1024.0));
+    printf("%-18s %9.2f ms\n", "sequential", load_sequential(paths));
+    for (u_int t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+      double first_ms = 0.0;
+      double ms = load_pool(paths, threads[t], &first_ms);
+      printf("pool threads=%-5u %9.2f ms, first model after %.2f ms\n",
+             get_threads_count(threads[t]), ms, first_ms);
+    }
+  }
+  for (u_int i = 0; i < FILES; i++) remove(storage[i]);
+
+  return is_ready ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#include "bench_common.h"
+
+#define GRID_SIDE 708U  // 2 * 708 * 708 ~ 1M triangles
+#define REPEATS 5
+
+static double time_normals(obj3d *obj, int weighting, u_int threads) {
+  double best = 0.0;
+
+  for (int i = 0; i < REPEATS; i++) {
+    double start = bench_now_ms();
+    compute_vertex_normals(obj, weighting, threads);
+    double elapsed = bench_now_ms() - start;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  return best;
+}
+
+int main(void) {
+  const char *names[] = {"area", "angle"};
+  u_int threads[] = {1, 2, 4, 0};
+
+  if (!bench_write_grid_obj(BENCH_GRID_PATH, GRID_SIDE, GRID_SIDE)) return 1;
+  obj3d *obj = parse_obj_file(BENCH_GRID_PATH);
+  remove(BENCH_GRID_PATH);
+  if (!obj) return 1;
+
+  printf("vertex normals: %u vertexes, %u faces, best of %d\n",
+         obj->vertexes_count, obj->faces_count, REPEATS);
+  for (int w = NORMALS_AREA_WEIGHTED; w <= NORMALS_ANGLE_WEIGHTED; w++) {
+    for (u_int t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+      double ms = time_normals(obj, w, threads[t]);
+      printf("%-6s threads=%-3u %9.2f ms %8.2f Mfaces/s\n", names[w],
+             get_threads_count(threads[t]), ms, obj->faces_count / ms / 1e3);
+    }
+  }
+  obj_destroy(obj);
+
+  return 0;
+}
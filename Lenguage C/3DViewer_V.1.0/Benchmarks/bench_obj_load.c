@@ -0,0 +1,93 @@
+#include "bench_common.h"
+
+#define DEFAULT_VERTEXES 1000000ULL
+
+/**
+ * @brief timings of one file, every phase is measured on its own
+ */
+typedef struct {
+  double parse_ms;   ///< parse_obj_file, bounds are updated while parsing
+  double bounds_ms;  ///< scaleObjBeforeDraw: center and rescale by bounds
+  double edges_ms;   ///< collect_unique_edges
+  u_int vertexes;
+  u_int faces;
+  u_int edges;
+  load_stats_t stats;  ///< phases inside parse_obj_file
+} load_result_t;
+
+static int run_phases(const char *path, load_result_t *result) {
+  double start = bench_now_ms();
+  obj3d *obj = NULL;
+  u_int *edges = NULL;
+
+  load_stats_attach(&result->stats);
+  obj = parse_obj_file(path);
+  load_stats_attach(NULL);
+  result->parse_ms = bench_now_ms() - start;
+  if (!obj) return FALSE;
+  result->vertexes = obj->vertexes_count;
+  result->faces = obj->faces_count;
+
+  start = bench_now_ms();
+  scaleObjBeforeDraw(0.5f, obj);
+  result->bounds_ms = bench_now_ms() - start;
+
+  start = bench_now_ms();
+  result->edges = collect_unique_edges(obj, &edges);
+  result->edges_ms = bench_now_ms() - start;
+  free(edges);
+  obj_destroy(obj);
+
+  return TRUE;
+}
+
+// вывод в JSON Lines, одна строка на файл, чтобы сравнивать коммиты
+static void print_result(unsigned long long target, int format,
+                         long long bytes, const load_result_t *r) {
+  printf("{\"bench\":\"obj_load\",\"target_vertexes\":%llu,\"format\":\"%s\"",
+         target, bench_format_name(format));
+  printf(",\"bytes\":%lld,\"vertexes\":%u,\"faces\":%u,\"edges\":%u", bytes,
+         r->vertexes, r->faces, r->edges);
+  printf(",\"parse_ms\":%.3f,\"bounds_ms\":%.3f,\"edges_ms\":%.3f",
+         r->parse_ms, r->bounds_ms, r->edges_ms);
+  printf(",\"read_ms\":%.3f,\"tokenize_ms\":%.3f,\"realloc_ms\":%.3f",
+         r->stats.read_ms, r->stats.parse_ms, r->stats.realloc_ms);
+  printf(",\"reallocs\":%u,\"peak_heap_bytes\":%lld,\"obj_bytes\":%llu",
+         r->stats.realloc_count, r->stats.peak_heap_bytes, r->stats.obj_bytes);
+  printf(",\"parse_mb_per_s\":%.2f}\n",
+         r->parse_ms > 0.0 ? (double)bytes / 1e3 / r->parse_ms : 0.0);
+}
+
+// usage: ./bench_obj_load [vertexes...], for example 1000000 10000000
+int main(int argc, char **argv) {
+  int failed = 0;
+
+  for (int a = 1; a < argc || a == 1; a++) {
+    unsigned long long target =
+        a < argc ? strtoull(argv[a], NULL, 10) : DEFAULT_VERTEXES;
+    u_int side = (u_int)sqrt((double)target);
+    u_int reference_edges = 0;
+
+    if (side < 2) side = 2;
+    for (int format = 0; format < BENCH_OBJ_FORMATS; format++) {
+      load_result_t result = {0};
+      if (!bench_write_mesh_obj(BENCH_GRID_PATH, side - 1, side - 1,
+                                format) ||
+          !run_phases(BENCH_GRID_PATH, &result)) {
+        failed = 1;
+        continue;
+      }
+      print_result(target, format, bench_file_size(BENCH_GRID_PATH), &result);
+      // все форматы описывают одну и ту же сетку
+      if (format == BENCH_OBJ_PLAIN) reference_edges = result.edges;
+      if (result.edges != reference_edges) {
+        fprintf(stderr, "bench_obj_load: %s gives %u edges instead of %u\n",
+                bench_format_name(format), result.edges, reference_edges);
+        failed = 1;
+      }
+    }
+    remove(BENCH_GRID_PATH);
+  }
+
+  return failed;
+}
@@ -0,0 +1,60 @@
+#include "bench_common.h"
+
+#define GRID_SIDE 708U  // 2 * 708 * 708 ~ 1M triangles
+#define REPEATS 5
+#define WRITE_PATH "/tmp/s21_bench_write.obj"
+
+static double time_parse(void) {
+  double best = 0.0;
+
+  for (int i = 0; i < REPEATS; i++) {
+    double start = bench_now_ms();
+    obj3d *obj = parse_obj_file(WRITE_PATH);
+    double elapsed = bench_now_ms() - start;
+    if (obj) obj_destroy(obj);
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  return best;
+}
+
+static double time_write(const obj3d *obj, u_int threads) {
+  double best = 0.0;
+
+  for (int i = 0; i < REPEATS; i++) {
+    double start = bench_now_ms();
+    write_obj_file(obj, WRITE_PATH, threads);
+    double elapsed = bench_now_ms() - start;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  return best;
+}
+
+int main(void) {
+  u_int threads[] = {1, 2, 4, 0};
+
+  if (!bench_write_grid_obj(BENCH_GRID_PATH, GRID_SIDE, GRID_SIDE)) return 1;
+  obj3d *obj = parse_obj_file(BENCH_GRID_PATH);
+  remove(BENCH_GRID_PATH);
+  if (!obj) return 1;
+  rotate_object(0.5f, obj, Y_CORD);
+
+  // читается тот же файл, который пишется, чтобы сравнивать одинаковые байты
+  write_obj_file(obj, WRITE_PATH, 1);
+  double mb = (double)bench_file_size(WRITE_PATH) / (1024.0 * 1024.0);
+  double parse_ms = time_parse();
+  printf("obj export: %u vertexes, %u faces, %.1f MB, best of %d\n",
+         obj->vertexes_count, obj->faces_count, mb, REPEATS);
+  printf("%-18s %9.2f ms %8.1f MB/s\n", "parse_obj_file", parse_ms,
+         mb / parse_ms * 1e3);
+  for (u_int t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+    double ms = time_write(obj, threads[t]);
+    printf("write threads=%-4u %9.2f ms %8.1f MB/s\n",
+           get_threads_count(threads[t]), ms, mb / ms * 1e3);
+  }
+  remove(WRITE_PATH);
+  obj_destroy(obj);
+
+  return 0;
+}
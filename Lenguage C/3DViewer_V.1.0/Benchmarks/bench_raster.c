@@ -0,0 +1,59 @@
+#include "bench_common.h"
+
+#define GRID_SIDE 708U  // 2 * 708 * 708 ~ 1M triangles
+#define FB_WIDTH 1280U
+#define FB_HEIGHT 720U
+#define REPEATS 3
+
+static double time_render(obj3d *obj, render_options_t *options,
+                          framebuffer_t *fb) {
+  float model[4][4], view[4][4], proj[4][4];
+  double best = 0.0;
+
+  matrix4_rotation(-1.0f, X_CORD, model);
+  matrix4_translation(0.0f, 0.0f, -1.5f, view);
+  matrix4_perspective(0.8f, (float)FB_WIDTH / FB_HEIGHT, 0.1f, 100.0f, proj);
+  for (int i = 0; i < REPEATS; i++) {
+    double start = bench_now_ms();
+    render_obj(obj, model, view, proj, options, fb);
+    double elapsed = bench_now_ms() - start;
+    if (i == 0 || elapsed < best) best = elapsed;
+  }
+
+  return best;
+}
+
+int main(void) {
+  const char *names[] = {"", "wireframe", "flat", "flat+wireframe"};
+  u_int threads[] = {1, 2, 4, 0};
+  render_options_t options;
+  u_int *edges = NULL;
+
+  if (!bench_write_grid_obj(BENCH_GRID_PATH, GRID_SIDE, GRID_SIDE)) return 1;
+  obj3d *obj = parse_obj_file(BENCH_GRID_PATH);
+  remove(BENCH_GRID_PATH);
+  framebuffer_t *fb = framebuffer_create(FB_WIDTH, FB_HEIGHT);
+  if (!obj || !fb) return 1;
+
+  scaleObjBeforeDraw(0.5f, obj);
+  render_options_default(&options);
+  options.edges_count = collect_unique_edges(obj, &edges);
+  options.edges = edges;
+  printf("software raster: %u faces, %u edges, %ux%u, best of %d\n",
+         obj->faces_count, options.edges_count, FB_WIDTH, FB_HEIGHT, REPEATS);
+  for (int mode = RENDER_WIREFRAME; mode <= (RENDER_WIREFRAME | RENDER_FLAT);
+       mode++) {
+    options.mode = mode;
+    for (u_int t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+      options.threads = threads[t];
+      double ms = time_render(obj, &options, fb);
+      printf("%-15s threads=%-3u %9.2f ms %8.2f fps\n", names[mode],
+             get_threads_count(threads[t]), ms, 1e3 / ms);
+    }
+  }
+  free(edges);
+  framebuffer_destroy(fb);
+  obj_destroy(obj);
+
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include "tests.h"
+
+#define FB_SIDE 96U
+
+// куб с гранями против часовой стрелки, если смотреть снаружи:
+// +z, -z, +x, -x, +y, -y
+static const float CUBE[8][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1},
+                                 {-1, 1, -1},  {-1, -1, 1}, {1, -1, 1},
+                                 {1, 1, 1},    {-1, 1, 1}};
+static const u_int CUBE_FACES[6][4] = {{5, 6, 7, 8}, {1, 4, 3, 2},
+                                       {2, 3, 7, 6}, {1, 5, 8, 4},
+                                       {4, 8, 7, 3}, {1, 2, 6, 5}};
+
+static obj3d *make_cube(void) {
+  obj3d *obj = obj_create();
+
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_int_eq(obj_reserve(obj, 8, 6, 24), TRUE);
+  memcpy(obj->vertexes, CUBE, sizeof(CUBE));
+  memcpy(obj->polygons.vertexes_ind, CUBE_FACES, sizeof(CUBE_FACES));
+  for (u_int f = 0; f < 6; f++) obj->polygons.indeces_count[f] = 4;
+
+  return obj;
+}
+
+static void orthographic(float m[4][4]) {
+  memset(m, 0, 16 * sizeof(float));
+  m[0][0] = 0.5f;
+  m[1][1] = 0.5f;
+  m[2][2] = -0.02f;
+  m[2][3] = -1.0f;
+  m[3][3] = 1.0f;
+}
+
+static void check_faces(const face_cull_t *cull, const u_int *expected,
+                        u_int count) {
+  ck_assert_uint_eq(cull->faces_count, count);
+  ck_assert_uint_eq(cull->total_indexes, count * 4);
+  for (u_int i = 0; i < count; i++) {
+    ck_assert_uint_eq(cull->faces[i], expected[i]);
+    ck_assert_uint_eq(cull->polygons.indeces_count[i], 4);
+    ck_assert_int_eq(memcmp(cull->polygons.vertexes_ind + i * 4,
+                            CUBE_FACES[expected[i]], 4 * sizeof(u_int)),
+                     0);
+  }
+}
+
+START_TEST(cull_cube_back_faces) {
+  obj3d *cube = make_cube();
+  face_cull_t *cull = face_cull_create();
+  float model[4][4], view[4][4], proj[4][4];
+  const u_int front[] = {0}, turned[] = {0, 3};
+
+  matrix4_identity(model);
+  matrix4_translation(0.0f, 0.0f, -5.0f, view);
+  matrix4_perspective(0.8f, 1.0f, 0.1f, 100.0f, proj);
+  ck_assert_int_eq(
+      cull_faces(cull, cube, model, view, proj, CULL_BACK_FACES, 1), TRUE);
+  check_faces(cull, front, 1);
+  // после поворота на камеру смотрит и грань -x
+  matrix4_rotation(0.5f, Y_CORD, model);
+  ck_assert_int_eq(cull_faces(cull, cube, model, view, proj,
+                              CULL_BACK_FACES | CULL_FRUSTUM, 2),
+                   TRUE);
+  check_faces(cull, turned, 2);
+  // ортогональная камера бесконечно далеко по +z
+  matrix4_identity(model);
+  orthographic(proj);
+  ck_assert_int_eq(
+      cull_faces(cull, cube, model, view, proj, CULL_BACK_FACES, 1), TRUE);
+  check_faces(cull, front, 1);
+  face_cull_destroy(cull);
+  obj_destroy(cube);
+}
+END_TEST
+
+START_TEST(cull_cube_frustum) {
+  obj3d *cube = make_cube();
+  face_cull_t *cull = face_cull_create();
+  float model[4][4], view[4][4], proj[4][4];
+  const u_int all[] = {0, 1, 2, 3, 4, 5};
+
+  matrix4_identity(model);
+  matrix4_translation(0.0f, 0.0f, -5.0f, view);
+  matrix4_perspective(0.8f, 1.0f, 0.1f, 100.0f, proj);
+  ck_assert_int_eq(cull_faces(cull, cube, model, view, proj, 0, 1), TRUE);
+  check_faces(cull, all, 6);
+  ck_assert_int_eq(
+      cull_faces(cull, cube, model, view, proj, CULL_FRUSTUM, 1), TRUE);
+  check_faces(cull, all, 6);
+  // куб далеко сбоку: он целиком вне пирамиды видимости
+  matrix4_translation(100.0f, 0.0f, -5.0f, view);
+  ck_assert_int_eq(
+      cull_faces(cull, cube, model, view, proj, CULL_FRUSTUM, 1), TRUE);
+  ck_assert_uint_eq(cull->faces_count, 0);
+  ck_assert_uint_eq(cull->total_indexes, 0);
+  ck_assert_int_eq(cull_faces(NULL, cube, model, view, proj, 0, 1), FALSE);
+  face_cull_destroy(cull);
+  obj_destroy(cube);
+}
+END_TEST
+
+START_TEST(cull_same_for_any_threads) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  face_cull_t *one = face_cull_create(), *many = face_cull_create();
+  float model[4][4], view[4][4], proj[4][4];
+  int mode = CULL_BACK_FACES | CULL_FRUSTUM;
+
+  scaleObjBeforeDraw(0.8f, obj);
+  matrix4_rotation(0.7f, Y_CORD, model);
+  matrix4_translation(0.3f, 0.0f, -2.0f, view);
+  matrix4_perspective(0.6f, 1.0f, 0.1f, 100.0f, proj);
+  ck_assert_int_eq(cull_faces(one, obj, model, view, proj, mode, 1), TRUE);
+  ck_assert_int_eq(cull_faces(many, obj, model, view, proj, mode, 3), TRUE);
+  ck_assert_uint_gt(one->faces_count, 0);
+  ck_assert_uint_lt(one->faces_count, obj->faces_count);
+  ck_assert_uint_eq(one->faces_count, many->faces_count);
+  ck_assert_uint_eq(one->total_indexes, many->total_indexes);
+  ck_assert_int_eq(
+      memcmp(one->faces, many->faces, one->faces_count * sizeof(u_int)), 0);
+  ck_assert_int_eq(memcmp(one->polygons.vertexes_ind,
+                          many->polygons.vertexes_ind,
+                          one->total_indexes * sizeof(u_int)),
+                   0);
+  for (u_int i = 1; i < one->faces_count; i++) {
+    ck_assert_uint_lt(one->faces[i - 1], one->faces[i]);
+  }
+
+  // вершины изменились - плоскости пересчитываются явно
+  rotate_object(3.14159265f, obj, Y_CORD);
+  ck_assert_int_eq(face_cull_update(many, obj, 2), TRUE);
+  ck_assert_int_eq(cull_faces(many, obj, model, view, proj, mode, 2), TRUE);
+  ck_assert_int_ne(memcmp(one->faces, many->faces,
+                          one->faces_count * sizeof(u_int)),
+                   0);
+  face_cull_destroy(one);
+  face_cull_destroy(many);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(render_with_face_cull) {
+  obj3d *cube = make_cube();
+  framebuffer_t *all = framebuffer_create(FB_SIDE, FB_SIDE);
+  framebuffer_t *culled = framebuffer_create(FB_SIDE, FB_SIDE);
+  float model[4][4], view[4][4], proj[4][4];
+  render_options_t options;
+
+  matrix4_rotation(0.5f, Y_CORD, model);
+  matrix4_translation(0.0f, 0.0f, -5.0f, view);
+  matrix4_perspective(0.8f, 1.0f, 0.1f, 100.0f, proj);
+  render_options_default(&options);
+  options.mode = RENDER_FLAT;
+  ck_assert_int_eq(render_obj(cube, model, view, proj, &options, all), TRUE);
+  options.face_cull = face_cull_create();
+  ck_assert_int_eq(render_obj(cube, model, view, proj, &options, culled),
+                   TRUE);
+  // задние грани замкнутого куба и так закрыты передними
+  ck_assert_int_eq(memcmp(all->pixels, culled->pixels, FB_SIDE * FB_SIDE * 4),
+                   0);
+  ck_assert_uint_eq(options.face_cull->faces_count, 2);
+  face_cull_destroy(options.face_cull);
+  framebuffer_destroy(all);
+  framebuffer_destroy(culled);
+  obj_destroy(cube);
+}
+END_TEST
+
+Suite *test_face_cull(void) {
+  Suite *s = suite_create("\033[45m-=S21_FACE_CULL=-\033[0m");
+  TCase *tc = tcase_create("test_face_cull_tc");
+
+  tcase_add_test(tc, cull_cube_back_faces);
+  tcase_add_test(tc, cull_cube_frustum);
+  tcase_add_test(tc, cull_same_for_any_threads);
+  tcase_add_test(tc, render_with_face_cull);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
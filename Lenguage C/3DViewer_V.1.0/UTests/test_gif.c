@@ -0,0 +1,188 @@
+#include "tests.h"
+
+#define GIF_SIDE 48U
+#define GIF_FRAMES 6U
+#define GIF_PATH "test_record.gif"
+#define GIF_TOLERANCE 8  ///< cell of 5-bit color histogram of the quantizer
+
+static u_int count_gif_images(const unsigned char *data, long size) {
+  u_int images = 0;
+  // заголовок 13 байт без глобальной палитры, дальше блоки
+  long pos = 13;
+  while (pos < size && data[pos] != 0x3B) {
+    if (data[pos] == 0x21) {
+      pos += 2;
+    } else if (data[pos] == 0x2C) {
+      images++;
+      pos += 10 + 768 + 1;
+    } else {
+      return 0;
+    }
+    while (pos < size && data[pos]) pos += data[pos] + 1;
+    pos++;
+  }
+  return pos < size ? images : 0;
+}
+
+// позиция дескриптора кадра number или -1
+static long find_gif_image(const unsigned char *data, long size,
+                           u_int number) {
+  long pos = 13;
+  while (pos < size && data[pos] != 0x3B) {
+    if (data[pos] == 0x2C && number-- == 0) return pos;
+    pos += data[pos] == 0x21 ? 2 : 10 + 768 + 1;
+    while (pos < size && data[pos]) pos += data[pos] + 1;
+    pos++;
+  }
+  return -1;
+}
+
+/**
+ * @brief decode LZW data of the image at pos into indexes, independent of
+ * the encoder in s21_gif.c
+ *
+ * @return[out] count of decoded indexes
+ */
+static u_int decode_gif_image(const unsigned char *data, long size, long pos,
+                              unsigned char *indexed, u_int pixels) {
+  static u_int prefix[4096];
+  static unsigned char suffix[4096], stack[4097];
+  unsigned char *codes = (unsigned char *)malloc((size_t)size);
+  long length = 0, bit = 0;
+  u_int count = 0, min_code_size = 0;
+
+  pos += 10 + 768;
+  min_code_size = data[pos++];
+  for (; pos < size && data[pos]; pos += data[pos] + 1) {
+    memcpy(codes + length, data + pos + 1, data[pos]);
+    length += data[pos];
+  }
+  const u_int clear = 1U << min_code_size, eoi = clear + 1;
+  u_int code_size = min_code_size + 1, next = eoi + 1;
+  u_int old = 4096, first = 0;
+  while (bit + (long)code_size <= length * 8) {
+    u_int code = 0;
+    for (u_int i = 0; i < code_size; i++, bit++) {
+      code |= (u_int)((codes[bit >> 3] >> (bit & 7)) & 1) << i;
+    }
+    if (code == eoi) break;
+    if (code == clear) {
+      code_size = min_code_size + 1;
+      next = eoi + 1;
+      old = 4096;
+      continue;
+    }
+    u_int in = code, depth = 0;
+    if (old == 4096) {
+      first = code;
+    } else {
+      if (code >= next) {
+        stack[depth++] = (unsigned char)first;
+        code = old;
+      }
+      while (code > eoi) {
+        stack[depth++] = suffix[code];
+        code = prefix[code];
+      }
+      first = code;
+    }
+    stack[depth++] = (unsigned char)first;
+    while (depth && count < pixels) indexed[count++] = stack[--depth];
+    if (old != 4096 && next < 4096) {
+      prefix[next] = old;
+      suffix[next] = (unsigned char)first;
+      if (++next == (1U << code_size) && code_size < 12) code_size++;
+    }
+    old = in;
+  }
+  free(codes);
+  return count;
+}
+
+START_TEST(gif_record_turntable) {
+  obj3d *obj = parse_obj_file("data-samples/cube.obj");
+  framebuffer_t *fb = framebuffer_create(GIF_SIDE, GIF_SIDE);
+  float model[4][4], view[4][4], proj[4][4];
+  render_options_t options;
+  render_options_default(&options);
+  matrix4_translation(0.0f, 0.0f, -3.0f, view);
+  matrix4_perspective(0.8f, 1.0f, 0.1f, 100.0f, proj);
+
+  const u_int pixels = GIF_SIDE * GIF_SIDE;
+  unsigned char *frames = (unsigned char *)malloc(GIF_FRAMES * pixels * 4);
+  gif_recorder_t *rec =
+      gif_recorder_start(GIF_PATH, GIF_SIDE, GIF_SIDE, 4, 2 * GIF_FRAMES, 2);
+  ck_assert_ptr_nonnull(rec);
+  for (u_int i = 0; i < GIF_FRAMES; i++) {
+    matrix4_rotation(0.3f * (float)i, Y_CORD, model);
+    render_obj(obj, model, view, proj, &options, fb);
+    memcpy(frames + i * pixels * 4, fb->pixels, pixels * 4);
+    ck_assert_int_eq(gif_recorder_push(rec, fb->pixels), TRUE);
+  }
+  ck_assert_int_eq(gif_recorder_finish(rec), TRUE);
+
+  FILE *file = fopen(GIF_PATH, "rb");
+  ck_assert_ptr_nonnull(file);
+  unsigned char *data = (unsigned char *)malloc(1 << 20);
+  long size = (long)fread(data, 1, 1 << 20, file);
+  fclose(file);
+  remove(GIF_PATH);
+  ck_assert_int_eq(memcmp(data, "GIF89a", 6), 0);
+  ck_assert_uint_eq(data[size - 1], 0x3B);
+  ck_assert_uint_eq(count_gif_images(data, size), GIF_FRAMES);
+  // кадры раскодируются обратно и сравниваются с исходными пикселями
+  unsigned char *indexed = (unsigned char *)malloc(pixels);
+  for (u_int i = 0; i < GIF_FRAMES; i++) {
+    long pos = find_gif_image(data, size, i);
+    ck_assert_int_gt(pos, 0);
+    ck_assert_uint_eq(decode_gif_image(data, size, pos, indexed, pixels),
+                      pixels);
+    const unsigned char *palette = data + pos + 10;
+    const unsigned char *rgba = frames + i * pixels * 4;
+    for (u_int p = 0; p < pixels; p++) {
+      for (u_int c = 0; c < 3; c++) {
+        int diff = palette[3 * indexed[p] + c] - rgba[4 * p + c];
+        ck_assert_int_le(abs(diff), GIF_TOLERANCE);
+      }
+    }
+  }
+  free(indexed);
+  free(frames);
+  free(data);
+  framebuffer_destroy(fb);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(gif_push_drops_when_full) {
+  unsigned char frame[4 * 4 * 4] = {0};
+  gif_recorder_t *rec = gif_recorder_start(GIF_PATH, 4, 4, 2, 2, 1);
+  u_int dropped = 0, accepted = 0;
+  ck_assert_ptr_nonnull(rec);
+  for (u_int i = 0; i < 200; i++) accepted += gif_recorder_push(rec, frame);
+  gif_recorder_stats(rec, NULL, &dropped);
+  ck_assert_uint_eq(accepted + dropped, 200);
+  ck_assert_int_eq(gif_recorder_finish(rec), TRUE);
+  remove(GIF_PATH);
+}
+END_TEST
+
+START_TEST(gif_bad_arguments) {
+  ck_assert_ptr_null(gif_recorder_start(GIF_PATH, 0, 10, 2, 4, 1));
+  ck_assert_ptr_null(gif_recorder_start("no_such_dir/x.gif", 10, 10, 2, 4, 1));
+  ck_assert_int_eq(gif_recorder_push(NULL, NULL), FALSE);
+  ck_assert_int_eq(gif_recorder_finish(NULL), FALSE);
+}
+END_TEST
+
+Suite *test_gif(void) {
+  Suite *s = suite_create("\033[45m-=S21_GIF=-\033[0m");
+  TCase *tc = tcase_create("test_gif_tc");
+
+  tcase_add_test(tc, gif_record_turntable);
+  tcase_add_test(tc, gif_push_drops_when_full);
+  tcase_add_test(tc, gif_bad_arguments);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,224 @@
+#define _GNU_SOURCE
+#include "tests.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+typedef struct {
+  unsigned long long last_read;
+  unsigned long long total;
+  u_int calls;
+  u_int cancel_after;
+} progress_log_t;
+
+static int log_progress(void *user, unsigned long long bytes_read,
+                        unsigned long long bytes_total) {
+  progress_log_t *log = (progress_log_t *)user;
+
+  ck_assert_uint_ge(bytes_read, log->last_read);
+  log->last_read = bytes_read;
+  log->total = bytes_total;
+  log->calls++;
+
+  return log->calls != log->cancel_after;
+}
+
+static int wait_loader(obj_loader_t *loader) {
+  struct timespec pause = {0, 1000000L};
+  int state = LOAD_RUNNING;
+
+  while ((state = obj_loader_poll(loader, NULL, NULL)) == LOAD_RUNNING) {
+    nanosleep(&pause, NULL);
+  }
+
+  return state;
+}
+
+START_TEST(loader_progress_reaches_file_size) {
+  progress_log_t log = {0, 0, 0, 0};
+  obj3d *obj = parse_obj_file_progress("data-samples/deer.obj", log_progress,
+                                       &log);
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_uint_gt(log.calls, 1);
+  ck_assert_uint_eq(log.last_read, log.total);
+  ck_assert_uint_eq(obj->vertexes_count, 772);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(loader_progress_cancels) {
+  progress_log_t log = {0, 0, 0, 1};
+  obj3d *obj = parse_obj_file_progress("data-samples/deer.obj", log_progress,
+                                       &log);
+  ck_assert_ptr_null(obj);
+  ck_assert_uint_eq(log.calls, 1);
+}
+END_TEST
+
+START_TEST(loader_async_same_as_sync) {
+  obj3d *sync = parse_obj_file("data-samples/deer.obj");
+  u_int sync_edges = get_count_edges(sync);
+  obj_loader_t *loader = obj_loader_start("data-samples/deer.obj");
+  u_int edges = 0;
+  unsigned long long read = 0, total = 0;
+
+  ck_assert_ptr_nonnull(loader);
+  ck_assert_int_eq(wait_loader(loader), LOAD_DONE);
+  obj_loader_poll(loader, &read, &total);
+  ck_assert_uint_eq(read, total);
+  obj3d *obj = obj_loader_take(loader, &edges);
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_ptr_null(obj_loader_take(loader, NULL));
+  ck_assert_uint_eq(obj->vertexes_count, sync->vertexes_count);
+  ck_assert_uint_eq(obj->total_indexes, sync->total_indexes);
+  ck_assert_uint_eq(edges, sync_edges);
+  obj_loader_destroy(loader);
+  obj_destroy(obj);
+  obj_destroy(sync);
+}
+END_TEST
+
+START_TEST(loader_async_errors) {
+  obj_loader_t *loader = obj_loader_start("data-samples/no_such_file.obj");
+  ck_assert_ptr_nonnull(loader);
+  ck_assert_int_eq(wait_loader(loader), LOAD_FAILED);
+  ck_assert_ptr_null(obj_loader_take(loader, NULL));
+  obj_loader_destroy(loader);
+  // объект, который никто не забрал, освобождается вместе с загрузчиком
+  loader = obj_loader_start("data-samples/cube.obj");
+  obj_loader_destroy(loader);
+  ck_assert_ptr_null(obj_loader_start(NULL));
+  ck_assert_int_eq(obj_loader_poll(NULL, NULL, NULL), LOAD_FAILED);
+}
+END_TEST
+
+START_TEST(loader_stats_track_phases) {
+  load_stats_t stats;
+  load_stats_attach(&stats);
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  u_int edges = get_count_edges(obj);
+
+  ck_assert_uint_eq(edges, 2271);
+  ck_assert_uint_eq(stats.bytes_read, 161057);
+  ck_assert_uint_gt(stats.realloc_count, 0);
+  ck_assert(stats.parse_ms > 0.0 && stats.edges_ms > 0.0);
+  ck_assert(stats.total_ms >= stats.read_ms + stats.parse_ms);
+  ck_assert_uint_eq(stats.obj_bytes, obj_footprint(obj));
+  ck_assert_int_gt(stats.peak_heap_bytes, (long long)stats.obj_bytes);
+  // вся память загрузки возвращается после удаления объекта
+  obj_destroy(obj);
+  ck_assert_int_eq(stats.heap_bytes, 0);
+  load_stats_attach(NULL);
+  ck_assert_uint_eq(obj_footprint(NULL), 0);
+}
+END_TEST
+
+START_TEST(loader_async_stats) {
+  obj_loader_t *loader = obj_loader_start("data-samples/cube.obj");
+  load_stats_t stats;
+
+  wait_loader(loader);
+  ck_assert_int_eq(obj_loader_stats(loader, &stats), TRUE);
+  ck_assert_uint_eq(stats.bytes_read, 425);
+  ck_assert_uint_gt(stats.obj_bytes, 0);
+  ck_assert_int_eq(obj_loader_stats(NULL, &stats), FALSE);
+  obj_loader_destroy(loader);
+}
+END_TEST
+
+typedef struct {
+  u_int order[8];
+  int states[8];
+  atomic_uint calls;
+} done_log_t;
+
+static void log_done(void *user, u_int index, int state) {
+  done_log_t *log = (done_log_t *)user;
+  u_int call = atomic_fetch_add(&log->calls, 1);
+
+  log->order[call] = index;
+  log->states[index] = state;
+}
+
+static void wait_multi_loader(obj_multi_loader_t *loader, u_int count) {
+  struct timespec pause = {0, 1000000L};
+
+  while (obj_multi_loader_poll(loader) < count) nanosleep(&pause, NULL);
+}
+
+START_TEST(multi_loader_largest_first) {
+  const char *paths[] = {"data-samples/cube.obj", "data-samples/deer.obj",
+                         "data-samples/no_such_file.obj",
+                         "data-samples/deer.obj"};
+  done_log_t log = {{0}, {0}, 0};
+  obj_multi_loader_t *loader =
+      obj_multi_loader_start(paths, 4, 1, log_done, &log);
+  u_int edges = 0;
+
+  ck_assert_ptr_nonnull(loader);
+  wait_multi_loader(loader, 4);
+  // один поток берет файлы строго по убыванию размера
+  ck_assert_uint_eq(atomic_load(&log.calls), 4);
+  ck_assert_uint_eq(log.order[0], 1);
+  ck_assert_uint_eq(log.order[1], 3);
+  ck_assert_uint_eq(log.order[2], 0);
+  ck_assert_uint_eq(log.order[3], 2);
+  ck_assert_int_eq(log.states[2], LOAD_FAILED);
+  ck_assert_int_eq(obj_multi_loader_state(loader, 2), LOAD_FAILED);
+  ck_assert_int_eq(obj_multi_loader_state(loader, 0), LOAD_DONE);
+  obj3d *deer = obj_multi_loader_take(loader, 3, &edges);
+  ck_assert_ptr_nonnull(deer);
+  ck_assert_ptr_null(obj_multi_loader_take(loader, 3, NULL));
+  ck_assert_uint_eq(deer->vertexes_count, 772);
+  ck_assert_uint_eq(edges, 2271);
+  // не забранные объекты освобождаются вместе с загрузчиком
+  obj_multi_loader_destroy(loader);
+  obj_destroy(deer);
+}
+END_TEST
+
+START_TEST(multi_loader_threads_and_cancel) {
+  const char *paths[8];
+  for (u_int i = 0; i < 8; i++) {
+    paths[i] = i % 2 ? "data-samples/deer.obj" : "data-samples/cube.obj";
+  }
+  obj_multi_loader_t *loader = obj_multi_loader_start(paths, 8, 4, NULL, NULL);
+
+  ck_assert_ptr_nonnull(loader);
+  wait_multi_loader(loader, 8);
+  for (u_int i = 0; i < 8; i++) {
+    obj3d *obj = obj_multi_loader_take(loader, i, NULL);
+    ck_assert_ptr_nonnull(obj);
+    ck_assert_uint_eq(obj->vertexes_count, i % 2 ? 772 : 8);
+    obj_destroy(obj);
+  }
+  obj_multi_loader_destroy(loader);
+
+  // после отмены каждый файл все равно получает итоговое состояние
+  done_log_t log = {{0}, {0}, 0};
+  loader = obj_multi_loader_start(paths, 8, 2, log_done, &log);
+  obj_multi_loader_cancel(loader);
+  wait_multi_loader(loader, 8);
+  ck_assert_uint_eq(atomic_load(&log.calls), 8);
+  obj_multi_loader_destroy(loader);
+  ck_assert_ptr_null(obj_multi_loader_start(NULL, 1, 1, NULL, NULL));
+  ck_assert_int_eq(obj_multi_loader_state(NULL, 0), LOAD_FAILED);
+}
+END_TEST
+
+Suite *test_loader(void) {
+  Suite *s = suite_create("\033[45m-=S21_LOADER=-\033[0m");
+  TCase *tc = tcase_create("test_loader_tc");
+
+  tcase_add_test(tc, loader_progress_reaches_file_size);
+  tcase_add_test(tc, loader_progress_cancels);
+  tcase_add_test(tc, loader_async_same_as_sync);
+  tcase_add_test(tc, loader_async_errors);
+  tcase_add_test(tc, loader_stats_track_phases);
+  tcase_add_test(tc, loader_async_stats);
+  tcase_add_test(tc, multi_loader_largest_first);
+  tcase_add_test(tc, multi_loader_threads_and_cancel);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,277 @@
+#define _GNU_SOURCE
+#include <unistd.h>
+
+#include "tests.h"
+
+#define STL_PATH "data-samples/mesh.stl"
+#define PLY_PATH "data-samples/mesh.ply"
+
+static const float TETRA[4][AX_DIMEN] = {
+    {0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {0, 0, -1.5f}};
+// последний треугольник выродится после слияния вершин
+static const u_int TETRA_FACES[5][3] = {
+    {0, 1, 2}, {0, 3, 1}, {0, 2, 3}, {1, 3, 2}, {1, 1, 2}};
+
+static void write_bytes(const char *path, const void *data, size_t size) {
+  FILE *file = fopen(path, "wb");
+
+  ck_assert_ptr_nonnull(file);
+  ck_assert_uint_eq(fwrite(data, 1, size, file), size);
+  fclose(file);
+}
+
+static void put_u32(unsigned char *p, u_int value) {
+  for (u_int i = 0; i < 4; i++) p[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void put_f32(unsigned char *p, float value) {
+  u_int bits = 0;
+
+  memcpy(&bits, &value, sizeof(bits));
+  put_u32(p, bits);
+}
+
+/**
+ * @brief binary STL from triangles of vertexes given by 0-based indices
+ */
+static void write_binary_stl(const char *path, const float *vertexes,
+                             const u_int *faces, u_int triangles) {
+  size_t size = 84 + 50 * (size_t)triangles;
+  unsigned char *data = (unsigned char *)calloc(size, 1);
+
+  // заголовок "solid" не должен сбивать определение формата
+  memcpy(data, "solid binary", 12);
+  put_u32(data + 80, triangles);
+  for (u_int t = 0; t < triangles; t++) {
+    for (u_int k = 0; k < 3 * AX_DIMEN; k++) {
+      float value = vertexes[faces[t * 3 + k / AX_DIMEN] * AX_DIMEN +
+                             k % AX_DIMEN];
+      put_f32(data + 84 + 50 * t + 12 + 4 * k, value);
+    }
+  }
+  write_bytes(path, data, size);
+  free(data);
+}
+
+static void check_tetra(const obj3d *obj) {
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_uint_eq(obj->vertexes_count, 4);
+  ck_assert_uint_eq(obj->faces_count, 4);
+  ck_assert_uint_eq(obj->total_indexes, 12);
+  for (u_int i = 0; i < obj->total_indexes; i++) {
+    u_int v = obj->polygons.vertexes_ind[i] - 1;
+    ck_assert_uint_lt(v, 4);
+    ck_assert_int_eq(memcmp(obj->vertexes + v * AX_DIMEN,
+                            TETRA[TETRA_FACES[i / 3][i % 3]],
+                            AX_DIMEN * sizeof(float)),
+                     0);
+  }
+  ck_assert_float_eq(obj->bounds.x_max, 1.0f);
+  ck_assert_float_eq(obj->bounds.z_min, -1.5f);
+  ck_assert_float_eq(obj->bounds.z_max, 0.0f);
+}
+
+START_TEST(stl_binary_welds_vertexes) {
+  write_binary_stl(STL_PATH, &TETRA[0][0], &TETRA_FACES[0][0], 5);
+  ck_assert_int_eq(detect_mesh_format(STL_PATH), MESH_STL_BINARY);
+  obj3d *obj = parse_mesh_file(STL_PATH);
+  check_tetra(obj);
+  obj_destroy(obj);
+  remove(STL_PATH);
+}
+END_TEST
+
+START_TEST(stl_binary_deer) {
+  obj3d *deer = parse_obj_file("data-samples/deer.obj");
+  u_int *faces = NULL, triangles = 0, first = 0;
+
+  ck_assert_ptr_nonnull(deer);
+  faces = (u_int *)malloc(deer->total_indexes * 3 * sizeof(u_int));
+  // полигоны режутся веером
+  for (u_int f = 0; f < deer->faces_count; f++) {
+    const u_int *ind = deer->polygons.vertexes_ind + first;
+    for (u_int k = 2; k < deer->polygons.indeces_count[f]; k++) {
+      faces[triangles * 3] = ind[0] - 1;
+      faces[triangles * 3 + 1] = ind[k - 1] - 1;
+      faces[triangles * 3 + 2] = ind[k] - 1;
+      triangles++;
+    }
+    first += deer->polygons.indeces_count[f];
+  }
+  write_binary_stl(STL_PATH, deer->vertexes, faces, triangles);
+  obj3d *obj = parse_mesh_file(STL_PATH);
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_uint_le(obj->vertexes_count, deer->vertexes_count);
+  ck_assert_uint_gt(obj->faces_count, triangles * 9 / 10);
+  ck_assert_uint_eq(obj->total_indexes, obj->faces_count * 3);
+  ck_assert_int_eq(memcmp(&obj->bounds, &deer->bounds, sizeof(axises)), 0);
+  obj_destroy(obj);
+  obj_destroy(deer);
+  free(faces);
+  remove(STL_PATH);
+}
+END_TEST
+
+START_TEST(stl_ascii) {
+  FILE *file = fopen(STL_PATH, "w");
+
+  ck_assert_ptr_nonnull(file);
+  fprintf(file, "solid tetra\n");
+  for (u_int t = 0; t < 5; t++) {
+    fprintf(file, "  facet normal 0 0 0\n    outer loop\n");
+    for (u_int k = 0; k < 3; k++) {
+      const float *v = TETRA[TETRA_FACES[t][k]];
+      fprintf(file, "      vertex %g %g %g\r\n", v[0], v[1], v[2]);
+    }
+    fprintf(file, "    endloop\n  endfacet\n");
+  }
+  fprintf(file, "endsolid tetra");
+  fclose(file);
+  ck_assert_int_eq(detect_mesh_format(STL_PATH), MESH_STL_ASCII);
+  obj3d *obj = parse_mesh_file(STL_PATH);
+  check_tetra(obj);
+  obj_destroy(obj);
+
+  // незаконченный треугольник
+  const char *broken = "solid x\nfacet normal 0 0 1\nvertex 1 2 3\n";
+  write_bytes(STL_PATH, broken, strlen(broken));
+  ck_assert_ptr_null(parse_mesh_file(STL_PATH));
+  remove(STL_PATH);
+}
+END_TEST
+
+START_TEST(ply_ascii_polygons) {
+  const char *text =
+      "ply\r\nformat ascii 1.0\r\ncomment made by hand\r\n"
+      "element vertex 5\r\nproperty float x\r\nproperty float y\r\n"
+      "property uchar red\r\nproperty float z\r\n"
+      "element face 2\r\nproperty list uchar int vertex_indices\r\n"
+      "property int flags\r\n"
+      "element edge 1\r\nproperty int vertex1\r\nproperty int vertex2\r\n"
+      "end_header\r\n"
+      "0 0 255 0\r\n1 0 0 0\r\n1 1 0 0\r\n0 1 7 0\r\n0.5 0.5 1 2e0\r\n"
+      "4 0 1 2 3 9\r\n3 3 2 4 0\r\n0 1\r\n";
+  write_bytes(PLY_PATH, text, strlen(text));
+  ck_assert_int_eq(detect_mesh_format(PLY_PATH), MESH_PLY);
+  obj3d *obj = parse_mesh_file(PLY_PATH);
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_uint_eq(obj->vertexes_count, 5);
+  ck_assert_uint_eq(obj->faces_count, 2);
+  ck_assert_uint_eq(obj->total_indexes, 7);
+  ck_assert_uint_eq(obj->polygons.indeces_count[0], 4);
+  ck_assert_uint_eq(obj->polygons.vertexes_ind[0], 1);
+  ck_assert_uint_eq(obj->polygons.vertexes_ind[6], 5);
+  ck_assert_float_eq(obj->vertexes[4 * AX_DIMEN + 2], 2.0f);
+  ck_assert_float_eq(obj->bounds.z_max, 2.0f);
+  obj_destroy(obj);
+
+  // индекс за пределами вершин
+  const char *broken =
+      "ply\nformat ascii 1.0\nelement vertex 1\nproperty float x\n"
+      "property float y\nproperty float z\nelement face 1\n"
+      "property list uchar uint vertex_index\nend_header\n0 0 0\n3 0 0 1\n";
+  write_bytes(PLY_PATH, broken, strlen(broken));
+  ck_assert_ptr_null(parse_mesh_file(PLY_PATH));
+  remove(PLY_PATH);
+}
+END_TEST
+
+static void check_binary_ply(const char *format, int is_big_endian) {
+  char header[512];
+  unsigned char body[256], *p = body;
+  int header_size = snprintf(
+      header, sizeof(header),
+      "ply\nformat %s 1.0\nelement vertex 4\nproperty double x\n"
+      "property float y\nproperty float z\nproperty list uchar short "
+      "extra\nelement face 4\nproperty list uchar int vertex_indices\n"
+      "end_header\n",
+      format);
+
+  for (u_int v = 0; v < 4; v++) {
+    double x = TETRA[v][0];
+    u_int bits[2] = {0};
+    unsigned char bytes[8];
+    memcpy(bits, &x, sizeof(x));
+    put_u32(bytes, bits[0]);
+    put_u32(bytes + 4, bits[1]);
+    for (u_int i = 0; i < 8; i++) *p++ = bytes[is_big_endian ? 7 - i : i];
+    for (u_int a = 1; a < AX_DIMEN; a++, p += 4) {
+      put_f32(bytes, TETRA[v][a]);
+      for (u_int i = 0; i < 4; i++) p[i] = bytes[is_big_endian ? 3 - i : i];
+    }
+    *p++ = 1;  // один short в списке extra
+    *p++ = 0;
+    *p++ = 0;
+  }
+  for (u_int f = 0; f < 4; f++) {
+    *p++ = 3;
+    for (u_int k = 0; k < 3; k++, p += 4) {
+      unsigned char bytes[4];
+      put_u32(bytes, TETRA_FACES[f][k]);
+      for (u_int i = 0; i < 4; i++) p[i] = bytes[is_big_endian ? 3 - i : i];
+    }
+  }
+  FILE *file = fopen(PLY_PATH, "wb");
+  ck_assert_ptr_nonnull(file);
+  fwrite(header, 1, (size_t)header_size, file);
+  fwrite(body, 1, (size_t)(p - body), file);
+  fclose(file);
+  obj3d *obj = parse_mesh_file(PLY_PATH);
+  check_tetra(obj);
+  obj_destroy(obj);
+
+  // обрезанное тело
+  ck_assert_int_eq(truncate(PLY_PATH, header_size + 20), 0);
+  ck_assert_ptr_null(parse_mesh_file(PLY_PATH));
+  remove(PLY_PATH);
+}
+
+START_TEST(ply_binary) {
+  check_binary_ply("binary_little_endian", FALSE);
+  check_binary_ply("binary_big_endian", TRUE);
+}
+END_TEST
+
+START_TEST(mesh_falls_back_to_obj) {
+  obj3d *expected = parse_obj_file("data-samples/cube.obj");
+  obj3d *obj = parse_mesh_file("data-samples/cube.obj");
+
+  ck_assert_int_eq(detect_mesh_format("data-samples/cube.obj"), MESH_OBJ);
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_uint_eq(obj->vertexes_count, expected->vertexes_count);
+  ck_assert_uint_eq(obj->faces_count, expected->faces_count);
+  obj_destroy(obj);
+  obj_destroy(expected);
+  ck_assert_int_eq(detect_mesh_format("data-samples/missing.stl"), -1);
+  ck_assert_ptr_null(parse_mesh_file("data-samples/missing.stl"));
+  ck_assert_ptr_null(parse_mesh_file(NULL));
+}
+END_TEST
+
+START_TEST(mesh_obj_bad_index) {
+  const char text[] = "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 -9\n";
+  write_bytes("data-samples/bad.obj", text, sizeof(text) - 1);
+  ck_assert_ptr_null(parse_mesh_file("data-samples/bad.obj"));
+  remove("data-samples/bad.obj");
+  // ошибка прошлого файла не влияет на следующий
+  obj3d *obj = parse_mesh_file("data-samples/cube.obj");
+  ck_assert_uint_eq(get_count_edges(obj), 18);
+  obj_destroy(obj);
+}
+END_TEST
+
+Suite *test_mesh_formats(void) {
+  Suite *s = suite_create("\033[45m-=S21_MESH_FORMATS=-\033[0m");
+  TCase *tc = tcase_create("test_mesh_formats_tc");
+
+  tcase_add_test(tc, stl_binary_welds_vertexes);
+  tcase_add_test(tc, stl_binary_deer);
+  tcase_add_test(tc, stl_ascii);
+  tcase_add_test(tc, ply_ascii_polygons);
+  tcase_add_test(tc, ply_binary);
+  tcase_add_test(tc, mesh_falls_back_to_obj);
+  tcase_add_test(tc, mesh_obj_bad_index);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
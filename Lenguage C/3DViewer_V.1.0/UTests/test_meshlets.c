@@ -0,0 +1,275 @@
+#include "tests.h"
+
+#define FB_SIDE 160U
+
+static int compare_triangles(const void *a, const void *b) {
+  const u_int *x = (const u_int *)a, *y = (const u_int *)b;
+  int result = 0;
+
+  for (int i = 0; result == 0 && i < 3; i++) {
+    result = (x[i] > y[i]) - (x[i] < y[i]);
+  }
+
+  return result;
+}
+
+static void camera(float model[4][4], float view[4][4], float proj[4][4]) {
+  matrix4_rotation(0.5f, Y_CORD, model);
+  matrix4_translation(0.0f, 0.0f, -3.0f, view);
+  matrix4_perspective(0.6f, 1.0f, 0.1f, 100.0f, proj);
+}
+
+static const float *meshlet_vertex(const obj3d *obj, const meshlets_t *ms,
+                                   const meshlet_t *m, u_int t, int corner) {
+  u_int local = ms->triangles[(size_t)(m->triangle_offset + t) * 3 + corner];
+
+  return obj->vertexes +
+         (size_t)ms->vertexes[m->vertex_offset + local] * AX_DIMEN;
+}
+
+START_TEST(meshlets_cover_every_triangle) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  meshlets_t *ms = build_meshlets(obj, 0);
+  u_int expected = 0, first = 0, count = 0;
+
+  ck_assert_ptr_nonnull(ms);
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    expected += obj->polygons.indeces_count[f] - 2;
+  }
+  u_int *fan = (u_int *)malloc(expected * 3 * sizeof(u_int));
+  u_int *got = (u_int *)malloc(expected * 3 * sizeof(u_int));
+  for (u_int f = 0; f < obj->faces_count; f++) {
+    const u_int *ind = obj->polygons.vertexes_ind + first;
+    for (u_int k = 1; k + 1 < obj->polygons.indeces_count[f]; k++, count++) {
+      fan[count * 3] = ind[0] - 1;
+      fan[count * 3 + 1] = ind[k] - 1;
+      fan[count * 3 + 2] = ind[k + 1] - 1;
+    }
+    first += obj->polygons.indeces_count[f];
+  }
+  ck_assert_uint_eq(ms->triangles_count, expected);
+  count = 0;
+  for (u_int i = 0; i < ms->count; i++) {
+    const meshlet_t *m = ms->items + i;
+    ck_assert_uint_le(m->vertex_count, MESHLET_MAX_VERTEXES);
+    ck_assert_uint_le(m->triangle_count, MESHLET_MAX_TRIANGLES);
+    ck_assert_uint_gt(m->triangle_count, 0);
+    for (u_int t = 0; t < m->triangle_count; t++, count++) {
+      for (int c = 0; c < 3; c++) {
+        const float *p = meshlet_vertex(obj, ms, m, t, c);
+        float d2 = 0.0f;
+        for (int a = 0; a < AX_DIMEN; a++) {
+          ck_assert_float_ge(p[a], m->aabb_min[a]);
+          ck_assert_float_le(p[a], m->aabb_max[a]);
+          d2 += (p[a] - m->center[a]) * (p[a] - m->center[a]);
+        }
+        ck_assert_float_le(sqrtf(d2), m->radius);
+        got[count * 3 + c] = (u_int)(p - obj->vertexes) / AX_DIMEN;
+      }
+    }
+  }
+  // кластеры в среднем заполнены, а не по треугольнику
+  ck_assert_uint_lt(ms->count, expected / 32);
+  qsort(fan, expected, 3 * sizeof(u_int), compare_triangles);
+  qsort(got, expected, 3 * sizeof(u_int), compare_triangles);
+  ck_assert_int_eq(memcmp(fan, got, expected * 3 * sizeof(u_int)), 0);
+  free(fan);
+  free(got);
+  meshlets_destroy(ms);
+  obj_destroy(obj);
+}
+END_TEST
+
+static int is_outside_one_plane(const meshlet_t *m, const obj3d *obj,
+                                const meshlets_t *ms, float mvp[4][4]) {
+  int is_out = FALSE;
+
+  for (int p = 0; !is_out && p < 6; p++) {
+    is_out = TRUE;
+    for (u_int t = 0; is_out && t < m->triangle_count; t++) {
+      for (int c = 0; is_out && c < 3; c++) {
+        const float *v = meshlet_vertex(obj, ms, m, t, c);
+        float clip[4];
+        for (int i = 0; i < 4; i++) {
+          clip[i] = mvp[i][0] * v[0] + mvp[i][1] * v[1] + mvp[i][2] * v[2] +
+                    mvp[i][3];
+        }
+        float side = p % 2 ? -clip[p / 2] : clip[p / 2];
+        is_out = clip[3] + side < 0.0f;
+      }
+    }
+  }
+
+  return is_out;
+}
+
+static int is_back_facing(const meshlet_t *m, const obj3d *obj,
+                          const meshlets_t *ms, const float *eye) {
+  int is_back = TRUE;
+
+  for (u_int t = 0; is_back && t < m->triangle_count; t++) {
+    const float *a = meshlet_vertex(obj, ms, m, t, 0);
+    const float *b = meshlet_vertex(obj, ms, m, t, 1);
+    const float *c = meshlet_vertex(obj, ms, m, t, 2);
+    float u[3], v[3], to_eye[3];
+    for (int i = 0; i < 3; i++) {
+      u[i] = b[i] - a[i];
+      v[i] = c[i] - a[i];
+      to_eye[i] = eye[i] - a[i];
+    }
+    float n[3] = {u[1] * v[2] - u[2] * v[1], u[2] * v[0] - u[0] * v[2],
+                  u[0] * v[1] - u[1] * v[0]};
+    is_back = n[0] * to_eye[0] + n[1] * to_eye[1] + n[2] * to_eye[2] <= 1e-7f;
+  }
+
+  return is_back;
+}
+
+START_TEST(cull_rejects_only_hidden_meshlets) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  float model[4][4], view[4][4], proj[4][4], mv[4][4], mvp[4][4];
+  float back[4][4];
+  // камера (0, 0, 3) в пространстве модели, повернутой на 0.5 вокруг Y
+  float eye[3] = {-3.0f * sinf(0.5f), 0.0f, 3.0f * cosf(0.5f)};
+
+  scaleObjBeforeDraw(0.8f, obj);
+  meshlets_t *ms = build_meshlets(obj, 2);
+  u_int *visible = (u_int *)malloc(ms->count * sizeof(u_int));
+  unsigned char *is_visible = (unsigned char *)calloc(ms->count, 1);
+  camera(model, view, proj);
+  // модель сдвинута вбок, часть кластеров выходит за пирамиду видимости
+  model[0][3] = 0.6f;
+  eye[0] -= 0.6f * cosf(0.5f);
+  eye[2] -= 0.6f * sinf(0.5f);
+  matrix4_multiply(view, model, mv);
+  matrix4_multiply(proj, mv, mvp);
+  u_int count = cull_meshlets(ms, model, view, proj, visible);
+  ck_assert_uint_gt(count, 0);
+  ck_assert_uint_lt(count, ms->count);
+  for (u_int i = 0; i < count; i++) is_visible[visible[i]] = TRUE;
+  for (u_int i = 0; i < ms->count; i++) {
+    if (is_visible[i]) continue;
+    const meshlet_t *m = ms->items + i;
+    ck_assert(is_outside_one_plane(m, obj, ms, mvp) ||
+              is_back_facing(m, obj, ms, eye));
+  }
+
+  // модель за камерой
+  matrix4_translation(0.0f, 0.0f, 3.0f, back);
+  ck_assert_uint_eq(cull_meshlets(ms, model, back, proj, visible), 0);
+  free(visible);
+  free(is_visible);
+  meshlets_destroy(ms);
+  obj_destroy(obj);
+}
+END_TEST
+
+/**
+ * @brief flat square grid in the plane z = 0 facing +z
+ */
+static obj3d *make_grid(u_int side) {
+  obj3d *obj = obj_create();
+  u_int faces = (side - 1) * (side - 1);
+
+  ck_assert_int_eq(obj_reserve(obj, side * side, faces, faces * 4), TRUE);
+  for (u_int y = 0; y < side; y++) {
+    for (u_int x = 0; x < side; x++) {
+      float *v = obj->vertexes + (size_t)(y * side + x) * AX_DIMEN;
+      v[0] = (float)x / (float)(side - 1) - 0.5f;
+      v[1] = (float)y / (float)(side - 1) - 0.5f;
+      v[2] = 0.0f;
+    }
+  }
+  for (u_int f = 0; f < faces; f++) {
+    u_int x = f % (side - 1), y = f / (side - 1);
+    u_int *ind = obj->polygons.vertexes_ind + f * 4;
+    obj->polygons.indeces_count[f] = 4;
+    ind[0] = y * side + x + 1;
+    ind[1] = ind[0] + 1;
+    ind[2] = ind[1] + side;
+    ind[3] = ind[0] + side;
+  }
+
+  return obj;
+}
+
+START_TEST(cull_back_facing_grid) {
+  obj3d *obj = make_grid(40);
+  meshlets_t *ms = build_meshlets(obj, 1);
+  float model[4][4], view[4][4], proj[4][4];
+  u_int *visible = (u_int *)malloc(ms->count * sizeof(u_int));
+
+  ck_assert_uint_gt(ms->count, 10);
+  for (u_int i = 0; i < ms->count; i++) {
+    ck_assert_float_eq_tol(ms->items[i].cone_axis[2], 1.0f, 1e-6f);
+    ck_assert_float_lt(ms->items[i].cone_cutoff, 1e-3f);
+  }
+  matrix4_identity(model);
+  matrix4_translation(0.0f, 0.0f, -2.0f, view);
+  matrix4_perspective(1.0f, 1.0f, 0.1f, 100.0f, proj);
+  ck_assert_uint_eq(cull_meshlets(ms, model, view, proj, visible), ms->count);
+  // вид снизу: плоскость повернута к камере обратной стороной
+  matrix4_rotation(3.14159265f, X_CORD, model);
+  ck_assert_uint_eq(cull_meshlets(ms, model, view, proj, visible), 0);
+  // то же в ортогональной проекции
+  matrix4_identity(proj);
+  proj[2][2] = -0.1f;
+  ck_assert_uint_eq(cull_meshlets(ms, model, view, proj, visible), 0);
+  matrix4_identity(model);
+  ck_assert_uint_eq(cull_meshlets(ms, model, view, proj, visible), ms->count);
+  free(visible);
+  meshlets_destroy(ms);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(render_with_meshlets) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  framebuffer_t *all = framebuffer_create(FB_SIDE, FB_SIDE);
+  framebuffer_t *culled = framebuffer_create(FB_SIDE, FB_SIDE);
+  float model[4][4], view[4][4], proj[4][4];
+  render_options_t options;
+  u_int drawn_all = 0, drawn_culled = 0;
+
+  scaleObjBeforeDraw(0.8f, obj);
+  meshlets_t *ms = build_meshlets(obj, 0);
+  camera(model, view, proj);
+  render_options_default(&options);
+  options.mode = RENDER_FLAT;
+  ck_assert_int_eq(render_obj(obj, model, view, proj, &options, all), TRUE);
+  options.meshlets = ms;
+  ck_assert_int_eq(render_obj(obj, model, view, proj, &options, culled),
+                   TRUE);
+  for (u_int i = 0; i < FB_SIDE * FB_SIDE; i++) {
+    drawn_all += all->depth[i] <= 1.0f;
+    drawn_culled += culled->depth[i] <= 1.0f;
+  }
+  // отброшенные кластеры закрыты видимыми
+  ck_assert_uint_gt(drawn_culled, drawn_all * 95 / 100);
+  ck_assert_uint_le(drawn_culled, drawn_all);
+
+  // после поворота вершин границы пересчитываются
+  rotate_object(1.0f, obj, X_CORD);
+  ck_assert_int_eq(meshlets_update_bounds(ms, obj, 1), TRUE);
+  obj->vertexes_count = 1;
+  ck_assert_int_eq(meshlets_update_bounds(ms, obj, 1), FALSE);
+  ck_assert_ptr_null(build_meshlets(NULL, 1));
+  framebuffer_destroy(all);
+  framebuffer_destroy(culled);
+  meshlets_destroy(ms);
+  obj_destroy(obj);
+}
+END_TEST
+
+Suite *test_meshlets(void) {
+  Suite *s = suite_create("\033[45m-=S21_MESHLETS=-\033[0m");
+  TCase *tc = tcase_create("test_meshlets_tc");
+
+  tcase_add_test(tc, meshlets_cover_every_triangle);
+  tcase_add_test(tc, cull_rejects_only_hidden_meshlets);
+  tcase_add_test(tc, cull_back_facing_grid);
+  tcase_add_test(tc, render_with_meshlets);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
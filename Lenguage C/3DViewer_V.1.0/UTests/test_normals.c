@@ -0,0 +1,94 @@
+#include "tests.h"
+
+#ifndef S21_EPS
+#define S21_EPS 1e-5
+#endif
+
+// Every cube corner touches three sides with a right angle on each of them
+START_TEST(normals_cube_angle_weighted) {
+  obj3d *obj = parse_obj_file("data-samples/cube.obj");
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_int_eq(compute_vertex_normals(obj, NORMALS_ANGLE_WEIGHTED, 2),
+                   TRUE);
+  ck_assert_ptr_nonnull(obj->normals);
+  for (u_int i = 0; i < obj->vertexes_count * AX_DIMEN; i++) {
+    float expected = (obj->vertexes[i] > 0 ? 1.0f : -1.0f) / sqrtf(3.0f);
+    ck_assert_float_eq_tol(obj->normals[i], expected, S21_EPS);
+  }
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(normals_same_for_any_threads) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_int_eq(compute_vertex_normals(obj, NORMALS_AREA_WEIGHTED, 1),
+                   TRUE);
+  u_int size = obj->vertexes_count * AX_DIMEN;
+  float *single = (float *)malloc(size * sizeof(float));
+  memcpy(single, obj->normals, size * sizeof(float));
+  ck_assert_int_eq(compute_vertex_normals(obj, NORMALS_AREA_WEIGHTED, 4),
+                   TRUE);
+  for (u_int i = 0; i < size; i++) {
+    ck_assert_float_eq_tol(obj->normals[i], single[i], 0.0);
+  }
+  for (u_int i = 0; i < size; i += AX_DIMEN) {
+    float *n = obj->normals + i;
+    float len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    ck_assert(fabsf(len - 1.0f) < 1e-4 || len == 0.0f);
+  }
+  free(single);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(normals_follow_rotation) {
+  obj3d *obj = parse_obj_file("data-samples/cube.obj");
+  compute_vertex_normals(obj, NORMALS_ANGLE_WEIGHTED, 0);
+  rotate_object(1, obj, Y_CORD);
+  float *v = obj->vertexes + 6;
+  float *n = obj->normals + 6;
+  float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  ck_assert_float_eq_tol(n[0], v[0] / len, S21_EPS);
+  ck_assert_float_eq_tol(n[1], v[1] / len, S21_EPS);
+  ck_assert_float_eq_tol(n[2], v[2] / len, S21_EPS);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(normals_counted_in_stats) {
+  load_stats_t stats;
+  load_stats_attach(&stats);
+  obj3d *obj = parse_obj_file("data-samples/cube.obj");
+  ck_assert_ptr_nonnull(obj);
+  size_t bytes = obj_footprint(obj);
+  compute_vertex_normals(obj, NORMALS_AREA_WEIGHTED, 0);
+  ck_assert_int_eq(obj->normals_count, obj->vertexes_count);
+  ck_assert_uint_eq(obj_footprint(obj),
+                    bytes + obj->vertexes_count * AX_DIMEN * sizeof(float));
+  ck_assert_int_eq(stats.heap_bytes, (long long)obj_footprint(obj));
+  obj_destroy(obj);
+  ck_assert_int_eq(stats.heap_bytes, 0);
+  load_stats_attach(NULL);
+}
+END_TEST
+
+START_TEST(normals_null_object) {
+  ck_assert_int_eq(compute_vertex_normals(NULL, NORMALS_AREA_WEIGHTED, 0),
+                   FALSE);
+}
+END_TEST
+
+Suite *test_normals(void) {
+  Suite *s = suite_create("\033[45m-=S21_NORMALS=-\033[0m");
+  TCase *tc = tcase_create("test_normals_tc");
+
+  tcase_add_test(tc, normals_cube_angle_weighted);
+  tcase_add_test(tc, normals_same_for_any_threads);
+  tcase_add_test(tc, normals_follow_rotation);
+  tcase_add_test(tc, normals_counted_in_stats);
+  tcase_add_test(tc, normals_null_object);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
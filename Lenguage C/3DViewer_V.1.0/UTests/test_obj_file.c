@@ -177,6 +177,48 @@ START_TEST(test_get_edges_count_book_5) {
 }
 END_TEST
 
+START_TEST(test_negative_indices_6) {
+  const char *path = "data-samples/negative.obj";
+  FILE *file = fopen(path, "w");
+  ck_assert_ptr_nonnull(file);
+  fprintf(file,
+          "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\n# comment\r\n"
+          "f -3 -2 -1\r\nv 0 1 0\r\nvn 0 0 1\r\nf 1//1 -2//1 -1//1\r\n");
+  fclose(file);
+
+  obj3d *obj = parse_obj_file(path);
+  u_int expected[6] = {1U, 2U, 3U, 1U, 3U, 4U};
+  remove(path);
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_uint_eq(obj->vertexes_count, 4);
+  ck_assert_uint_eq(obj->faces_count, 2);
+  ck_assert_uint_eq(obj->total_indexes, 6);
+  for (u_int i = 0; i < 6; i++) {
+    ck_assert_uint_eq(obj->polygons.vertexes_ind[i], expected[i]);
+  }
+  ck_assert_uint_eq(get_count_edges(obj), 5);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(test_float_exponents_7) {
+  const char *path = "data-samples/exponents.obj";
+  FILE *file = fopen(path, "w");
+  ck_assert_ptr_nonnull(file);
+  fprintf(file, "v 1e-2 2E+3 -3e1\nv 1.5e0 -25E-1 0\nv 0 1 0\nf 1 2 3\n");
+  fclose(file);
+
+  obj3d *obj = parse_obj_file(path);
+  float expected[6] = {0.01f, 2000.0f, -30.0f, 1.5f, -2.5f, 0.0f};
+  remove(path);
+  ck_assert_ptr_nonnull(obj);
+  for (u_int i = 0; i < 6; i++) {
+    ck_assert_float_eq_tol(obj->vertexes[i], expected[i], 1e-6);
+  }
+  obj_destroy(obj);
+}
+END_TEST
+
 Suite *test_obj_file(void) {
   Suite *s = suite_create("\033[45m-=S21_OBJ_FILE=-\033[0m");
   TCase *tc = tcase_create("test_obj_file_tc");
@@ -188,6 +230,8 @@ Suite *test_obj_file(void) {
   tcase_add_test(tc,
                  test_open_success_and_parse_correct_get_edges_count_deer_4);
   tcase_add_test(tc, test_get_edges_count_book_5);
+  tcase_add_test(tc, test_negative_indices_6);
+  tcase_add_test(tc, test_float_exponents_7);
 
   suite_add_tcase(s, tc);
 
@@ -0,0 +1,119 @@
+#include "tests.h"
+
+#define EXPORT_PATH "data-samples/exported.obj"
+
+static char *read_text(const char *path, long *size) {
+  FILE *file = fopen(path, "rb");
+  char *text = NULL;
+
+  ck_assert_ptr_nonnull(file);
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  rewind(file);
+  text = (char *)calloc((size_t)*size + 1, 1);
+  ck_assert_uint_eq(fread(text, 1, (size_t)*size, file), (size_t)*size);
+  fclose(file);
+
+  return text;
+}
+
+static void check_read_back(const obj3d *obj) {
+  obj3d *back = parse_obj_file(EXPORT_PATH);
+
+  ck_assert_ptr_nonnull(back);
+  ck_assert_uint_eq(back->vertexes_count, obj->vertexes_count);
+  ck_assert_uint_eq(back->faces_count, obj->faces_count);
+  ck_assert_uint_eq(back->total_indexes, obj->total_indexes);
+  for (u_int i = 0; i < obj->vertexes_count * AX_DIMEN; i++) {
+    float tol = 1e-6f * fabsf(obj->vertexes[i]);
+    ck_assert_float_eq_tol(back->vertexes[i], obj->vertexes[i], tol);
+  }
+  ck_assert_int_eq(memcmp(back->polygons.indeces_count,
+                          obj->polygons.indeces_count,
+                          obj->faces_count * sizeof(u_int)),
+                   0);
+  ck_assert_int_eq(memcmp(back->polygons.vertexes_ind,
+                          obj->polygons.vertexes_ind,
+                          obj->total_indexes * sizeof(u_int)),
+                   0);
+  obj_destroy(back);
+}
+
+START_TEST(writer_round_trip_deer) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  long size1 = 0, size4 = 0;
+
+  ck_assert_ptr_nonnull(obj);
+  rotate_object(0.3f, obj, X_CORD);
+  ck_assert_int_eq(write_obj_file(obj, EXPORT_PATH, 1), TRUE);
+  check_read_back(obj);
+  char *text1 = read_text(EXPORT_PATH, &size1);
+  // результат не зависит от количества потоков
+  ck_assert_int_eq(write_obj_file(obj, EXPORT_PATH, 4), TRUE);
+  char *text4 = read_text(EXPORT_PATH, &size4);
+  ck_assert_int_eq(size1, size4);
+  ck_assert_int_eq(memcmp(text1, text4, (size_t)size1), 0);
+  free(text1);
+  free(text4);
+  remove(EXPORT_PATH);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(writer_float_formats) {
+  const float values[] = {0.1f,  -2.5f,      1e-7f, 123456.7f, -3e12f, 0.0f,
+                          1e9f,  0.000123f, 5e-6f, 7.0f,      -0.0f,  1e18f};
+  const char *expected = "v 0.1 -2.5 1e-7\nv 123456.7 -3e12 0\n"
+                         "v 1e9 0.000123 5e-6\nv 7 0 1e18\nf 1 2 3 4\n";
+  obj3d *obj = obj_create();
+  long size = 0;
+
+  ck_assert_int_eq(obj_reserve(obj, 4, 1, 4), TRUE);
+  memcpy(obj->vertexes, values, sizeof(values));
+  obj->polygons.indeces_count[0] = 4;
+  for (u_int i = 0; i < 4; i++) obj->polygons.vertexes_ind[i] = i + 1;
+  ck_assert_int_eq(write_obj_file(obj, EXPORT_PATH, 0), TRUE);
+  char *text = read_text(EXPORT_PATH, &size);
+  ck_assert_ptr_nonnull(strstr(text, expected));
+  free(text);
+  check_read_back(obj);
+  remove(EXPORT_PATH);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(writer_normals_and_errors) {
+  obj3d *obj = parse_obj_file("data-samples/cube.obj");
+  long size = 0;
+
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_int_eq(compute_vertex_normals(obj, NORMALS_AREA_WEIGHTED, 1),
+                   TRUE);
+  ck_assert_int_eq(write_obj_file(obj, EXPORT_PATH, 2), TRUE);
+  char *text = read_text(EXPORT_PATH, &size);
+  ck_assert_ptr_nonnull(strstr(text, "\nvn "));
+  ck_assert_ptr_nonnull(strstr(text, "\nf 1//1 "));
+  free(text);
+  check_read_back(obj);
+  remove(EXPORT_PATH);
+
+  ck_assert_int_eq(write_obj_file(NULL, EXPORT_PATH, 1), FALSE);
+  ck_assert_int_eq(write_obj_file(obj, "data-samples/no/such/dir.obj", 1),
+                   FALSE);
+  obj->polygons.indeces_count[0]++;
+  ck_assert_int_eq(write_obj_file(obj, EXPORT_PATH, 1), FALSE);
+  obj_destroy(obj);
+}
+END_TEST
+
+Suite *test_obj_writer(void) {
+  Suite *s = suite_create("\033[45m-=S21_OBJ_WRITER=-\033[0m");
+  TCase *tc = tcase_create("test_obj_writer_tc");
+
+  tcase_add_test(tc, writer_round_trip_deer);
+  tcase_add_test(tc, writer_float_formats);
+  tcase_add_test(tc, writer_normals_and_errors);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,77 @@
+#include "tests.h"
+
+#include <stdatomic.h>
+
+#define PARALLEL_COUNT 10007U
+
+typedef struct {
+  atomic_uint visits[PARALLEL_COUNT];
+  atomic_uint calls;
+} visit_job_t;
+
+static void visit_range(void *ctx, u_int begin, u_int end,
+                        u_int thread_index) {
+  visit_job_t *job = (visit_job_t *)ctx;
+  volatile u_int sink = 0;
+  (void)thread_index;
+
+  atomic_fetch_add(&job->calls, 1);
+  for (u_int i = begin; i < end; i++) {
+    // задачи неравной стоимости, чтобы потоки успели украсть работу
+    for (u_int k = 0; k < (i % 97) * 10; k++) sink += k;
+    atomic_fetch_add(&job->visits[i], 1);
+  }
+}
+
+static void check_every_index_once(visit_job_t *job) {
+  for (u_int i = 0; i < PARALLEL_COUNT; i++) {
+    ck_assert_uint_eq(atomic_load(&job->visits[i]), 1);
+  }
+}
+
+START_TEST(parallel_for_visits_every_index) {
+  visit_job_t *job = (visit_job_t *)calloc(1, sizeof(visit_job_t));
+  ck_assert_uint_eq(parallel_for(PARALLEL_COUNT, 4, visit_range, job), 4);
+  check_every_index_once(job);
+  ck_assert_uint_eq(atomic_load(&job->calls), 4);
+  free(job);
+}
+END_TEST
+
+START_TEST(parallel_stealing_visits_every_index) {
+  u_int threads[] = {1, 3, 8, 0};
+  for (u_int t = 0; t < sizeof(threads) / sizeof(*threads); t++) {
+    visit_job_t *job = (visit_job_t *)calloc(1, sizeof(visit_job_t));
+    parallel_for_stealing(PARALLEL_COUNT, threads[t], visit_range, job);
+    check_every_index_once(job);
+    ck_assert_uint_eq(atomic_load(&job->calls), PARALLEL_COUNT);
+    free(job);
+  }
+}
+END_TEST
+
+START_TEST(parallel_threads_limits) {
+  visit_job_t *job = (visit_job_t *)calloc(1, sizeof(visit_job_t));
+  ck_assert_uint_eq(parallel_for(0, 4, visit_range, job), 0);
+  ck_assert_uint_eq(parallel_for_stealing(0, 4, visit_range, job), 0);
+  ck_assert_uint_eq(parallel_for_stealing(3, 16, visit_range, job), 3);
+  ck_assert_uint_eq(
+      parallel_for_stealing(PARALLEL_COUNT, 1000, visit_range, job),
+      MAX_THREADS);
+  ck_assert_uint_ge(get_threads_count(0), 1);
+  ck_assert_uint_eq(get_threads_count(5), 5);
+  free(job);
+}
+END_TEST
+
+Suite *test_parallel(void) {
+  Suite *s = suite_create("\033[45m-=S21_PARALLEL=-\033[0m");
+  TCase *tc = tcase_create("test_parallel_tc");
+
+  tcase_add_test(tc, parallel_for_visits_every_index);
+  tcase_add_test(tc, parallel_stealing_visits_every_index);
+  tcase_add_test(tc, parallel_threads_limits);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
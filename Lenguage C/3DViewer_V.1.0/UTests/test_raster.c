@@ -0,0 +1,110 @@
+#include "tests.h"
+
+#define FB_SIDE 96U
+
+static void camera(float model[4][4], float view[4][4], float proj[4][4]) {
+  matrix4_rotation(0.5f, Y_CORD, model);
+  matrix4_translation(0.0f, 0.0f, -3.0f, view);
+  matrix4_perspective(0.8f, 1.0f, 0.1f, 100.0f, proj);
+}
+
+static u_int count_not_background(const framebuffer_t *fb,
+                                  const render_options_t *options) {
+  u_int count = 0;
+  for (u_int i = 0; i < fb->width * fb->height; i++) {
+    if (memcmp(fb->pixels + 4 * i, options->background, 4)) count++;
+  }
+  return count;
+}
+
+START_TEST(raster_unique_edges_match_count) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  u_int *edges = NULL;
+  u_int count = collect_unique_edges(obj, &edges);
+  ck_assert_uint_eq(count, get_count_edges(obj));
+  for (u_int i = 0; i < count; i++) {
+    ck_assert_uint_lt(edges[2 * i], edges[2 * i + 1]);
+  }
+  free(edges);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(raster_flat_cube) {
+  obj3d *obj = parse_obj_file("data-samples/cube.obj");
+  framebuffer_t *fb = framebuffer_create(FB_SIDE, FB_SIDE);
+  float model[4][4], view[4][4], proj[4][4];
+  render_options_t options;
+  render_options_default(&options);
+  options.mode = RENDER_FLAT;
+  camera(model, view, proj);
+  ck_assert_int_eq(render_obj(obj, model, view, proj, &options, fb), TRUE);
+  // центр закрыт гранью, угол остается фоном
+  const unsigned char *center =
+      fb->pixels + 4 * (FB_SIDE / 2 * FB_SIDE + FB_SIDE / 2);
+  ck_assert_int_ne(memcmp(center, options.background, 4), 0);
+  ck_assert_int_eq(memcmp(fb->pixels, options.background, 4), 0);
+  ck_assert_float_lt(fb->depth[FB_SIDE / 2 * FB_SIDE + FB_SIDE / 2], 1.0f);
+  framebuffer_destroy(fb);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(raster_same_for_any_threads) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  framebuffer_t *single = framebuffer_create(200, 150);
+  framebuffer_t *many = framebuffer_create(200, 150);
+  float model[4][4], view[4][4], proj[4][4];
+  render_options_t options;
+  render_options_default(&options);
+  scaleObjBeforeDraw(0.5f, obj);
+  camera(model, view, proj);
+  options.threads = 1;
+  ck_assert_int_eq(render_obj(obj, model, view, proj, &options, single), TRUE);
+  options.threads = 5;
+  ck_assert_int_eq(render_obj(obj, model, view, proj, &options, many), TRUE);
+  ck_assert_int_eq(memcmp(single->pixels, many->pixels, 200 * 150 * 4), 0);
+  ck_assert_uint_gt(count_not_background(single, &options), 100);
+  framebuffer_destroy(single);
+  framebuffer_destroy(many);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(raster_wireframe_and_png) {
+  obj3d *obj = parse_obj_file("data-samples/cube.obj");
+  framebuffer_t *fb = framebuffer_create(FB_SIDE, FB_SIDE / 2);
+  float model[4][4], view[4][4], proj[4][4];
+  render_options_t options;
+  render_options_default(&options);
+  options.mode = RENDER_WIREFRAME;
+  camera(model, view, proj);
+  ck_assert_int_eq(render_obj(obj, model, view, proj, &options, fb), TRUE);
+  u_int drawn = count_not_background(fb, &options);
+  ck_assert_uint_gt(drawn, 0);
+  ck_assert_uint_lt(drawn, FB_SIDE * FB_SIDE / 4);
+  ck_assert_int_eq(framebuffer_save_png(fb, "test_raster.png"), TRUE);
+  FILE *file = fopen("test_raster.png", "rb");
+  unsigned char signature[8] = {0};
+  ck_assert_ptr_nonnull(file);
+  ck_assert_uint_eq(fread(signature, 1, 8, file), 8);
+  fclose(file);
+  remove("test_raster.png");
+  ck_assert_int_eq(memcmp(signature, "\x89PNG\r\n\x1a\n", 8), 0);
+  framebuffer_destroy(fb);
+  obj_destroy(obj);
+}
+END_TEST
+
+Suite *test_raster(void) {
+  Suite *s = suite_create("\033[45m-=S21_RASTER=-\033[0m");
+  TCase *tc = tcase_create("test_raster_tc");
+
+  tcase_add_test(tc, raster_unique_edges_match_count);
+  tcase_add_test(tc, raster_flat_cube);
+  tcase_add_test(tc, raster_same_for_any_threads);
+  tcase_add_test(tc, raster_wireframe_and_png);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -0,0 +1,253 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tests.h"
+
+#define CACHE_DIR "data-samples/scene_cache"
+#define DEER_COPY "data-samples/scene_deer.obj"
+
+static void copy_file(const char *from, const char *to) {
+  FILE *in = fopen(from, "rb");
+  FILE *out = fopen(to, "wb");
+  char buffer[4096];
+  size_t read = 0;
+
+  ck_assert_ptr_nonnull(in);
+  ck_assert_ptr_nonnull(out);
+  while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+    fwrite(buffer, 1, read, out);
+  }
+  fclose(in);
+  fclose(out);
+}
+
+static void remove_cache_dir(void) {
+  DIR *dir = opendir(CACHE_DIR);
+  struct dirent *entry = NULL;
+  char path[512];
+
+  while (dir && (entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] == '.') continue;
+    snprintf(path, sizeof(path), "%s/%s", CACHE_DIR, entry->d_name);
+    remove(path);
+  }
+  if (dir) closedir(dir);
+  rmdir(CACHE_DIR);
+}
+
+static void check_same_obj(const obj3d *a, const obj3d *b) {
+  ck_assert_uint_eq(a->vertexes_count, b->vertexes_count);
+  ck_assert_uint_eq(a->faces_count, b->faces_count);
+  ck_assert_uint_eq(a->total_indexes, b->total_indexes);
+  ck_assert_int_eq(memcmp(a->vertexes, b->vertexes,
+                          a->vertexes_count * AX_DIMEN * sizeof(float)),
+                   0);
+  ck_assert_int_eq(memcmp(a->polygons.indeces_count,
+                          b->polygons.indeces_count,
+                          a->faces_count * sizeof(u_int)),
+                   0);
+  ck_assert_int_eq(memcmp(a->polygons.vertexes_ind, b->polygons.vertexes_ind,
+                          a->total_indexes * sizeof(u_int)),
+                   0);
+  ck_assert_int_eq(memcmp(&a->bounds, &b->bounds, sizeof(axises)), 0);
+}
+
+static void wait_for_state(scene_t *scene, u_int id, int state) {
+  struct timespec pause = {0, 1000000};
+
+  for (int i = 0; i < 5000 && scene_state(scene, id) != state; i++) {
+    nanosleep(&pause, NULL);
+  }
+  ck_assert_int_eq(scene_state(scene, id), state);
+}
+
+START_TEST(binary_cache_round_trip) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_int_eq(obj_save_binary(obj, "data-samples/deer.s21b"), TRUE);
+  obj3d *cached = obj_load_binary("data-samples/deer.s21b");
+  ck_assert_ptr_nonnull(cached);
+  check_same_obj(obj, cached);
+  obj_destroy(cached);
+
+  // обрезанный кэш не читается
+  ck_assert_int_eq(truncate("data-samples/deer.s21b", 1000), 0);
+  ck_assert_ptr_null(obj_load_binary("data-samples/deer.s21b"));
+  ck_assert_ptr_null(obj_load_binary("data-samples/cube.obj"));
+  ck_assert_ptr_null(obj_load_binary("data-samples/missing.s21b"));
+  remove("data-samples/deer.s21b");
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(compressed_cache_lossless) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_int_eq(obj_save_compressed(obj, "data-samples/deer.s21b", 0),
+                   TRUE);
+  obj3d *cached = obj_load_binary("data-samples/deer.s21b");
+  ck_assert_ptr_nonnull(cached);
+  check_same_obj(obj, cached);
+  obj_destroy(cached);
+
+  ck_assert_int_eq(truncate("data-samples/deer.s21b", 1000), 0);
+  ck_assert_ptr_null(obj_load_binary("data-samples/deer.s21b"));
+  ck_assert_int_eq(obj_save_compressed(obj, "data-samples/deer.s21b",
+                                       CACHE_MAX_QUANT_BITS + 1),
+                   FALSE);
+  remove("data-samples/deer.s21b");
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(compressed_cache_quantized) {
+  obj3d *obj = parse_obj_file("data-samples/deer.obj");
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_int_eq(obj_save_compressed(obj, "data-samples/deer.s21b",
+                                       CACHE_QUANT_BITS),
+                   TRUE);
+  obj3d *cached = obj_load_binary("data-samples/deer.s21b");
+  ck_assert_ptr_nonnull(cached);
+  ck_assert_uint_eq(obj->vertexes_count, cached->vertexes_count);
+  ck_assert_uint_eq(obj->total_indexes, cached->total_indexes);
+  ck_assert_int_eq(memcmp(obj->polygons.vertexes_ind,
+                          cached->polygons.vertexes_ind,
+                          obj->total_indexes * sizeof(u_int)),
+                   0);
+  const axises *b = &obj->bounds;
+  float sizes[AX_DIMEN] = {b->x_max - b->x_min, b->y_max - b->y_min,
+                           b->z_max - b->z_min};
+  for (u_int i = 0; i < AX_DIMEN; i++) {
+    float tolerance = sizes[i] / (float)((1u << CACHE_QUANT_BITS) - 1);
+    for (u_int v = 0; v < obj->vertexes_count; v++) {
+      ck_assert_float_eq_tol(obj->vertexes[v * AX_DIMEN + i],
+                             cached->vertexes[v * AX_DIMEN + i], tolerance);
+    }
+  }
+  remove("data-samples/deer.s21b");
+  obj_destroy(cached);
+  obj_destroy(obj);
+}
+END_TEST
+
+START_TEST(scene_evicts_lru_to_cache) {
+  obj3d *deer = parse_obj_file("data-samples/deer.obj");
+  size_t deer_bytes = obj_footprint(deer);
+  copy_file("data-samples/deer.obj", DEER_COPY);
+  scene_t *scene =
+      scene_create(deer_bytes * 3 / 2, CACHE_DIR, SCENE_EVICT_TO_CACHE, 0);
+  ck_assert_ptr_nonnull(scene);
+  ck_assert_int_eq(scene_add(scene, "data-samples/deer.obj"), 0);
+  ck_assert_int_eq(scene_add(scene, "data-samples/cube.obj"), 1);
+  ck_assert_int_eq(scene_add(scene, DEER_COPY), 2);
+  ck_assert_int_eq(scene_add(scene, "data-samples/missing.obj"), 3);
+
+  ck_assert_ptr_nonnull(scene_view(scene, 0));
+  ck_assert_ptr_nonnull(scene_view(scene, 1));
+  ck_assert_int_eq(scene_state(scene, 0), MODEL_LOADED);
+  // второй олень не влезает вместе с первым, вытесняется давно смотренный
+  ck_assert_ptr_nonnull(scene_view(scene, 2));
+  ck_assert_int_eq(scene_state(scene, 0), MODEL_CACHED);
+  ck_assert_int_eq(scene_state(scene, 1), MODEL_LOADED);
+  ck_assert_uint_le(scene_memory(scene), deer_bytes * 3 / 2);
+
+  obj3d *obj = scene_view(scene, 0);
+  ck_assert_ptr_nonnull(obj);
+  check_same_obj(obj, deer);
+  ck_assert_int_eq(scene_state(scene, 2), MODEL_CACHED);
+  ck_assert_ptr_null(scene_view(scene, 3));
+  ck_assert_int_eq(scene_state(scene, 3), MODEL_FAILED);
+  ck_assert_ptr_null(scene_view(scene, 4));
+  scene_destroy(scene);
+
+  // свежий кэш виден новой сцене сразу
+  scene = scene_create(deer_bytes, CACHE_DIR, SCENE_EVICT_TO_CACHE, 0);
+  ck_assert_int_eq(scene_add(scene, "data-samples/deer.obj"), 0);
+  ck_assert_int_eq(scene_state(scene, 0), MODEL_CACHED);
+  scene_destroy(scene);
+
+  obj_destroy(deer);
+  remove(DEER_COPY);
+  remove_cache_dir();
+}
+END_TEST
+
+START_TEST(scene_keeps_lod) {
+  obj3d *deer = parse_obj_file("data-samples/deer.obj");
+  size_t deer_bytes = obj_footprint(deer);
+  copy_file("data-samples/deer.obj", DEER_COPY);
+  scene_t *scene =
+      scene_create(deer_bytes * 3 / 2, NULL, SCENE_EVICT_TO_LOD, 0);
+  ck_assert_int_eq(scene_add(scene, "data-samples/deer.obj"), 0);
+  ck_assert_int_eq(scene_add(scene, DEER_COPY), 1);
+
+  ck_assert_ptr_nonnull(scene_view(scene, 0));
+  ck_assert_ptr_null(scene_preview(scene, 0));
+  ck_assert_ptr_nonnull(scene_view(scene, 1));
+  ck_assert_int_eq(scene_state(scene, 0), MODEL_LOD);
+  ck_assert_uint_le(scene_memory(scene), deer_bytes * 3 / 2);
+
+  obj3d *lod = scene_preview(scene, 0);
+  ck_assert_ptr_nonnull(lod);
+  ck_assert_uint_lt(lod->vertexes_count, deer->vertexes_count);
+  ck_assert_uint_gt(lod->faces_count, 0);
+  for (u_int i = 0; i < lod->total_indexes; i++) {
+    ck_assert_uint_ge(lod->polygons.vertexes_ind[i], 1);
+    ck_assert_uint_le(lod->polygons.vertexes_ind[i], lod->vertexes_count);
+  }
+  for (u_int v = 0; v < lod->vertexes_count; v++) {
+    ck_assert_float_ge(lod->vertexes[v * AX_DIMEN], deer->bounds.x_min);
+    ck_assert_float_le(lod->vertexes[v * AX_DIMEN], deer->bounds.x_max);
+  }
+  obj_destroy(lod);
+
+  // полная модель заменяет LOD при следующем просмотре
+  obj3d *obj = scene_view(scene, 0);
+  check_same_obj(obj, deer);
+  ck_assert_int_eq(scene_state(scene, 1), MODEL_LOD);
+  scene_destroy(scene);
+  obj_destroy(deer);
+  remove(DEER_COPY);
+}
+END_TEST
+
+START_TEST(scene_prefetches_neighbours) {
+  scene_t *scene = scene_create((size_t)1 << 30, NULL, SCENE_EVICT_TO_CACHE, 2);
+  ck_assert_int_eq(scene_add(scene, "data-samples/cube.obj"), 0);
+  ck_assert_int_eq(scene_add(scene, "data-samples/deer.obj"), 1);
+  ck_assert_int_eq(scene_add(scene, "data-samples/cube.obj"), 2);
+  ck_assert_int_eq(scene_add(scene, "data-samples/deer.obj"), 3);
+  ck_assert_int_eq(scene_add(scene, "data-samples/cube.obj"), 4);
+
+  ck_assert_ptr_nonnull(scene_view(scene, 0));
+  wait_for_state(scene, 1, MODEL_LOADED);
+  wait_for_state(scene, 2, MODEL_LOADED);
+  ck_assert_int_eq(scene_state(scene, 3), MODEL_UNLOADED);
+
+  obj3d *obj = scene_view(scene, 1);
+  ck_assert_ptr_nonnull(obj);
+  ck_assert_uint_gt(obj->vertexes_count, 8);
+  wait_for_state(scene, 3, MODEL_LOADED);
+  // уничтожение не ждет загрузки, которую никто не ставил
+  scene_view(scene, 4);
+  scene_destroy(scene);
+  ck_assert_ptr_null(scene_create(1, "data-samples/cube.obj/dir", 0, 0));
+}
+END_TEST
+
+Suite *test_scene(void) {
+  Suite *s = suite_create("\033[45m-=S21_SCENE=-\033[0m");
+  TCase *tc = tcase_create("test_scene_tc");
+
+  tcase_add_test(tc, binary_cache_round_trip);
+  tcase_add_test(tc, compressed_cache_lossless);
+  tcase_add_test(tc, compressed_cache_quantized);
+  tcase_add_test(tc, scene_evicts_lru_to_cache);
+  tcase_add_test(tc, scene_keeps_lod);
+  tcase_add_test(tc, scene_prefetches_neighbours);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
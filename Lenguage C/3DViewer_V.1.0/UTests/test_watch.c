@@ -0,0 +1,190 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "tests.h"
+
+#define WATCH_PATH "data-samples/watched.obj"
+
+static void write_text(const char *mode, const char *text) {
+  FILE *file = fopen(WATCH_PATH, mode);
+  ck_assert_ptr_nonnull(file);
+  fputs(text, file);
+  fclose(file);
+}
+
+// lines of vertexes well past two windows of BUFFER_SIZE, one of them moved
+static void write_vertexes(u_int count, u_int moved) {
+  FILE *file = fopen(WATCH_PATH, "w");
+  ck_assert_ptr_nonnull(file);
+  for (u_int i = 0; i < count; i++) {
+    fputs(i == moved ? "v 7 0 0\n" : "v 1 2 3\n", file);
+  }
+  fputs("f 1 2 3\n", file);
+  fclose(file);
+}
+
+static void check_same_as_full_parse(obj_watch_t *watch) {
+  obj3d *full = parse_obj_file(WATCH_PATH);
+  obj3d *obj = obj_watch_object(watch);
+  u_int *edges = NULL;
+
+  ck_assert_uint_eq(obj->vertexes_count, full->vertexes_count);
+  ck_assert_uint_eq(obj->faces_count, full->faces_count);
+  ck_assert_uint_eq(obj->total_indexes, full->total_indexes);
+  ck_assert_int_eq(memcmp(obj->polygons.vertexes_ind,
+                          full->polygons.vertexes_ind,
+                          full->total_indexes * sizeof(u_int)),
+                   0);
+  ck_assert_int_eq(memcmp(&obj->bounds, &full->bounds, sizeof(axises)), 0);
+  ck_assert_uint_eq(obj_watch_edges(watch), collect_unique_edges(full, &edges));
+  free(edges);
+  obj_destroy(full);
+}
+
+START_TEST(watch_append_parses_tail) {
+  write_text("w", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n");
+  obj_watch_t *watch = obj_watch_open(WATCH_PATH);
+  ck_assert_ptr_nonnull(watch);
+  obj3d *before = obj_watch_object(watch);
+  ck_assert_uint_eq(obj_watch_edges(watch), 3);
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_UNCHANGED);
+
+  write_text("a", "v 0 1 2\nf 1 3 -1\nv -1 0 0\nf -1 1 2\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_APPENDED);
+  ck_assert_ptr_eq(obj_watch_object(watch), before);
+  ck_assert_uint_eq(obj_watch_edges(watch), 7);
+  check_same_as_full_parse(watch);
+  obj_watch_close(watch);
+  remove(WATCH_PATH);
+}
+END_TEST
+
+START_TEST(watch_rewrite_reloads) {
+  write_text("w", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n");
+  obj_watch_t *watch = obj_watch_open(WATCH_PATH);
+  ck_assert_ptr_nonnull(watch);
+  // префикс изменился, хотя файл вырос
+  write_text("w", "v 5 0 0\nv 1 0 0\nv 1 1 0\nv 2 2 2\nf 1 2 3 4\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_RELOADED);
+  check_same_as_full_parse(watch);
+  // недописанная строка разбирается как есть, а ее продолжение ведет к
+  // перечитыванию всего файла
+  write_text("a", "f 1 2");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_APPENDED);
+  write_text("a", " 4\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_RELOADED);
+  check_same_as_full_parse(watch);
+  obj_watch_close(watch);
+  remove(WATCH_PATH);
+}
+END_TEST
+
+START_TEST(watch_middle_edit_reloads) {
+  write_vertexes(40000, 40000);
+  obj_watch_t *watch = obj_watch_open(WATCH_PATH);
+  ck_assert_ptr_nonnull(watch);
+  // правка в середине файла вместе с дозаписью не считается дозаписью
+  write_vertexes(40000, 20000);
+  write_text("a", "f 2 3 4\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_RELOADED);
+  ck_assert_float_eq(obj_watch_object(watch)->vertexes[20000 * AX_DIMEN], 7);
+  check_same_as_full_parse(watch);
+  obj_watch_close(watch);
+  remove(WATCH_PATH);
+}
+END_TEST
+
+START_TEST(watch_big_file_checks_ends) {
+  write_vertexes(100000, 100000);
+  obj_watch_t *watch = obj_watch_open(WATCH_PATH);
+  ck_assert_ptr_nonnull(watch);
+  write_text("a", "f 2 3 4\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_APPENDED);
+  // первый и последний блоки сверяются при любом размере файла
+  write_vertexes(100000, 99999);
+  write_text("a", "f 2 3 4\nf 3 4 5\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_RELOADED);
+  write_vertexes(100000, 0);
+  write_text("a", "f 2 3 4\nf 3 4 5\nf 4 5 6\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_RELOADED);
+  check_same_as_full_parse(watch);
+  obj_watch_close(watch);
+  remove(WATCH_PATH);
+}
+END_TEST
+
+START_TEST(watch_same_second_rewrite_reloads) {
+  struct stat st;
+  write_text("w", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n");
+  obj_watch_t *watch = obj_watch_open(WATCH_PATH);
+  ck_assert_ptr_nonnull(watch);
+  ck_assert_int_eq(stat(WATCH_PATH, &st), 0);
+  // тот же размер и та же секунда mtime, отличаются только наносекунды
+  write_text("w", "v 0 0 0\nv 2 0 0\nv 1 1 0\nf 1 2 3\n");
+  struct timespec times[2] = {st.st_atim, st.st_mtim};
+  times[1].tv_nsec = (times[1].tv_nsec + 1) % 1000000000L;
+  ck_assert_int_eq(utimensat(AT_FDCWD, WATCH_PATH, times, 0), 0);
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_RELOADED);
+  ck_assert_float_eq(obj_watch_object(watch)->bounds.x_max, 2);
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_UNCHANGED);
+  obj_watch_close(watch);
+  remove(WATCH_PATH);
+}
+END_TEST
+
+START_TEST(watch_bad_face_fails) {
+  write_text("w", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 3\n");
+  obj_watch_t *watch = obj_watch_open(WATCH_PATH);
+  ck_assert_ptr_nonnull(watch);
+  // грань с несуществующей вершиной не меняет объект
+  write_text("a", "v 0 1 2\nf 1 2 -9\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_FAILED);
+  ck_assert_uint_eq(obj_watch_object(watch)->vertexes_count, 3);
+  ck_assert_uint_eq(obj_watch_object(watch)->faces_count, 1);
+  ck_assert_uint_eq(obj_watch_object(watch)->total_indexes, 3);
+  write_text("w", "v 0 0 0\nf 1 2 -9\n");
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_FAILED);
+  ck_assert_uint_eq(obj_watch_object(watch)->faces_count, 1);
+  obj_watch_close(watch);
+  ck_assert_ptr_null(obj_watch_open(WATCH_PATH));
+  remove(WATCH_PATH);
+  // ошибка разбора не остается в потоке
+  obj3d *cube = parse_obj_file("data-samples/cube.obj");
+  ck_assert_uint_eq(get_count_edges(cube), 18);
+  obj_destroy(cube);
+}
+END_TEST
+
+START_TEST(watch_poll_notices_changes) {
+  write_text("w", "v 0 0 0\nv 1 0 0\nv 1 1 0\n");
+  obj_watch_t *watch = obj_watch_open(WATCH_PATH);
+  ck_assert_ptr_nonnull(watch);
+  ck_assert_int_eq(obj_watch_poll(watch, 10), WATCH_UNCHANGED);
+  write_text("a", "f 1 2 3\n");
+  ck_assert_int_eq(obj_watch_poll(watch, 1000), WATCH_APPENDED);
+  ck_assert_uint_eq(obj_watch_object(watch)->faces_count, 1);
+  remove(WATCH_PATH);
+  ck_assert_int_eq(obj_watch_refresh(watch), WATCH_FAILED);
+  ck_assert_uint_eq(obj_watch_object(watch)->faces_count, 1);
+  obj_watch_close(watch);
+  ck_assert_ptr_null(obj_watch_open(WATCH_PATH));
+  ck_assert_int_eq(obj_watch_fd(NULL), -1);
+}
+END_TEST
+
+Suite *test_watch(void) {
+  Suite *s = suite_create("\033[45m-=S21_WATCH=-\033[0m");
+  TCase *tc = tcase_create("test_watch_tc");
+
+  tcase_add_test(tc, watch_append_parses_tail);
+  tcase_add_test(tc, watch_rewrite_reloads);
+  tcase_add_test(tc, watch_middle_edit_reloads);
+  tcase_add_test(tc, watch_big_file_checks_ends);
+  tcase_add_test(tc, watch_same_second_rewrite_reloads);
+  tcase_add_test(tc, watch_bad_face_fails);
+  tcase_add_test(tc, watch_poll_notices_changes);
+  suite_add_tcase(s, tc);
+
+  return s;
+}
@@ -3,7 +3,13 @@
 int main(void) {
   int failed = 0;
   int i = 0;
-  Suite *s21_3d_viewer_back_test[] = {test_obj_file(), test_affine(), NULL};
+  Suite *s21_3d_viewer_back_test[] = {test_obj_file(), test_affine(),
+                                       test_normals(), test_raster(),
+                                       test_gif(),     test_parallel(),
+                                       test_loader(),  test_watch(),
+                                       test_scene(),   test_obj_writer(),
+                                       test_mesh_formats(), test_meshlets(),
+                                       test_face_cull(), NULL};
 
   for (; s21_3d_viewer_back_test[i] != NULL; i++) {
     SRunner *sr = srunner_create(s21_3d_viewer_back_test[i]);
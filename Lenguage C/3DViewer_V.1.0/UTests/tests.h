@@ -7,5 +7,16 @@
 
 Suite *test_obj_file(void);
 Suite *test_affine(void);
+Suite *test_normals(void);
+Suite *test_raster(void);
+Suite *test_gif(void);
+Suite *test_parallel(void);
+Suite *test_loader(void);
+Suite *test_watch(void);
+Suite *test_scene(void);
+Suite *test_obj_writer(void);
+Suite *test_mesh_formats(void);
+Suite *test_meshlets(void);
+Suite *test_face_cull(void);
 
 #endif // SRC_UTESTS_TESTS_H_
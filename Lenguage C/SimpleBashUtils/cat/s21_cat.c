@@ -1,8 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "../common/s21_getline.h"
+#include "../common/s21_writer.h"
 
 enum Boolean { False, True };
 
@@ -32,25 +34,60 @@ int is_tab(char symbol) { return symbol == '\t'; }
 
 int is_end_of_line(char symbol) { return symbol == '\n'; }
 
-void print_line_number(int number) {
-  printf("%6d\t", number); /* width for line number is 6 */
+void print_line_number(Writer *writer, int number) {
+  writer_print_format(writer, "%6d\t", number); /* width for number is 6 */
 }
 
-void print_with_unprintable(char symbol) {
-  if (0 <= symbol && symbol <= 31 && !is_tab(symbol) &&
-      !is_end_of_line(symbol)) {
-    symbol += 64;
-    printf("^%c", symbol);
-  } else if (symbol == 127) {
-    symbol = '?';
-    printf("^%c", symbol);
-  } else {
-    printf("%c", symbol);
+int is_unprintable(char symbol) {
+  return (0 <= symbol && symbol <= 31 && !is_tab(symbol) &&
+          !is_end_of_line(symbol)) ||
+         symbol == 127;
+}
+
+/* the text printed in place of a symbol, its length is 0 when the symbol is
+   printed as is */
+int get_replacement(char symbol, const Flags *flags, char *replacement) {
+  int length = 0;
+
+  if ((flags->t || flags->T) && is_tab(symbol)) {
+    replacement[0] = '^';
+    replacement[1] = 'I';
+    length = 2;
+  } else if ((flags->e || flags->E) && is_end_of_line(symbol)) {
+    replacement[0] = '$';
+    replacement[1] = '\n';
+    length = 2;
+  } else if ((flags->v || flags->t || flags->e) && is_unprintable(symbol)) {
+    replacement[0] = '^';
+    replacement[1] = symbol == 127 ? '?' : symbol + 64;
+    length = 2;
   }
+
+  return length;
 }
 
-void print_line(int *line_number, const char *line, int length,
-                const Flags *flags, int *is_empty) {
+/* the symbols between two replacements go out as one piece */
+void print_with_unprintable(Writer *writer, const char *line, int length,
+                            const Flags *flags) {
+  int piece_begin = 0;
+
+  for (int index = 0; index < length; ++index) {
+    char replacement[2];
+    const int replacement_length =
+        get_replacement(line[index], flags, replacement);
+
+    if (replacement_length) {
+      writer_write(writer, line + piece_begin, index - piece_begin);
+      writer_write(writer, replacement, replacement_length);
+      piece_begin = index + 1;
+    }
+  }
+
+  writer_write(writer, line + piece_begin, length - piece_begin);
+}
+
+void print_line(Writer *writer, int *line_number, const char *line,
+                int length, const Flags *flags, int *is_empty) {
   if (flags->s && *is_empty && length <= 1) {
     return;
   }
@@ -62,37 +99,26 @@ void print_line(int *line_number, const char *line, int length,
 
   if (flags->b) {
     if (length > 1) {
-      print_line_number(*line_number);
+      print_line_number(writer, *line_number);
       ++(*line_number);
     }
   } else if (flags->n) {
-    print_line_number(*line_number);
+    print_line_number(writer, *line_number);
     ++(*line_number);
   }
 
-  for (int index = 0; index < length; ++index) {
-    if (flags->t && is_tab(line[index])) {
-      printf("%s", "^I");
-    } else if (flags->T && is_tab(line[index])) {
-      printf("%s", "^I");
-    } else if (flags->e && is_end_of_line(line[index])) {
-      printf("%c", '$');
-      printf("%c", '\n');
-    } else if (flags->E && is_end_of_line(line[index])) {
-      printf("%c", '$');
-      printf("%c", '\n');
-    } else if (flags->v || flags->t || flags->e) {
-      print_with_unprintable(line[index]);
-    } else {
-      printf("%c", line[index]);
-    }
+  if (flags->t || flags->T || flags->e || flags->E || flags->v) {
+    print_with_unprintable(writer, line, length, flags);
+  } else {
+    writer_write(writer, line, length);
   }
 }
 
-void read_and_output_file_line_by_line(const char *filename,
+void read_and_output_file_line_by_line(Writer *writer, const char *filename,
                                        const Flags *flags) {
   FILE *input_file = fopen(filename, "r");
   if (input_file == NULL) {
+    writer_flush(writer); /* the lines before the error come first */
     fprintf(stderr, "cat: %s: No such file or directory\n", filename);
     return;
   }
@@ -110,7 +136,8 @@ void read_and_output_file_line_by_line(const char *filename,
       break;
     }
 
-    print_line(&line_number, line, line_actual_length, flags, &is_line_empty);
+    print_line(writer, &line_number, line, line_actual_length, flags,
+               &is_line_empty);
   }
 
   free(line); /* because getline allocates memory */
@@ -199,10 +226,16 @@ int main(int counter, const char **arguments) {
   const int status = set_flags(counter, arguments, &flags, &flag_counter);
 
   if (status) {
+    Writer writer;
+    initialize_writer_allocate(&writer, STDOUT_FILENO);
+
     for (int file_index = flag_counter + 1; file_index < counter;
          ++file_index) {
-      read_and_output_file_line_by_line(arguments[file_index], &flags);
+      read_and_output_file_line_by_line(&writer, arguments[file_index],
+                                        &flags);
     }
+
+    free_writer(&writer);
   }
 
   return 0;
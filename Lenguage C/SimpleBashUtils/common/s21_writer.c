@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+#include "s21_writer.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* a few hundred lines of output per system call */
+#define WRITER_CAPACITY (1 << 17)
+
+void initialize_writer_allocate(Writer *writer, int descriptor) {
+  writer->descriptor = descriptor;
+  writer->data = malloc(WRITER_CAPACITY);
+
+  if (!writer->data) {
+    exit(-1);
+  }
+
+  writer->length = 0;
+  writer->capacity = WRITER_CAPACITY;
+  writer->is_failed = 0;
+}
+
+void free_writer(Writer *writer) {
+  writer_flush(writer);
+
+  if (writer->data) {
+    free(writer->data);
+    writer->data = NULL;
+  }
+
+  writer->capacity = 0;
+}
+
+/* writev may stop anywhere inside the pieces, so it is called again on
+   what is left of them */
+void write_pieces(Writer *writer, struct iovec *piece, int count) {
+  while (count > 0 && !writer->is_failed) {
+    const ssize_t written = writev(writer->descriptor, piece, count);
+
+    if (written < 0) {
+      if (errno != EINTR) {
+        writer->is_failed = 1;
+      }
+    } else {
+      size_t left = written;
+      while (count > 0 && left >= piece->iov_len) {
+        left -= piece->iov_len;
+        ++piece;
+        --count;
+      }
+
+      if (count > 0) {
+        piece->iov_base = (char *)piece->iov_base + left;
+        piece->iov_len -= left;
+      }
+    }
+  }
+}
+
+int writer_flush(Writer *writer) {
+  if (writer->length > 0) {
+    struct iovec piece = {writer->data, writer->length};
+
+    write_pieces(writer, &piece, 1);
+    writer->length = 0;
+  }
+
+  return !writer->is_failed;
+}
+
+void writer_write(Writer *writer, const char *data, size_t length) {
+  if (length == 0) {
+    return; /* data may be NULL */
+  }
+
+  if (writer->length + length <= writer->capacity) {
+    memcpy(writer->data + writer->length, data, length);
+    writer->length += length;
+  } else if (length < writer->capacity) {
+    writer_flush(writer);
+    memcpy(writer->data, data, length);
+    writer->length = length;
+  } else {
+    /* no copy of a big piece, the buffer goes first in the same call */
+    struct iovec piece[2] = {{writer->data, writer->length},
+                             {(char *)data, length}};
+
+    write_pieces(writer, piece, 2);
+    writer->length = 0;
+  }
+}
+
+void writer_write_string(Writer *writer, const char *string) {
+  writer_write(writer, string, strlen(string));
+}
+
+void writer_write_character(Writer *writer, char character) {
+  if (writer->length == writer->capacity) {
+    writer_flush(writer);
+  }
+
+  writer->data[writer->length] = character;
+  ++writer->length;
+}
+
+void writer_print_format(Writer *writer, const char *format, ...) {
+  va_list argument;
+  va_list argument_copy;
+  va_start(argument, format);
+  va_copy(argument_copy, argument);
+
+  size_t room = writer->capacity - writer->length;
+  const int length =
+      vsnprintf(writer->data + writer->length, room, format, argument);
+
+  if (length < 0) {
+    writer->is_failed = 1;
+  } else if ((size_t)length < room) {
+    writer->length += length;
+  } else if ((size_t)length < writer->capacity) {
+    writer_flush(writer);
+    vsnprintf(writer->data, writer->capacity, format, argument_copy);
+    writer->length = length;
+  } else {
+    char *text = malloc(length + 1);
+
+    if (!text) {
+      exit(-1);
+    }
+
+    vsnprintf(text, length + 1, format, argument_copy);
+    writer_write(writer, text, length);
+    free(text);
+  }
+
+  va_end(argument_copy);
+  va_end(argument);
+}
@@ -0,0 +1,33 @@
+#ifndef SRC_COMMON_S21_WRITER_H_
+#define SRC_COMMON_S21_WRITER_H_
+
+#include <stddef.h>
+
+//  output to a file descriptor gathered in one big buffer: small pieces are
+//  copied into it, a piece bigger than the buffer goes out together with it
+//  in a single writev, nothing is written before a flush or a full buffer
+typedef struct Writer {
+  int descriptor;
+  char *data;
+  size_t length;
+  size_t capacity;
+  int is_failed; /* a write failed, the rest of the output is dropped */
+} Writer;
+
+void initialize_writer_allocate(Writer *writer, int descriptor);
+
+//  flushes what is left in the buffer
+void free_writer(Writer *writer);
+
+void writer_write(Writer *writer, const char *data, size_t length);
+
+void writer_write_string(Writer *writer, const char *string);
+
+void writer_write_character(Writer *writer, char character);
+
+void writer_print_format(Writer *writer, const char *format, ...);
+
+//  zero when any output of the writer was lost
+int writer_flush(Writer *writer);
+
+#endif  //  SRC_COMMON_S21_WRITER_H_
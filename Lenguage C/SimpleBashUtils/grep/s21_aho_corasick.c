@@ -0,0 +1,205 @@
+#include "s21_aho_corasick.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ROOT_STATE 0u
+/* set in a transition to a matching state, the rest is the row offset */
+#define MATCH_FLAG 0x80000000u
+
+static unsigned char fold_byte(unsigned char symbol, int is_icase) {
+  if (is_icase && symbol >= 'A' && symbol <= 'Z') {
+    symbol = symbol - 'A' + 'a';
+  }
+  return symbol;
+}
+
+static void set_byte_classes(AhoCorasick *automaton, const char *const *words,
+                             int count, int is_icase) {
+  char is_used[256] = {0};
+
+  for (int index = 0; index < count; ++index) {
+    for (const char *symbol = words[index]; *symbol; ++symbol) {
+      is_used[fold_byte((unsigned char)*symbol, is_icase)] = 1;
+    }
+  }
+
+  automaton->class_count = 1;
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    automaton->class_of[symbol] = 0;
+    if (is_used[symbol]) {
+      automaton->class_of[symbol] = automaton->class_count;
+      ++automaton->class_count;
+    }
+  }
+
+  if (is_icase) {
+    for (int symbol = 'A'; symbol <= 'Z'; ++symbol) {
+      automaton->class_of[symbol] = automaton->class_of[symbol - 'A' + 'a'];
+    }
+  }
+}
+
+static uint32_t add_state(AhoCorasick *automaton) {
+  if (automaton->state_count == automaton->allocated_state_count) {
+    const uint32_t new_count = automaton->allocated_state_count * 2;
+
+    uint32_t *transition = realloc(
+        automaton->transition,
+        (size_t)new_count * automaton->class_count * sizeof(uint32_t));
+    char *is_match = realloc(automaton->is_match, new_count);
+
+    if (!transition || !is_match) {
+      exit(-1);
+    }
+
+    automaton->transition = transition;
+    automaton->is_match = is_match;
+    automaton->allocated_state_count = new_count;
+  }
+
+  const uint32_t state = automaton->state_count;
+  memset(automaton->transition + (size_t)state * automaton->class_count, 0,
+         automaton->class_count * sizeof(uint32_t));
+  automaton->is_match[state] = 0;
+  ++automaton->state_count;
+
+  return state;
+}
+
+static void add_word(AhoCorasick *automaton, const char *word) {
+  uint32_t state = ROOT_STATE;
+
+  for (const char *symbol = word; *symbol; ++symbol) {
+    uint32_t *next = automaton->transition +
+                     (size_t)state * automaton->class_count +
+                     automaton->class_of[(unsigned char)*symbol];
+
+    /* nothing goes back to the root inside the trie, 0 means no edge */
+    if (*next == ROOT_STATE) {
+      const uint32_t new_state = add_state(automaton);
+      next = automaton->transition + (size_t)state * automaton->class_count +
+             automaton->class_of[(unsigned char)*symbol];
+      *next = new_state;
+    }
+    state = *next;
+  }
+
+  automaton->is_match[state] = 1;
+}
+
+/* breadth first: a failure state is always shallower, so its row is done */
+static void add_failure_transitions(AhoCorasick *automaton) {
+  const uint32_t class_count = automaton->class_count;
+
+  uint32_t *queue = malloc(automaton->state_count * sizeof(uint32_t));
+  uint32_t *failure = malloc(automaton->state_count * sizeof(uint32_t));
+
+  if (!queue || !failure) {
+    exit(-1);
+  }
+
+  uint32_t head = 0;
+  uint32_t tail = 0;
+
+  failure[ROOT_STATE] = ROOT_STATE;
+  queue[tail++] = ROOT_STATE;
+
+  while (head < tail) {
+    const uint32_t state = queue[head++];
+    uint32_t *row = automaton->transition + (size_t)state * class_count;
+    const uint32_t *failure_row =
+        automaton->transition + (size_t)failure[state] * class_count;
+
+    for (uint32_t symbol_class = 0; symbol_class < class_count;
+         ++symbol_class) {
+      const uint32_t child = row[symbol_class];
+
+      if (child != ROOT_STATE) {
+        failure[child] =
+            state == ROOT_STATE ? ROOT_STATE : failure_row[symbol_class];
+        automaton->is_match[child] |= automaton->is_match[failure[child]];
+        queue[tail++] = child;
+      } else if (state != ROOT_STATE) {
+        row[symbol_class] = failure_row[symbol_class];
+      }
+    }
+  }
+
+  free(queue);
+  free(failure);
+}
+
+/* next states become row offsets with the match flag: one load per byte */
+static void premultiply_transitions(AhoCorasick *automaton) {
+  const size_t transition_count =
+      (size_t)automaton->state_count * automaton->class_count;
+
+  for (size_t index = 0; index < transition_count; ++index) {
+    const uint32_t state = automaton->transition[index];
+
+    automaton->transition[index] = state * automaton->class_count;
+    if (automaton->is_match[state]) {
+      automaton->transition[index] |= MATCH_FLAG;
+    }
+  }
+}
+
+void initialize_aho_corasick_allocate(AhoCorasick *automaton,
+                                      const char *const *words, int count,
+                                      int is_icase) {
+  set_byte_classes(automaton, words, count, is_icase);
+
+  automaton->state_count = 0;
+  automaton->allocated_state_count = 64;
+  automaton->transition = malloc((size_t)automaton->allocated_state_count *
+                                 automaton->class_count * sizeof(uint32_t));
+  automaton->is_match = malloc(automaton->allocated_state_count);
+
+  if (!automaton->transition || !automaton->is_match) {
+    exit(-1);
+  }
+
+  add_state(automaton);
+  for (int index = 0; index < count; ++index) {
+    add_word(automaton, words[index]);
+  }
+  add_failure_transitions(automaton);
+  premultiply_transitions(automaton);
+}
+
+void free_aho_corasick(AhoCorasick *automaton) {
+  if (automaton->transition) {
+    free(automaton->transition);
+    automaton->transition = NULL;
+  }
+
+  if (automaton->is_match) {
+    free(automaton->is_match);
+    automaton->is_match = NULL;
+  }
+
+  automaton->state_count = 0;
+  automaton->allocated_state_count = 0;
+}
+
+const char *aho_corasick_search(const AhoCorasick *automaton,
+                                const char *begin, const char *end) {
+  const uint32_t *transition = automaton->transition;
+  const uint16_t *class_of = automaton->class_of;
+
+  if (automaton->is_match[ROOT_STATE]) { /* -F with an empty string */
+    return begin;
+  }
+
+  uint32_t offset = ROOT_STATE;
+  for (const char *position = begin; position < end; ++position) {
+    offset = transition[offset + class_of[(unsigned char)*position]];
+
+    if (offset & MATCH_FLAG) {
+      return position + 1;
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,29 @@
+#ifndef SRC_GREP_S21_AHO_CORASICK_H_
+#define SRC_GREP_S21_AHO_CORASICK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+//  all fixed strings of a pattern set in one automaton: the failure links
+//  are folded into a dense table, so every byte costs one lookup
+typedef struct AhoCorasick {
+  uint32_t *transition; /* state_count rows of class_count next row offsets */
+  char *is_match;
+  uint32_t state_count;
+  uint32_t allocated_state_count;
+
+  uint16_t class_of[256]; /* bytes absent from the patterns share class 0 */
+  uint32_t class_count;
+} AhoCorasick;
+
+void initialize_aho_corasick_allocate(AhoCorasick *automaton,
+                                      const char *const *words, int count,
+                                      int is_icase);
+
+void free_aho_corasick(AhoCorasick *automaton);
+
+//  end of the first occurrence of any word inside [begin, end) or NULL
+const char *aho_corasick_search(const AhoCorasick *automaton,
+                                const char *begin, const char *end);
+
+#endif  //  SRC_GREP_S21_AHO_CORASICK_H_
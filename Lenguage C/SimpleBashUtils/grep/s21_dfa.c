@@ -0,0 +1,1186 @@
+#include "s21_dfa.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_literal.h"
+
+enum DfaBoolean { DFA_FALSE, DFA_TRUE };
+
+enum NfaType { NFA_SET, NFA_SPLIT, NFA_BEGIN, NFA_END, NFA_MATCH };
+
+enum AstType {
+  AST_SET,
+  AST_EMPTY,
+  AST_CONCATENATION,
+  AST_ALTERNATION,
+  AST_REPETITION,
+  AST_BEGIN,
+  AST_END
+};
+
+/* longer patterns and bigger counted repetitions stay with regexec */
+#define PATTERN_LENGTH_LIMIT 4096
+#define GROUP_DEPTH_LIMIT 256
+#define REPETITION_LIMIT 255
+#define NFA_STATE_LIMIT 16384
+
+/* a full cache starts over, so memory stays bounded on any input */
+#define DFA_STATE_LIMIT 1024
+#define HASH_TABLE_SIZE (4 * DFA_STATE_LIMIT)
+/* more bytes that may start a match make the skip slower than the DFA */
+#define START_BYTE_LIMIT 2
+
+#define REPETITION_INFINITE -1
+
+/* longer required strings are cut, any part of them is required too */
+#define REQUIRED_LENGTH_LIMIT 32
+
+/* a transition is the row offset of the next state; the flag marks the
+   next state as a match, dead or the initial state the search skips from,
+   all ones is a transition not built yet */
+#define STOP_FLAG 0x80000000u
+#define UNKNOWN_TRANSITION 0xffffffffu
+
+typedef struct AstNode {
+  int type;
+  int left;
+  int right;
+  int set_index;
+  int min;
+  int max;
+} AstNode;
+
+typedef struct RegexParser {
+  const char *pattern;
+  const char *position;
+  int is_extended;
+  int is_icase;
+  int is_supported;
+  int depth;
+
+  AstNode *node;
+  int node_count;
+  int node_capacity;
+
+  Dfa *dfa;
+} RegexParser;
+
+/* the strings every match of an AST node has, for the prefilter */
+typedef struct RequiredStrings {
+  int is_exact; /* the node matches exactly one string */
+  char exact[REQUIRED_LENGTH_LIMIT + 1];
+  char prefix[REQUIRED_LENGTH_LIMIT + 1];
+  char suffix[REQUIRED_LENGTH_LIMIT + 1];
+  char must[REQUIRED_LENGTH_LIMIT + 1]; /* somewhere inside the match */
+} RequiredStrings;
+
+typedef struct CharacterClass {
+  const char *name;
+  int (*is_member)(int symbol);
+} CharacterClass;
+
+static void *grow_array(void *array, int *capacity, int count,
+                        size_t element_size) {
+  if (count == *capacity) {
+    *capacity = *capacity ? *capacity * 2 : 16;
+    array = realloc(array, (size_t)*capacity * element_size);
+
+    if (!array) {
+      exit(-1);
+    }
+  }
+
+  return array;
+}
+
+static int add_node(RegexParser *parser, int type, int left, int right) {
+  parser->node = grow_array(parser->node, &parser->node_capacity,
+                            parser->node_count, sizeof(AstNode));
+
+  AstNode *node = &parser->node[parser->node_count];
+  node->type = type;
+  node->left = left;
+  node->right = right;
+  node->set_index = -1;
+  node->min = 0;
+  node->max = 0;
+
+  return parser->node_count++;
+}
+
+static int add_set(Dfa *dfa) {
+  dfa->set =
+      grow_array(dfa->set, &dfa->set_capacity, dfa->set_count, sizeof(ByteSet));
+  memset(&dfa->set[dfa->set_count], 0, sizeof(ByteSet));
+
+  return dfa->set_count++;
+}
+
+static int add_set_node(RegexParser *parser, int set_index) {
+  const int node = add_node(parser, AST_SET, -1, -1);
+  parser->node[node].set_index = set_index;
+
+  return node;
+}
+
+static int add_unsupported_node(RegexParser *parser) {
+  parser->is_supported = DFA_FALSE;
+
+  return add_node(parser, AST_EMPTY, -1, -1);
+}
+
+/* with -i both cases of a letter are members, the text is not folded */
+static void add_other_cases(ByteSet *set) {
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    if (set->is_member[symbol]) {
+      set->is_member[tolower(symbol)] = DFA_TRUE;
+      set->is_member[toupper(symbol)] = DFA_TRUE;
+    }
+  }
+}
+
+static int add_byte_node(RegexParser *parser, unsigned char symbol) {
+  const int set_index = add_set(parser->dfa);
+  ByteSet *set = &parser->dfa->set[set_index];
+
+  set->is_member[symbol] = DFA_TRUE;
+  if (parser->is_icase) {
+    add_other_cases(set);
+  }
+
+  return add_set_node(parser, set_index);
+}
+
+/* '.' is any byte but NUL in the POSIX syntax of glibc */
+static int add_any_byte_node(RegexParser *parser) {
+  const int set_index = add_set(parser->dfa);
+  ByteSet *set = &parser->dfa->set[set_index];
+
+  memset(set->is_member, DFA_TRUE, sizeof(set->is_member));
+  set->is_member[0] = DFA_FALSE;
+
+  return add_set_node(parser, set_index);
+}
+
+static int is_word_byte(int symbol) { return isalnum(symbol) || symbol == '_'; }
+
+/* \w, \W, \s and \S */
+static int add_class_escape_node(RegexParser *parser, char letter) {
+  const int set_index = add_set(parser->dfa);
+  ByteSet *set = &parser->dfa->set[set_index];
+
+  const int is_word = letter == 'w' || letter == 'W';
+  const int is_negated = letter == 'W' || letter == 'S';
+
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    const int is_member = is_word ? is_word_byte(symbol) : isspace(symbol);
+    set->is_member[symbol] = is_negated ? !is_member : is_member != 0;
+  }
+
+  return add_set_node(parser, set_index);
+}
+
+static int is_alternation_next(const RegexParser *parser) {
+  const char *position = parser->position;
+
+  return parser->is_extended ? position[0] == '|'
+                             : position[0] == '\\' && position[1] == '|';
+}
+
+static int is_group_end_next(const RegexParser *parser) {
+  const char *position = parser->position;
+
+  return parser->depth > 0 &&
+         (parser->is_extended ? position[0] == ')'
+                              : position[0] == '\\' && position[1] == ')');
+}
+
+static int is_repetition_next(const RegexParser *parser) {
+  const char *position = parser->position;
+  int is_repetition = position[0] == '*';
+
+  if (parser->is_extended) {
+    is_repetition |= position[0] && strchr("+?{", position[0]);
+  } else if (position[0] == '\\') {
+    is_repetition |= position[1] && strchr("+?{", position[1]);
+  }
+
+  return is_repetition;
+}
+
+static int parse_number(RegexParser *parser) {
+  int number = -1;
+
+  while (isdigit((unsigned char)*parser->position)) {
+    if (number < 0) {
+      number = 0;
+    }
+    if (number <= REPETITION_LIMIT) {
+      number = number * 10 + (*parser->position - '0');
+    }
+    ++parser->position;
+  }
+
+  return number;
+}
+
+/* {m}, {m,}, {,n} and {m,n} after the opening brace */
+static void parse_bounds(RegexParser *parser, int *min, int *max) {
+  *min = parse_number(parser);
+  *max = *min;
+
+  if (*parser->position == ',') {
+    ++parser->position;
+    *max = parse_number(parser);
+    if (*min < 0) {
+      *min = 0;
+    }
+  }
+
+  const char *closing = parser->is_extended ? "}" : "\\}";
+  if (*min < 0 || strncmp(parser->position, closing, strlen(closing))) {
+    parser->is_supported = DFA_FALSE;
+  } else {
+    parser->position += strlen(closing);
+  }
+
+  if (*max > REPETITION_LIMIT || *min > REPETITION_LIMIT ||
+      (*max >= 0 && *max < *min)) {
+    parser->is_supported = DFA_FALSE;
+  }
+}
+
+static void parse_repetition_operator(RegexParser *parser, int *min,
+                                      int *max) {
+  if (*parser->position == '\\') {
+    ++parser->position;
+  }
+
+  const char symbol = *parser->position;
+  ++parser->position;
+
+  *min = symbol == '+' ? 1 : 0;
+  *max = symbol == '?' ? 1 : REPETITION_INFINITE;
+
+  if (symbol == '{') {
+    parse_bounds(parser, min, max);
+    if (*max < 0) {
+      *max = REPETITION_INFINITE;
+    }
+  }
+}
+
+static int add_character_class(RegexParser *parser, ByteSet *set) {
+  static const CharacterClass classes[] = {
+      {"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum},
+      {"upper", isupper}, {"lower", islower}, {"space", isspace},
+      {"blank", isblank}, {"punct", ispunct}, {"print", isprint},
+      {"graph", isgraph}, {"cntrl", iscntrl}, {"xdigit", isxdigit}};
+
+  const char *name = parser->position + 2; /* after "[:" */
+  const char *name_end = strstr(name, ":]");
+  int is_found = DFA_FALSE;
+
+  for (size_t index = 0;
+       name_end && index < sizeof(classes) / sizeof(classes[0]); ++index) {
+    if ((size_t)(name_end - name) == strlen(classes[index].name) &&
+        !strncmp(name, classes[index].name, name_end - name)) {
+      for (int symbol = 0; symbol < 256; ++symbol) {
+        if (classes[index].is_member(symbol)) {
+          set->is_member[symbol] = DFA_TRUE;
+        }
+      }
+      parser->position = name_end + 2;
+      is_found = DFA_TRUE;
+    }
+  }
+
+  return is_found;
+}
+
+/* a bracket expression after its '[', the first ']' is a member */
+static int parse_bracket(RegexParser *parser) {
+  const int set_index = add_set(parser->dfa);
+  ByteSet set;
+  memset(&set, 0, sizeof(set));
+
+  const int is_negated = *parser->position == '^';
+  if (is_negated) {
+    ++parser->position;
+  }
+
+  int is_first = DFA_TRUE;
+  int is_closed = DFA_FALSE;
+  while (parser->is_supported && !is_closed) {
+    const char *position = parser->position;
+    const unsigned char symbol = (unsigned char)position[0];
+
+    if (!symbol ||
+        (symbol == '[' && position[1] && strchr(".=", position[1]))) {
+      parser->is_supported = DFA_FALSE;
+    } else if (symbol == ']' && !is_first) {
+      ++parser->position;
+      is_closed = DFA_TRUE;
+    } else if (symbol == '[' && position[1] == ':') {
+      parser->is_supported = add_character_class(parser, &set);
+    } else if (position[1] == '-' && position[2] && position[2] != ']') {
+      const unsigned char last = (unsigned char)position[2];
+
+      if (last < symbol || (last == '[' && position[3] &&
+                            strchr(".=:", position[3]))) {
+        parser->is_supported = DFA_FALSE;
+      }
+      for (int member = symbol; member <= last; ++member) {
+        set.is_member[member] = DFA_TRUE;
+      }
+      parser->position += 3;
+    } else {
+      set.is_member[symbol] = DFA_TRUE;
+      ++parser->position;
+    }
+
+    is_first = DFA_FALSE;
+  }
+
+  if (parser->is_icase) {
+    add_other_cases(&set);
+  }
+
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    parser->dfa->set[set_index].is_member[symbol] =
+        is_negated ? !set.is_member[symbol] : set.is_member[symbol];
+  }
+
+  return add_set_node(parser, set_index);
+}
+
+static int parse_alternation(RegexParser *parser);
+
+static int parse_group(RegexParser *parser) {
+  if (parser->depth == GROUP_DEPTH_LIMIT) {
+    return add_unsupported_node(parser);
+  }
+
+  ++parser->depth;
+  const int node = parse_alternation(parser);
+  --parser->depth;
+
+  const char *closing = parser->is_extended ? ")" : "\\)";
+  if (strncmp(parser->position, closing, strlen(closing))) {
+    parser->is_supported = DFA_FALSE;
+  } else {
+    parser->position += strlen(closing);
+  }
+
+  return node;
+}
+
+/* the symbol after a backslash */
+static int parse_escape(RegexParser *parser) {
+  const char symbol = parser->position[1];
+  int node = -1;
+
+  parser->position += 2;
+
+  if (!parser->is_extended && symbol == '(') {
+    node = parse_group(parser);
+  } else if (symbol == 'w' || symbol == 'W' || symbol == 's' ||
+             symbol == 'S') {
+    node = add_class_escape_node(parser, symbol);
+  } else if (!symbol || isdigit((unsigned char)symbol) ||
+             strchr("bB<>`'", symbol) ||
+             (!parser->is_extended && strchr("(){}|+?", symbol)) ||
+             (parser->is_icase && isalpha((unsigned char)symbol))) {
+    /* backreferences and word boundaries need regexec, an escaped letter
+       does not match itself with -i in glibc */
+    node = add_unsupported_node(parser);
+  } else {
+    node = add_byte_node(parser, (unsigned char)symbol);
+  }
+
+  return node;
+}
+
+static int parse_atom(RegexParser *parser, int is_context_start) {
+  const char symbol = *parser->position;
+  int node = -1;
+
+  if (symbol == '\\') {
+    node = parse_escape(parser);
+  } else if (symbol == '[') {
+    ++parser->position;
+    node = parse_bracket(parser);
+  } else if (symbol == '.') {
+    ++parser->position;
+    node = add_any_byte_node(parser);
+  } else if (parser->is_extended && symbol == '(') {
+    ++parser->position;
+    node = parse_group(parser);
+  } else if (parser->is_extended && symbol == ')') {
+    node = add_unsupported_node(parser); /* glibc reads it as a literal */
+  } else if (symbol == '^' && parser->position == parser->pattern) {
+    ++parser->position;
+    node = add_node(parser, AST_BEGIN, -1, -1);
+  } else if (symbol == '^' && (parser->is_extended || is_context_start)) {
+    /* glibc lets an inner ^ hold after a newline and at the end */
+    node = add_unsupported_node(parser);
+  } else if (symbol == '$' && parser->position[1] == '\0') {
+    ++parser->position;
+    node = add_node(parser, AST_END, -1, -1);
+  } else if (symbol == '$' &&
+             (parser->is_extended ||
+              (parser->position[1] == '\\' && parser->position[2] &&
+               strchr(")|", parser->position[2])))) {
+    /* and an inner $ before a newline */
+    node = add_unsupported_node(parser);
+  } else {
+    ++parser->position;
+    node = add_byte_node(parser, (unsigned char)symbol);
+  }
+
+  return node;
+}
+
+static int parse_repetition(RegexParser *parser, int is_context_start) {
+  /* a leading '*' is a literal in a BRE and an error in an ERE */
+  if (is_context_start && is_repetition_next(parser)) {
+    return add_unsupported_node(parser);
+  }
+
+  int node = parse_atom(parser, is_context_start);
+
+  while (parser->is_supported && is_repetition_next(parser)) {
+    const int type = parser->node[node].type;
+    if (type == AST_BEGIN || type == AST_END) {
+      parser->is_supported = DFA_FALSE;
+    }
+
+    int min = 0;
+    int max = 0;
+    parse_repetition_operator(parser, &min, &max);
+
+    node = add_node(parser, AST_REPETITION, node, -1);
+    parser->node[node].min = min;
+    parser->node[node].max = max;
+  }
+
+  return node;
+}
+
+static int parse_concatenation(RegexParser *parser) {
+  int node = add_node(parser, AST_EMPTY, -1, -1);
+  int is_context_start = DFA_TRUE;
+
+  while (parser->is_supported && *parser->position &&
+         !is_alternation_next(parser) && !is_group_end_next(parser)) {
+    const int atom = parse_repetition(parser, is_context_start);
+    node = add_node(parser, AST_CONCATENATION, node, atom);
+    is_context_start = DFA_FALSE;
+  }
+
+  return node;
+}
+
+static int parse_alternation(RegexParser *parser) {
+  int node = parse_concatenation(parser);
+
+  while (parser->is_supported && is_alternation_next(parser)) {
+    parser->position += parser->is_extended ? 1 : 2;
+    const int other = parse_concatenation(parser);
+    node = add_node(parser, AST_ALTERNATION, node, other);
+  }
+
+  return node;
+}
+
+static int add_nfa_state(Dfa *dfa, int type, int out, int out_other,
+                         int set_index) {
+  dfa->nfa = grow_array(dfa->nfa, &dfa->nfa_capacity, dfa->nfa_count,
+                        sizeof(NfaState));
+
+  NfaState *state = &dfa->nfa[dfa->nfa_count];
+  state->type = type;
+  state->out = out;
+  state->out_other = out_other;
+  state->set_index = set_index;
+
+  return dfa->nfa_count++;
+}
+
+/* Thompson construction from the end: the entry state of the node that
+   continues to next */
+static int compile_node(Dfa *dfa, const AstNode *ast, int index, int next) {
+  const AstNode *node = &ast[index];
+  int start = next;
+
+  if (dfa->nfa_count > NFA_STATE_LIMIT) {
+    return start;
+  }
+
+  if (node->type == AST_SET) {
+    start = add_nfa_state(dfa, NFA_SET, next, -1, node->set_index);
+  } else if (node->type == AST_CONCATENATION) {
+    start = compile_node(dfa, ast, node->left,
+                         compile_node(dfa, ast, node->right, next));
+  } else if (node->type == AST_ALTERNATION) {
+    const int left = compile_node(dfa, ast, node->left, next);
+    const int right = compile_node(dfa, ast, node->right, next);
+    start = add_nfa_state(dfa, NFA_SPLIT, left, right, -1);
+  } else if (node->type == AST_BEGIN || node->type == AST_END) {
+    start = add_nfa_state(dfa, node->type == AST_BEGIN ? NFA_BEGIN : NFA_END,
+                          next, -1, -1);
+  } else if (node->type == AST_REPETITION) {
+    if (node->max == REPETITION_INFINITE) {
+      const int loop = add_nfa_state(dfa, NFA_SPLIT, -1, next, -1);
+      /* compile_node may move dfa->nfa */
+      const int body = compile_node(dfa, ast, node->left, loop);
+      dfa->nfa[loop].out = body;
+      start = loop;
+    } else {
+      for (int count = node->min; count < node->max; ++count) {
+        const int body = compile_node(dfa, ast, node->left, start);
+        start = add_nfa_state(dfa, NFA_SPLIT, body, next, -1);
+      }
+    }
+
+    for (int count = 0; count < node->min; ++count) {
+      start = compile_node(dfa, ast, node->left, start);
+    }
+  }
+
+  return start;
+}
+
+/* bytes that belong to the same sets behave the same in every state */
+static void set_byte_classes(Dfa *dfa) {
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    dfa->class_of[symbol] = 0;
+  }
+  dfa->class_count = 1;
+
+  for (int set_index = 0; set_index < dfa->set_count; ++set_index) {
+    const ByteSet *set = &dfa->set[set_index];
+    int new_class[2 * 256];
+    int new_count = 0;
+
+    for (int index = 0; index < 2 * dfa->class_count; ++index) {
+      new_class[index] = -1;
+    }
+
+    for (int symbol = 0; symbol < 256; ++symbol) {
+      const int key = dfa->class_of[symbol] * 2 + (set->is_member[symbol] != 0);
+
+      if (new_class[key] < 0) {
+        new_class[key] = new_count++;
+      }
+      dfa->class_of[symbol] = new_class[key];
+    }
+    dfa->class_count = new_count;
+  }
+
+  for (int symbol = 255; symbol >= 0; --symbol) {
+    dfa->class_byte[dfa->class_of[symbol]] = (unsigned char)symbol;
+  }
+}
+
+/* a new mark for the visited states, old marks are wiped on overflow */
+static void start_generation(Dfa *dfa) {
+  ++dfa->generation;
+
+  if (dfa->generation == 0) {
+    memset(dfa->visited, 0, dfa->nfa_count * sizeof(unsigned));
+    dfa->generation = 1;
+  }
+}
+
+static int compare_states(const void *first, const void *second) {
+  return *(const int *)first - *(const int *)second;
+}
+
+/* appends to dfa->closure the set states, the match state and the $
+   states reachable from nfa_index without a byte */
+static int add_closure(Dfa *dfa, int nfa_index, int length, int is_at_start) {
+  int stack_size = 0;
+  dfa->stack[stack_size++] = nfa_index;
+
+  while (stack_size > 0) {
+    const int index = dfa->stack[--stack_size];
+
+    if (index >= 0 && dfa->visited[index] != dfa->generation) {
+      const NfaState *state = &dfa->nfa[index];
+      dfa->visited[index] = dfa->generation;
+
+      if (state->type == NFA_SPLIT) {
+        dfa->stack[stack_size++] = state->out_other;
+        dfa->stack[stack_size++] = state->out;
+      } else if (state->type == NFA_BEGIN) {
+        if (is_at_start) {
+          dfa->stack[stack_size++] = state->out;
+        }
+      } else {
+        dfa->closure[length++] = index;
+      }
+    }
+  }
+
+  return length;
+}
+
+/* at the end of the text every $ holds */
+static int is_match_at_end(Dfa *dfa, const int *list, int length,
+                           int is_at_start) {
+  int is_match = DFA_FALSE;
+  int stack_size = 0;
+
+  start_generation(dfa);
+  for (int index = 0; index < length; ++index) {
+    dfa->stack[stack_size++] = list[index];
+  }
+
+  while (!is_match && stack_size > 0) {
+    const int index = dfa->stack[--stack_size];
+
+    if (index >= 0 && dfa->visited[index] != dfa->generation) {
+      const NfaState *state = &dfa->nfa[index];
+      dfa->visited[index] = dfa->generation;
+
+      if (state->type == NFA_MATCH) {
+        is_match = DFA_TRUE;
+      } else if (state->type == NFA_SPLIT) {
+        dfa->stack[stack_size++] = state->out_other;
+        dfa->stack[stack_size++] = state->out;
+      } else if (state->type == NFA_END ||
+                 (state->type == NFA_BEGIN && is_at_start)) {
+        dfa->stack[stack_size++] = state->out;
+      }
+    }
+  }
+
+  return is_match;
+}
+
+static uint32_t hash_list(const int *list, int length) {
+  uint32_t hash = 2166136261u;
+
+  for (int index = 0; index < length; ++index) {
+    hash = (hash ^ (uint32_t)list[index]) * 16777619u;
+  }
+
+  return hash;
+}
+
+static int find_state(const Dfa *dfa, const int *list, int length,
+                      uint32_t *slot) {
+  int found = -1;
+
+  *slot = hash_list(list, length) & (HASH_TABLE_SIZE - 1);
+  while (found < 0 && dfa->hash_table[*slot] >= 0) {
+    const DfaState *state = &dfa->state[dfa->hash_table[*slot]];
+
+    if (state->list_length == length &&
+        !memcmp(dfa->list + state->list_begin, list, length * sizeof(int))) {
+      found = dfa->hash_table[*slot];
+    } else {
+      *slot = (*slot + 1) & (HASH_TABLE_SIZE - 1);
+    }
+  }
+
+  return found;
+}
+
+static void clear_states(Dfa *dfa) {
+  for (int slot = 0; slot < HASH_TABLE_SIZE; ++slot) {
+    dfa->hash_table[slot] = -1;
+  }
+
+  dfa->state_count = 0;
+  dfa->list_length = 0;
+  dfa->initial_state = -1;
+  dfa->start_byte_count = 256;
+}
+
+/* the list is in dfa->closure */
+static int add_state(Dfa *dfa, int length, uint32_t slot) {
+  const int index = dfa->state_count;
+
+  if (index % 16 == 0) {
+    const size_t capacity = index + 16;
+
+    dfa->state = realloc(dfa->state, capacity * sizeof(DfaState));
+    dfa->transition = realloc(dfa->transition, capacity * dfa->class_count *
+                                                   sizeof(uint32_t));
+    if (!dfa->state || !dfa->transition) {
+      exit(-1);
+    }
+  }
+
+  if (dfa->list_length + length > dfa->list_capacity) {
+    while (dfa->list_length + length > dfa->list_capacity) {
+      dfa->list_capacity = dfa->list_capacity ? dfa->list_capacity * 2 : 1024;
+    }
+    dfa->list = realloc(dfa->list, dfa->list_capacity * sizeof(int));
+
+    if (!dfa->list) {
+      exit(-1);
+    }
+  }
+
+  DfaState *state = &dfa->state[index];
+  state->list_begin = dfa->list_length;
+  state->list_length = length;
+  memcpy(dfa->list + dfa->list_length, dfa->closure, length * sizeof(int));
+  dfa->list_length += length;
+
+  state->is_match = DFA_FALSE;
+  for (int member = 0; member < length; ++member) {
+    state->is_match |= dfa->nfa[dfa->closure[member]].type == NFA_MATCH;
+  }
+  state->is_match_at_end =
+      is_match_at_end(dfa, dfa->closure, length, DFA_FALSE);
+  state->is_dead = length == 0;
+
+  for (int symbol_class = 0; symbol_class < dfa->class_count;
+       ++symbol_class) {
+    dfa->transition[(size_t)index * dfa->class_count + symbol_class] =
+        UNKNOWN_TRANSITION;
+  }
+
+  dfa->hash_table[slot] = index;
+  ++dfa->state_count;
+
+  return index;
+}
+
+static int find_or_add_state(Dfa *dfa, int length) {
+  qsort(dfa->closure, length, sizeof(int), compare_states);
+
+  uint32_t slot = 0;
+  int index = find_state(dfa, dfa->closure, length, &slot);
+
+  if (index < 0 && dfa->state_count == DFA_STATE_LIMIT) {
+    clear_states(dfa);
+    find_state(dfa, dfa->closure, length, &slot);
+  }
+
+  if (index < 0) {
+    index = add_state(dfa, length, slot);
+  }
+
+  return index;
+}
+
+static int add_initial_state(Dfa *dfa) {
+  start_generation(dfa);
+  const int length = add_closure(dfa, dfa->nfa_start, 0, DFA_TRUE);
+
+  return find_or_add_state(dfa, length);
+}
+
+/* a match may also start right after the byte, so the start state is
+   always part of the next state */
+static int add_transition(Dfa *dfa, int state_index, int symbol_class) {
+  const unsigned char symbol = dfa->class_byte[symbol_class];
+  const DfaState *state = &dfa->state[state_index];
+  const int state_count = dfa->state_count;
+
+  start_generation(dfa);
+  int length = 0;
+  for (int member = 0; member < state->list_length; ++member) {
+    const NfaState *nfa = &dfa->nfa[dfa->list[state->list_begin + member]];
+
+    if (nfa->type == NFA_SET && dfa->set[nfa->set_index].is_member[symbol]) {
+      length = add_closure(dfa, nfa->out, length, DFA_FALSE);
+    }
+  }
+  length = add_closure(dfa, dfa->nfa_start, length, DFA_FALSE);
+
+  const int next = find_or_add_state(dfa, length);
+
+  /* the cache started over, the old state is gone */
+  if (dfa->state_count >= state_count) {
+    const DfaState *next_state = &dfa->state[next];
+    uint32_t offset = (uint32_t)next * dfa->class_count;
+
+    if (next_state->is_match || next_state->is_dead ||
+        (next == dfa->initial_state &&
+         dfa->start_byte_count <= START_BYTE_LIMIT)) {
+      offset |= STOP_FLAG;
+    }
+    dfa->transition[(size_t)state_index * dfa->class_count + symbol_class] =
+        offset;
+  }
+
+  return next;
+}
+
+/* like the fastmap of glibc: the bytes that can begin a match, the others
+   keep the search in the initial state */
+static void set_start_bytes(Dfa *dfa) {
+  const int initial_state = dfa->initial_state;
+  int count = 0;
+
+  for (int symbol = 0; symbol < 256 && dfa->initial_state == initial_state;
+       ++symbol) {
+    const int symbol_class = dfa->class_of[symbol];
+    const uint32_t next =
+        dfa->transition[(size_t)initial_state * dfa->class_count +
+                        symbol_class];
+    int next_state = (int)((next & ~STOP_FLAG) / dfa->class_count);
+
+    if (next == UNKNOWN_TRANSITION) {
+      next_state = add_transition(dfa, initial_state, symbol_class);
+    }
+
+    if (next_state != initial_state) {
+      if (count < START_BYTE_LIMIT) {
+        dfa->start_byte[count] = (unsigned char)symbol;
+      }
+      ++count;
+    }
+  }
+
+  /* the cache started over on the way, the search goes without skips */
+  if (dfa->initial_state == initial_state) {
+    dfa->start_byte_count = count;
+  } else {
+    dfa->initial_state = add_initial_state(dfa);
+  }
+}
+
+static const char *skip_to_start_byte(const Dfa *dfa, const char *begin,
+                                      const char *end) {
+  const char *found = NULL;
+
+  if (dfa->start_byte_count == 1) {
+    found = memchr(begin, dfa->start_byte[0], end - begin);
+  } else if (dfa->start_byte_count == 2) {
+    found = find_either_byte(begin, end, dfa->start_byte[0],
+                             dfa->start_byte[1]);
+  }
+
+  return found ? found : end;
+}
+
+/* the one byte a set stands for or -1, a letter is lower case with -i */
+static int get_set_byte(const ByteSet *set, int is_icase) {
+  int first = -1;
+  int count = 0;
+
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    if (set->is_member[symbol]) {
+      if (first < 0) {
+        first = symbol;
+      }
+      ++count;
+    }
+  }
+
+  if (is_icase && first >= 0) {
+    first = tolower(first);
+  }
+
+  /* with -i the prefilter ignores case, so both cases are one byte */
+  const int is_one_byte =
+      count == 1 || (is_icase && count == 2 && set->is_member[first] &&
+                     set->is_member[toupper(first)] && first != toupper(first));
+
+  return is_one_byte && first > 0 ? first : -1;
+}
+
+static void join_strings(char *target, const char *first, const char *second,
+                         int is_tail_kept) {
+  char joined[2 * REQUIRED_LENGTH_LIMIT + 1];
+  const size_t first_length = strlen(first);
+  const size_t second_length = strlen(second);
+
+  memcpy(joined, first, first_length);
+  memcpy(joined + first_length, second, second_length + 1);
+
+  const size_t length = first_length + second_length;
+  const char *kept = joined;
+  if (length > REQUIRED_LENGTH_LIMIT && is_tail_kept) {
+    kept = joined + length - REQUIRED_LENGTH_LIMIT;
+  }
+
+  strncpy(target, kept, REQUIRED_LENGTH_LIMIT);
+  target[REQUIRED_LENGTH_LIMIT] = '\0';
+}
+
+static void keep_longer(char *target, const char *candidate) {
+  if (strlen(candidate) > strlen(target)) {
+    strcpy(target, candidate);
+  }
+}
+
+static void set_common_prefix(char *target, const char *first,
+                              const char *second) {
+  size_t length = 0;
+  while (first[length] && first[length] == second[length]) {
+    target[length] = first[length];
+    ++length;
+  }
+  target[length] = '\0';
+}
+
+static void set_common_suffix(char *target, const char *first,
+                              const char *second) {
+  const size_t first_length = strlen(first);
+  const size_t second_length = strlen(second);
+
+  size_t length = 0;
+  while (length < first_length && length < second_length &&
+         first[first_length - 1 - length] ==
+             second[second_length - 1 - length]) {
+    ++length;
+  }
+  memmove(target, first + first_length - length, length + 1);
+}
+
+static void set_concatenation_strings(RequiredStrings *strings,
+                                      const RequiredStrings *left,
+                                      const RequiredStrings *right) {
+  strings->is_exact = left->is_exact && right->is_exact &&
+                      strlen(left->exact) + strlen(right->exact) <=
+                          REQUIRED_LENGTH_LIMIT;
+  join_strings(strings->exact, left->exact, right->exact, DFA_FALSE);
+
+  if (left->is_exact) {
+    join_strings(strings->prefix, left->exact, right->prefix, DFA_FALSE);
+  } else {
+    strcpy(strings->prefix, left->prefix);
+  }
+
+  if (right->is_exact) {
+    join_strings(strings->suffix, left->suffix, right->exact, DFA_TRUE);
+  } else {
+    strcpy(strings->suffix, right->suffix);
+  }
+
+  join_strings(strings->must, left->suffix, right->prefix, DFA_FALSE);
+  keep_longer(strings->must, left->must);
+  keep_longer(strings->must, right->must);
+}
+
+static void set_alternation_strings(RequiredStrings *strings,
+                                    const RequiredStrings *left,
+                                    const RequiredStrings *right) {
+  strings->is_exact = left->is_exact && right->is_exact &&
+                      !strcmp(left->exact, right->exact);
+  strcpy(strings->exact, strings->is_exact ? left->exact : "");
+
+  set_common_prefix(strings->prefix, left->prefix, right->prefix);
+  set_common_suffix(strings->suffix, left->suffix, right->suffix);
+
+  strcpy(strings->must, !strcmp(left->must, right->must) ? left->must : "");
+}
+
+static void set_repetition_strings(RequiredStrings *strings,
+                                   const RequiredStrings *child,
+                                   const AstNode *node) {
+  if (node->min == 0) {
+    strings->is_exact = node->max == 0;
+    return; /* all strings stay empty */
+  }
+
+  strcpy(strings->prefix, child->prefix);
+  strcpy(strings->suffix, child->suffix);
+  strcpy(strings->must, child->must);
+
+  /* x{3} is xxx, x{3,} starts and ends with xxx */
+  if (child->is_exact) {
+    for (int count = 1; count < node->min; ++count) {
+      join_strings(strings->prefix, strings->prefix, child->exact, DFA_FALSE);
+      join_strings(strings->suffix, child->exact, strings->suffix, DFA_TRUE);
+    }
+    strcpy(strings->exact, strings->prefix);
+    strings->is_exact =
+        node->min == node->max &&
+        strlen(child->exact) * node->min <= REQUIRED_LENGTH_LIMIT;
+    keep_longer(strings->must, strings->prefix);
+  }
+}
+
+/* the nodes come after their children, so one pass is enough */
+static void set_required_literal(Dfa *dfa, const RegexParser *parser,
+                                 int root) {
+  RequiredStrings *strings =
+      calloc(parser->node_count, sizeof(RequiredStrings));
+
+  if (!strings) {
+    exit(-1);
+  }
+
+  for (int index = 0; index <= root; ++index) {
+    const AstNode *node = &parser->node[index];
+    RequiredStrings *current = &strings[index];
+
+    if (node->type == AST_SET) {
+      const int symbol =
+          get_set_byte(&dfa->set[node->set_index], parser->is_icase);
+
+      current->is_exact = symbol > 0;
+      if (current->is_exact) {
+        current->exact[0] = (char)symbol;
+        strcpy(current->prefix, current->exact);
+        strcpy(current->suffix, current->exact);
+        strcpy(current->must, current->exact);
+      }
+    } else if (node->type == AST_CONCATENATION) {
+      set_concatenation_strings(current, &strings[node->left],
+                                &strings[node->right]);
+    } else if (node->type == AST_ALTERNATION) {
+      set_alternation_strings(current, &strings[node->left],
+                              &strings[node->right]);
+    } else if (node->type == AST_REPETITION) {
+      set_repetition_strings(current, &strings[node->left], node);
+    } else { /* the empty string and the anchors */
+      current->is_exact = DFA_TRUE;
+    }
+
+    keep_longer(current->must, current->prefix);
+    keep_longer(current->must, current->suffix);
+  }
+
+  const char *must = strings[root].must;
+  dfa->required_literal = malloc(strlen(must) + 1);
+
+  if (!dfa->required_literal) {
+    exit(-1);
+  }
+  strcpy(dfa->required_literal, must);
+
+  free(strings);
+}
+
+static void initialize_dfa(Dfa *dfa) {
+  memset(dfa, 0, sizeof(*dfa));
+  dfa->initial_state = -1;
+}
+
+int initialize_dfa_allocate(Dfa *dfa, const char *word, int is_extended,
+                            int is_icase) {
+  initialize_dfa(dfa);
+
+  RegexParser parser;
+  memset(&parser, 0, sizeof(parser));
+  parser.pattern = word;
+  parser.position = word;
+  parser.is_extended = is_extended;
+  parser.is_icase = is_icase;
+  parser.is_supported = strlen(word) <= PATTERN_LENGTH_LIMIT;
+  parser.dfa = dfa;
+
+  int root = -1;
+  if (parser.is_supported) {
+    root = parse_alternation(&parser);
+  }
+
+  if (parser.is_supported && *parser.position) {
+    parser.is_supported = DFA_FALSE; /* an unmatched \) */
+  }
+
+  if (parser.is_supported) {
+    const int match = add_nfa_state(dfa, NFA_MATCH, -1, -1, -1);
+    dfa->nfa_start = compile_node(dfa, parser.node, root, match);
+    parser.is_supported = dfa->nfa_count <= NFA_STATE_LIMIT;
+  }
+
+  if (parser.is_supported) {
+    set_required_literal(dfa, &parser, root);
+  }
+
+  free(parser.node);
+
+  if (!parser.is_supported) {
+    free_dfa(dfa);
+    return DFA_FALSE;
+  }
+
+  set_byte_classes(dfa);
+
+  dfa->closure = malloc(dfa->nfa_count * sizeof(int));
+  dfa->stack = malloc((3 * dfa->nfa_count + 2) * sizeof(int));
+  dfa->visited = calloc(dfa->nfa_count, sizeof(unsigned));
+  dfa->hash_table = malloc(HASH_TABLE_SIZE * sizeof(int));
+
+  if (!dfa->closure || !dfa->stack || !dfa->visited || !dfa->hash_table) {
+    exit(-1);
+  }
+
+  clear_states(dfa);
+  dfa->is_empty_match = is_match_at_end(dfa, &dfa->nfa_start, 1, DFA_TRUE);
+
+  return DFA_TRUE;
+}
+
+void free_dfa(Dfa *dfa) {
+  free(dfa->nfa);
+  free(dfa->set);
+  free(dfa->state);
+  free(dfa->transition);
+  free(dfa->list);
+  free(dfa->hash_table);
+  free(dfa->closure);
+  free(dfa->stack);
+  free(dfa->visited);
+  free(dfa->required_literal);
+
+  initialize_dfa(dfa);
+}
+
+int dfa_search(Dfa *dfa, const char *begin, const char *end) {
+  if (begin == end) {
+    return dfa->is_empty_match;
+  }
+
+  if (dfa->initial_state < 0) {
+    dfa->initial_state = add_initial_state(dfa);
+    set_start_bytes(dfa);
+  }
+
+  int state = dfa->initial_state;
+  const char *position = begin;
+
+  while (!dfa->state[state].is_match && !dfa->state[state].is_dead &&
+         position < end) {
+    if (state == dfa->initial_state &&
+        dfa->start_byte_count <= START_BYTE_LIMIT) {
+      position = skip_to_start_byte(dfa, position, end);
+      if (position == end) {
+        break;
+      }
+    }
+
+    const uint32_t *transition = dfa->transition;
+    const uint16_t *class_of = dfa->class_of;
+    const uint32_t class_count = dfa->class_count;
+
+    uint32_t offset = (uint32_t)state * class_count;
+    uint32_t next = 0;
+
+    /* one load per byte while the next state is built and not final */
+    while (position < end &&
+           (next = transition[offset + class_of[(unsigned char)*position]]) <
+               STOP_FLAG) {
+      offset = next;
+      ++position;
+    }
+
+    state = offset / class_count;
+    if (position < end) {
+      const int symbol_class = class_of[(unsigned char)*position];
+
+      if (next == UNKNOWN_TRANSITION) {
+        state = add_transition(dfa, state, symbol_class);
+      } else {
+        state = (next & ~STOP_FLAG) / class_count;
+      }
+      ++position;
+    }
+  }
+
+  /* a match state also holds at the end, a dead one never */
+  return dfa->state[state].is_match_at_end;
+}
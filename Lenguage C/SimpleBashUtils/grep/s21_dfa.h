@@ -0,0 +1,80 @@
+#ifndef SRC_GREP_S21_DFA_H_
+#define SRC_GREP_S21_DFA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+//  a regex without backreferences as a Thompson NFA, searched through a DFA
+//  whose states are built the first time a line needs them and kept for
+//  the next lines: every byte of a line costs one table lookup
+typedef struct NfaState {
+  int type;
+  int out;
+  int out_other; /* the second branch of a split */
+  int set_index; /* the bytes a set state accepts */
+} NfaState;
+
+typedef struct ByteSet {
+  unsigned char is_member[256];
+} ByteSet;
+
+typedef struct DfaState {
+  size_t list_begin; /* the NFA states of the DFA state inside Dfa.list */
+  int list_length;
+
+  int is_match;
+  int is_match_at_end; /* after the last byte, where $ holds */
+  int is_dead;         /* no match can start any more */
+} DfaState;
+
+typedef struct Dfa {
+  NfaState *nfa;
+  int nfa_count;
+  int nfa_capacity;
+  int nfa_start;
+
+  ByteSet *set;
+  int set_count;
+  int set_capacity;
+
+  uint16_t class_of[256]; /* bytes no set tells apart share a class */
+  unsigned char class_byte[256];
+  int class_count;
+
+  /* the cache of DFA states, dropped as a whole when it is full */
+  DfaState *state;
+  int state_count;
+  uint32_t *transition; /* state_count rows of class_count row offsets */
+  int *list;
+  size_t list_length;
+  size_t list_capacity;
+  int *hash_table;
+  int initial_state;
+  int is_empty_match;
+
+  /* the bytes that leave the initial state, kept when there are only two */
+  int start_byte_count;
+  unsigned char start_byte[2];
+
+  /* in every match, folded to lower case for -i, "" when no string is */
+  char *required_literal;
+
+  /* scratch space of the closure */
+  int *closure;
+  int *stack;
+  unsigned *visited;
+  unsigned generation;
+} Dfa;
+
+//  False when the pattern needs regexec: backreferences, word boundaries,
+//  collating elements and the rare syntax glibc reads its own way
+int initialize_dfa_allocate(Dfa *dfa, const char *word, int is_extended,
+                            int is_icase);
+
+void free_dfa(Dfa *dfa);
+
+//  does any part of [begin, end) match, the same answer regexec with
+//  REG_STARTEND gives for a pattern compiled without REG_NEWLINE
+int dfa_search(Dfa *dfa, const char *begin, const char *end);
+
+#endif  //  SRC_GREP_S21_DFA_H_
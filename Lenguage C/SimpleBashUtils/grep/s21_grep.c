@@ -1,10 +1,22 @@
 #define _GNU_SOURCE
 #include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
 #include <regex.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-#include "../common/s21_getline.h"
+#include "../common/s21_writer.h"
+#include "s21_aho_corasick.h"
+#include "s21_dfa.h"
+#include "s21_literal.h"
 
 enum Boolean { False, True };
 
@@ -19,8 +31,12 @@ typedef struct Flags {
   char s;
   char f;
   char o;
+  char F;
+  char r; /* -r and -R: directories are searched with all they hold */
+  char R; /* -R: and symbolic links inside them are followed */
 
   char print_filename;
+  int thread_count; /* -j, files searched at the same time */
 } Flags;
 
 typedef struct FileStruct {
@@ -35,7 +51,10 @@ enum ArgumentTypes {
   ONLY_FLAG_T = 0,
   PATTERN_T = 1,
   FILENAME_T = 2,
-  REGEX_FILENAME_T = 3
+  REGEX_FILENAME_T = 3,
+  INCLUDE_GLOB_T = 4,
+  EXCLUDE_GLOB_T = 5,
+  EXCLUDE_DIRECTORY_GLOB_T = 6
 };
 
 typedef struct Arguments {
@@ -81,286 +100,1765 @@ void initialize_flags(Flags *flags) {
   flags->s = False;
   flags->f = False;
   flags->o = False;
+  flags->F = False;
+  flags->r = False;
+  flags->R = False;
 
   flags->print_filename = False;
+  flags->thread_count = 1;
 }
 
-void print_line_number(int number) { printf("%d:", number); }
+/* a line number of a chunk that does not know its first line number yet */
+typedef struct NumberMark {
+  size_t offset;
+  int number;
+} NumberMark;
+
+/* output of one job, kept in memory until it is this job's turn */
+typedef struct Output {
+  char *data;
+  size_t length;
+  size_t capacity;
+
+  NumberMark *mark;
+  int mark_count;
+  int mark_capacity;
+  int is_numbering_deferred;
+} Output;
+
+void initialize_output(Output *output) {
+  output->data = NULL;
+  output->length = 0;
+  output->capacity = 0;
+  output->mark = NULL;
+  output->mark_count = 0;
+  output->mark_capacity = 0;
+  output->is_numbering_deferred = False;
+}
+
+void free_output(Output *output) {
+  if (output->data) {
+    free(output->data);
+    output->data = NULL;
+  }
+
+  if (output->mark) {
+    free(output->mark);
+    output->mark = NULL;
+  }
+
+  output->length = 0;
+  output->capacity = 0;
+  output->mark_count = 0;
+  output->mark_capacity = 0;
+}
+
+void output_append(Output *output, const char *data, size_t length) {
+  if (output->length + length > output->capacity) {
+    size_t capacity = output->capacity ? output->capacity : 4096;
+    while (capacity < output->length + length) {
+      capacity *= 2;
+    }
+
+    output->data = realloc(output->data, capacity);
+
+    if (!output->data) {
+      exit(-1);
+    }
+    output->capacity = capacity;
+  }
+
+  memcpy(output->data + output->length, data, length);
+  output->length += length;
+}
+
+void output_append_string(Output *output, const char *string) {
+  output_append(output, string, strlen(string));
+}
+
+void output_append_mark(Output *output, int number) {
+  if (output->mark_count == output->mark_capacity) {
+    output->mark_capacity = output->mark_capacity ? output->mark_capacity * 2
+                                                   : 256;
+    output->mark =
+        realloc(output->mark, output->mark_capacity * sizeof(NumberMark));
+
+    if (!output->mark) {
+      exit(-1);
+    }
+  }
+
+  output->mark[output->mark_count].offset = output->length;
+  output->mark[output->mark_count].number = number;
+  ++output->mark_count;
+}
+
+/* a deferred number is written when the lines before the chunk are known */
+void print_line_number(Output *output, int number) {
+  if (output->is_numbering_deferred) {
+    output_append_mark(output, number);
+  } else {
+    char text[16];
+    const int length = snprintf(text, sizeof(text), "%d:", number);
+
+    output_append(output, text, length);
+  }
+}
+
+/* line_base is the count of lines before the chunk of the output */
+void write_output(Output *output, Writer *writer, int line_base) {
+  size_t written = 0;
+
+  for (int index = 0; index < output->mark_count; ++index) {
+    const NumberMark *mark = &output->mark[index];
+
+    writer_write(writer, output->data + written, mark->offset - written);
+    writer_print_format(writer, "%d:", line_base + mark->number);
+    written = mark->offset;
+  }
+
+  writer_write(writer, output->data + written, output->length - written);
+
+  output->length = 0;
+  output->mark_count = 0;
+}
 
 typedef struct Line {
   const char *line;
-  int length;
+  int length; /* with the newline, which patterns do not see */
   int has_newline_at_end;
   int line_number;
   int match_counter;
   const char *pattern_word;
   const char *filename;
+  Output *output;
 } Line;
 
-void print_line(const Line *line, const Flags *flags) {
-  if (flags->print_filename && !flags->h) {
-    printf("%s:", line->filename);
+void print_filename(Output *output, const char *filename) {
+  output_append_string(output, filename);
+  output_append(output, ":", 1);
+}
+
+/* called by -j workers: strerror may share its buffer between threads, the
+   GNU strerror_r returns either the local buffer or a constant string */
+void print_file_error(Output *errors, const char *filename) {
+  char buffer[256];
+  const char *message = strerror_r(errno, buffer, sizeof(buffer));
+
+  output_append_string(errors, "grep: ");
+  output_append_string(errors, filename);
+  output_append_string(errors, ": ");
+  output_append_string(errors, message);
+  output_append(errors, "\n", 1);
+}
+
+void print_line(const Line *line, const Flags *flags) {
+  if (flags->print_filename && !flags->h) {
+    print_filename(line->output, line->filename);
+  }
+
+  if (flags->n) {
+    print_line_number(line->output, line->line_number);
+  }
+
+  output_append(line->output, line->line, line->length);
+}
+
+int get_string_length(const char *string) {
+  if (!string) {
+    return 0;
+  }
+
+  int length = 0;
+  while (string[length]) {
+    ++length;
+  }
+  return length;
+}
+
+void print_for_o(const Line *line, int begin, int end, const Flags *flags,
+                 int *is_beginning_of_the_line) {
+  if (*is_beginning_of_the_line) {
+    if (flags->print_filename && !flags->h) {
+      print_filename(line->output, line->filename);
+    }
+
+    if (flags->n) {
+      print_line_number(line->output, line->line_number);
+    }
+
+    *is_beginning_of_the_line = False;
+  }
+
+  output_append(line->output, line->line + begin, end - begin);
+  output_append(line->output, "\n", 1);
+}
+
+typedef struct CompiledPattern {
+  regex_t regex;
+  int is_compiled;
+
+  Dfa *dfa; /* NULL when only regexec knows the pattern */
+
+  LiteralPattern literal; /* plain strings skip the regex engine */
+  int is_literal;
+} CompiledPattern;
+
+typedef struct PatternSet {
+  CompiledPattern *pattern;
+  int count;
+
+  int argument_pattern_count; /* -e patterns go first, then -f patterns */
+
+  AhoCorasick literal_set; /* all fixed strings in one pass over a line */
+  int has_literal_set;
+  int *regex_pattern_index; /* the patterns left out of the literal set */
+  int regex_pattern_count;
+
+  /* every match holds one of the required strings: the fixed strings and
+     the strings each regex needs, so a buffer is searched for them first
+     and only the lines with a hit go to the patterns */
+  const AhoCorasick *required_set;
+  const LiteralPattern *required_literal;
+  AhoCorasick required_set_allocated;
+  LiteralPattern required_literal_allocated;
+  int is_buffer_searchable;
+} PatternSet;
+
+/* below this a few memchr scans are faster than the automaton */
+#define LITERAL_SET_MIN_COUNT 4
+
+void initialize_pattern_set(PatternSet *pattern_set) {
+  pattern_set->pattern = NULL;
+  pattern_set->count = 0;
+  pattern_set->argument_pattern_count = 0;
+  pattern_set->has_literal_set = False;
+  pattern_set->regex_pattern_index = NULL;
+  pattern_set->regex_pattern_count = 0;
+  pattern_set->required_set = NULL;
+  pattern_set->required_literal = NULL;
+  pattern_set->is_buffer_searchable = False;
+}
+
+void compile_pattern(CompiledPattern *pattern, const char *regex_word,
+                     int cflags, int is_fixed_string, int is_error_reported) {
+  pattern->is_literal =
+      is_fixed_string || is_literal_pattern(regex_word, cflags & REG_EXTENDED);
+
+  pattern->dfa = NULL;
+
+  if (pattern->is_literal) {
+    initialize_literal_pattern_allocate(&pattern->literal, regex_word,
+                                        cflags & REG_ICASE);
+    pattern->is_compiled = True;
+  } else {
+    pattern->is_compiled = !regcomp(&pattern->regex, regex_word, cflags);
+  }
+
+  /* regexec still finds the -o matches, the DFA answers "any match" */
+  if (pattern->is_compiled && !pattern->is_literal) {
+    pattern->dfa = malloc(sizeof(Dfa));
+
+    if (!pattern->dfa) {
+      exit(-1);
+    }
+
+    if (!initialize_dfa_allocate(pattern->dfa, regex_word,
+                                 cflags & REG_EXTENDED, cflags & REG_ICASE)) {
+      free(pattern->dfa);
+      pattern->dfa = NULL;
+    }
+  }
+
+  if (!pattern->is_compiled && is_error_reported) {
+    fprintf(stderr, "Regex compilation fail\n");
+  }
+}
+
+/* the same contract as regexec: True and the first match or False */
+int execute_pattern(const CompiledPattern *pattern, const char *text,
+                    int length, regmatch_t *match) {
+  int is_found = False;
+
+  if (pattern->is_literal) {
+    const char *found =
+        literal_search(&pattern->literal, text, text + length);
+
+    if (found) {
+      match->rm_so = found - text;
+      match->rm_eo = match->rm_so + pattern->literal.length;
+      is_found = True;
+    }
+  } else {
+    /* the text is a span of a buffer, not a terminated string */
+    match->rm_so = 0;
+    match->rm_eo = length;
+    is_found = !regexec(&pattern->regex, text, 1, match, REG_STARTEND);
+  }
+
+  return is_found;
+}
+
+/* only whether the text has a match, without its position */
+int is_pattern_found(const CompiledPattern *pattern, const char *text,
+                     int length) {
+  int is_found = False;
+
+  if (pattern->dfa) {
+    is_found = dfa_search(pattern->dfa, text, text + length);
+  } else {
+    regmatch_t match;
+    is_found = execute_pattern(pattern, text, length, &match);
+  }
+
+  return is_found;
+}
+
+void set_literal_set_allocate(PatternSet *pattern_set, const Flags *flags) {
+  const int count = pattern_set->count + 1;
+  const char **literal_word = malloc(count * sizeof(char *));
+  pattern_set->regex_pattern_index = malloc(count * sizeof(int));
+
+  if (!literal_word || !pattern_set->regex_pattern_index) {
+    exit(-1);
+  }
+
+  int literal_count = 0;
+  for (int index = 0; index < pattern_set->count; ++index) {
+    const LiteralPattern *literal = &pattern_set->pattern[index].literal;
+
+    if (pattern_set->pattern[index].is_literal) {
+      literal_word[literal_count] = (const char *)literal->word;
+      ++literal_count;
+    } else if (pattern_set->pattern[index].is_compiled) {
+      pattern_set->regex_pattern_index[pattern_set->regex_pattern_count] =
+          index;
+      ++pattern_set->regex_pattern_count;
+    }
+  }
+
+  if (literal_count >= LITERAL_SET_MIN_COUNT) {
+    initialize_aho_corasick_allocate(&pattern_set->literal_set, literal_word,
+                                     literal_count, flags->i);
+    pattern_set->has_literal_set = True;
+  }
+
+  free(literal_word);
+}
+
+/* the string a pattern cannot match without or NULL */
+const char *get_required_word(const CompiledPattern *pattern) {
+  const char *word = NULL;
+
+  if (pattern->is_literal) {
+    word = (const char *)pattern->literal.word;
+  } else if (pattern->dfa) {
+    word = pattern->dfa->required_literal;
+  }
+
+  /* a newline would let a hit run into the next line (-F only) */
+  if (word && (!word[0] || strchr(word, '\n'))) {
+    word = NULL;
+  }
+
+  return word;
+}
+
+void set_required_strings_allocate(PatternSet *pattern_set,
+                                   const Flags *flags) {
+  const char **required_word =
+      malloc((pattern_set->count + 1) * sizeof(char *));
+
+  if (!required_word) {
+    exit(-1);
+  }
+
+  int word_count = 0;
+  int last_index = -1;
+  int is_every_pattern_covered = True;
+  for (int index = 0; index < pattern_set->count; ++index) {
+    const CompiledPattern *pattern = &pattern_set->pattern[index];
+    const char *word = get_required_word(pattern);
+
+    if (word) {
+      required_word[word_count] = word;
+      ++word_count;
+      last_index = index;
+    } else if (pattern->is_compiled) {
+      is_every_pattern_covered = False;
+    }
+  }
+
+  /* one pattern without a required string may match any line */
+  if (is_every_pattern_covered && word_count > 0) {
+    if (pattern_set->has_literal_set &&
+        pattern_set->regex_pattern_count == 0) {
+      pattern_set->required_set = &pattern_set->literal_set;
+    } else if (word_count == 1 &&
+               pattern_set->pattern[last_index].is_literal) {
+      pattern_set->required_literal =
+          &pattern_set->pattern[last_index].literal;
+    } else if (word_count == 1) {
+      initialize_literal_pattern_allocate(
+          &pattern_set->required_literal_allocated, required_word[0],
+          flags->i);
+      pattern_set->required_literal =
+          &pattern_set->required_literal_allocated;
+    } else {
+      initialize_aho_corasick_allocate(&pattern_set->required_set_allocated,
+                                       required_word, word_count, flags->i);
+      pattern_set->required_set = &pattern_set->required_set_allocated;
+    }
+  }
+
+  pattern_set->is_buffer_searchable =
+      pattern_set->required_set || pattern_set->required_literal;
+
+  free(required_word);
+}
+
+void set_pattern_set_allocate(PatternSet *pattern_set, const Flags *flags,
+                              const Arguments *arguments_struct,
+                              const FileStruct *all_regexes,
+                              int is_error_reported) {
+  int argument_pattern_count = 0;
+  for (int index = 0; index < arguments_struct->counter; ++index) {
+    if (arguments_struct->type[index] == PATTERN_T) {
+      ++argument_pattern_count;
+    }
+  }
+
+  const int file_pattern_count =
+      all_regexes->line_count > 0 ? all_regexes->line_count : 0;
+  const int total_count = argument_pattern_count + file_pattern_count;
+
+  if (total_count > 0) {
+    pattern_set->pattern = malloc(total_count * sizeof(CompiledPattern));
+
+    if (!pattern_set->pattern) {
+      exit(-1);
+    }
+  }
+
+  const int icase = flags->i ? REG_ICASE : 0;
+
+  for (int index = 0; index < arguments_struct->counter; ++index) {
+    if (arguments_struct->type[index] == PATTERN_T) {
+      compile_pattern(&pattern_set->pattern[pattern_set->count],
+                      arguments_struct->word[index], icase, flags->F,
+                      is_error_reported);
+      ++pattern_set->count;
+    }
+  }
+  pattern_set->argument_pattern_count = pattern_set->count;
+
+  for (int index = 0; index < file_pattern_count; ++index) {
+    compile_pattern(&pattern_set->pattern[pattern_set->count],
+                    all_regexes->line[index], icase | REG_EXTENDED, flags->F,
+                    is_error_reported);
+    ++pattern_set->count;
+  }
+
+  set_literal_set_allocate(pattern_set, flags);
+  set_required_strings_allocate(pattern_set, flags);
+}
+
+void free_pattern_set(PatternSet *pattern_set) {
+  for (int index = 0; index < pattern_set->count; ++index) {
+    if (pattern_set->pattern[index].is_literal) {
+      free_literal_pattern(&pattern_set->pattern[index].literal);
+    } else if (pattern_set->pattern[index].is_compiled) {
+      regfree(&pattern_set->pattern[index].regex);
+    }
+
+    if (pattern_set->pattern[index].dfa) {
+      free_dfa(pattern_set->pattern[index].dfa);
+      free(pattern_set->pattern[index].dfa);
+    }
+  }
+
+  if (pattern_set->pattern) {
+    free(pattern_set->pattern);
+    pattern_set->pattern = NULL;
+  }
+
+  if (pattern_set->has_literal_set) {
+    free_aho_corasick(&pattern_set->literal_set);
+    pattern_set->has_literal_set = False;
+  }
+
+  if (pattern_set->required_set == &pattern_set->required_set_allocated) {
+    free_aho_corasick(&pattern_set->required_set_allocated);
+  }
+
+  if (pattern_set->required_literal ==
+      &pattern_set->required_literal_allocated) {
+    free_literal_pattern(&pattern_set->required_literal_allocated);
+  }
+  pattern_set->required_set = NULL;
+  pattern_set->required_literal = NULL;
+  pattern_set->is_buffer_searchable = False;
+
+  if (pattern_set->regex_pattern_index) {
+    free(pattern_set->regex_pattern_index);
+    pattern_set->regex_pattern_index = NULL;
+  }
+  pattern_set->regex_pattern_count = 0;
+
+  pattern_set->count = 0;
+  pattern_set->argument_pattern_count = 0;
+}
+
+/* the line without its newline, so that $ matches before it */
+int get_text_length(const Line *line) {
+  return line->length - (line->has_newline_at_end ? 1 : 0);
+}
+
+int is_any_pattern_found(const Line *line, const PatternSet *pattern_set) {
+  const int text_length = get_text_length(line);
+  int is_found = NULL != aho_corasick_search(&pattern_set->literal_set,
+                                             line->line,
+                                             line->line + text_length);
+
+  for (int index = 0; !is_found && index < pattern_set->regex_pattern_count;
+       ++index) {
+    is_found = is_pattern_found(
+        &pattern_set->pattern[pattern_set->regex_pattern_index[index]],
+        line->line, text_length);
+  }
+
+  return is_found;
+}
+
+int is_line_suitable_and_print_o(Line *line, const Flags *flags,
+                                 const PatternSet *pattern_set) {
+  int is_suitable = False;
+
+  int is_beginning_of_the_line = True;
+
+  int offset = 0;
+
+  int shortest_length_of_word_found = 99999999;
+
+  const int text_length = get_text_length(line);
+
+  /* without -o only "does any pattern match" matters */
+  const int is_any_match_enough = !flags->o || flags->v || flags->c || flags->l;
+  const int is_literal_set_used =
+      is_any_match_enough && pattern_set->has_literal_set;
+
+  if (is_literal_set_used) {
+    is_suitable = is_any_pattern_found(line, pattern_set);
+  }
+
+  for (int pattern_number = 0;
+       !is_literal_set_used && pattern_number < pattern_set->count;
+       ++pattern_number) {
+    if (pattern_number == pattern_set->argument_pattern_count) {
+      shortest_length_of_word_found = 99999999;
+    }
+
+    const CompiledPattern *pattern = &pattern_set->pattern[pattern_number];
+
+    if (pattern->is_compiled && is_any_match_enough) {
+      if (is_pattern_found(pattern, line->line, text_length)) {
+        is_suitable = True;
+      }
+    } else if (pattern->is_compiled &&
+               (!pattern->dfa ||
+                dfa_search(pattern->dfa, line->line,
+                           line->line + text_length))) {
+      regmatch_t match;
+
+      offset = 0;
+
+      while (execute_pattern(pattern, line->line + offset,
+                             text_length - offset, &match)) {
+        is_suitable = True;
+
+        const int begin = offset + match.rm_so;
+        const int end = offset + match.rm_eo;
+
+        const int length_of_found_word = end - begin;
+
+        if (length_of_found_word == 0) { /* grep prints no empty matches */
+          if (end >= text_length) {
+            break;
+          }
+          offset = end + 1;
+          continue;
+        }
+
+        if (length_of_found_word <= shortest_length_of_word_found) {
+          print_for_o(line, begin, end, flags, &is_beginning_of_the_line);
+          shortest_length_of_word_found =
+              length_of_found_word; /* to copy weird behaviour of grep */
+        }
+
+        offset = end;
+      }
+    }
+    if (is_suitable && !flags->o) {
+      break;
+    }
+  }
+
+  if (flags->v) {
+    is_suitable = !is_suitable;
+  }
+
+  return is_suitable;
+}
+
+void initialize_line(Line *line) {
+  line->line = NULL;
+  line->length = 0;
+  line->has_newline_at_end = False;
+  line->line_number = 0;
+  line->match_counter = 0;
+  line->pattern_word = NULL;
+  line->filename = NULL;
+  line->output = NULL;
+}
+
+/* big enough to amortize read(), small enough to stay in the cache */
+#define READ_BLOCK_SIZE (1 << 18)
+/* the job whose turn it is writes to stdout in pieces of this size */
+#define OUTPUT_FLUSH_SIZE (1 << 16)
+/* with -j a file of two chunks or more is searched by several threads */
+#define FILE_CHUNK_SIZE (1 << 23)
+
+/* -r: jobs and files live in blocks that never move while other threads
+   read them, the slot of a printed job is taken by the next new one */
+#define QUEUE_BLOCK_SIZE 1024
+#define QUEUE_BLOCK_COUNT (1 << 16)
+/* -r: a few hundred directory entries per getdents64 */
+#define DIRECTORY_BUFFER_SIZE (1 << 15)
+
+typedef struct DirectoryId {
+  dev_t device;
+  ino_t inode;
+} DirectoryId;
+
+typedef struct QueuedFile {
+  const char *filename;
+  char *allocated_filename; /* the path of a file found by -r */
+  int is_binary_skipped;    /* found by -r: a zero byte means no match */
+
+  /* sums over the chunks already printed */
+  int suitable_line_counter;
+  int is_file_suitable;
+  int line_count;
+
+  atomic_int is_found; /* -l: the other chunks of the file may stop */
+  int next_free;
+} QueuedFile;
+
+/* a whole file or a chunk of it: the lines beginning inside the range */
+typedef struct FileJob {
+  int file_index;
+  int is_directory; /* -r: the entries are listed instead */
+  off_t range_begin;
+  off_t range_end; /* the last chunk reads to the end of the file */
+  int is_last_chunk;
+
+  Output output;
+  Output errors;
+
+  int is_opened;
+  int suitable_line_counter;
+  int is_file_suitable;
+  int line_count;
+  int is_done;
+
+  int next_in_order; /* the job printed after this one or -1 */
+
+  /* -R: the directories above this one, a link back to them is a loop */
+  DirectoryId *ancestor;
+  int ancestor_count;
+} FileJob;
+
+/* jobs are printed in command line order, the entries of a directory right
+   after it: the output of a job waits in memory until all jobs before it
+   are printed */
+typedef struct FileQueue {
+  QueuedFile **file_block;
+  int file_count; /* slots ever made */
+  int free_file;  /* a list through QueuedFile.next_free */
+
+  FileJob **job_block;
+  int count;
+  int free_job; /* a list through FileJob.next_in_order */
+  int last_job; /* the end of the order while the operands are added */
+
+  /* jobs not taken yet, the next one on top: the entries of a directory go
+     on top in their order, so the tree is searched depth first, close to
+     the order of the output */
+  int *pending;
+  int pending_count;
+  int pending_capacity;
+  int listing_count; /* directories taken and not listed yet */
+  pthread_cond_t job_added;
+
+  const Flags *flags;
+  const Arguments *arguments_struct; /* the --include and --exclude globs */
+  int turn; /* the job that may write to stdout right now or -1 */
+  pthread_mutex_t lock;
+
+  /* written by the job whose turn it is, under the lock */
+  Writer standard_output;
+  Writer standard_error;
+} FileQueue;
+
+FileJob *get_job(const FileQueue *queue, int index) {
+  return &queue->job_block[index / QUEUE_BLOCK_SIZE][index % QUEUE_BLOCK_SIZE];
+}
+
+QueuedFile *get_queued_file(const FileQueue *queue, int index) {
+  return &queue->file_block[index / QUEUE_BLOCK_SIZE]
+                           [index % QUEUE_BLOCK_SIZE];
+}
+
+/* the implicit operand of -r is the current directory with short names */
+const char *get_directory_path(const char *filename) {
+  return filename[0] ? filename : ".";
+}
+
+int is_directory(const char *filename) {
+  struct stat file_stat;
+
+  return stat(get_directory_path(filename), &file_stat) == 0 &&
+         S_ISDIR(file_stat.st_mode);
+}
+
+int get_file_chunk_count(const char *filename, const Flags *flags,
+                         off_t *file_size) {
+  struct stat file_stat;
+  int chunk_count = 1;
+
+  if (flags->thread_count > 1 && stat(filename, &file_stat) == 0 &&
+      S_ISREG(file_stat.st_mode) && file_stat.st_size >= 2 * FILE_CHUNK_SIZE) {
+    chunk_count = (file_stat.st_size + FILE_CHUNK_SIZE - 1) / FILE_CHUNK_SIZE;
+    *file_size = file_stat.st_size;
+  }
+
+  return chunk_count;
+}
+
+/* called under the lock, except while the operands are added */
+int allocate_queued_file(FileQueue *queue, const char *filename,
+                         char *allocated_filename) {
+  int index = queue->free_file;
+
+  if (index != -1) {
+    queue->free_file = get_queued_file(queue, index)->next_free;
+  } else {
+    index = queue->file_count;
+    if (index % QUEUE_BLOCK_SIZE == 0) {
+      if (index / QUEUE_BLOCK_SIZE == QUEUE_BLOCK_COUNT) {
+        exit(-1);
+      }
+
+      queue->file_block[index / QUEUE_BLOCK_SIZE] =
+          malloc(QUEUE_BLOCK_SIZE * sizeof(QueuedFile));
+
+      if (!queue->file_block[index / QUEUE_BLOCK_SIZE]) {
+        exit(-1);
+      }
+    }
+    ++queue->file_count;
+  }
+
+  QueuedFile *file = get_queued_file(queue, index);
+  file->filename = filename;
+  file->allocated_filename = allocated_filename;
+  file->is_binary_skipped = False;
+  file->suitable_line_counter = 0;
+  file->is_file_suitable = False;
+  file->line_count = 0;
+  atomic_init(&file->is_found, False);
+  file->next_free = -1;
+
+  return index;
+}
+
+void release_queued_file(FileQueue *queue, int index) {
+  QueuedFile *file = get_queued_file(queue, index);
+
+  if (file->allocated_filename) {
+    free(file->allocated_filename);
+    file->allocated_filename = NULL;
+  }
+
+  file->next_free = queue->free_file;
+  queue->free_file = index;
+}
+
+/* a job for the whole file, called like allocate_queued_file */
+int allocate_job(FileQueue *queue, int file_index) {
+  int index = queue->free_job;
+
+  if (index != -1) {
+    queue->free_job = get_job(queue, index)->next_in_order;
+  } else {
+    index = queue->count;
+    if (index % QUEUE_BLOCK_SIZE == 0) {
+      if (index / QUEUE_BLOCK_SIZE == QUEUE_BLOCK_COUNT) {
+        exit(-1);
+      }
+
+      queue->job_block[index / QUEUE_BLOCK_SIZE] =
+          malloc(QUEUE_BLOCK_SIZE * sizeof(FileJob));
+
+      if (!queue->job_block[index / QUEUE_BLOCK_SIZE]) {
+        exit(-1);
+      }
+    }
+    ++queue->count;
+  }
+
+  FileJob *job = get_job(queue, index);
+  job->file_index = file_index;
+  job->is_directory = False;
+  job->range_begin = 0;
+  job->range_end = FILE_CHUNK_SIZE;
+  job->is_last_chunk = True;
+  initialize_output(&job->output);
+  initialize_output(&job->errors);
+  job->is_opened = False;
+  job->suitable_line_counter = 0;
+  job->is_file_suitable = False;
+  job->line_count = 0;
+  job->is_done = False;
+  job->next_in_order = -1;
+  job->ancestor = NULL;
+  job->ancestor_count = 0;
+
+  return index;
+}
+
+void push_pending_job(FileQueue *queue, int index) {
+  if (queue->pending_count == queue->pending_capacity) {
+    queue->pending_capacity =
+        queue->pending_capacity ? queue->pending_capacity * 2 : 256;
+    queue->pending =
+        realloc(queue->pending, queue->pending_capacity * sizeof(int));
+
+    if (!queue->pending) {
+      exit(-1);
+    }
+  }
+
+  queue->pending[queue->pending_count] = index;
+  ++queue->pending_count;
+}
+
+void append_job(FileQueue *queue, int index) {
+  if (queue->last_job == -1) {
+    queue->turn = index;
+  } else {
+    get_job(queue, queue->last_job)->next_in_order = index;
+  }
+  queue->last_job = index;
+}
+
+void add_file_jobs(FileQueue *queue, const char *filename, const Flags *flags) {
+  const int file_index = allocate_queued_file(queue, filename, NULL);
+
+  if (flags->r && is_directory(filename)) {
+    const int index = allocate_job(queue, file_index);
+
+    get_job(queue, index)->is_directory = True;
+    append_job(queue, index);
+    return;
+  }
+
+  off_t file_size = 0;
+  const int chunk_count = get_file_chunk_count(filename, flags, &file_size);
+
+  for (int chunk = 0; chunk < chunk_count; ++chunk) {
+    const int index = allocate_job(queue, file_index);
+    FileJob *job = get_job(queue, index);
+
+    job->range_begin = (off_t)chunk * FILE_CHUNK_SIZE;
+    job->range_end = job->range_begin + FILE_CHUNK_SIZE;
+    job->is_last_chunk = chunk == chunk_count - 1;
+    /* the first line number of the chunk is known only after the others */
+    job->output.is_numbering_deferred = flags->n && job->range_begin > 0;
+    append_job(queue, index);
+  }
+}
+
+void initialize_file_queue_allocate(FileQueue *queue, const Flags *flags,
+                                    const Arguments *arguments_struct) {
+  queue->file_block = calloc(QUEUE_BLOCK_COUNT, sizeof(QueuedFile *));
+  queue->job_block = calloc(QUEUE_BLOCK_COUNT, sizeof(FileJob *));
+
+  if (!queue->file_block || !queue->job_block) {
+    exit(-1);
+  }
+
+  queue->file_count = 0;
+  queue->free_file = -1;
+  queue->count = 0;
+  queue->free_job = -1;
+  queue->last_job = -1;
+  queue->pending = NULL;
+  queue->pending_count = 0;
+  queue->pending_capacity = 0;
+  queue->listing_count = 0;
+  queue->flags = flags;
+  queue->arguments_struct = arguments_struct;
+  queue->turn = -1;
+
+  int is_operand_found = False;
+  for (int index = 1; index < arguments_struct->counter; ++index) {
+    if (arguments_struct->type[index] == FILENAME_T) {
+      add_file_jobs(queue, arguments_struct->word[index], flags);
+      is_operand_found = True;
+    }
+  }
+
+  if (flags->r && !is_operand_found) {
+    add_file_jobs(queue, "", flags);
+  }
+
+  /* the first job on top */
+  for (int index = queue->count - 1; index >= 0; --index) {
+    push_pending_job(queue, index);
+  }
+
+  pthread_mutex_init(&queue->lock, NULL);
+  pthread_cond_init(&queue->job_added, NULL);
+
+  initialize_writer_allocate(&queue->standard_output, STDOUT_FILENO);
+  initialize_writer_allocate(&queue->standard_error, STDERR_FILENO);
+}
+
+void free_file_queue(FileQueue *queue) {
+  for (int index = 0; index < queue->count; ++index) {
+    FileJob *job = get_job(queue, index);
+
+    free_output(&job->output);
+    free_output(&job->errors);
+
+    if (job->ancestor) {
+      free(job->ancestor);
+      job->ancestor = NULL;
+    }
+  }
+
+  for (int index = 0; index < queue->file_count; ++index) {
+    QueuedFile *file = get_queued_file(queue, index);
+
+    if (file->allocated_filename) {
+      free(file->allocated_filename);
+      file->allocated_filename = NULL;
+    }
+  }
+
+  for (int block = 0; block < QUEUE_BLOCK_COUNT; ++block) {
+    free(queue->job_block[block]);
+    free(queue->file_block[block]);
+  }
+
+  free(queue->job_block);
+  queue->job_block = NULL;
+  free(queue->file_block);
+  queue->file_block = NULL;
+
+  if (queue->pending) {
+    free(queue->pending);
+    queue->pending = NULL;
+  }
+
+  queue->count = 0;
+  queue->file_count = 0;
+  pthread_cond_destroy(&queue->job_added);
+  pthread_mutex_destroy(&queue->lock);
+
+  free_writer(&queue->standard_output);
+  free_writer(&queue->standard_error);
+}
+
+/* -1 when every job is taken and no directory may add more */
+int take_next_job(FileQueue *queue) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->pending_count == 0 && queue->listing_count > 0) {
+    pthread_cond_wait(&queue->job_added, &queue->lock);
+  }
+
+  int index = -1;
+  if (queue->pending_count > 0) {
+    --queue->pending_count;
+    index = queue->pending[queue->pending_count];
+
+    if (get_job(queue, index)->is_directory) {
+      ++queue->listing_count;
+    }
+  }
+  pthread_mutex_unlock(&queue->lock);
+
+  return index;
+}
+
+/* the count and -l names are printed after the last chunk of a file */
+void print_file_summary(Writer *writer, const QueuedFile *file,
+                        const Flags *flags) {
+  if (flags->c) {
+    if (!flags->h && flags->print_filename) {
+      writer_write_string(writer, file->filename);
+      writer_write_character(writer, ':');
+    }
+    /* -l stops at the first suitable line of a file */
+    writer_print_format(
+        writer, "%d\n",
+        flags->l ? file->is_file_suitable : file->suitable_line_counter);
   }
 
-  if (flags->n) {
-    print_line_number(line->line_number);
+  if (flags->l && file->is_file_suitable) {
+    writer_write_string(writer, file->filename);
+    writer_write_character(writer, '\n');
   }
+}
 
-  for (int index = 0; index < line->length; ++index) {
-    printf("%c", line->line[index]);
+/* a big output of the current job goes out early, the others wait */
+void flush_job_output(FileQueue *queue, int index) {
+  pthread_mutex_lock(&queue->lock);
+  if (queue->turn == index) {
+    FileJob *job = get_job(queue, index);
+    write_output(&job->output, &queue->standard_output,
+                 get_queued_file(queue, job->file_index)->line_count);
   }
+  pthread_mutex_unlock(&queue->lock);
 }
 
-int get_string_length(const char *string) {
-  if (!string) {
-    return 0;
+void finish_job(FileQueue *queue, int index) {
+  pthread_mutex_lock(&queue->lock);
+  get_job(queue, index)->is_done = True;
+
+  if (get_job(queue, index)->is_directory) {
+    --queue->listing_count;
+    pthread_cond_broadcast(&queue->job_added);
   }
 
-  int length = 0;
-  while (string[length]) {
-    ++length;
+  while (queue->turn != -1 && get_job(queue, queue->turn)->is_done) {
+    FileJob *job = get_job(queue, queue->turn);
+    QueuedFile *file = get_queued_file(queue, job->file_index);
+
+    if (job->errors.length > 0) {
+      /* the lines before the error come first, as with stdio */
+      writer_flush(&queue->standard_output);
+      write_output(&job->errors, &queue->standard_error, 0);
+      writer_flush(&queue->standard_error);
+    }
+    write_output(&job->output, &queue->standard_output, file->line_count);
+    free_output(&job->errors);
+    free_output(&job->output);
+
+    file->line_count += job->line_count;
+    file->suitable_line_counter += job->suitable_line_counter;
+    file->is_file_suitable |= job->is_file_suitable;
+
+    if (job->is_last_chunk && job->is_opened) {
+      print_file_summary(&queue->standard_output, file, queue->flags);
+    }
+
+    const int next = job->next_in_order;
+    if (job->is_last_chunk) {
+      release_queued_file(queue, job->file_index);
+    }
+
+    if (job->ancestor) {
+      free(job->ancestor);
+      job->ancestor = NULL;
+    }
+    job->next_in_order = queue->free_job;
+    queue->free_job = queue->turn;
+    queue->turn = next;
   }
-  return length;
+  pthread_mutex_unlock(&queue->lock);
 }
 
-void print_for_o(const Line *line, int begin, int end, const Flags *flags,
-                 int *is_beginning_of_the_line) {
-  if (*is_beginning_of_the_line) {
-    if (flags->print_filename && !flags->h) {
-      printf("%s:", line->filename);
+typedef struct FileSearch {
+  const char *filename;
+  Output *output;
+
+  FileQueue *queue;
+  int job_index;
+
+  int suitable_line_counter;
+  int is_file_suitable;
+
+  const char *counted_until; /* newlines before it are already counted */
+  int line_number;           /* number of the line at counted_until */
+} FileSearch;
+
+void initialize_file_search(FileSearch *search, FileQueue *queue,
+                            int job_index) {
+  FileJob *job = get_job(queue, job_index);
+
+  search->filename = get_queued_file(queue, job->file_index)->filename;
+  search->output = &job->output;
+  search->queue = queue;
+  search->job_index = job_index;
+  search->suitable_line_counter = 0;
+  search->is_file_suitable = False;
+  search->counted_until = NULL;
+  search->line_number = 1; /* first line has number '1' */
+}
+
+/* line numbers are counted only for -n and only up to the printed lines */
+int get_line_number(FileSearch *search, const char *line_begin) {
+  search->line_number +=
+      count_byte_occurrences(search->counted_until, line_begin, '\n');
+  search->counted_until = line_begin;
+
+  return search->line_number;
+}
+
+/* False when the rest of the file does not matter any more */
+int output_line(Line *line, const Flags *flags, const PatternSet *pattern_set,
+                FileSearch *search) {
+  int is_continued = True;
+
+  if (is_line_suitable_and_print_o(line, flags, pattern_set)) {
+    ++search->suitable_line_counter;
+
+    if (flags->l) {
+      search->is_file_suitable = True;
+      is_continued = False;
+    } else if ((!flags->o || flags->v) && !flags->c) {
+      print_line(line, flags);
+      if (!line->has_newline_at_end) {
+        output_append(line->output, "\n", 1);
+      }
+    }
+  }
+
+  if (search->output->length >= OUTPUT_FLUSH_SIZE) {
+    flush_job_output(search->queue, search->job_index);
+  }
+
+  return is_continued;
+}
+
+/* a byte inside the first line with a hit or end */
+const char *find_suitable_line(const char *begin, const char *end,
+                               const PatternSet *pattern_set) {
+  const char *found = NULL;
+
+  if (pattern_set->required_set) {
+    found = aho_corasick_search(pattern_set->required_set, begin, end);
+    if (found) {
+      --found; /* the last byte of the hit */
+    }
+  } else {
+    found = literal_search(pattern_set->required_literal, begin, end);
+  }
+
+  return found ? found : end;
+}
+
+/* the lines of [begin, end), the last one may lack its newline */
+int search_lines(const char *begin, const char *end, const Flags *flags,
+                 const PatternSet *pattern_set, FileSearch *search) {
+  /* with -v the lines without hits are the output, so no skipping */
+  const int is_skipping = pattern_set->is_buffer_searchable && !flags->v;
+
+  int is_continued = True;
+  const char *position = begin;
+  while (is_continued && position < end) {
+    if (is_skipping) {
+      const char *found = find_suitable_line(position, end, pattern_set);
+
+      if (found == end) {
+        break;
+      }
+
+      const char *previous_newline =
+          memrchr(position, '\n', found - position);
+      position = previous_newline ? previous_newline + 1 : position;
     }
 
+    const char *newline = memchr(position, '\n', end - position);
+    const char *line_end = newline ? newline + 1 : end;
+
+    Line line;
+    initialize_line(&line);
+    line.line = position;
+    line.length = line_end - position;
+    line.has_newline_at_end = newline != NULL;
+    line.filename = search->filename;
+    line.output = search->output;
+
     if (flags->n) {
-      print_line_number(line->line_number);
+      line.line_number = get_line_number(search, position);
     }
 
-    *is_beginning_of_the_line = False;
+    is_continued = output_line(&line, flags, pattern_set, search);
+    position = line_end;
   }
 
-  for (int index = begin; index < end; ++index) {
-    printf("%c", line->line[index]);
-  }
+  return is_continued;
+}
+
+/* the chunk after the line it starts in: False when no line begins
+   inside the range of the job */
+int skip_to_line_start(char *buffer, size_t *filled, off_t *buffer_position,
+                       const FileJob *job, int *is_line_start_found) {
+  const char *newline = memchr(buffer, '\n', *filled);
+  const size_t skipped = newline ? (size_t)(newline + 1 - buffer) : *filled;
 
-  printf("\n");
+  *is_line_start_found = newline != NULL;
+  *buffer_position += skipped;
+  *filled -= skipped;
+  memmove(buffer, buffer + skipped, *filled);
+
+  return *buffer_position < job->range_end;
 }
 
-int is_line_suitable_and_print_o(Line *line, const Flags *flags,
-                                 const Arguments *argument_struct,
-                                 const FileStruct *all_regexes) {
-  int is_suitable = False;
+/* the newline of the line crossing the end of the chunk or NULL */
+const char *find_chunk_end(const char *buffer, size_t filled,
+                           off_t buffer_position, const FileJob *job) {
+  const off_t last_byte = job->range_end - 1 - buffer_position;
+  const char *newline = NULL;
 
-  int is_beginning_of_the_line = True;
+  if (!job->is_last_chunk && last_byte < (off_t)filled) {
+    const char *from = buffer + (last_byte > 0 ? last_byte : 0);
+    newline = memchr(from, '\n', buffer + filled - from);
+  }
 
-  int offset = 0;
+  return newline;
+}
 
-  int shortest_length_of_word_found = 99999999;
+/* the file is read in blocks, only whole lines are searched, the tail
+   without a newline moves to the front for the next read; a chunk of a big
+   file starts after its first newline and ends with the line crossing its
+   end */
+void search_and_output_file(FileQueue *queue, int job_index,
+                            const Flags *flags,
+                            const PatternSet *pattern_set) {
+  FileJob *job = get_job(queue, job_index);
+  QueuedFile *queued_file = get_queued_file(queue, job->file_index);
+
+  if (flags->l && atomic_load(&queued_file->is_found)) {
+    job->is_opened = True;
+    return;
+  }
 
-  for (int pattern_number = 0; pattern_number < argument_struct->counter;
-       ++pattern_number) {
-    if (argument_struct->type[pattern_number] == PATTERN_T) {
-      const char *regex_word = argument_struct->word[pattern_number];
+  const int file = open(queued_file->filename, O_RDONLY);
+  if (file == -1) {
+    if (!flags->s && job->range_begin == 0) {
+      print_file_error(&job->errors, queued_file->filename);
+    }
+    return;
+  }
+  job->is_opened = True;
 
-      int compile_result = -1;
+  size_t capacity = READ_BLOCK_SIZE;
+  char *buffer = malloc(capacity);
 
-      regex_t regex;
-      if (flags->i) {
-        compile_result = regcomp(&regex, regex_word, REG_ICASE);
-      } else {
-        compile_result = regcomp(&regex, regex_word, 0);
-      }
+  if (!buffer) {
+    exit(-1);
+  }
 
-      if (!compile_result) {
-        regmatch_t match;
-        int eflags = 0;
+  FileSearch search;
+  initialize_file_search(&search, queue, job_index);
+  search.counted_until = buffer;
 
-        if (flags->o) {
-          offset = 0;
-        }
+  /* the byte before the chunk tells if the chunk starts with a line */
+  off_t read_position = job->range_begin > 0 ? job->range_begin - 1 : 0;
+  off_t buffer_position = read_position; /* file offset of buffer[0] */
+  int is_line_start_found = job->range_begin == 0;
 
-        while (0 == regexec(&regex, line->line + offset, 1, &match, eflags)) {
-          is_suitable = True;
+  size_t filled = 0;
+  int is_continued = True;
+  while (is_continued) {
+    if (capacity - filled < READ_BLOCK_SIZE / 2) { /* a very long line */
+      capacity *= 2;
+      buffer = realloc(buffer, capacity);
 
-          if (!flags->o || flags->v || flags->c || flags->l) {
-            break;
-          }
+      if (!buffer) {
+        exit(-1);
+      }
+      search.counted_until = buffer;
+    }
 
-          const int begin = offset + match.rm_so;
-          const int end = offset + match.rm_eo;
+    const ssize_t read_count =
+        pread(file, buffer + filled, capacity - filled, read_position);
 
-          const int length_of_found_word = end - begin;
+    if (read_count <= 0) { /* the last line may have no newline */
+      if (is_line_start_found) {
+        search_lines(buffer, buffer + filled, flags, pattern_set, &search);
+      }
+      is_continued = False;
+    } else {
+      filled += read_count;
+      read_position += read_count;
+
+      /* -r: a zero byte in the first block makes the file binary */
+      if (queued_file->is_binary_skipped && read_position == read_count &&
+          memchr(buffer, '\0', filled)) {
+        is_continued = False;
+        is_line_start_found = False;
+      }
 
-          if (length_of_found_word <= shortest_length_of_word_found) {
-            print_for_o(line, begin, end, flags, &is_beginning_of_the_line);
-            shortest_length_of_word_found =
-                length_of_found_word; /* to copy weird behaviour of grep */
-          }
+      if (!is_line_start_found) {
+        is_continued = skip_to_line_start(buffer, &filled, &buffer_position,
+                                          job, &is_line_start_found);
+      }
+    }
 
-          offset = end;
-        }
-        regfree(&regex);
-      } else {
-        fprintf(stderr, "Regex compilation fail\n");
+    if (is_continued && is_line_start_found) {
+      const char *chunk_end =
+          find_chunk_end(buffer, filled, buffer_position, job);
+      const char *last_newline =
+          chunk_end ? chunk_end : memrchr(buffer, '\n', filled);
+      const char *lines_end = last_newline ? last_newline + 1 : buffer;
+
+      is_continued =
+          search_lines(buffer, lines_end, flags, pattern_set, &search) &&
+          !chunk_end;
+
+      if (flags->n) {
+        get_line_number(&search, lines_end);
       }
-      if (is_suitable && !flags->o) {
-        break;
+
+      /* -l: a match in another chunk of the file is enough */
+      if (flags->l && atomic_load(&queued_file->is_found)) {
+        is_continued = False;
       }
+
+      filled -= lines_end - buffer;
+      buffer_position += lines_end - buffer;
+      memmove(buffer, lines_end, filled);
+      search.counted_until = buffer;
     }
   }
 
-  regex_t regex_extended;
-  shortest_length_of_word_found = 99999999;
+  free(buffer);
+  close(file);
 
-  for (int regex_number = 0; regex_number < all_regexes->line_count;
-       ++regex_number) {
-    const char *regex_word = all_regexes->line[regex_number];
+  job->suitable_line_counter = search.suitable_line_counter;
+  job->is_file_suitable = search.is_file_suitable;
+  job->line_count = search.line_number - 1;
 
-    int compile_result = -1;
+  if (flags->l && search.is_file_suitable) {
+    atomic_store(&queued_file->is_found, True);
+  }
+}
 
-    if (flags->i) {
-      compile_result =
-          regcomp(&regex_extended, regex_word, REG_ICASE | REG_EXTENDED);
-    } else {
-      compile_result = regcomp(&regex_extended, regex_word, REG_EXTENDED);
+enum EntryTypes { OTHER_ENTRY, FILE_ENTRY, DIRECTORY_ENTRY };
+
+typedef struct ListedEntry {
+  char *path;
+  int is_directory;
+} ListedEntry;
+
+/* -R: a link back to a directory above */
+int is_directory_loop(const FileJob *job, const struct stat *directory_stat) {
+  int is_loop = False;
+
+  for (int index = 0; index < job->ancestor_count; ++index) {
+    if (job->ancestor[index].device == directory_stat->st_dev &&
+        job->ancestor[index].inode == directory_stat->st_ino) {
+      is_loop = True;
     }
+  }
 
-    if (!compile_result) {
-      regmatch_t match;
-      int eflags = 0;
+  return is_loop;
+}
 
-      if (flags->o) {
-        offset = 0;
-      }
+/* -R: the ancestors of the directories inside this one */
+DirectoryId *get_entry_ancestors_allocate(const FileJob *job,
+                                          const struct stat *directory_stat) {
+  const int count = job->ancestor_count;
+  DirectoryId *ancestor = malloc((count + 1) * sizeof(DirectoryId));
 
-      while (0 ==
-             regexec(&regex_extended, line->line + offset, 1, &match, eflags)) {
-        is_suitable = True;
+  if (!ancestor) {
+    exit(-1);
+  }
 
-        if (!flags->o || flags->v || flags->c || flags->l) {
-          break;
-        }
+  if (count > 0) {
+    memcpy(ancestor, job->ancestor, count * sizeof(DirectoryId));
+  }
+  ancestor[count].device = directory_stat->st_dev;
+  ancestor[count].inode = directory_stat->st_ino;
 
-        const int begin = offset + match.rm_so;
-        const int end = offset + match.rm_eo;
+  return ancestor;
+}
 
-        const int length_of_found_word = end - begin;
+/* -r follows no symbolic link inside a directory, -R follows all of them,
+   devices, fifos and sockets are left out */
+int get_entry_type(int directory, const struct dirent64 *record,
+                   const Flags *flags) {
+  const char *name = record->d_name;
+  if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) {
+    return OTHER_ENTRY;
+  }
 
-        if (length_of_found_word <= shortest_length_of_word_found) {
-          print_for_o(line, begin, end, flags, &is_beginning_of_the_line);
-          shortest_length_of_word_found =
-              length_of_found_word; /* to copy weird behaviour of grep */
-        }
+  int type = record->d_type;
+  if (type == DT_UNKNOWN || (type == DT_LNK && flags->R)) {
+    struct stat entry_stat;
+    const int stat_flags = flags->R ? 0 : AT_SYMLINK_NOFOLLOW;
+
+    if (fstatat(directory, name, &entry_stat, stat_flags) != 0) {
+      /* a dangling link is reported when it is opened */
+      type = type == DT_LNK ? DT_REG : DT_UNKNOWN;
+    } else if (S_ISREG(entry_stat.st_mode)) {
+      type = DT_REG;
+    } else if (S_ISDIR(entry_stat.st_mode)) {
+      type = DT_DIR;
+    } else {
+      type = DT_UNKNOWN;
+    }
+  }
 
-        offset = end;
+  int entry_type = OTHER_ENTRY;
+  if (type == DT_REG) {
+    entry_type = FILE_ENTRY;
+  } else if (type == DT_DIR) {
+    entry_type = DIRECTORY_ENTRY;
+  }
+
+  return entry_type;
+}
+
+/* a file is searched when it matches an --include glob, if there are any,
+   and no --exclude glob; a directory when it matches no --exclude-dir */
+int is_entry_included(const Arguments *arguments_struct, const char *name,
+                      int is_directory_entry) {
+  int is_excluded = False;
+  int has_include = False;
+  int is_include_matched = False;
+
+  for (int index = 1; index < arguments_struct->counter; ++index) {
+    const int type = arguments_struct->type[index];
+    const char *glob = arguments_struct->word[index];
+
+    if (is_directory_entry) {
+      if (type == EXCLUDE_DIRECTORY_GLOB_T && !fnmatch(glob, name, 0)) {
+        is_excluded = True;
       }
-    } else {
-      fprintf(stderr, "Regex compilation fail\n");
+    } else if (type == INCLUDE_GLOB_T) {
+      has_include = True;
+      if (!fnmatch(glob, name, 0)) {
+        is_include_matched = True;
+      }
+    } else if (type == EXCLUDE_GLOB_T && !fnmatch(glob, name, 0)) {
+      is_excluded = True;
     }
-    regfree(&regex_extended);
-    if (is_suitable && !flags->o) {
-      break;
+  }
+
+  return !is_excluded && (!has_include || is_include_matched);
+}
+
+char *join_path_allocate(const char *directory, const char *name) {
+  const size_t directory_length = strlen(directory);
+  const size_t name_length = strlen(name);
+  const int is_separated =
+      directory_length == 0 || directory[directory_length - 1] == '/';
+  char *path = malloc(directory_length + !is_separated + name_length + 1);
+
+  if (!path) {
+    exit(-1);
+  }
+
+  memcpy(path, directory, directory_length);
+  if (!is_separated) {
+    path[directory_length] = '/';
+  }
+  memcpy(path + directory_length + !is_separated, name, name_length + 1);
+
+  return path;
+}
+
+void add_listed_entry(ListedEntry **entry, int *count, int *capacity,
+                      char *path, int is_directory_entry) {
+  if (*count == *capacity) {
+    *capacity = *capacity ? *capacity * 2 : 64;
+    *entry = realloc(*entry, *capacity * sizeof(ListedEntry));
+
+    if (!*entry) {
+      exit(-1);
     }
   }
 
-  if (flags->v) {
-    is_suitable = !is_suitable;
+  (*entry)[*count].path = path;
+  (*entry)[*count].is_directory = is_directory_entry;
+  ++(*count);
+}
+
+void set_job_ancestors_allocate(FileJob *job, const DirectoryId *ancestor,
+                                int ancestor_count) {
+  job->ancestor = malloc(ancestor_count * sizeof(DirectoryId));
+
+  if (!job->ancestor) {
+    exit(-1);
   }
 
-  return is_suitable;
+  memcpy(job->ancestor, ancestor, ancestor_count * sizeof(DirectoryId));
+  job->ancestor_count = ancestor_count;
 }
 
-void initialize_line(Line *line) {
-  line->line = NULL;
-  line->length = 0;
-  line->has_newline_at_end = False;
-  line->line_number = 0;
-  line->match_counter = 0;
-  line->pattern_word = NULL;
-  line->filename = NULL;
+/* the entries are printed right after the directory and taken first */
+void add_directory_entries(FileQueue *queue, int job_index,
+                           const ListedEntry *entry, int count,
+                           const DirectoryId *ancestor) {
+  const int ancestor_count = get_job(queue, job_index)->ancestor_count + 1;
+
+  pthread_mutex_lock(&queue->lock);
+  const int next = get_job(queue, job_index)->next_in_order;
+  const int first_pending = queue->pending_count;
+  int previous = job_index;
+
+  for (int entry_index = 0; entry_index < count; ++entry_index) {
+    const int file_index = allocate_queued_file(
+        queue, entry[entry_index].path, entry[entry_index].path);
+    const int index = allocate_job(queue, file_index);
+
+    get_queued_file(queue, file_index)->is_binary_skipped = True;
+    get_job(queue, index)->is_directory = entry[entry_index].is_directory;
+    if (ancestor && entry[entry_index].is_directory) {
+      set_job_ancestors_allocate(get_job(queue, index), ancestor,
+                                 ancestor_count);
+    }
+    get_job(queue, previous)->next_in_order = index;
+    previous = index;
+    push_pending_job(queue, index);
+  }
+  get_job(queue, previous)->next_in_order = next;
+
+  /* the first entry on top */
+  for (int low = first_pending, high = queue->pending_count - 1; low < high;
+       ++low, --high) {
+    const int index = queue->pending[low];
+    queue->pending[low] = queue->pending[high];
+    queue->pending[high] = index;
+  }
+
+  pthread_cond_broadcast(&queue->job_added);
+  pthread_mutex_unlock(&queue->lock);
 }
 
-void read_and_output_file_line_by_line(
-    const char *filename, /*int is_last_file,*/
-    const Flags *flags, const Arguments *arguments_struct,
-    const FileStruct *all_regexes) {
-  FILE *input_file = fopen(filename, "r");
-  if (input_file == NULL) {
+/* the entries are read with getdents64 and typed without a stat when the
+   file system gives the type; errors wait in the job like those of files */
+void list_directory(FileQueue *queue, int job_index, const Flags *flags) {
+  FileJob *job = get_job(queue, job_index);
+  const char *path = get_queued_file(queue, job->file_index)->filename;
+
+  const int directory =
+      open(get_directory_path(path), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (directory == -1) {
     if (!flags->s) {
-      fprintf(stderr, "grep: %s: No such file or directory\n", filename);
+      print_file_error(&job->errors, path);
     }
     return;
   }
 
-  char *line_for_getline = NULL;
+  DirectoryId *ancestor = NULL;
+  struct stat directory_stat;
+  if (flags->R && fstat(directory, &directory_stat) == 0) {
+    if (is_directory_loop(job, &directory_stat)) {
+      output_append_string(&job->errors, "grep: ");
+      output_append_string(&job->errors, path);
+      output_append_string(&job->errors,
+                           ": warning: recursive directory loop\n");
+      close(directory);
+      return;
+    }
+
+    ancestor = get_entry_ancestors_allocate(job, &directory_stat);
+  }
 
-  int line_number = 1; /* first line has number '1' */
+  char *buffer = malloc(DIRECTORY_BUFFER_SIZE);
 
-  int is_file_suitable = False;
-  int suitable_line_counter = 0;
-  static int suitable_file_counter = 0;
-  int is_file_counted = False;
-  while (True) { /* getline allocates memory */
-    ssize_t line_actual_length = 0ul;
-    size_t line_allocated_length = 0l;
-    line_actual_length = s21_getline_allocate(
-        &line_for_getline, &line_allocated_length, input_file);
+  if (!buffer) {
+    exit(-1);
+  }
 
-    if (line_actual_length < 0l) {
-      break;
+  ListedEntry *entry = NULL;
+  int count = 0;
+  int capacity = 0;
+
+  ssize_t length = 0;
+  while ((length = getdents64(directory, buffer, DIRECTORY_BUFFER_SIZE)) >
+         0) {
+    for (ssize_t offset = 0; offset < length;) {
+      const struct dirent64 *record =
+          (const struct dirent64 *)(buffer + offset);
+      const int type = get_entry_type(directory, record, flags);
+
+      if (type != OTHER_ENTRY &&
+          is_entry_included(queue->arguments_struct, record->d_name,
+                            type == DIRECTORY_ENTRY)) {
+        add_listed_entry(&entry, &count, &capacity,
+                         join_path_allocate(path, record->d_name),
+                         type == DIRECTORY_ENTRY);
+      }
+      offset += record->d_reclen;
     }
+  }
 
-    Line line;
-    initialize_line(&line);
+  if (length < 0 && !flags->s) {
+    print_file_error(&job->errors, path);
+  }
 
-    if (line_actual_length > 0l &&
-        line_for_getline[line_actual_length - 1] == '\n') {
-      line.has_newline_at_end = True;
-    }
+  free(buffer);
+  close(directory);
 
-    line.line = line_for_getline;
-    line.length = line_actual_length;
-    line.line_number = line_number;
-    line.filename = filename;
+  if (count > 0) {
+    add_directory_entries(queue, job_index, entry, count, ancestor);
+  }
 
-    if (line_actual_length == EOF) {
-      break;
+  if (entry) {
+    free(entry);
+  }
+
+  if (ancestor) {
+    free(ancestor);
+  }
+}
+
+void search_queued_files(FileQueue *queue, const Flags *flags,
+                         const PatternSet *pattern_set) {
+  int index = take_next_job(queue);
+
+  while (index != -1) {
+    if (get_job(queue, index)->is_directory) {
+      list_directory(queue, index, flags);
+    } else {
+      search_and_output_file(queue, index, flags, pattern_set);
     }
+    finish_job(queue, index);
+    index = take_next_job(queue);
+  }
+}
 
-    if (is_line_suitable_and_print_o(&line, flags, arguments_struct,
-                                     all_regexes)) {
-      ++suitable_line_counter;
-      if (!is_file_counted) {
-        ++suitable_file_counter;
-        is_file_counted = True;
-      }
+typedef struct SearchWorker {
+  pthread_t thread;
+  FileQueue *queue;
+  const Flags *flags;
+  PatternSet pattern_set; /* glibc regexec locks a shared regex_t */
+} SearchWorker;
 
-      if (flags->l) {
-        is_file_suitable = True;
-        break;
-      }
+void *search_worker(void *argument) {
+  SearchWorker *worker = argument;
 
-      if ((!flags->o || flags->v) && !flags->c) {
-        print_line(&line, flags);
-        if (!line.has_newline_at_end) {
-          printf("\n");
-        }
-      }
+  search_queued_files(worker->queue, worker->flags, &worker->pattern_set);
+
+  return NULL;
+}
+
+/* the main thread is worker number zero with the main pattern set */
+void search_files(FileQueue *queue, const Flags *flags,
+                  const PatternSet *pattern_set,
+                  const Arguments *arguments_struct,
+                  const FileStruct *all_regexes) {
+  int worker_count = flags->thread_count;
+  if (!flags->r && worker_count > queue->count) {
+    worker_count = queue->count;
+  }
+
+  SearchWorker *worker = NULL;
+  int started_count = 0;
+
+  if (worker_count > 1) {
+    worker = malloc((worker_count - 1) * sizeof(SearchWorker));
+
+    if (!worker) {
+      exit(-1);
     }
-    ++line_number;
   }
 
-  free(line_for_getline); /* because getline allocates memory */
-  fclose(input_file);
+  for (int index = 0; index < worker_count - 1; ++index) {
+    SearchWorker *next_worker = &worker[started_count];
 
-  if (flags->c) {
-    if (!flags->h && flags->print_filename) {
-      printf("%s:", filename);
+    next_worker->queue = queue;
+    next_worker->flags = flags;
+    initialize_pattern_set(&next_worker->pattern_set);
+    set_pattern_set_allocate(&next_worker->pattern_set, flags,
+                             arguments_struct, all_regexes, False);
+
+    if (pthread_create(&next_worker->thread, NULL, search_worker,
+                       next_worker) == 0) {
+      ++started_count;
+    } else {
+      free_pattern_set(&next_worker->pattern_set);
     }
-    printf("%d\n", suitable_line_counter);
   }
 
-  if (flags->l && is_file_suitable) {
-    printf("%s\n", filename);
+  search_queued_files(queue, flags, pattern_set);
+
+  for (int index = 0; index < started_count; ++index) {
+    pthread_join(worker[index].thread, NULL);
+    free_pattern_set(&worker[index].pattern_set);
+  }
+
+  if (worker) {
+    free(worker);
+  }
+}
+
+/* -j 0 means one thread per processor */
+int get_thread_count(const char *number) {
+  char *number_end = NULL;
+  long thread_count = strtol(number, &number_end, 10);
+
+  if (number_end == number || *number_end || thread_count < 0 ||
+      thread_count > 1024) {
+    fprintf(stderr, "grep: invalid number of threads: %s\n", number);
+    thread_count = 1;
+  } else if (thread_count == 0) {
+    thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+  }
+
+  return thread_count > 0 ? (int)thread_count : 1;
+}
+
+/* the text after the name of a --name=value option or NULL */
+const char *get_long_option_value(const char *argument, const char *name) {
+  const size_t name_length = strlen(name);
+
+  return strncmp(argument, name, name_length) ? NULL : argument + name_length;
+}
+
+void parse_long_option(int argument_index, const char **arguments,
+                       Flags *flags, Arguments *arguments_struct) {
+  const char *argument = arguments[argument_index];
+  const char *glob = NULL;
+
+  if ((glob = get_long_option_value(argument, "--include="))) {
+    arguments_struct->word[argument_index] = glob;
+    arguments_struct->type[argument_index] = INCLUDE_GLOB_T;
+  } else if ((glob = get_long_option_value(argument, "--exclude="))) {
+    arguments_struct->word[argument_index] = glob;
+    arguments_struct->type[argument_index] = EXCLUDE_GLOB_T;
+  } else if ((glob = get_long_option_value(argument, "--exclude-dir="))) {
+    arguments_struct->word[argument_index] = glob;
+    arguments_struct->type[argument_index] = EXCLUDE_DIRECTORY_GLOB_T;
+  } else if (!strcmp(argument, "--recursive")) {
+    flags->r = True;
+  } else if (!strcmp(argument, "--dereference-recursive")) {
+    flags->r = True;
+    flags->R = True;
+  } else {
+    fprintf(stderr, "invalid flag %s\n", argument);
+  }
+}
+
+int is_directory_operand(const Arguments *arguments_struct) {
+  int is_found = False;
+
+  for (int index = 1; index < arguments_struct->counter; ++index) {
+    if (arguments_struct->type[index] == FILENAME_T &&
+        is_directory(arguments_struct->word[index])) {
+      is_found = True;
+    }
   }
+
+  return is_found;
 }
 
 int parse(int counter, const char **arguments, Flags *flags,
@@ -372,7 +1870,9 @@ int parse(int counter, const char **arguments, Flags *flags,
     const char *argument = arguments[argument_index];
     const int argument_length = get_string_length(argument);
 
-    if (argument[0] == '-') {
+    if (argument[0] == '-' && argument[1] == '-') {
+      parse_long_option(argument_index, arguments, flags, arguments_struct);
+    } else if (argument[0] == '-') {
       for (int index = 1; index < argument_length; ++index) {
         if (argument[index] == 'e') {
           flags->e = True;
@@ -424,6 +1924,30 @@ int parse(int counter, const char **arguments, Flags *flags,
 
         } else if (argument[index] == 'o') {
           flags->o = True;
+        } else if (argument[index] == 'F') {
+          flags->F = True;
+        } else if (argument[index] == 'r') {
+          flags->r = True;
+        } else if (argument[index] == 'R') {
+          flags->r = True;
+          flags->R = True;
+        } else if (argument[index] == 'j') {
+          const char *number = argument + index + 1;
+
+          if (index == argument_length - 1) {
+            number = NULL;
+            if (argument_index < counter - 1) {
+              ++argument_index;
+              number = arguments[argument_index];
+            } else {
+              fprintf(stderr, "grep: option requires an argument -- j");
+            }
+          }
+
+          if (number) {
+            flags->thread_count = get_thread_count(number);
+          }
+          break;
         } else {
           fprintf(stderr, "invalid flag %c%c\n", '-', argument[index]);
         }
@@ -449,6 +1973,12 @@ int parse(int counter, const char **arguments, Flags *flags,
     flags->print_filename = True;
   }
 
+  /* -r names the files found inside a directory */
+  if (flags->r && !flags->h &&
+      (filename_counter == 0 || is_directory_operand(arguments_struct))) {
+    flags->print_filename = True;
+  }
+
   return filename_counter;
 }
 
@@ -477,17 +2007,20 @@ int get_file_line_count(const char *filename) {
     return -1;
   }
 
-  int counter = 1;
+  /* the empty rest after the last newline is not a line */
+  int counter = 0;
+  int previous_symbol = '\n';
   while (True) {
     const int symbol = fgetc(file);
 
-    if (symbol == '\n') {
-      ++counter;
-    }
-
     if (symbol == EOF) {
       break;
     }
+
+    if (previous_symbol == '\n') {
+      ++counter;
+    }
+    previous_symbol = symbol;
   }
 
   fclose(file);
@@ -521,7 +2054,7 @@ void set_struct_from_file_allocate(const char *filename,
     }
 
     if (success) {
-      file_struct->line = malloc(line_count * sizeof(char *));
+      file_struct->line = malloc((line_count + 1) * sizeof(char *));
 
       if (!file_struct->line) {
         success = False;
@@ -636,7 +2169,6 @@ void set_list_of_regexes_allocate(FileStruct *giant_file_struct,
         giant_file_struct->line_count = total_line_count;
 
         int line_index = 0;
-        ++line_index;
         int character_shift = 0;
 
         for (int filename_index = 0; filename_index < arguments_struct->counter;
@@ -650,21 +2182,17 @@ void set_list_of_regexes_allocate(FileStruct *giant_file_struct,
 
             for (int character_index = 0;
                  character_index < file_struct.file_length; ++character_index) {
-              const char symbol = file_struct.data[character_index];
-
               assert(character_index + character_shift < total_character_count);
               giant_file_struct->data[character_index + character_shift] =
-                  symbol;
-
-              if (!symbol && line_index < total_line_count) {
-                assert(character_index + character_shift + 1 <
-                       total_character_count);
-                assert(line_index < total_line_count);
-                giant_file_struct->line[line_index] = giant_file_struct->data +
-                                                      character_index +
-                                                      character_shift + 1;
-                ++line_index;
-              }
+                  file_struct.data[character_index];
+            }
+
+            for (int index = 0; index < file_struct.line_count; ++index) {
+              assert(line_index < total_line_count);
+              giant_file_struct->line[line_index] =
+                  giant_file_struct->data + character_shift +
+                  (file_struct.line[index] - file_struct.data);
+              ++line_index;
             }
 
             character_shift += file_struct.file_length;
@@ -730,17 +2258,18 @@ int main(int counter, const char **arguments) {
 
   set_list_of_regexes_allocate(&all_regexes, &arguments_struct);
 
-  int file_number = 0;
-  for (int argument_index = 1; argument_index < arguments_struct.counter;
-       ++argument_index) {
-    if (arguments_struct.type[argument_index] == FILENAME_T) {
-      ++file_number;
-      read_and_output_file_line_by_line(arguments_struct.word[argument_index],
-                                        &flags, &arguments_struct,
-                                        &all_regexes);
-    }
-  }
+  /* every pattern is compiled once here, not for every line */
+  PatternSet pattern_set;
+  initialize_pattern_set(&pattern_set);
+  set_pattern_set_allocate(&pattern_set, &flags, &arguments_struct,
+                           &all_regexes, True);
+
+  FileQueue queue;
+  initialize_file_queue_allocate(&queue, &flags, &arguments_struct);
+  search_files(&queue, &flags, &pattern_set, &arguments_struct, &all_regexes);
+  free_file_queue(&queue);
 
+  free_pattern_set(&pattern_set);
   free_file_struct(&all_regexes);
   free_arguments_struct(&arguments_struct);
   return 0;
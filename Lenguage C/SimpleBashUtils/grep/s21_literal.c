@@ -0,0 +1,284 @@
+#include "s21_literal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+enum LiteralBoolean { LITERAL_FALSE, LITERAL_TRUE };
+
+/* after this many wrong guesses of the rare byte memchr stops paying off */
+#define FALSE_CANDIDATE_LIMIT 32
+#define FALSE_CANDIDATE_DISTANCE 16
+
+static unsigned char fold_byte(unsigned char symbol) {
+  if (symbol >= 'A' && symbol <= 'Z') {
+    symbol = symbol - 'A' + 'a';
+  }
+  return symbol;
+}
+
+static unsigned char get_other_case(unsigned char symbol) {
+  if (symbol >= 'a' && symbol <= 'z') {
+    symbol = symbol - 'a' + 'A';
+  }
+  return symbol;
+}
+
+/* bigger is more frequent, roughly for english text and logs */
+static int get_byte_frequency_rank(unsigned char symbol) {
+  static const char frequent_letters[] = " etaoinsrhldcumfpgwybvkxjqz";
+
+  int rank = 10; /* control and non-ascii bytes */
+  const char *letter = NULL;
+
+  if (symbol) {
+    letter = memchr(frequent_letters, symbol, sizeof(frequent_letters) - 1);
+  }
+
+  if (letter) {
+    rank = 255 - (int)(letter - frequent_letters) * 4;
+  } else if (symbol >= 'A' && symbol <= 'Z') {
+    rank = get_byte_frequency_rank(fold_byte(symbol)) / 2;
+  } else if (symbol >= '0' && symbol <= '9') {
+    rank = 140;
+  } else if (symbol == '\n' || symbol == '\t') {
+    rank = 100;
+  } else if (symbol && strchr(".,:;/-_=()'\"", symbol)) {
+    rank = 120;
+  } else if (symbol > ' ' && symbol < 127) {
+    rank = 60;
+  }
+
+  return rank;
+}
+
+int is_literal_pattern(const char *word, int is_extended) {
+  /* a newline would let a match run into the next line */
+  static const char basic_metacharacters[] = "\\.[*^$\n";
+  static const char extended_metacharacters[] = "\\.[*^$+?(){}|\n";
+
+  const char *metacharacters =
+      is_extended ? extended_metacharacters : basic_metacharacters;
+
+  /* the empty pattern stays with the regex engine */
+  return word[0] && !word[strcspn(word, metacharacters)];
+}
+
+void initialize_literal_pattern_allocate(LiteralPattern *pattern,
+                                         const char *word, int is_icase) {
+  pattern->length = strlen(word);
+  pattern->is_icase = is_icase;
+  pattern->folded_word_allocated = NULL;
+  pattern->word = (const unsigned char *)word;
+
+  if (is_icase) {
+    pattern->folded_word_allocated = malloc(pattern->length + 1);
+
+    if (!pattern->folded_word_allocated) {
+      exit(-1);
+    }
+
+    for (size_t index = 0; index <= pattern->length; ++index) {
+      pattern->folded_word_allocated[index] =
+          fold_byte((unsigned char)word[index]);
+    }
+    pattern->word = pattern->folded_word_allocated;
+  }
+
+  int rarest_rank = 0;
+  pattern->rare_index = 0;
+  for (size_t index = 0; index < pattern->length; ++index) {
+    const unsigned char symbol = pattern->word[index];
+    int rank = get_byte_frequency_rank(symbol);
+
+    if (is_icase && get_other_case(symbol) != symbol) {
+      rank += get_byte_frequency_rank(get_other_case(symbol));
+    }
+
+    if (index == 0 || rank < rarest_rank) {
+      rarest_rank = rank;
+      pattern->rare_index = index;
+    }
+  }
+
+  pattern->rare_byte = pattern->word[pattern->rare_index];
+  pattern->rare_byte_other_case = pattern->rare_byte;
+  if (is_icase) {
+    pattern->rare_byte_other_case = get_other_case(pattern->rare_byte);
+  }
+
+  for (int symbol = 0; symbol < 256; ++symbol) {
+    pattern->skip[symbol] = pattern->length;
+  }
+  for (size_t index = 0; index + 1 < pattern->length; ++index) {
+    pattern->skip[pattern->word[index]] = pattern->length - 1 - index;
+  }
+}
+
+void free_literal_pattern(LiteralPattern *pattern) {
+  if (pattern->folded_word_allocated) {
+    free(pattern->folded_word_allocated);
+    pattern->folded_word_allocated = NULL;
+  }
+
+  pattern->word = NULL;
+  pattern->length = 0;
+}
+
+const char *find_either_byte(const char *begin, const char *end,
+                             unsigned char first, unsigned char second) {
+  const char *position = begin;
+
+#if defined(__SSE2__)
+  const __m128i first_vector = _mm_set1_epi8((char)first);
+  const __m128i second_vector = _mm_set1_epi8((char)second);
+
+  while (end - position >= 16) {
+    const __m128i block = _mm_loadu_si128((const __m128i *)position);
+    const int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(block, first_vector),
+                     _mm_cmpeq_epi8(block, second_vector)));
+
+    if (mask) {
+      return position + __builtin_ctz(mask);
+    }
+    position += 16;
+  }
+#endif
+
+  for (; position < end; ++position) {
+    const unsigned char symbol = (unsigned char)*position;
+
+    if (symbol == first || symbol == second) {
+      return position;
+    }
+  }
+
+  return NULL;
+}
+
+static const char *find_rare_byte(const LiteralPattern *pattern,
+                                  const char *begin, const char *end) {
+  if (pattern->rare_byte == pattern->rare_byte_other_case) {
+    return memchr(begin, pattern->rare_byte, end - begin);
+  }
+
+  return find_either_byte(begin, end, pattern->rare_byte,
+                          pattern->rare_byte_other_case);
+}
+
+static int is_equal_at(const LiteralPattern *pattern, const char *text) {
+  if (!pattern->is_icase) {
+    return !memcmp(text, pattern->word, pattern->length);
+  }
+
+  for (size_t index = 0; index < pattern->length; ++index) {
+    if (fold_byte((unsigned char)text[index]) != pattern->word[index]) {
+      return LITERAL_FALSE;
+    }
+  }
+
+  return LITERAL_TRUE;
+}
+
+static const char *horspool_search(const LiteralPattern *pattern,
+                                   const char *begin, const char *end) {
+  const size_t length = pattern->length;
+  const unsigned char last_byte = pattern->word[length - 1];
+
+  const char *window = begin;
+  while (end - window >= (ptrdiff_t)length) {
+    unsigned char symbol = (unsigned char)window[length - 1];
+    if (pattern->is_icase) {
+      symbol = fold_byte(symbol);
+    }
+
+    if (symbol == last_byte && is_equal_at(pattern, window)) {
+      return window;
+    }
+
+    window += pattern->skip[symbol];
+  }
+
+  return NULL;
+}
+
+const char *literal_search(const LiteralPattern *pattern, const char *begin,
+                           const char *end) {
+  if (end - begin < (ptrdiff_t)pattern->length) {
+    return NULL;
+  }
+
+  if (pattern->length == 0) { /* -F with an empty string matches anywhere */
+    return begin;
+  }
+
+  if (pattern->length == 1) {
+    return find_rare_byte(pattern, begin, end);
+  }
+
+  /* the rare byte of any window fits into [position, candidate_end) */
+  const char *position = begin + pattern->rare_index;
+  const char *candidate_end = end - (pattern->length - 1 - pattern->rare_index);
+  size_t false_candidate_count = 0;
+
+  while (position < candidate_end) {
+    const char *found = find_rare_byte(pattern, position, candidate_end);
+
+    if (!found) {
+      return NULL;
+    }
+
+    const char *window = found - pattern->rare_index;
+    if (is_equal_at(pattern, window)) {
+      return window;
+    }
+
+    position = found + 1;
+    ++false_candidate_count;
+
+    /* the "rare" byte is everywhere in this text, windows before
+       position - rare_index are already checked */
+    if (false_candidate_count > FALSE_CANDIDATE_LIMIT &&
+        (size_t)(position - begin) <
+            false_candidate_count * FALSE_CANDIDATE_DISTANCE) {
+      return horspool_search(pattern, position - pattern->rare_index, end);
+    }
+  }
+
+  return NULL;
+}
+
+size_t count_byte_occurrences(const char *begin, const char *end,
+                              unsigned char symbol) {
+  const char *position = begin;
+  size_t count = 0;
+
+#if defined(__SSE2__)
+  const __m128i symbol_vector = _mm_set1_epi8((char)symbol);
+  const __m128i zero = _mm_setzero_si128();
+
+  while (end - position >= 16) {
+    /* byte lanes count -1 per hit and must not wrap: 255 blocks at most */
+    __m128i lane_count = zero;
+    for (int block = 0; block < 255 && end - position >= 16; ++block) {
+      const __m128i data = _mm_loadu_si128((const __m128i *)position);
+      lane_count =
+          _mm_sub_epi8(lane_count, _mm_cmpeq_epi8(data, symbol_vector));
+      position += 16;
+    }
+
+    const __m128i sum = _mm_sad_epu8(lane_count, zero);
+    count += (size_t)_mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4);
+  }
+#endif
+
+  for (; position < end; ++position) {
+    count += (unsigned char)*position == symbol;
+  }
+
+  return count;
+}
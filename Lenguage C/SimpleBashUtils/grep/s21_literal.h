@@ -0,0 +1,40 @@
+#ifndef SRC_GREP_S21_LITERAL_H_
+#define SRC_GREP_S21_LITERAL_H_
+
+#include <stddef.h>
+
+//  fixed string matcher: memchr on the rarest byte of the pattern,
+//  Boyer-Moore-Horspool when that byte turns out to be frequent
+typedef struct LiteralPattern {
+  const unsigned char *word; /* folded to lower case for -i */
+  unsigned char *folded_word_allocated;
+  size_t length;
+  int is_icase;
+
+  size_t rare_index; /* position of the rarest byte inside the word */
+  unsigned char rare_byte;
+  unsigned char rare_byte_other_case;
+
+  size_t skip[256]; /* Horspool shift for the last byte of a window */
+} LiteralPattern;
+
+int is_literal_pattern(const char *word, int is_extended);
+
+void initialize_literal_pattern_allocate(LiteralPattern *pattern,
+                                         const char *word, int is_icase);
+
+void free_literal_pattern(LiteralPattern *pattern);
+
+//  leftmost occurrence inside [begin, end) or NULL
+const char *literal_search(const LiteralPattern *pattern, const char *begin,
+                           const char *end);
+
+//  leftmost of two bytes inside [begin, end) or NULL
+const char *find_either_byte(const char *begin, const char *end,
+                             unsigned char first, unsigned char second);
+
+//  how many times symbol occurs inside [begin, end), for line numbers
+size_t count_byte_occurrences(const char *begin, const char *end,
+                              unsigned char symbol);
+
+#endif  //  SRC_GREP_S21_LITERAL_H_
@@ -0,0 +1,172 @@
+#!/bin/bash
+# compares s21_grep with the system grep on generated files: fixed strings,
+# many patterns, files bigger than a read block and a file chunk, threads,
+# regexes of the DFA and the literal prefilter, output of the writer and
+# recursive search; run from the grep directory after make
+SUCCESS=0
+FAIL=0
+COUNTER=0
+
+s21_command="$(pwd)/s21_grep"
+sys_command="grep"
+data="$(mktemp -d)"
+trap 'rm -rf "$data"' EXIT
+cd "$data" || exit 1
+
+# -j is not an option of grep, sort is for the order of a directory walk
+run_test() {
+  local param=("$@")
+  local sys_param=()
+  while [ $# -gt 0 ]; do
+    case "$1" in
+      -j) shift ;;
+      -j*) ;;
+      *) sys_param+=("$1") ;;
+    esac
+    shift
+  done
+
+  "$s21_command" "${param[@]}" >s21_grep.log 2>/dev/null
+  $sys_command "${sys_param[@]}" >grep.log 2>/dev/null
+  if [ -n "$SORT" ]; then
+    sort -o s21_grep.log s21_grep.log
+    sort -o grep.log grep.log
+  fi
+
+  let "COUNTER++"
+  if cmp -s s21_grep.log grep.log; then
+    let "SUCCESS++"
+    echo "$COUNTER - Success ${param[*]}"
+  else
+    let "FAIL++"
+    echo "$COUNTER - Fail ${param[*]}"
+  fi
+  rm -f s21_grep.log grep.log
+}
+
+# ------------------------------- test files -------------------------------
+awk 'BEGIN {
+  split("int char for while return lorem ipsum dolor sit amet foo bar baz", w)
+  for (i = 0; i < 40000; i++) {
+    line = ""
+    for (k = 0; k < 1 + i % 9; k++) line = line w[1 + (i * 7 + k * 13) % 13] " "
+    if (i % 97 == 0) line = line "error " i % 10 " in foo.c"
+    if (i % 131 == 0) line = line "Needle x" i
+    if (i % 53 == 0) line = line "aa.bb (x) [y] xx"
+    print line i
+  }
+}' >text.txt
+head -c 300000 /dev/zero | tr '\0' 'q' >long.txt
+echo " needle" >>long.txt
+printf 'no newline at the end foo' >nonl.txt
+awk 'BEGIN { for (i = 0; i < 300; i++) printf "word%d\n", i * 37 }' >words.txt
+printf 'foo\nipsum\nNeedle\n' >patterns.txt
+# больше двух частей по FILE_CHUNK_SIZE (8 МБ), чтобы файл делился на части
+awk 'BEGIN {
+  for (i = 0; i < 450000; i++) {
+    printf "line %d of the big file with some text to search\n", i
+    if (i % 10007 == 0) print "rare marker " i
+  }
+}' >big.txt
+
+mkdir -p tree/src/sub tree/docs tree/.hidden other
+printf 'int main() { return 0; }\nfoo\n' >tree/src/main.c
+printf 'int helper;\n' >tree/src/sub/helper.c
+printf 'foo in header\n' >tree/src/sub/helper.h
+printf 'foo bar\nint docs\n' >tree/docs/readme.txt
+printf 'foo hidden\n' >tree/.hidden/secret.c
+printf 'foo other\n' >other/linked.c
+ln -s ../other tree/link
+
+# -------------------------------- fixed strings ---------------------------
+run_test -F aa.bb text.txt
+run_test -F "(x)" text.txt
+run_test -Fi needle text.txt
+run_test -Fc foo text.txt nonl.txt
+run_test -Fv o text.txt
+run_test -Fn "[y]" text.txt
+run_test -Fo Needle text.txt
+run_test -Fl needle text.txt long.txt nonl.txt
+
+# ----------------------- many patterns (Aho-Corasick) ---------------------
+run_test -F -e foo -e bar -e baz -e lorem -e error -e Needle text.txt
+run_test -F -f words.txt text.txt
+run_test -Fc -f words.txt text.txt
+run_test -Fi -f patterns.txt text.txt
+run_test -Fv -f patterns.txt text.txt
+run_test -Fn -f patterns.txt -e amet text.txt
+run_test -Fh -e needle -e end text.txt long.txt nonl.txt
+
+# --------------------- files bigger than a read block ---------------------
+run_test -c int text.txt
+run_test -n "error 7" text.txt
+run_test -vc foo text.txt
+run_test -l needle long.txt text.txt
+run_test -c needle long.txt
+
+# ------------------------------- threads ----------------------------------
+run_test -j 4 foo text.txt long.txt nonl.txt words.txt
+run_test -j 2 -c -e int -e Needle text.txt nonl.txt
+run_test -j 3 -l amet text.txt words.txt nonl.txt no_file.txt
+run_test -j4 -n -F error text.txt nonl.txt
+
+# ------------------------ big file in chunks with -j ----------------------
+run_test -j 4 -c line big.txt
+run_test -j 4 -n marker big.txt
+run_test -j 4 -vc file big.txt
+run_test -j 4 -l "rare marker 440" big.txt text.txt
+run_test -j 4 -h -F -e "marker 1" -e "line 449999" big.txt
+run_test -c marker big.txt
+
+# ------------------------------ regexes (DFA) -----------------------------
+run_test "^int" text.txt
+run_test -c "amet [0-9]*$" text.txt
+run_test -n "a.b" text.txt
+run_test "x\{2\}" text.txt
+run_test -c "\(foo \)*bar" text.txt
+run_test "[[:digit:]]\{5\}" text.txt
+run_test -i "^[a-c]ar " text.txt
+run_test -c ".*" text.txt nonl.txt
+run_test -v "[aeiou]" text.txt
+run_test -e "^char" -e "9$" text.txt
+
+# --------------------------- literal prefilter ----------------------------
+run_test "error [0-9] in foo" text.txt
+run_test -c "foo.*bar" text.txt
+run_test -i "needle x[0-9]*1$" text.txt
+run_test -n "lorem.*Needle" text.txt
+run_test "qqqq.*needle" long.txt
+run_test -c "ipsum.*dolor.*sit" text.txt
+
+# ------------------------------ output -------------------------------------
+run_test o text.txt
+run_test -n . text.txt long.txt nonl.txt
+run_test -c foo text.txt long.txt nonl.txt words.txt
+run_test q long.txt
+run_test -h end nonl.txt text.txt
+run_test -s foo no_file.txt nonl.txt
+
+# ------------------------------ recursion ----------------------------------
+SORT=1
+run_test -r foo tree
+run_test -R foo tree
+run_test -rn int tree
+run_test -r foo tree/link
+run_test -rc foo tree
+run_test -rl foo tree
+run_test -rh foo tree
+run_test -r --include=*.c foo tree
+run_test -r --include=*.c --include=*.h foo tree
+run_test -r --exclude=*.c foo tree
+run_test -R --exclude-dir=sub foo tree
+run_test -r --exclude-dir=.hidden --include=*.c foo tree
+run_test -j 4 -R -F -e foo -e int tree
+unset SORT
+
+echo "^^^^^^^^^^^^^^^^^^^^^^^"
+echo "SUCCESS: $SUCCESS"
+echo "FAIL: $FAIL"
+echo "ALL: $COUNTER"
+echo "^^^^^^^^^^^^^^^^^^^^^^^"
+
+[ "$FAIL" -eq 0 ]